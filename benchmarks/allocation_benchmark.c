@@ -0,0 +1,290 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * allocation_benchmark.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Benchmark counts heap calls made while document with array of records is deserialized on heap and in arena.
+ * Usage: allocation_benchmark [records_count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "yajp/deserialization.h"
+#include "yajp/deserialization_routine.h"
+
+void *__real_malloc(size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_calloc(size_t count, size_t size);
+void __real_free(void *ptr);
+
+static size_t heap_calls;
+
+void *__wrap_malloc(size_t size) {
+    heap_calls++;
+    return __real_malloc(size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    heap_calls++;
+    return __real_realloc(ptr, size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    heap_calls++;
+    return __real_calloc(count, size);
+}
+
+void __wrap_free(void *ptr) {
+    __real_free(ptr);
+}
+
+typedef struct {
+    union {
+        void *elems;
+        void *rows;
+    };
+    bool final_dim;
+    size_t count;
+} array_t;
+
+typedef struct {
+    int id;
+    double score;
+} details_t;
+
+typedef struct {
+    int id;
+    char *name;
+    array_t tags;
+    details_t *details;
+} record_t;
+
+typedef struct {
+    array_t records;
+} document_t;
+
+static char *generate_document(size_t records_count, size_t *size);
+
+static int init_contexts(yajp_deserialization_context_t *document_ctx);
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end);
+
+int main(int argc, char **argv) {
+    yajp_deserialization_context_t ctx;
+    yajp_arena_t arena;
+    document_t document;
+    struct timespec start, end;
+    size_t records_count = 10000, json_size, calls, reuse_calls, allocations;
+    char *json;
+    double heap_ms, reuse_ms, arena_ms, release_ms;
+
+    if (1 < argc) {
+        records_count = strtoul(argv[1], NULL, 10);
+    }
+
+    json = generate_document(records_count, &json_size);
+    if (NULL == json || 0 != init_contexts(&ctx) || 0 != yajp_arena_init(0, &arena)) {
+        fprintf(stderr, "Failed to initialize benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    // heap
+    memset(&document, 0, sizeof(document));
+    calls = heap_calls;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (0 != yajp_deserialize_json_string(json, json_size, &ctx, &document, NULL) ||
+        records_count != document.records.count) {
+        fprintf(stderr, "Deserialization failed\n");
+        return EXIT_FAILURE;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    calls = heap_calls - calls;
+    heap_ms = elapsed_ms(&start, &end);
+
+    // heap, the same document is deserialized again into memory of previous one
+    yajp_deserialization_context_set_reuse(&ctx, true);
+    reuse_calls = heap_calls;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (0 != yajp_deserialize_json_string(json, json_size, &ctx, &document, NULL) ||
+        records_count != document.records.count) {
+        fprintf(stderr, "Deserialization failed\n");
+        return EXIT_FAILURE;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    reuse_calls = heap_calls - reuse_calls;
+    reuse_ms = elapsed_ms(&start, &end);
+    yajp_deserialization_context_set_reuse(&ctx, false);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    yajp_deserialization_free(&ctx, &document);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    release_ms = elapsed_ms(&start, &end);
+
+    printf("records: %zu, document size: %zu bytes\n", records_count, json_size);
+    printf("%-8s %16s %16s %12s %12s\n", "output", "heap calls", "arena allocs", "time, ms", "release, ms");
+    printf("%-8s %16zu %16s %12.2f %12.2f\n", "heap", calls, "-", heap_ms, release_ms);
+    printf("%-8s %16zu %16s %12.2f %12s\n", "reuse", reuse_calls, "-", reuse_ms, "-");
+
+    // arena, first run allocates blocks, second one reuses them after reset
+    for (int run = 0; run < 2; run++) {
+        memset(&document, 0, sizeof(document));
+        calls = heap_calls;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_deserialize_json_string_in_arena(json, json_size, &ctx, &document, NULL, &arena) ||
+            records_count != document.records.count) {
+            fprintf(stderr, "Deserialization failed\n");
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        calls = heap_calls - calls;
+        arena_ms = elapsed_ms(&start, &end);
+        allocations = arena.allocations;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        yajp_arena_reset(&arena);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        release_ms = elapsed_ms(&start, &end);
+
+        printf("%-8s %16zu %16zu %12.2f %12.2f\n", (0 == run) ? "arena" : "reused", calls, allocations, arena_ms,
+               release_ms);
+    }
+
+    printf("\nheap calls include transient allocations of lexer and parser, which are kept by thread after first document\n");
+
+    yajp_arena_release(&arena);
+    __real_free(json);
+
+    return EXIT_SUCCESS;
+}
+
+static char *generate_document(size_t records_count, size_t *size) {
+    static const char record[] = "{\"id\":%zu,\"name\":\"record name %zu\",\"tags\":[\"red\",\"green\",\"blue\"],"
+                                 "\"details\":{\"id\":%zu,\"score\":%zu.5}}";
+    size_t capacity = 64 + records_count * (sizeof(record) + 64), used = 0, i;
+    char *json = malloc(capacity);
+
+    if (NULL == json) {
+        return NULL;
+    }
+
+    used += sprintf(json + used, "{\"records\":[");
+    for (i = 0; i < records_count; i++) {
+        used += sprintf(json + used, record, i, i, i, i);
+        if (i + 1 < records_count) {
+            json[used++] = ',';
+        }
+    }
+    used += sprintf(json + used, "]}");
+
+    // lexer expects terminating zero to be part of input, as with sizeof() of string literal
+    *size = used + 1;
+
+    return json;
+}
+
+static int init_contexts(yajp_deserialization_context_t *document_ctx) {
+    static yajp_deserialization_rule_t details_rules[2], record_rules[4], document_rules[1];
+    static yajp_deserialization_context_t details_ctx, record_ctx;
+    int ret = 0;
+
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   details_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &details_rules[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   details_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          score
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_double
+    #define YAJP_DESERIALIZATION_RULE                       &details_rules[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+
+    ret |= yajp_deserialization_context_init(details_rules, 2, &details_ctx);
+
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &record_rules[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &record_rules[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          tags
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         char *
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+    #define YAJP_DESERIALIZATION_RULE                       &record_rules[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          details
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &details_ctx
+    #define YAJP_DESERIALIZATION_RULE                       &record_rules[3]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+
+    ret |= yajp_deserialization_context_init(record_rules, 4, &record_ctx);
+
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          records
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &record_ctx
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         record_t
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+    #define YAJP_DESERIALIZATION_RULE                       &document_rules[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+
+    ret |= yajp_deserialization_context_init(document_rules, 1, document_ctx);
+
+    return ret;
+}
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (double) (end->tv_sec - start->tv_sec) * 1e3 + (double) (end->tv_nsec - start->tv_nsec) / 1e6;
+}
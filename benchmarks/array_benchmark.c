@@ -0,0 +1,186 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * array_benchmark.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Benchmark measures deserialization of big arrays of numbers and counts reallocations of output memory.
+ * Usage: array_benchmark [max_elements_count]
+ * Arrays of 1e3, 1e4, ... elements are deserialized up to max_elements_count (1e6 by default, 1e7 at most).
+ * In "hints" mode the document is deserialized once before measurement, so context learns sizes of array and lexer buffer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "yajp/deserialization.h"
+#include "yajp/deserialization_routine.h"
+#include "test_common.h"
+
+typedef struct {
+    int *elems;
+    size_t count;
+    size_t capacity;
+    bool final_dim;
+} int_array_t;
+
+typedef struct {
+    int_array_t values;
+} document_t;
+
+static char *generate_document(size_t elements_count, size_t *size);
+
+static int init_context(int options, yajp_deserialization_rule_t *rule, yajp_deserialization_context_t *ctx);
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end);
+
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        int options;
+        bool size_hints;
+    } modes[] = {
+            { "grow", YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS, false },
+            { "shrink", YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS | YAJP_DESERIALIZATION_OPTIONS_SHRINK_TO_FIT, false },
+            { "hints", YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS, true },
+    };
+
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t rule;
+    yajp_deserialization_size_hints_t hints;
+    counting_allocator_stat_t stat;
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    document_t document;
+    struct timespec start, end;
+    size_t max_count = 1000000, count, json_size, mode;
+    char *json;
+    double ms;
+
+    if (1 < argc) {
+        max_count = strtoul(argv[1], NULL, 10);
+    }
+
+    if (10000000 < max_count) {
+        max_count = 10000000;
+    }
+
+    printf("%-8s %12s %12s %12s %14s %12s %12s\n", "mode", "elements", "capacity", "allocations", "reallocations",
+           "time, ms", "ns/element");
+
+    for (count = 1000; count <= max_count; count *= 10) {
+        json = generate_document(count, &json_size);
+        if (NULL == json) {
+            fprintf(stderr, "Failed to generate document\n");
+            return EXIT_FAILURE;
+        }
+
+        for (mode = 0; mode < sizeof(modes) / sizeof(modes[0]); mode++) {
+            if (0 != init_context(modes[mode].options, &rule, &ctx)) {
+                fprintf(stderr, "Failed to initialize benchmark\n");
+                return EXIT_FAILURE;
+            }
+
+            if (modes[mode].size_hints) {
+                if (0 != yajp_deserialization_size_hints_init(1, &hints)) {
+                    fprintf(stderr, "Failed to initialize size hints\n");
+                    return EXIT_FAILURE;
+                }
+                yajp_deserialization_context_set_size_hints(&ctx, &hints);
+
+                // warm up: first document teaches context
+                memset(&document, 0, sizeof(document));
+                if (0 != yajp_deserialize_json_string_with_allocator(json, json_size, &ctx, &document, NULL,
+                                                                     &allocator)) {
+                    fprintf(stderr, "Deserialization failed\n");
+                    return EXIT_FAILURE;
+                }
+                free(document.values.elems);
+            }
+
+            memset(&document, 0, sizeof(document));
+            memset(&stat, 0, sizeof(stat));
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            if (0 != yajp_deserialize_json_string_with_allocator(json, json_size, &ctx, &document, NULL, &allocator) ||
+                count != document.values.count) {
+                fprintf(stderr, "Deserialization failed\n");
+                return EXIT_FAILURE;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            ms = elapsed_ms(&start, &end);
+
+            printf("%-8s %12zu %12zu %12zu %14zu %12.2f %12.1f\n", modes[mode].name, count, document.values.capacity,
+                   stat.allocations, stat.reallocations, ms, ms * 1e6 / (double) count);
+
+            free(document.values.elems);
+            if (modes[mode].size_hints) {
+                yajp_deserialization_size_hints_release(&hints);
+            }
+        }
+
+        free(json);
+    }
+
+    printf("\nallocations include memory of parser and lexer, reallocations are growth of array and lexer buffer\n");
+
+    return EXIT_SUCCESS;
+}
+
+static char *generate_document(size_t elements_count, size_t *size) {
+    // every element takes at most 11 characters with comma
+    size_t capacity = 64 + elements_count * 11, used = 0, i;
+    char *json = malloc(capacity);
+
+    if (NULL == json) {
+        return NULL;
+    }
+
+    used += sprintf(json + used, "{\"values\":[");
+    for (i = 0; i < elements_count; i++) {
+        used += sprintf(json + used, (i + 1 < elements_count) ? "%zu," : "%zu", i);
+    }
+    used += sprintf(json + used, "]}");
+
+    // lexer expects terminating zero to be part of input, as with sizeof() of string literal
+    *size = used + 1;
+
+    return json;
+}
+
+static int init_context(int options, yajp_deserialization_rule_t *rule, yajp_deserialization_context_t *ctx) {
+    int ret;
+
+    // options are passed in variable, so rule is initialized by function instead of declarative API
+    ret = yajp_deserialization_rule_init("values", sizeof("values") - 1,
+                                         offsetof(document_t, values), sizeof(int_array_t),
+                                         YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER | options,
+                                         offsetof(int_array_t, count), offsetof(int_array_t, final_dim),
+                                         offsetof(int_array_t, elems), offsetof(int_array_t, elems), sizeof(int),
+                                         yajp_set_int, NULL, rule);
+
+    ret |= yajp_deserialization_rule_set_capacity_offset(rule, offsetof(int_array_t, capacity));
+    ret |= yajp_deserialization_context_init(rule, 1, ctx);
+
+    return ret;
+}
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (double) (end->tv_sec - start->tv_sec) * 1e3 + (double) (end->tv_nsec - start->tv_nsec) / 1e6;
+}
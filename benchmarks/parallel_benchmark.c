@@ -0,0 +1,259 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * parallel_benchmark.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Benchmark measures parallel deserialization of big top-level array of objects.
+ * Usage: parallel_benchmark [elements_count]
+ * Array of elements_count objects (1e6 by default) is deserialized sequentially as field of document, then by 1, 2,
+ * 4, ... threads up to amount of online processors. Result of every run is compared with sequential result, speedup is
+ * measured against it too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "yajp/parallel.h"
+#include "yajp/deserialization_routine.h"
+
+typedef struct {
+    int id;
+    double score;
+    char *name;
+} element_t;
+
+typedef struct {
+    union {
+        element_t *elems;
+        void *rows;
+    };
+    bool final_dim;
+    size_t count;
+} elements_array_t;
+
+typedef struct {
+    elements_array_t elements;
+} document_t;
+
+/**
+ * Prefix of generated document. Array of elements follows it, and document is closed by one brace
+ */
+#define DOCUMENT_PREFIX     "{\"elements\":"
+
+static char *generate_document(size_t elements_count, size_t *size);
+
+static int init_context(yajp_deserialization_rule_t *rules, yajp_deserialization_context_t *ctx);
+
+static int init_document_context(yajp_deserialization_rule_t *rules, const yajp_deserialization_context_t *element_ctx,
+                                 yajp_deserialization_context_t *ctx);
+
+static bool elements_match(const element_t *a, const element_t *b, size_t count);
+
+static void release_elements(const yajp_deserialization_context_t *ctx, element_t *elements, size_t count);
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end);
+
+int main(int argc, char **argv) {
+    yajp_deserialization_context_t ctx, document_ctx;
+    yajp_deserialization_rule_t rules[3], document_rules[1];
+    document_t document;
+    element_t *elements;
+    struct timespec start, end;
+    size_t elements_count = 1000000, json_size, array_size, count;
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    double ms, sequential_ms;
+    const char *array;
+    char *json;
+    int nthreads;
+
+    if (1 < argc) {
+        elements_count = strtoul(argv[1], NULL, 10);
+    }
+
+    json = generate_document(elements_count, &json_size);
+    if (NULL == json || 0 != init_context(rules, &ctx) || 0 != init_document_context(document_rules, &ctx,
+                                                                                     &document_ctx)) {
+        fprintf(stderr, "Failed to initialize benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    // parallel deserialization takes the same array without enclosing document
+    array = json + sizeof(DOCUMENT_PREFIX) - 1;
+    array_size = json_size - (sizeof(DOCUMENT_PREFIX) - 1) - 1;
+
+    printf("%-10s %12s %12s %12s %10s\n", "threads", "elements", "time, ms", "MB/s", "speedup");
+
+    // reference is sequential deserialization of array as field of document
+    memset(&document, 0, sizeof(document));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (0 != yajp_deserialize_json_string(json, json_size + 1, &document_ctx, &document, NULL) ||
+        elements_count != document.elements.count) {
+        fprintf(stderr, "Sequential deserialization failed\n");
+        return EXIT_FAILURE;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sequential_ms = elapsed_ms(&start, &end);
+
+    printf("%-10s %12zu %12.2f %12.1f %10.2f\n", "sequential", document.elements.count, sequential_ms,
+           (double) json_size / 1e3 / sequential_ms, 1.0);
+
+    for (nthreads = 1; nthreads <= online || 1 == nthreads; nthreads *= 2) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_deserialize_array_parallel(array, array_size, &ctx, sizeof(element_t), (void **) &elements,
+                                                 &count, NULL, nthreads) || elements_count != count) {
+            fprintf(stderr, "Deserialization failed\n");
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ms = elapsed_ms(&start, &end);
+
+        if (!elements_match(document.elements.elems, elements, count)) {
+            fprintf(stderr, "Result of %d threads differs from sequential result\n", nthreads);
+            return EXIT_FAILURE;
+        }
+        release_elements(&ctx, elements, count);
+
+        printf("%-10d %12zu %12.2f %12.1f %10.2f\n", nthreads, count, ms, (double) array_size / 1e3 / ms,
+               sequential_ms / ms);
+    }
+
+    yajp_deserialization_free(&document_ctx, &document);
+    free(json);
+
+    return EXIT_SUCCESS;
+}
+
+static char *generate_document(size_t elements_count, size_t *size) {
+    // every element takes at most 96 characters with comma
+    size_t capacity = 64 + elements_count * 96, used = 0, i;
+    char *json = malloc(capacity);
+
+    if (NULL == json) {
+        return NULL;
+    }
+
+    used += sprintf(json + used, DOCUMENT_PREFIX "[");
+    for (i = 0; i < elements_count; i++) {
+        used += sprintf(json + used, "{\"id\":%zu,\"score\":%zu.%02zu,\"name\":\"element number %zu\"}%s", i, i % 1000,
+                        i % 100, i, (i + 1 < elements_count) ? "," : "");
+    }
+    used += sprintf(json + used, "]}");
+
+    *size = used;
+
+    return json;
+}
+
+static int init_context(yajp_deserialization_rule_t *rules, yajp_deserialization_context_t *ctx) {
+    int ret;
+
+    // declare rules for element_t.id
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   element_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &rules[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+
+    // declare rules for element_t.score
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   element_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          score
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_double
+    #define YAJP_DESERIALIZATION_RULE                       &rules[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+
+    // declare rules for element_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   element_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &rules[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+
+    return yajp_deserialization_context_init(rules, 3, ctx);
+}
+
+static int init_document_context(yajp_deserialization_rule_t *rules, const yajp_deserialization_context_t *element_ctx,
+                                 yajp_deserialization_context_t *ctx) {
+    int ret;
+
+    // declare rules for document_t.elements
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          elements
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             element_ctx
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         element_t
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+    #define YAJP_DESERIALIZATION_RULE                       &rules[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+
+    return yajp_deserialization_context_init(rules, 1, ctx);
+}
+
+static bool elements_match(const element_t *a, const element_t *b, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        if (a[i].id != b[i].id || a[i].score != b[i].score || 0 != strcmp(a[i].name, b[i].name)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void release_elements(const yajp_deserialization_context_t *ctx, element_t *elements, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        yajp_deserialization_free(ctx, &elements[i]);
+    }
+
+    // context has no allocator, so array is allocated on heap
+    free(elements);
+}
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (double) (end->tv_sec - start->tv_sec) * 1e3 + (double) (end->tv_nsec - start->tv_nsec) / 1e6;
+}
@@ -0,0 +1,300 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * serialization_benchmark.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Benchmark compares throughput of serialization with throughput of deserialization of the same document.
+ * Usage: serialization_benchmark [records_count]
+ * Document is array of records_count records (100000 by default), every record holds integer, real number, string and
+ * array of integers. Every direction is measured 5 times and the best time is taken. Serialization is measured also in
+ * exact size mode, where document is measured before it's written into string allocated at once.
+ * Serialization of strings without characters to escape is compared with memcpy() of the same amount of bytes: document
+ * of records_count / 64 records with names of 4 KiB. The same document is serialized into chain, what references names
+ * instead of copying them, and in exact size mode.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "yajp/deserialization.h"
+#include "yajp/deserialization_routine.h"
+#include "yajp/serialization.h"
+
+#define ROUNDS          5
+#define LONG_NAME_SIZE  4096
+
+typedef struct {
+    int *elems;
+    size_t count;
+    bool final_dim;
+} int_array_t;
+
+typedef struct {
+    int id;
+    double price;
+    char *name;
+    int_array_t sizes;
+} record_t;
+
+typedef struct {
+    record_t *elems;
+    size_t count;
+    bool final_dim;
+} record_array_t;
+
+typedef struct {
+    record_array_t records;
+} document_t;
+
+typedef struct {
+    yajp_deserialization_rule_t record_rules[4];
+    yajp_deserialization_rule_t document_rules[1];
+    yajp_deserialization_context_t record;
+    yajp_deserialization_context_t document;
+} contexts_t;
+
+static char *generate_document(size_t records_count, size_t *size);
+
+static int init_contexts(contexts_t *contexts);
+
+static int measure_strings(contexts_t *contexts, size_t records_count);
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end);
+
+int main(int argc, char **argv) {
+    contexts_t contexts;
+    document_t document;
+    struct timespec start, end;
+    size_t records_count = 100000, json_size, output_size = 0, round;
+    double deserialization_ms = 0, serialization_ms = 0, exact_ms = 0, ms;
+    char *json, *output;
+
+    if (1 < argc) {
+        records_count = strtoul(argv[1], NULL, 10);
+    }
+
+    json = generate_document(records_count, &json_size);
+    if (NULL == json || 0 != init_contexts(&contexts)) {
+        fprintf(stderr, "Failed to initialize benchmark\n");
+        return EXIT_FAILURE;
+    }
+
+    for (round = 0; round < ROUNDS; round++) {
+        memset(&document, 0, sizeof(document));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_deserialize_json_string(json, json_size, &contexts.document, &document, NULL)) {
+            fprintf(stderr, "Deserialization failed\n");
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ms = elapsed_ms(&start, &end);
+        deserialization_ms = (0 == round || ms < deserialization_ms) ? ms : deserialization_ms;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_serialize_json_buffer(&contexts.document, &document, &output, &output_size)) {
+            fprintf(stderr, "Serialization failed\n");
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ms = elapsed_ms(&start, &end);
+        serialization_ms = (0 == round || ms < serialization_ms) ? ms : serialization_ms;
+        free(output);
+
+        yajp_serialization_context_set_exact_size(&contexts.document, true);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_serialize_json_buffer(&contexts.document, &document, &output, &output_size)) {
+            fprintf(stderr, "Serialization of exact size failed\n");
+            return EXIT_FAILURE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        yajp_serialization_context_set_exact_size(&contexts.document, false);
+        ms = elapsed_ms(&start, &end);
+        exact_ms = (0 == round || ms < exact_ms) ? ms : exact_ms;
+
+        free(output);
+        yajp_deserialization_free(&contexts.document, &document);
+    }
+
+    printf("%-16s %12s %12s %12s\n", "direction", "size, bytes", "time, ms", "MB/s");
+    printf("%-16s %12zu %12.2f %12.1f\n", "deserialization", json_size, deserialization_ms,
+           (double) json_size / deserialization_ms / 1e3);
+    printf("%-16s %12zu %12.2f %12.1f\n", "serialization", output_size, serialization_ms,
+           (double) output_size / serialization_ms / 1e3);
+    printf("%-16s %12zu %12.2f %12.1f\n", "exact size", output_size, exact_ms, (double) output_size / exact_ms / 1e3);
+
+    free(json);
+
+    if (0 != measure_strings(&contexts, records_count)) {
+        fprintf(stderr, "Serialization of strings failed\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int measure_strings(contexts_t *contexts, size_t records_count) {
+    // copy isn't read, call through volatile pointer keeps it from being optimized out
+    static void *(*volatile copy_memory)(void *, const void *, size_t) = memcpy;
+    document_t document;
+    yajp_serialization_chain_t chain;
+    struct timespec start, end;
+    size_t output_size = 0, round, i;
+    double serialization_ms = 0, memcpy_ms = 0, chain_ms = 0, exact_ms = 0, ms;
+    char *name, *output, *copy;
+
+    document.records.count = (64 > records_count) ? 1 : records_count / 64;
+    document.records.final_dim = true;
+    document.records.elems = calloc(document.records.count, sizeof(record_t));
+    name = malloc(LONG_NAME_SIZE + 1);
+    if (NULL == document.records.elems || NULL == name) {
+        return -1;
+    }
+
+    for (i = 0; i < LONG_NAME_SIZE; i++) {
+        name[i] = (char) ('a' + i % 26);
+    }
+    name[LONG_NAME_SIZE] = '\0';
+
+    for (i = 0; i < document.records.count; i++) {
+        document.records.elems[i].id = (int) i;
+        document.records.elems[i].name = name;
+        document.records.elems[i].sizes.final_dim = true;
+    }
+
+    for (round = 0; round < ROUNDS; round++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_serialize_json_buffer(&contexts->document, &document, &output, &output_size)) {
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ms = elapsed_ms(&start, &end);
+        serialization_ms = (0 == round || ms < serialization_ms) ? ms : serialization_ms;
+
+        // copy of document is written into memory what wasn't touched yet, as buffer of serialization
+        copy = malloc(output_size);
+        if (NULL == copy) {
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        copy_memory(copy, output, output_size);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ms = elapsed_ms(&start, &end);
+        memcpy_ms = (0 == round || ms < memcpy_ms) ? ms : memcpy_ms;
+
+        free(copy);
+        free(output);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_serialize_json_chain(&contexts->document, &document, YAJP_SERIALIZATION_DEFAULT_REFERENCE_SIZE,
+                                           &chain)) {
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        ms = elapsed_ms(&start, &end);
+        chain_ms = (0 == round || ms < chain_ms) ? ms : chain_ms;
+
+        yajp_serialization_chain_release(&chain);
+
+        yajp_serialization_context_set_exact_size(&contexts->document, true);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (0 != yajp_serialize_json_buffer(&contexts->document, &document, &output, &output_size)) {
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        yajp_serialization_context_set_exact_size(&contexts->document, false);
+        ms = elapsed_ms(&start, &end);
+        exact_ms = (0 == round || ms < exact_ms) ? ms : exact_ms;
+
+        free(output);
+    }
+
+    printf("%-16s %12zu %12.2f %12.1f\n", "strings", output_size, serialization_ms,
+           (double) output_size / serialization_ms / 1e3);
+    printf("%-16s %12zu %12.2f %12.1f\n", "memcpy", output_size, memcpy_ms, (double) output_size / memcpy_ms / 1e3);
+    printf("%-16s %12zu %12.2f %12.1f\n", "strings, chain", output_size, chain_ms,
+           (double) output_size / chain_ms / 1e3);
+    printf("%-16s %12zu %12.2f %12.1f\n", "strings, exact", output_size, exact_ms,
+           (double) output_size / exact_ms / 1e3);
+
+    free(name);
+    free(document.records.elems);
+
+    return 0;
+}
+
+static char *generate_document(size_t records_count, size_t *size) {
+    // every record takes at most 128 characters with comma
+    size_t capacity = 64 + records_count * 128, used = 0, i;
+    char *json = malloc(capacity);
+
+    if (NULL == json) {
+        return NULL;
+    }
+
+    used += sprintf(json + used, "{\"records\":[");
+    for (i = 0; i < records_count; i++) {
+        used += sprintf(json + used, "{\"id\":%zu,\"price\":%.2f,\"name\":\"record number %zu\",\"sizes\":[%zu,%zu,%zu]}%s",
+                        i, (double) (i % 100000) * 0.37, i, i % 7, i % 13, i % 101, (i + 1 < records_count) ? "," : "");
+    }
+    used += sprintf(json + used, "]}");
+
+    // lexer expects terminating zero to be part of input, as with sizeof() of string literal
+    *size = used + 1;
+
+    return json;
+}
+
+static int init_contexts(contexts_t *contexts) {
+    int ret;
+
+    ret = yajp_deserialization_rule_init("id", sizeof("id") - 1, offsetof(record_t, id), sizeof(int),
+                                         YAJP_DESERIALIZATION_TYPE_NUMBER, 0, 0, 0, 0, 0, yajp_set_int, NULL,
+                                         &contexts->record_rules[0]);
+    ret |= yajp_deserialization_rule_init("price", sizeof("price") - 1, offsetof(record_t, price), sizeof(double),
+                                          YAJP_DESERIALIZATION_TYPE_NUMBER, 0, 0, 0, 0, 0, yajp_set_double, NULL,
+                                          &contexts->record_rules[1]);
+    ret |= yajp_deserialization_rule_init("name", sizeof("name") - 1, offsetof(record_t, name), sizeof(char *),
+                                          YAJP_DESERIALIZATION_TYPE_STRING | YAJP_DESERIALIZATION_OPTIONS_ALLOCATE,
+                                          0, 0, 0, 0, sizeof(char), yajp_set_string, NULL, &contexts->record_rules[2]);
+    ret |= yajp_deserialization_rule_init("sizes", sizeof("sizes") - 1, offsetof(record_t, sizes), sizeof(int_array_t),
+                                          YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER |
+                                          YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS,
+                                          offsetof(int_array_t, count), offsetof(int_array_t, final_dim),
+                                          offsetof(int_array_t, elems), offsetof(int_array_t, elems), sizeof(int),
+                                          yajp_set_int, NULL, &contexts->record_rules[3]);
+    ret |= yajp_deserialization_context_init(contexts->record_rules, 4, &contexts->record);
+
+    ret |= yajp_deserialization_rule_init("records", sizeof("records") - 1, offsetof(document_t, records),
+                                          sizeof(record_array_t),
+                                          YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT |
+                                          YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS,
+                                          offsetof(record_array_t, count), offsetof(record_array_t, final_dim),
+                                          offsetof(record_array_t, elems), offsetof(record_array_t, elems),
+                                          sizeof(record_t), NULL, &contexts->record, &contexts->document_rules[0]);
+    ret |= yajp_deserialization_context_init(contexts->document_rules, 1, &contexts->document);
+
+    return ret;
+}
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (double) (end->tv_sec - start->tv_sec) * 1e3 + (double) (end->tv_nsec - start->tv_nsec) / 1e6;
+}
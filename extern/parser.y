@@ -18,6 +18,12 @@
 // fourth argument for yajp_parser_parse function
 %extra_argument { yajp_parser_recognized_entity_t *entity }
 
+// stack is sized at runtime, see yajp_parser_init_with_stack()
+%stack_size 0
+
+// overflow is reported as recognized entity, so caller can stop parsing
+%stack_overflow { entity->type = YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_OVERFLOW; }
+
 %start_symbol start
 
 start 	    ::= obj.
@@ -24,6 +24,7 @@
 */
 #include <stdio.h>
 #include <assert.h>
+#include <limits.h>
 /************ Begin %include sections from the grammar ************************/
 %%
 /**************** End of %include directives **********************************/
@@ -65,6 +66,9 @@
 **                       for terminal symbols is called "yy0".
 **    YYSTACKDEPTH       is the maximum depth of the parser's stack.  If
 **                       zero the stack is dynamically sized using realloc()
+**                       of the allocator passed to Parse_init_with_stack()
+**    YYSTACKINLINE      is the number of stack entries embedded into the
+**                       parser structure when the stack is dynamically sized
 **    ParseARG_SDECL     A static variable declaration for the %extra_argument
 **    ParseARG_PDECL     A parameter declaration for the %extra_argument
 **    ParseARG_PARAM     Code to pass %extra_argument as a subroutine parameter
@@ -91,6 +95,9 @@
 /************* Begin control #defines *****************************************/
 %%
 /************* End control #defines *******************************************/
+#ifndef YYSTACKINLINE
+# define YYSTACKINLINE 16
+#endif
 #define YY_NLOOKAHEAD ((int)(sizeof(yy_lookahead)/sizeof(yy_lookahead[0])))
 
 /* Define the yytestcase() macro to be a no-op if is not already defined
@@ -218,8 +225,10 @@ struct yyParser {
   ParseCTX_SDECL                /* A place to hold %extra_context */
 #if YYSTACKDEPTH<=0
   int yystksz;                  /* Current side of the stack */
+  int yystkmax;                 /* Maximal size of the stack */
+  const yajp_allocator_t *yyallocator;  /* Allocator of the stack memory */
   yyStackEntry *yystack;        /* The parser's stack */
-  yyStackEntry yystk0;          /* First stack entry */
+  yyStackEntry yystk0[YYSTACKINLINE];  /* Embedded stack, used until it is full */
 #else
   yyStackEntry yystack[YYSTACKDEPTH];  /* The parser's stack */
   yyStackEntry *yystackEnd;            /* Last entry in the stack */
@@ -278,21 +287,26 @@ static const char *const yyRuleName[] = {
 
 #if YYSTACKDEPTH<=0
 /*
-** Try to increase the size of the parser stack.  Return the number
-** of errors.  Return 0 on success.
+** Try to increase the size of the parser stack up to newSize entries.
+** Return the number of errors.  Return 0 on success.
 */
-static int yyGrowStack(yyParser *p){
-  int newSize;
+static int yyResizeStack(yyParser *p, int newSize){
   int idx;
+  int i;
   yyStackEntry *pNew;
+  const yajp_allocator_t *allocator = p->yyallocator;
 
-  newSize = p->yystksz*2 + 100;
+  if( newSize<=p->yystksz ) return 0;
   idx = p->yytos ? (int)(p->yytos - p->yystack) : 0;
-  if( p->yystack==&p->yystk0 ){
-    pNew = malloc(newSize*sizeof(pNew[0]));
-    if( pNew ) pNew[0] = p->yystk0;
+  if( p->yystack==p->yystk0 ){
+    pNew = allocator->realloc(NULL, 0, (size_t)newSize*sizeof(pNew[0]),
+                              allocator->user);
+    if( pNew ){
+      for(i=0; i<p->yystksz; i++) pNew[i] = p->yystk0[i];
+    }
   }else{
-    pNew = realloc(p->yystack, newSize*sizeof(pNew[0]));
+    pNew = allocator->realloc(p->yystack, (size_t)p->yystksz*sizeof(pNew[0]),
+                              (size_t)newSize*sizeof(pNew[0]), allocator->user);
   }
   if( pNew ){
     p->yystack = pNew;
@@ -307,6 +321,16 @@ static int yyGrowStack(yyParser *p){
   }
   return pNew==0; 
 }
+
+/*
+** Try to increase the size of the parser stack twice, but not above the
+** maximal size.  Return the number of errors.  Return 0 on success.
+*/
+static int yyGrowStack(yyParser *p){
+  if( p->yystksz>=p->yystkmax ) return 1;
+  if( p->yystksz>p->yystkmax/2 ) return yyResizeStack(p, p->yystkmax);
+  return yyResizeStack(p, p->yystksz*2);
+}
 #endif
 
 /* Datatype of the argument to the memory allocated passed as the
@@ -318,22 +342,55 @@ static int yyGrowStack(yyParser *p){
 # define YYMALLOCARGTYPE size_t
 #endif
 
+static void yy_pop_parser_stack(yyParser *pParser);
+
 /* Initialize a new parser that has already been allocated.
 */
 void Parse_init(void *yypRawParser ParseCTX_PDECL){
+  Parse_init_with_stack(yypRawParser, NULL, 0, 0 ParseCTX_PARAM);
+}
+
+/* Initialize a new parser that has already been allocated.  The stack
+** memory is taken from allocator (heap when NULL).  The stack is presized
+** for stackSize entries and never grows above maxStackSize entries (no
+** limit when zero).  Both sizes are ignored when YYSTACKDEPTH>0.
+*/
+void Parse_init_with_stack(
+  void *yypRawParser,                  /* The parser */
+  const yajp_allocator_t *allocator,   /* Allocator of the stack */
+  int stackSize,                       /* Initial size of the stack */
+  int maxStackSize                     /* Maximal size of the stack */
+  ParseCTX_PDECL
+){
   yyParser *yypParser = (yyParser*)yypRawParser;
   ParseCTX_STORE
-#ifdef YYTRACKMAXSTACKDEPTH
-  yypParser->yyhwm = 0;
-#endif
 #if YYSTACKDEPTH<=0
+  yypParser->yyallocator = allocator ? allocator : &yajp_heap_allocator;
+  yypParser->yystkmax = maxStackSize>0 ? maxStackSize : INT_MAX;
   yypParser->yytos = NULL;
-  yypParser->yystack = NULL;
-  yypParser->yystksz = 0;
-  if( yyGrowStack(yypParser) ){
-    yypParser->yystack = &yypParser->yystk0;
-    yypParser->yystksz = 1;
-  }
+  yypParser->yystack = yypParser->yystk0;
+  yypParser->yystksz = YYSTACKINLINE<yypParser->yystkmax
+                       ? YYSTACKINLINE : yypParser->yystkmax;
+  if( stackSize>yypParser->yystkmax ) stackSize = yypParser->yystkmax;
+  /* On failure the stack stays embedded and grows on demand */
+  (void)yyResizeStack(yypParser, stackSize);
+#else
+  (void)allocator;
+  (void)stackSize;
+  (void)maxStackSize;
+#endif
+  yypParser->yytos = yypParser->yystack;
+  Parse_reset(yypParser);
+}
+
+/* Return a parser to the initial state, so it can parse next input.  The
+** grown stack is kept.
+*/
+void Parse_reset(void *yypRawParser){
+  yyParser *yypParser = (yyParser*)yypRawParser;
+  while( yypParser->yytos>yypParser->yystack ) yy_pop_parser_stack(yypParser);
+#ifdef YYTRACKMAXSTACKDEPTH
+  yypParser->yyhwm = 0;
 #endif
 #ifndef YYNOERRORRECOVERY
   yypParser->yyerrcnt = -1;
@@ -346,6 +403,38 @@ void Parse_init(void *yypRawParser ParseCTX_PDECL){
 #endif
 }
 
+/* Change sizes of the stack of a parser what has been reset, so it can
+** parse next input with other limits.  The grown stack is kept while it
+** fits into maxStackSize entries.  Both sizes are ignored when
+** YYSTACKDEPTH>0.
+*/
+void Parse_resize_stack(void *yypRawParser, int stackSize, int maxStackSize){
+#if YYSTACKDEPTH<=0
+  yyParser *yypParser = (yyParser*)yypRawParser;
+  int maxSize = maxStackSize>0 ? maxStackSize : INT_MAX;
+  if( yypParser->yystksz>maxSize && yypParser->yystack!=yypParser->yystk0 ){
+    yypParser->yyallocator->free(yypParser->yystack,
+                                 yypParser->yyallocator->user);
+    yypParser->yystack = yypParser->yystk0;
+  }
+  if( yypParser->yystack==yypParser->yystk0 ){
+    yypParser->yystksz = YYSTACKINLINE<maxSize ? YYSTACKINLINE : maxSize;
+  }
+  yypParser->yystkmax = maxSize;
+  yypParser->yytos = yypParser->yystack;
+  if( stackSize>maxSize ) stackSize = maxSize;
+  /* On failure the stack stays as is and grows on demand */
+  (void)yyResizeStack(yypParser, stackSize);
+  yypParser->yytos = yypParser->yystack;
+  yypParser->yystack[0].stateno = 0;
+  yypParser->yystack[0].major = 0;
+#else
+  (void)yypRawParser;
+  (void)stackSize;
+  (void)maxStackSize;
+#endif
+}
+
 #ifndef Parse_ENGINEALWAYSONSTACK
 /* 
 ** This function allocates a new parser.
@@ -370,6 +459,14 @@ void *Parse_allocate(void *(*mallocProc)(YYMALLOCARGTYPE) ParseCTX_PDECL){
 }
 #endif /* Parse_ENGINEALWAYSONSTACK */
 
+/*
+** Return size of parser structure. It's used to allocate parser
+** with custom allocator and initialize it with Parse_init().
+*/
+size_t Parse_size(void){
+  return sizeof(yyParser);
+}
+
 
 /* The following function deletes the "minor type" or semantic value
 ** associated with a symbol.  The symbol can be either a terminal
@@ -431,7 +528,13 @@ void Parse_finalize(void *p){
   yyParser *pParser = (yyParser*)p;
   while( pParser->yytos>pParser->yystack ) yy_pop_parser_stack(pParser);
 #if YYSTACKDEPTH<=0
-  if( pParser->yystack!=&pParser->yystk0 ) free(pParser->yystack);
+  if( pParser->yystack!=pParser->yystk0 ){
+    pParser->yyallocator->free(pParser->yystack, pParser->yyallocator->user);
+    pParser->yystack = pParser->yystk0;
+    pParser->yytos = pParser->yystack;
+    pParser->yystksz = YYSTACKINLINE<pParser->yystkmax
+                       ? YYSTACKINLINE : pParser->yystkmax;
+  }
 #endif
 }
 
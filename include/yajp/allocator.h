@@ -0,0 +1,61 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * allocator.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_ALLOCATOR_H
+#define YAJP_ALLOCATOR_H
+
+#include <stddef.h>
+
+#include <yajp/arena.h>
+
+/**
+ * Allocator used by library for memory of lexer, parser and deserialized output.
+ *
+ * Every function receives @c user pointer of allocator, so allocator can be bound to arena, pool or any other memory
+ * source. Functions should set errno and return NULL on error, like standard ones.
+ *
+ * @note    Library passes to @c realloc only NULL or pointers returned by previous @c realloc, and passes to @c free
+ *          pointers returned by both @c alloc and @c realloc. So allocator can keep bookkeeping only for resizable
+ *          memory.
+ */
+typedef struct yajp_allocator {
+    void *(*alloc)(size_t size, void *user);                                    // allocate memory
+    void *(*realloc)(void *ptr, size_t old_size, size_t new_size, void *user);  // allocate or resize memory
+    void (*free)(void *ptr, void *user);                                        // release memory
+    void *user;                                                                 // passed to all functions above
+} yajp_allocator_t;
+
+/**
+ * Allocator backed by malloc(), realloc() and free(). Used when no other allocator is specified
+ */
+extern const yajp_allocator_t yajp_heap_allocator;
+
+/**
+ * Initialize allocator which allocates memory from arena. @c free of such allocator does nothing, memory is released
+ * with arena.
+ *
+ * @param[in]   arena   Pointer to arena. Should outlive allocator
+ * @param[out]  result  Pointer to initializing allocator
+ * @return      Result of allocator initialization. 0 - on success
+ */
+int yajp_arena_allocator_init(yajp_arena_t *arena, yajp_allocator_t *result);
+
+#endif //YAJP_ALLOCATOR_H
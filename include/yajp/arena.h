@@ -0,0 +1,100 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * arena.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_ARENA_H
+#define YAJP_ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Default size of arena block in bytes
+ */
+#define YAJP_ARENA_DEFAULT_BLOCK_SIZE   (64 * 1024)
+
+typedef struct yajp_arena_block yajp_arena_block_t;
+
+/**
+ * Arena (bump allocator) used to allocate deserialized output. Memory is carved from chain of blocks and released at
+ * once with @c yajp_arena_reset() or @c yajp_arena_release(). Should be initialized with @c yajp_arena_init()
+ */
+typedef struct yajp_arena {
+    size_t block_size;                  // minimal size of block
+    yajp_arena_block_t *first;          // first block of chain
+    yajp_arena_block_t *current;        // block used for allocations
+    void *last_allocation;              // last allocation. Can be grown in place
+    size_t allocations;                 // number of allocations since last reset
+    size_t blocks_allocations;          // number of blocks allocated on heap since arena initialization
+} yajp_arena_t;
+
+/**
+ * Initialize arena.
+ *
+ * @param[in]   block_size  Minimal size of block in bytes. If 0, @c YAJP_ARENA_DEFAULT_BLOCK_SIZE is used
+ * @param[out]  arena       Pointer to initializing arena
+ * @return      Result of arena initialization. 0 - on success
+ *
+ * @note    Blocks are allocated on first use, so initialization doesn't allocate memory
+ */
+int yajp_arena_init(size_t block_size, yajp_arena_t *arena);
+
+/**
+ * Allocate memory from arena.
+ *
+ * @param[in]   arena   Pointer to arena
+ * @param[in]   size    Size of memory in bytes
+ * @return      Pointer to memory aligned for any type or NULL on error
+ */
+void *yajp_arena_alloc(yajp_arena_t *arena, size_t size);
+
+/**
+ * Allocate or change size of resizable memory allocated from arena.
+ *
+ * @param[in]   arena       Pointer to arena
+ * @param[in]   ptr         Pointer to memory returned by @c yajp_arena_realloc() or NULL to allocate new memory
+ * @param[in]   old_size    Size of memory pointed by @c ptr in bytes
+ * @param[in]   new_size    New size of memory in bytes
+ * @return      Pointer to memory or NULL on error. On error memory pointed by @c ptr is not changed
+ *
+ * @note    Resizable memory keeps its capacity in front of it, so pointers returned by @c yajp_arena_alloc() can't be
+ *          passed as @c ptr.
+ * @note    Last allocation is grown in place if block has enough space. Otherwise memory is moved to allocation with
+ *          at least twice larger capacity and old memory is wasted till arena reset. So growing array element by
+ *          element costs amortized constant time and memory per element.
+ */
+void *yajp_arena_realloc(yajp_arena_t *arena, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * Release all memory allocated from arena. Blocks are kept for future allocations.
+ *
+ * @param[in]   arena   Pointer to arena
+ *
+ * @note    All pointers returned by arena become invalid
+ */
+void yajp_arena_reset(yajp_arena_t *arena);
+
+/**
+ * Release arena and all its blocks
+ *
+ * @param[in]   arena   Pointer to arena
+ */
+void yajp_arena_release(yajp_arena_t *arena);
+
+#endif //YAJP_ARENA_H
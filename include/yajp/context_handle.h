@@ -0,0 +1,100 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * context_handle.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_CONTEXT_HANDLE_H
+#define YAJP_CONTEXT_HANDLE_H
+
+#include <stdbool.h>
+
+#include <yajp/deserialization.h>
+
+/**
+ * Handle of replaceable deserialization context, i.e. of field mappings reloaded at runtime. Threads take current
+ * version of context for deserialization without locks, while other thread swaps it with new version. Swap returns old
+ * version only when no thread uses it, so it can be released at once. Should be initialized with
+ * @c yajp_context_handle_init()
+ */
+typedef struct yajp_context_handle {
+    const yajp_deserialization_context_t *current;  // current version of context
+    unsigned long readers[2];                       // amount of references taken in even and odd epochs
+    unsigned long epoch;                            // epoch of new references. Is advanced by swap
+    bool swapping;                                  // swap is in progress. Serializes swaps
+} yajp_context_handle_t;
+
+/**
+ * Reference to version of context taken from handle
+ */
+typedef struct yajp_context_ref {
+    const yajp_deserialization_context_t *ctx;      // version of context
+    unsigned long slot;                             // counter of readers the reference is counted by
+} yajp_context_ref_t;
+
+/**
+ * Initialize handle of context.
+ *
+ * @param[in]   ctx     Pointer to initialized deserialization context, the first version
+ * @param[out]  handle  Pointer to initializing handle
+ * @return      Result of handle initialization. 0 - on success, -1 with errno set to EINVAL if @p ctx is NULL
+ *
+ * @note    Handle doesn't own contexts and doesn't allocate memory, so it has no release function. The last version
+ *          is released by owner after all threads stopped to use handle.
+ */
+int yajp_context_handle_init(const yajp_deserialization_context_t *ctx, yajp_context_handle_t *handle);
+
+/**
+ * Take reference to current version of context. Doesn't lock and doesn't wait.
+ *
+ * @param[in]   handle  Pointer to handle
+ * @param[out]  ref     Pointer to receive reference
+ * @return      Current version of context, the same as @c ref->ctx
+ *
+ * @note    Version is alive until reference is released, so reference should be held while deserialized structures
+ *          are released with @c yajp_deserialization_free(), which walks rules of the same version.
+ * @note    Swap waits for all references taken before it, so references should be short, i.e. for one document.
+ */
+const yajp_deserialization_context_t *yajp_context_handle_acquire(yajp_context_handle_t *handle,
+                                                                  yajp_context_ref_t *ref);
+
+/**
+ * Release reference taken by @c yajp_context_handle_acquire().
+ *
+ * @param[in]   handle  Pointer to handle
+ * @param[in]   ref     Pointer to reference
+ */
+void yajp_context_handle_release(yajp_context_handle_t *handle, const yajp_context_ref_t *ref);
+
+/**
+ * Replace current version of context. New references get new version at once, old version is returned after all
+ * references to it are released, i.e. after documents being deserialized with it are done.
+ *
+ * @param[in]   handle  Pointer to handle
+ * @param[in]   ctx     Pointer to initialized deserialization context, the new version
+ * @return      Old version of context, which isn't used by any thread anymore and can be released with
+ *              @c yajp_deserialization_context_release() together with its rules and contexts bound to them. NULL with
+ *              errno set to EINVAL if @p ctx is NULL
+ *
+ * @note    Swap blocks calling thread until old version is unused. Concurrent swaps are done one by one.
+ * @note    Calling thread must not hold reference of the same handle, otherwise swap never returns.
+ */
+const yajp_deserialization_context_t *yajp_context_handle_swap(yajp_context_handle_t *handle,
+                                                               const yajp_deserialization_context_t *ctx);
+
+#endif //YAJP_CONTEXT_HANDLE_H
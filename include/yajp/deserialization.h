@@ -26,6 +26,9 @@
 #include <stdbool.h>
 #include <limits.h>
 
+#include <yajp/arena.h>
+#include <yajp/allocator.h>
+
 /**
  * @details     @c YAJP_DESERIALIZATION_FIELD_TYPE declaration value used to specify that deserializing type is number (integral or real)
  */
@@ -68,6 +71,33 @@
  *          YAJP what memory for elements should be allocated on heap. Ignored otherwise
  */
 #define YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS  0b10000000
+/**
+ * @details Deserialization option. Tells YAJP what string should be stored in place, into array of characters, with
+ *          bounds check. Value what doesn't fit into array together with '\0' is treated as deserialization error.
+ *
+ * @note    Field in structure (or element of array) must be represented as array of characters. Capacity of array is
+ *          taken from @c sizeof of field (or element). Can't be combined with @c YAJP_DESERIALIZATION_OPTIONS_ALLOCATE
+ *          and @c YAJP_DESERIALIZATION_TYPE_NULLABLE
+ */
+#define YAJP_DESERIALIZATION_OPTIONS_INLINE             0b100000000
+/**
+ * @details Same as @c YAJP_DESERIALIZATION_OPTIONS_INLINE, but value what doesn't fit into array is truncated instead
+ *          of error. Value is truncated by boundary of UTF-8 character or escape sequence.
+ */
+#define YAJP_DESERIALIZATION_OPTIONS_TRUNCATE           0b1000000000
+/**
+ * @details In case if @c YAJP_DESERIALIZATION_FIELD_TYPE contains @c YAJP_DESERIALIZATION_TYPE_ARRAY_OF tells YAJP
+ *          what memory of elements and rows should be shrunk to their amount when array is deserialized. Ignored
+ *          otherwise
+ *
+ * @note    Memory of arrays grows geometrically, so without this option up to half of it can be unused
+ */
+#define YAJP_DESERIALIZATION_OPTIONS_SHRINK_TO_FIT      0b10000000000
+
+/**
+ * Maximal nesting depth of objects and arrays of document accepted by context by default
+ */
+#define YAJP_DESERIALIZATION_DEFAULT_MAX_DEPTH          1024
 
 /**
  *  Prototype of function used to convert string value into structure field type
@@ -93,11 +123,32 @@ struct yajp_deserialization_rule;
 typedef struct yajp_deserialization_context yajp_deserialization_context_t;
 typedef struct yajp_deserialization_rule yajp_deserialization_rule_t;
 
+/**
+ * Sizes learned from previous documents by size hints mode. Owned by caller and should be initialized with
+ * @c yajp_deserialization_size_hints_init()
+ */
+typedef struct yajp_deserialization_size_hints {
+    size_t buffer_size;                 // moving maximum of lexer buffer size
+    size_t slots_mask;                  // number of slots - 1
+    void *slots;                        // moving maximums of amount of rows and elements, keyed by array rule
+} yajp_deserialization_size_hints_t;
+
 /**
  * Deserialization context
  */
 struct yajp_deserialization_context {
    const void *rules;
+   const yajp_deserialization_rule_t *rules_list;   // rules passed to context initialization, walked on release
+   size_t rules_count;                              // number of rules in rules_list
+   const yajp_allocator_t *allocator;               // allocator of deserialization with this context or NULL for heap
+   bool reuse;                                      // deserialization reuses memory of previously deserialized values
+   yajp_deserialization_size_hints_t *size_hints;   // sizes learned from previous documents. NULL - not learned
+   size_t max_depth;                                // maximal nesting depth of objects and arrays of document
+   size_t stack_depth;                              // nesting depth parser stack is allocated for at once
+   size_t read_ahead;                               // size of blocks read from stream by reader thread. 0 - disabled
+   const void *fields;                              // names and value writers of rules used by serialization
+   bool escape_non_ascii;                           // serialization writes non-ASCII characters as \u escape sequences
+   bool exact_size;                                 // serialization into string measures document before allocation
 };
 
 #if UINT_MAX == 0xffffffffu
@@ -112,10 +163,8 @@ struct yajp_deserialization_context {
 struct yajp_deserialization_rule {
     field_key_t field_key;
 
-#if DEBUG
-    const char *field_name;                         // name of field
-    size_t field_name_size;                  // size of field without '\0;
-#endif
+    const char *field_name;                         // name of field. Is used by serialization
+    size_t field_name_size;                         // size of field without '\0'
 
     size_t field_offset;                            // offset of field in structure
     size_t field_size;                              // size of field
@@ -124,17 +173,24 @@ struct yajp_deserialization_rule {
 
     bool allocate;                                  // memory allocation required for this deserializing field
     bool allocate_elems;                            // allocation for array values needed
+    bool inline_string;                             // string is stored in place with bounds check
+    bool interned_string;                           // string is stored by pointer into pool, it isn't owned by field
+    bool shrink_to_fit;                             // memory of array should be shrunk to its elements
+    bool track_capacity;                            // capacity of array or string should be stored into holder
 
     size_t counter_offset;                          // offset of counter
     size_t rows_offset;                             // offset of rows array
     size_t elems_offset;                            // offset of array values
     size_t final_dym_offset;                        // offset of final_dim flag
     size_t elem_size;                               // size of array element
+    size_t capacity_offset;                         // offset of capacity. Used if track_capacity is set
 
     union {
         yajp_value_setter_t setter;                 // pointer to setter function
         const yajp_deserialization_context_t *ctx;  // deserialization context
     };
+
+    const void *setter_data;                        // data bound to rule. If not NULL, passed to setter as user_data
 };
 
 /**
@@ -162,6 +218,10 @@ struct yajp_deserialization_rule {
  *          doesn't have @c YAJP_DESERIALIZATION_ACTION_OPTIONS_TYPE_ARRAY_OF
  * @note    Value in @b elem_size should be size in bytes of string character in case of string deserialization or size
  *          of array item in case of array deserialization
+ * @note    In case if @b options have @c YAJP_DESERIALIZATION_OPTIONS_INLINE or @c YAJP_DESERIALIZATION_OPTIONS_TRUNCATE,
+ *          @b field_size (or @b elem_size for arrays) is used as capacity of array of characters
+ * @note    Rule is initialized without setter data. Use @c yajp_deserialization_rule_set_setter_data() or
+ *          @c YAJP_DESERIALIZATION_SETTER_DATA declaration to bind it.
  */
 int yajp_deserialization_rule_init(const char *name,
                                    size_t name_size,
@@ -177,15 +237,196 @@ int yajp_deserialization_rule_init(const char *name,
                                    const yajp_deserialization_context_t *ctx,
                                    yajp_deserialization_rule_t *result);
 
+/**
+ * @details Bind data to deserialization rule. Bound data will be passed to rule setter as @c user_data instead of
+ *          @c user_data passed to deserialization functions. It's used by setters which require some per field
+ *          configuration, like @c yajp_set_enum().
+ *
+ * @param [in]  rule            Pointer to initialized deserialization rule
+ * @param [in]  setter_data     Pointer to data what will be passed to setter. NULL to unbind data
+ *
+ * @return  Result of binding. 0 - on success
+ *
+ * @note    Bound data is not copied, so it should be alive till rule is used.
+ */
+int yajp_deserialization_rule_set_setter_data(yajp_deserialization_rule_t *rule, const void *setter_data);
+
+/**
+ * @details Tell deserialization to store capacity of array, i.e. number of elements (or rows) what fits into allocated
+ *          memory, into @c size_t field of array holder. For allocated string field capacity is number of characters
+ *          what fit into memory of string, including terminating one, and it's stored into @c size_t field of
+ *          structure holding string field. Reuse mode takes capacity of string from it instead of length of string.
+ *
+ * @param [in]  rule                Pointer to initialized deserialization rule of array or of allocated string
+ * @param [in]  capacity_offset     Offset of capacity field in array holder or in structure holding string field
+ *
+ * @return  Result of setting. 0 - on success, -1 if rule doesn't describe array or allocated string
+ *
+ * @note    Consider using @c YAJP_DESERIALIZATION_ARRAY_CAPACITY or @c YAJP_DESERIALIZATION_STRING_CAPACITY
+ *          declaration
+ */
+int yajp_deserialization_rule_set_capacity_offset(yajp_deserialization_rule_t *rule, size_t capacity_offset);
+
 /**
  * Initialize deserialization context
  * @param[in]   acts    Pointer to array of deserialization action
  * @param[in]   count   Number of deserialization action in array
  * @param[out]  ctx     Pointer to initializing deserialization context
  * @return      Result of deserialization context initialization. 0 on success
+ *
+ * @note    Names of rules are encoded for serialization (see @c yajp/serialization.h) at once, so memory of context
+ *          should be released with @c yajp_deserialization_context_release().
  */
 int yajp_deserialization_context_init(yajp_deserialization_rule_t *acts, int count, yajp_deserialization_context_t *ctx);
 
+/**
+ * Release memory of deserialization context, i.e. its hash table of rules. Rules and contexts bound to them are not
+ * owned by context and are not released.
+ * @param[in]   ctx     Pointer to initialized deserialization context
+ *
+ * @note    Context must not be used by deserialization after release, including release of structures deserialized
+ *          with it. Use @c yajp_context_handle_swap() to replace context what is used by other threads.
+ */
+void yajp_deserialization_context_release(yajp_deserialization_context_t *ctx);
+
+/**
+ * Set allocator used by deserialization with this context, i.e. for whole session which uses the context.
+ * @param[in]   ctx         Pointer to initialized deserialization context
+ * @param[in]   allocator   Pointer to allocator or NULL to use heap
+ * @return      Result of setting allocator. 0 on success
+ *
+ * @note    Only allocator of context passed to deserialization function is used. Allocators of contexts bound to
+ *          object rules are ignored.
+ * @note    Allocator is not copied, so it should be alive till context is used.
+ */
+int yajp_deserialization_context_set_allocator(yajp_deserialization_context_t *ctx, const yajp_allocator_t *allocator);
+
+/**
+ * Set reuse mode of deserialization with this context. In reuse mode deserialization overwrites previously deserialized
+ * structure in place: allocated objects, buffers of arrays and allocated strings are reused and grown only if they are
+ * too small, surplus items of arrays are released. So repeated deserialization of similar documents into the same
+ * structure doesn't allocate output memory.
+ * @param[in]   ctx     Pointer to initialized deserialization context
+ * @param[in]   reuse   true - to reuse memory of deserializing structure, false - to overwrite it with new memory
+ * @return      Result of setting reuse mode. 0 on success
+ *
+ * @note    Deserializing structure should be zero initialized before first deserialization.
+ * @note    Fields absent in document keep their previous values.
+ * @note    Capacity of allocated string is taken from capacity field (see @c YAJP_DESERIALIZATION_STRING_CAPACITY) or
+ *          as its length otherwise, so string values should be terminated by '\0'. Capacity of array is taken from
+ *          capacity field (see @c YAJP_DESERIALIZATION_ARRAY_CAPACITY) or amount of items otherwise. Allocated numbers
+ *          and booleans have size of their type, so their memory is always reused.
+ * @note    Memory should be allocated by the same allocator, so reuse mode can't be used with arena what is reset
+ *          between deserializations.
+ * @note    Only reuse mode of context passed to deserialization function is used.
+ */
+int yajp_deserialization_context_set_reuse(yajp_deserialization_context_t *ctx, bool reuse);
+
+/**
+ * Set size hints mode of deserialization with this context. In this mode deserialization keeps statistics of previous
+ * documents: moving maximum of amount of rows and elements of every array rule and of lexer buffer size, i.e. of the
+ * longest token. Memory of arrays and lexer buffer of next document is allocated by these sizes at once, so feed of
+ * documents with stable shape doesn't grow memory step by step.
+ * @param[in]   ctx         Pointer to initialized deserialization context
+ * @param[in]   hints       Pointer to initialized size hints what receive statistics. NULL - to grow memory from
+ *                          minimal size
+ * @return      Result of setting size hints mode. 0 on success
+ *
+ * @note    Statistics of rules of contexts bound to object rules are stored in the same hints. Context and rules stay
+ *          read-only, so hints can be shared by contexts and by concurrent deserializations. They are updated without
+ *          locks and can lose some updates, what affects only sizes of allocations.
+ * @note    Moving maximum follows bigger sizes at once and decays to smaller ones by 1/8 of difference per document.
+ * @note    Only size hints of context passed to deserialization function are used.
+ */
+int yajp_deserialization_context_set_size_hints(yajp_deserialization_context_t *ctx,
+                                                yajp_deserialization_size_hints_t *hints);
+
+/**
+ * Initialize size hints.
+ *
+ * @param[in]   expected_count  Expected amount of array rules of all contexts using hints. Used to choose amount of
+ *                              slots
+ * @param[out]  result          Pointer to initializing hints
+ * @return      Result of hints initialization. 0 - on success, -1 with errno set otherwise
+ *
+ * @note    Amount of slots is fixed by @p expected_count and table never grows, because lookup is done without locks.
+ *          Array rules what don't fit into table are deserialized without hints.
+ */
+int yajp_deserialization_size_hints_init(size_t expected_count, yajp_deserialization_size_hints_t *result);
+
+/**
+ * Release size hints.
+ *
+ * @param[in]   hints   Pointer to hints
+ *
+ * @note    Function is not thread safe. Contexts using hints shouldn't be used after it.
+ */
+void yajp_deserialization_size_hints_release(yajp_deserialization_size_hints_t *hints);
+
+/**
+ * Get sizes of array rule learned by hints.
+ *
+ * @param[in]   hints   Pointer to hints
+ * @param[in]   rule    Array rule
+ * @param[out]  rows    Pointer to receive moving maximum of amount of rows. Can be NULL
+ * @param[out]  elems   Pointer to receive moving maximum of amount of elements. Can be NULL
+ * @return      0 - if sizes of rule are learned, -1 otherwise
+ */
+int yajp_deserialization_size_hints_get(const yajp_deserialization_size_hints_t *hints,
+                                        const yajp_deserialization_rule_t *rule, size_t *rows, size_t *elems);
+
+/**
+ * Set maximal nesting depth of objects and arrays of documents deserialized with this context. Root object has depth 1.
+ * Deserialization of deeper document fails with errno set to EOVERFLOW, memory allocated for it is released.
+ * @param[in]   ctx         Pointer to initialized deserialization context
+ * @param[in]   max_depth   Maximal nesting depth. YAJP_DESERIALIZATION_DEFAULT_MAX_DEPTH by default
+ * @return      Result of setting maximal depth. 0 on success, -1 with errno set to EINVAL if max_depth is 0
+ *
+ * @note    Only maximal depth of context passed to deserialization function is used.
+ */
+int yajp_deserialization_context_set_max_depth(yajp_deserialization_context_t *ctx, size_t max_depth);
+
+/**
+ * Set nesting depth parser stack is allocated for at the beginning of deserialization with this context. Stack of
+ * shallow documents fits into parser itself, deeper documents grow stack geometrically up to maximal depth, so
+ * setting is useful only for feeds of deep documents.
+ * @param[in]   ctx         Pointer to initialized deserialization context
+ * @param[in]   depth       Nesting depth of objects and arrays. 0 by default
+ * @return      Result of setting parser stack depth. 0 on success
+ *
+ * @note    Depth above maximal depth of context is limited by it.
+ */
+int yajp_deserialization_context_set_stack_depth(yajp_deserialization_context_t *ctx, size_t depth);
+
+/**
+ * Set read-ahead mode of stream deserialization with this context. In this mode helper thread reads stream by blocks
+ * of specified size into double buffer, while lexer works on previously read block, so reading and parsing of big
+ * files or pipes overlap.
+ * @param[in]   ctx         Pointer to initialized deserialization context
+ * @param[in]   block_size  Size of block in bytes, i.e. 1 MiB. 0 - to read stream by lexer itself (default)
+ * @return      Result of setting read-ahead mode. 0 on success
+ *
+ * @note    Only @c yajp_deserialize_json_stream* functions use read-ahead, string is in memory already.
+ * @note    Helper thread reads stream ahead of document, so position of stream after deserialization is undefined,
+ *          as it is without read-ahead. If helper thread can't be started, stream is read by lexer.
+ * @note    Deserialization waits for helper thread to finish its current read before return, even on error.
+ */
+int yajp_deserialization_context_set_read_ahead(yajp_deserialization_context_t *ctx, size_t block_size);
+
+/**
+ * Release memory what calling thread keeps for next deserializations.
+ *
+ * Deserialization with heap allocator (context without allocator) keeps its parser, parser stack, lexer buffer and
+ * deserialization stack in session of thread and reuses them for the next document, so steady feed of documents on
+ * the same thread doesn't allocate them again. Session is released automatically when thread exits, this function
+ * releases it earlier, i.e. in main thread or in pool thread what doesn't deserialize anymore.
+ *
+ * @note    Deserializations with custom allocator of context or explicitly passed one don't use session, output
+ *          memory is never kept. Lexer buffers bigger than 64 KiB aren't kept.
+ * @note    Nested deserialization, i.e. from setter, doesn't use session of outer one.
+ */
+void yajp_deserialization_release_thread_session(void);
+
 /**
  * Deserialize JSON stream into provided structure
  * @param[in]   json                    Pointer to JSON stream
@@ -216,4 +457,162 @@ int yajp_deserialize_json_string(const char *json,
                                  void *deserializing_struct,
                                  void *user_data);
 
+/**
+ * Deserialize JSON stream into provided structure allocating all output memory from arena
+ * @param[in]   json                    Pointer to JSON stream
+ * @param[in]   ctx                     Pointer to deserialization context
+ * @param[out]  deserializing_struct    Pointer to deserializing structure
+ * @param[in]   user_data               Pointer to value what will be passed as \c user_data to \c setter in \c yajp_deserialization_rule_init
+ * @param[in]   arena                   Pointer to arena used for strings, arrays and objects allocated during
+ *                                      deserialization. If NULL, memory is allocated by allocator of context
+ * @return      Result of deserialization process. See \c yajp_deserialization_result_t for details
+ *
+ * @note    Temporary memory of lexer and parser is still allocated by allocator of context.
+ * @note    Memory allocated from arena must not be freed. It's released with \c yajp_arena_reset() or
+ *          \c yajp_arena_release(). Memory of failed deserialization is released with arena as well
+ */
+int yajp_deserialize_json_stream_in_arena(FILE *json,
+                                          const yajp_deserialization_context_t *ctx,
+                                          void *deserializing_struct,
+                                          void *user_data,
+                                          yajp_arena_t *arena);
+
+/**
+ * Deserialize plain JSON string into provided structure allocating all output memory from arena
+ * @param[in]   json                    Pointer to string with JSON
+ * @param[in]   json_size               Size in bytes of deserializing JSON string
+ * @param[in]   ctx                     Pointer to deserialization context
+ * @param[out]  deserializing_struct    Pointer to deserializing structure
+ * @param[in]   user_data               Pointer to value what will be passed as \c user_data to \c setter in \c yajp_deserialization_rule_init
+ * @param[in]   arena                   Pointer to arena used for strings, arrays and objects allocated during
+ *                                      deserialization. If NULL, memory is allocated by allocator of context
+ * @return      Result of deserialization process. See \c yajp_deserialization_result_t for details
+ *
+ * @note    See \c yajp_deserialize_json_stream_in_arena()
+ */
+int yajp_deserialize_json_string_in_arena(const char *json,
+                                          size_t json_size,
+                                          const yajp_deserialization_context_t *ctx,
+                                          void *deserializing_struct,
+                                          void *user_data,
+                                          yajp_arena_t *arena);
+
+/**
+ * Deserialize JSON stream into provided structure using allocator passed to this call
+ * @param[in]   json                    Pointer to JSON stream
+ * @param[in]   ctx                     Pointer to deserialization context
+ * @param[out]  deserializing_struct    Pointer to deserializing structure
+ * @param[in]   user_data               Pointer to value what will be passed as \c user_data to \c setter in \c yajp_deserialization_rule_init
+ * @param[in]   allocator               Pointer to allocator used for lexer, parser and output memory. If NULL,
+ *                                      allocator of context is used
+ * @return      Result of deserialization process. See \c yajp_deserialization_result_t for details
+ *
+ * @note    Strings, arrays and objects of deserialized structure should be released with \c free of the same allocator
+ */
+int yajp_deserialize_json_stream_with_allocator(FILE *json,
+                                                const yajp_deserialization_context_t *ctx,
+                                                void *deserializing_struct,
+                                                void *user_data,
+                                                const yajp_allocator_t *allocator);
+
+/**
+ * Deserialize plain JSON string into provided structure using allocator passed to this call
+ * @param[in]   json                    Pointer to string with JSON
+ * @param[in]   json_size               Size in bytes of deserializing JSON string
+ * @param[in]   ctx                     Pointer to deserialization context
+ * @param[out]  deserializing_struct    Pointer to deserializing structure
+ * @param[in]   user_data               Pointer to value what will be passed as \c user_data to \c setter in \c yajp_deserialization_rule_init
+ * @param[in]   allocator               Pointer to allocator used for lexer, parser and output memory. If NULL,
+ *                                      allocator of context is used
+ * @return      Result of deserialization process. See \c yajp_deserialization_result_t for details
+ *
+ * @note    See \c yajp_deserialize_json_stream_with_allocator()
+ */
+int yajp_deserialize_json_string_with_allocator(const char *json,
+                                                size_t json_size,
+                                                const yajp_deserialization_context_t *ctx,
+                                                void *deserializing_struct,
+                                                void *user_data,
+                                                const yajp_allocator_t *allocator);
+
+/**
+ * Release memory allocated by deserialization of structure: allocated fields, arrays, their rows and elements, strings
+ * of arrays and nested objects. Structure is walked once by rules of context, released pointers are set to NULL and
+ * counters of arrays to 0, so structure can be deserialized again. Nesting is walked on heap, not by recursion, so
+ * structure of any depth is released on small stack.
+ * @param[in]       ctx                     Pointer to deserialization context used to deserialize structure
+ * @param[in, out]  deserialized_struct     Pointer to deserialized structure
+ *
+ * @note    Memory is released by allocator of context or heap. Use @c yajp_deserialization_free_with_allocator() if
+ *          structure was deserialized with allocator passed to the call.
+ * @note    Strings set by @c yajp_set_interned_string() and inline strings are not released, they are not owned by
+ *          structure. Memory allocated from arena must not be released by this function.
+ * @note    Structure should be zero initialized before deserialization, otherwise fields absent in JSON are released
+ *          as garbage. Structure of failed deserialization holds everything allocated so far and can be released as well
+ */
+void yajp_deserialization_free(const yajp_deserialization_context_t *ctx, void *deserialized_struct);
+
+/**
+ * Release memory allocated by deserialization of structure with specified allocator.
+ * @param[in]       ctx                     Pointer to deserialization context used to deserialize structure
+ * @param[in, out]  deserialized_struct     Pointer to deserialized structure
+ * @param[in]       allocator               Pointer to allocator passed to deserialization. If NULL, allocator of
+ *                                          context is used
+ *
+ * @note    See @c yajp_deserialization_free()
+ */
+void yajp_deserialization_free_with_allocator(const yajp_deserialization_context_t *ctx,
+                                              void *deserialized_struct,
+                                              const yajp_allocator_t *allocator);
+
+/**
+ * Result of @c yajp_step(): document isn't complete yet, next part of input should be passed
+ */
+#define YAJP_STEP_NEED_MORE_INPUT                       1
+
+/**
+ * State of incremental deserialization of one document
+ */
+typedef struct yajp_step_state yajp_step_state_t;
+
+/**
+ * Start incremental deserialization. Document is passed by parts to @c yajp_step(), which deserializes everything
+ * what is available and returns instead of waiting for more input, so thousands of documents can be interleaved on few
+ * threads, i.e. in coroutines or fibers. Nesting of document is kept in heap memory, so deserialization doesn't recurse
+ * on the stack of calling thread.
+ * @param[in]   ctx         Pointer to deserialization context
+ * @param[out]  address     Pointer to deserializing structure. Should be alive till deserialization is done
+ * @param[in]   user_data   Pointer to value what will be passed as @b user_data to setters
+ * @param[out]  state       Pointer to receive state of deserialization
+ * @return      Result of start. 0 - on success, -1 with errno set otherwise
+ *
+ * @note    State is allocated by allocator of context (heap if it's not set), output memory as well. State isn't bound
+ *          to thread, so steps can be done by different threads one by one.
+ * @note    Memory of failed or abandoned document is released by walking its nesting on heap as well.
+ */
+int yajp_step_start(const yajp_deserialization_context_t *ctx, void *address, void *user_data,
+                    yajp_step_state_t **state);
+
+/**
+ * Deserialize next part of document.
+ * @param[in]   state       Pointer to state of deserialization
+ * @param[in]   input       Pointer to part of JSON. Doesn't need terminating zero. Can be reused after return
+ * @param[in]   input_size  Size of part in bytes. Can be 0
+ * @param[in]   last        true - if part is the end of document
+ * @return      Result of step. 0 - if document is deserialized, YAJP_STEP_NEED_MORE_INPUT - if document continues in
+ *              next part, -1 with errno set if deserialization failed. Result of finished document is returned by
+ *              following steps as well
+ *
+ * @note    Token split between parts is kept by state, so parts can be of any size, including one byte.
+ * @note    Input after the end of document is ignored, as it's done by @c yajp_deserialize_json_string().
+ */
+int yajp_step(yajp_step_state_t *state, const char *input, size_t input_size, bool last);
+
+/**
+ * Release state of incremental deserialization. Memory of document what isn't finished is released as it's done for
+ * failed one.
+ * @param[in]   state   Pointer to state of deserialization or NULL
+ */
+void yajp_step_release(yajp_step_state_t *state);
+
 #endif // YAJP_DESERIALIZE_H
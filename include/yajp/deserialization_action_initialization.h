@@ -48,6 +48,8 @@ do {
 #if (YAJP_DESERIALIZATION_FIELD_TYPE & YAJP_DESERIALIZATION_TYPE_OBJECT)
     #if !defined(YAJP_DESERIALIZATION_OBJECT_CONTEXT)
         #error "YAJP_DESERIALIZATION_OBJECT_CONTEXT is not defined"
+    #elif defined(YAJP_DESERIALIZATION_SETTER_DATA)
+        #error "YAJP_DESERIALIZATION_SETTER_DATA can't be used with YAJP_DESERIALIZATION_TYPE_OBJECT"
     #endif
 #else
     #if !defined(YAJP_DESERIALIZATION_SETTER)
@@ -67,6 +69,15 @@ do {
     #elif !defined(YAJP_DESERIALIZATION_ARRAY_FINAL_DIM)
         #error "YAJP_DESERIALIZATION_ARRAY_FINAL_DIM is not defined"
     #endif
+#elif defined(YAJP_DESERIALIZATION_ARRAY_CAPACITY)
+    #error "YAJP_DESERIALIZATION_ARRAY_CAPACITY can be used only with YAJP_DESERIALIZATION_TYPE_ARRAY_OF"
+#endif
+
+#if defined(YAJP_DESERIALIZATION_STRING_CAPACITY) && \
+    ((YAJP_DESERIALIZATION_FIELD_TYPE & YAJP_DESERIALIZATION_TYPE_ARRAY_OF) || \
+     !(YAJP_DESERIALIZATION_FIELD_TYPE & YAJP_DESERIALIZATION_TYPE_STRING) || \
+     !(YAJP_DESERIALIZATION_OPTIONS & YAJP_DESERIALIZATION_OPTIONS_ALLOCATE))
+    #error "YAJP_DESERIALIZATION_STRING_CAPACITY can be used only with allocated YAJP_DESERIALIZATION_TYPE_STRING"
 #endif
 
 
@@ -122,6 +133,25 @@ do {
     #endif
 #endif
 
+#if (YAJP_DESERIALIZATION_OPTIONS & (YAJP_DESERIALIZATION_OPTIONS_INLINE | YAJP_DESERIALIZATION_OPTIONS_TRUNCATE))
+    #if !(YAJP_DESERIALIZATION_FIELD_TYPE & YAJP_DESERIALIZATION_TYPE_STRING)
+        #error "YAJP_DESERIALIZATION_OPTIONS_INLINE and YAJP_DESERIALIZATION_OPTIONS_TRUNCATE can be used only with YAJP_DESERIALIZATION_TYPE_STRING"
+    #elif (YAJP_DESERIALIZATION_OPTIONS & YAJP_DESERIALIZATION_OPTIONS_ALLOCATE) || (YAJP_DESERIALIZATION_FIELD_TYPE & YAJP_DESERIALIZATION_TYPE_NULLABLE)
+        #error "Inline strings can't be combined with YAJP_DESERIALIZATION_OPTIONS_ALLOCATE or YAJP_DESERIALIZATION_TYPE_NULLABLE"
+    #endif
+
+    // capacity of inline string is taken from sizeof, so it must be array of characters, not a pointer
+    #if (YAJP_DESERIALIZATION_FIELD_TYPE & YAJP_DESERIALIZATION_TYPE_ARRAY_OF)
+    _Static_assert(!__builtin_types_compatible_p(YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE,
+                                                 typeof(&(*(typeof(YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE) *) NULL)[0])),
+                   "Element of inline strings array must be array of characters");
+    #else
+    _Static_assert(!__builtin_types_compatible_p(YAJP_DESERIALIZATION_RULE_INIT_FIELD_TYPE,
+                                                 typeof(&(*(YAJP_DESERIALIZATION_RULE_INIT_FIELD_TYPE *) NULL)[0])),
+                   "Inline string field must be array of characters");
+    #endif
+#endif
+
 #ifdef YAJP_DESERIALIZATION_RULE_INIT_RESULT
     YAJP_DESERIALIZATION_RULE_INIT_RESULT = yajp_deserialization_rule_init(
             YAJP_DESERIALIZATION_FIELD_NAME,                                    // name
@@ -156,6 +186,54 @@ do {
     );
 #endif
 
+#ifdef YAJP_DESERIALIZATION_SETTER_DATA
+    #ifdef YAJP_DESERIALIZATION_RULE_INIT_RESULT
+    if (0 == YAJP_DESERIALIZATION_RULE_INIT_RESULT) {
+        YAJP_DESERIALIZATION_RULE_INIT_RESULT = yajp_deserialization_rule_set_setter_data(
+                YAJP_DESERIALIZATION_RULE,                                      // rule
+                YAJP_DESERIALIZATION_SETTER_DATA                                // setter_data
+        );
+    }
+    #else
+    yajp_deserialization_rule_set_setter_data(
+            YAJP_DESERIALIZATION_RULE,                                          // rule
+            YAJP_DESERIALIZATION_SETTER_DATA                                    // setter_data
+    );
+    #endif
+#endif
+
+#ifdef YAJP_DESERIALIZATION_ARRAY_CAPACITY
+    #ifdef YAJP_DESERIALIZATION_RULE_INIT_RESULT
+    if (0 == YAJP_DESERIALIZATION_RULE_INIT_RESULT) {
+        YAJP_DESERIALIZATION_RULE_INIT_RESULT = yajp_deserialization_rule_set_capacity_offset(
+                YAJP_DESERIALIZATION_RULE,                                      // rule
+                offsetof(YAJP_DESERIALIZATION_RULE_INIT_FIELD_TYPE, YAJP_DESERIALIZATION_ARRAY_CAPACITY)   // capacity_offset
+        );
+    }
+    #else
+    yajp_deserialization_rule_set_capacity_offset(
+            YAJP_DESERIALIZATION_RULE,                                          // rule
+            offsetof(YAJP_DESERIALIZATION_RULE_INIT_FIELD_TYPE, YAJP_DESERIALIZATION_ARRAY_CAPACITY)   // capacity_offset
+    );
+    #endif
+#endif
+
+#ifdef YAJP_DESERIALIZATION_STRING_CAPACITY
+    #ifdef YAJP_DESERIALIZATION_RULE_INIT_RESULT
+    if (0 == YAJP_DESERIALIZATION_RULE_INIT_RESULT) {
+        YAJP_DESERIALIZATION_RULE_INIT_RESULT = yajp_deserialization_rule_set_capacity_offset(
+                YAJP_DESERIALIZATION_RULE,                                      // rule
+                offsetof(YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE, YAJP_DESERIALIZATION_STRING_CAPACITY)   // capacity_offset
+        );
+    }
+    #else
+    yajp_deserialization_rule_set_capacity_offset(
+            YAJP_DESERIALIZATION_RULE,                                          // rule
+            offsetof(YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE, YAJP_DESERIALIZATION_STRING_CAPACITY)   // capacity_offset
+    );
+    #endif
+#endif
+
 #undef YAJP_DESERIALIZATION_GET_FIELD_NAME_SIZE
 #undef YAJP_DESERIALIZATION_STRINGIFY2
 #undef YAJP_DESERIALIZATION_STRINGIFY
@@ -168,12 +246,15 @@ do {
 #undef YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE
 #undef YAJP_DESERIALIZATION_STRUCT_FIELD_NAME
 #undef YAJP_DESERIALIZATION_SETTER
+#undef YAJP_DESERIALIZATION_SETTER_DATA
 #undef YAJP_DESERIALIZATION_OBJECT_CONTEXT
 #undef YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE
 #undef YAJP_DESERIALIZATION_ARRAY_ELEMENTS
 #undef YAJP_DESERIALIZATION_ARRAY_ROWS
 #undef YAJP_DESERIALIZATION_ARRAY_COUNTER
 #undef YAJP_DESERIALIZATION_ARRAY_FINAL_DIM
+#undef YAJP_DESERIALIZATION_ARRAY_CAPACITY
+#undef YAJP_DESERIALIZATION_STRING_CAPACITY
 #undef YAJP_DESERIALIZATION_OPTIONS
 #undef YAJP_DESERIALIZATION_FIELD_NAME
 #undef YAJP_DESERIALIZATION_SETTER
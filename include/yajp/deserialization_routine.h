@@ -22,8 +22,141 @@
 #ifndef YAJP_DESERIALIZATION_ROUTINE_H
 #define YAJP_DESERIALIZATION_ROUTINE_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdbool.h>
+
+/**
+ * Item of enumeration used by @c yajp_set_enum()
+ */
+typedef struct yajp_deserialization_enum_item {
+    const char *name;                   // string value of enumeration item in JSON stream
+    size_t name_size;                   // size of string value without '\0'
+    int value;                          // value stored in deserializing field
+} yajp_deserialization_enum_item_t;
+
+/**
+ * Enumeration used by @c yajp_set_enum() to convert JSON strings into integral codes. Should be initialized with
+ * @c yajp_deserialization_enum_init()
+ */
+typedef struct yajp_deserialization_enum {
+    const yajp_deserialization_enum_item_t *items;  // enumeration items
+    size_t count;                                   // number of items
+
+    bool use_default;                               // store default_value for unknown strings instead of error
+    int default_value;                              // value for unknown strings
+
+    uint64_t seed;                                  // seed of hash function
+    size_t buckets_mask;                            // number of buckets - 1
+    size_t slots_mask;                              // number of slots - 1
+    uint32_t *displacements;                        // displacement for each bucket
+    int32_t *slots;                                 // index of item in each slot or -1
+} yajp_deserialization_enum_t;
+
+/**
+ * Initialize enumeration used by @c yajp_set_enum().
+ *
+ * @param[in]   items           Pointer to array of enumeration items. Array is not copied and should be alive till
+ *                              enumeration is used.
+ * @param[in]   count           Number of items in array
+ * @param[in]   use_default     If true, @c default_value will be stored for unknown strings. Otherwise
+ *                              @c yajp_set_enum() will fail on unknown strings
+ * @param[in]   default_value   Value for unknown strings
+ * @param[out]  result          Pointer to initializing enumeration
+ * @return      Result of enumeration initialization. 0 - on success
+ *
+ * @note    Function builds collision free (perfect) hash table for items names, so lookup of value takes one pass of
+ *          hash function over string and one comparison. Table isn't minimal: amount of its slots is power of two not
+ *          less than twice amount of items.
+ * @note    Items names should be unique. Otherwise initialization fails.
+ */
+int yajp_deserialization_enum_init(const yajp_deserialization_enum_item_t *items,
+                                   size_t count,
+                                   bool use_default,
+                                   int default_value,
+                                   yajp_deserialization_enum_t *result);
+
+/**
+ * Release resources allocated by @c yajp_deserialization_enum_init()
+ *
+ * @param[in]   enumeration     Pointer to enumeration
+ */
+void yajp_deserialization_enum_release(yajp_deserialization_enum_t *enumeration);
+
+/**
+ * Alphabets of base64 encoding supported by @c yajp_set_base64()
+ */
+typedef enum yajp_deserialization_base64_alphabet {
+    YAJP_DESERIALIZATION_BASE64_STANDARD = 0,       // RFC 4648 section 4, uses '+' and '/'
+    YAJP_DESERIALIZATION_BASE64_URL = 1,            // RFC 4648 section 5, uses '-' and '_'
+} yajp_deserialization_base64_alphabet_t;
+
+/**
+ * Description of binary field used by @c yajp_set_base64(). Can be initialized with
+ * @c YAJP_DESERIALIZATION_BASE64_INIT()
+ */
+typedef struct yajp_deserialization_base64 {
+    yajp_deserialization_base64_alphabet_t alphabet;    // alphabet of encoded values
+    size_t capacity;                                    // size of deserializing field in bytes
+    ptrdiff_t size_offset;                              // offset of size_t field for decoded size relative to deserializing field
+} yajp_deserialization_base64_t;
+
+/**
+ * Initializer of @c yajp_deserialization_base64_t for array of bytes @c field and @c size_t field @c size_field of
+ * the same structure @c holder_type
+ */
+#define YAJP_DESERIALIZATION_BASE64_INIT(holder_type, field, size_field, base64_alphabet) {                      \
+        .alphabet = (base64_alphabet),                                                                          \
+        .capacity = sizeof(((holder_type *) 0)->field),                                                         \
+        .size_offset = (ptrdiff_t) offsetof(holder_type, size_field) - (ptrdiff_t) offsetof(holder_type, field)  \
+}
+
+/**
+ * Pool of interned strings used by @c yajp_set_interned_string(). Should be initialized with
+ * @c yajp_deserialization_intern_pool_init()
+ */
+typedef struct yajp_deserialization_intern_pool {
+    size_t buckets_mask;                // number of buckets - 1
+    void *buckets;                      // heads of buckets chains
+} yajp_deserialization_intern_pool_t;
+
+/**
+ * Initialize pool of interned strings.
+ *
+ * @param[in]   expected_count  Expected amount of distinct strings. Used to choose amount of buckets
+ * @param[out]  result          Pointer to initializing pool
+ * @return      Result of pool initialization. 0 - on success
+ *
+ * @note    Pool can be shared between rules, deserialization calls and threads. Strings are never removed from pool,
+ *          so it's intended for fields with small amount of distinct values.
+ * @note    Amount of buckets is fixed by @p expected_count and table never grows, because lookup is done without
+ *          locks. If pool holds more distinct strings than expected, chains of buckets grow and lookup becomes linear
+ *          in amount of strings per bucket, so @p expected_count should be upper bound of distinct values.
+ */
+int yajp_deserialization_intern_pool_init(size_t expected_count, yajp_deserialization_intern_pool_t *result);
+
+/**
+ * Release pool of interned strings and all strings in it.
+ *
+ * @param[in]   pool    Pointer to pool
+ *
+ * @note    Function is not thread safe. Pointers returned by pool become invalid.
+ */
+void yajp_deserialization_intern_pool_release(yajp_deserialization_intern_pool_t *pool);
+
+/**
+ * Find string in pool and add it if it's not found.
+ *
+ * @param[in]   pool        Pointer to pool
+ * @param[in]   value       Pointer to string
+ * @param[in]   value_size  Size of string in bytes
+ * @return      Pointer to '\0' terminated copy of string owned by pool or NULL on error. Pointer stays valid till pool
+ *              is released.
+ *
+ * @note    Function is lock free. Lookup of string what is already in pool doesn't write to shared memory.
+ */
+const char *yajp_deserialization_intern(yajp_deserialization_intern_pool_t *pool, const uint8_t *value, size_t value_size);
 
 /**
  * Function will convert passed string value to short and initialize passed deserializing field with this value.
@@ -156,4 +289,80 @@ int yajp_set_bool(const uint8_t *name, size_t name_size, const uint8_t *value, s
  */
 int yajp_set_string(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field, void *user_data);
 
+/**
+ * Function will convert passed RFC 3339 timestamp to number of nanoseconds since Unix epoch and initialize passed
+ * deserializing field with this value.
+ *
+ * @param[in] name          Pointer to string with name of field where value should be set. Not used.
+ * @param[in] name_size     Size of name field in bytes. Not used.
+ * @param[in] value         Pointer to string with value for field.
+ * @param[in] value_size    Size of string with value
+ * @param[in] field         Pointer to field what should be set. Field should have @c int64_t type.
+ * @param[in] user_data     Pointer to user data passed as parameter to deserialization functions. Not used
+ * @return      Result of converting and setting string value to field. 0 - on success
+ *
+ * @note Accepted format is @c YYYY-MM-DDTHH:MM:SS[.fraction](Z|+HH:MM|-HH:MM). Separator between date and time can
+ *       be @c 'T', @c 't' or space. Only 9 first digits of fraction are significant, remaining are validated and
+ *       dropped. Value is parsed in place, without allocations and calls to @c strptime() or @c timegm(), so field
+ *       can be declared with @c YAJP_DESERIALIZATION_TYPE_STRING and without @c YAJP_DESERIALIZATION_OPTIONS_ALLOCATE.
+ * @note Timestamps which can't be represented in @c int64_t nanoseconds (before 1677 or after 2262 year) are rejected.
+ */
+int yajp_set_timestamp(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field, void *user_data);
+
+/**
+ * Function will convert passed string value to integral code of enumeration item and initialize passed deserializing
+ * field with this value.
+ *
+ * @param[in] name          Pointer to string with name of field where value should be set. Not used.
+ * @param[in] name_size     Size of name field in bytes. Not used.
+ * @param[in] value         Pointer to string with value for field.
+ * @param[in] value_size    Size of string with value
+ * @param[in] field         Pointer to field what should be set. Field should have @c int type or be C enumeration.
+ * @param[in] user_data     Pointer to @c yajp_deserialization_enum_t used to convert value
+ * @return      Result of converting and setting string value to field. 0 - on success
+ *
+ * @note Enumeration should be bound to rule with @c YAJP_DESERIALIZATION_SETTER_DATA declaration or
+ *       @c yajp_deserialization_rule_set_setter_data(). Field can be declared with @c YAJP_DESERIALIZATION_TYPE_STRING
+ *       and without @c YAJP_DESERIALIZATION_OPTIONS_ALLOCATE, because value is converted without allocations.
+ */
+int yajp_set_enum(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field, void *user_data);
+
+/**
+ * Function will decode passed base64 string value into bytes of passed deserializing field and set size of decoded
+ * data to sibling field.
+ *
+ * @param[in] name          Pointer to string with name of field where value should be set. Not used.
+ * @param[in] name_size     Size of name field in bytes. Not used.
+ * @param[in] value         Pointer to string with value for field.
+ * @param[in] value_size    Size of string with value
+ * @param[in] field         Pointer to array of bytes what should be set.
+ * @param[in] user_data     Pointer to @c yajp_deserialization_base64_t what describes field
+ * @return      Result of decoding and setting string value to field. 0 - on success
+ *
+ * @note Description should be bound to rule with @c YAJP_DESERIALIZATION_SETTER_DATA declaration or
+ *       @c yajp_deserialization_rule_set_setter_data(). Value is decoded directly from lexer buffer, so field should be
+ *       declared with @c YAJP_DESERIALIZATION_TYPE_STRING and without @c YAJP_DESERIALIZATION_OPTIONS_ALLOCATE.
+ * @note Padding is optional, but if present it should be correct. Escaped solidus (@c "\/") is accepted. Values what
+ *       don't fit into @c capacity bytes are rejected. Size field is set only on success.
+ */
+int yajp_set_base64(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field, void *user_data);
+
+/**
+ * Function will intern passed string value and initialize passed deserializing field with pointer to interned string.
+ *
+ * @param[in] name          Pointer to string with name of field where value should be set. Not used.
+ * @param[in] name_size     Size of name field in bytes. Not used.
+ * @param[in] value         Pointer to string with value for field.
+ * @param[in] value_size    Size of string with value
+ * @param[in] field         Pointer to field what should be set. Field should have @c const @c char* type.
+ * @param[in] user_data     Pointer to @c yajp_deserialization_intern_pool_t
+ * @return      Result of setting string value to field. 0 - on success
+ *
+ * @note Pool should be bound to rule with @c YAJP_DESERIALIZATION_SETTER_DATA declaration or
+ *       @c yajp_deserialization_rule_set_setter_data(). Field should be declared with
+ *       @c YAJP_DESERIALIZATION_TYPE_STRING and without @c YAJP_DESERIALIZATION_OPTIONS_ALLOCATE, because memory is
+ *       owned by pool. Interned strings must not be freed or modified.
+ */
+int yajp_set_interned_string(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field, void *user_data);
+
 #endif //YAJP_DESERIALIZATION_ROUTINE_H
@@ -0,0 +1,151 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * parallel.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_PARALLEL_H
+#define YAJP_PARALLEL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include <yajp/deserialization.h>
+
+/**
+ * Input document of batch
+ */
+typedef struct yajp_buffer {
+    const char *data;       // JSON text. Doesn't need terminating zero
+    size_t size;            // size of JSON text in bytes
+} yajp_buffer_t;
+
+/**
+ * Prototype of function receiving records of newline-delimited JSON
+ *
+ * @param[in]       index       Zero-based number of line of record in input
+ * @param[in]       record      Pointer to deserialized record. Memory of record is reused after function returns, so
+ *                              record should be copied or released with @c yajp_deserialization_free()
+ * @param[in]       error       0 - if record was deserialized, errno of deserialization otherwise. Failed record
+ *                              can be partially filled and should be released as well
+ * @param[in, out]  user_data   Pointer to user data passed to deserialization function
+ * @return  0 - to continue deserialization, any other value - to stop it
+ */
+typedef int (*yajp_ndjson_callback_t)(size_t index, void *record, int error, void *user_data);
+
+/**
+ * Deserialize newline-delimited JSON (one object per line) on pool of threads.
+ *
+ * Input is split into batches of lines, which are deserialized by workers, each with its own buffers. Records are
+ * delivered to @p callback in order of lines, or as soon as batch is deserialized if @p ordered is false. Empty lines
+ * are skipped.
+ *
+ * @param[in]   input       Pointer to input. Doesn't need terminating zero
+ * @param[in]   input_size  Size of input in bytes
+ * @param[in]   ctx         Deserialization context of record
+ * @param[in]   elem_size   Size of record structure in bytes
+ * @param[in]   callback    Function receiving records
+ * @param[in]   user_data   Data passed to setters and to @p callback
+ * @param[in]   nthreads    Amount of threads, including calling one. 0 or less - amount of online processors.
+ *                          Clamped to 64
+ * @param[in]   ordered     true - to deliver records in order of lines, false - in order of completion
+ * @return      Result of deserialization. 0 - on success, -1 with errno set to ECANCELED if @p callback stopped
+ *              deserialization, to EINVAL if arguments are invalid or to ENOMEM if buffers can't be allocated
+ *
+ * @note    In ordered mode @p callback is never called concurrently. In unordered mode it's called from all threads
+ *          at once and should be thread-safe. Setters are called from all threads in both modes.
+ * @note    Context is shared by threads, so size hints mode is allowed, but reuse mode is pointless: every record
+ *          is deserialized into zeroed memory.
+ */
+int yajp_deserialize_ndjson(const char *input,
+                            size_t input_size,
+                            const yajp_deserialization_context_t *ctx,
+                            size_t elem_size,
+                            yajp_ndjson_callback_t callback,
+                            void *user_data,
+                            int nthreads,
+                            bool ordered);
+
+/**
+ * Deserialize top-level JSON array of objects on pool of threads.
+ *
+ * Boundaries of elements are found by structural scan of input first (brackets outside of strings), then memory for
+ * all elements is allocated at once and elements are deserialized concurrently with work stealing. Result is the same
+ * as deserialization of every element one by one.
+ *
+ * @param[in]   json        Pointer to JSON array of objects. Doesn't need terminating zero
+ * @param[in]   json_size   Size of JSON in bytes
+ * @param[in]   ctx         Deserialization context of element
+ * @param[in]   elem_size   Size of element structure in bytes
+ * @param[out]  elements    Pointer to receive array of elements. NULL if array is empty
+ * @param[out]  count       Pointer to receive amount of elements
+ * @param[in]   user_data   Data passed to setters
+ * @param[in]   nthreads    Amount of threads, including calling one. 0 or less - amount of online processors.
+ *                          Clamped to 64
+ * @return      Result of deserialization. 0 - on success, -1 with errno set otherwise: EINVAL if input isn't array
+ *              of objects, errno of one of failed elements or ENOMEM. On error nothing is allocated
+ *
+ * @note    Array of elements is allocated by allocator of context (heap if it's not set). Every element should be
+ *          released with @c yajp_deserialization_free() and then array with @c free of the same allocator.
+ * @note    Setters are called from all threads.
+ */
+int yajp_deserialize_array_parallel(const char *json,
+                                    size_t json_size,
+                                    const yajp_deserialization_context_t *ctx,
+                                    size_t elem_size,
+                                    void **elements,
+                                    size_t *count,
+                                    void *user_data,
+                                    int nthreads);
+
+/**
+ * Deserialize batch of independent documents, i.e. small messages, on pool of threads.
+ *
+ * Documents are shared by workers with work stealing, so pool is busy until the whole batch is done even if sizes of
+ * documents differ. Documents are read in place, and every worker keeps one parser, lexer buffer and deserialization
+ * stack for all documents it takes, so deserialization of document doesn't start threads or open streams. Besides
+ * memory of its structure, document allocates only values of tokens longer than lexer buffer.
+ *
+ * @param[in]       inputs      Array of @p n documents
+ * @param[in]       n           Amount of documents
+ * @param[in]       ctx         Deserialization context of documents
+ * @param[in, out]  outputs     Pointer to structure of the first document. Structures should be zeroed (or hold
+ *                              previous results in reuse mode)
+ * @param[in]       stride      Distance between structures of neighbour documents in bytes. Is size of structure for
+ *                              plain array, but can be bigger if structures are fields of bigger records
+ * @param[out]      errors      Array of @p n errors: 0 - if document was deserialized, errno otherwise. Can be NULL
+ * @param[in]       user_data   Data passed to setters
+ * @param[in]       nthreads    Amount of threads, including calling one. 0 or less - amount of online processors.
+ *                              Clamped to 64
+ * @return          Result of deserialization. 0 - if all documents were deserialized, -1 with errno set otherwise:
+ *                  EINVAL if arguments are invalid, errno of one of failed documents or ENOMEM
+ *
+ * @note    Failed document doesn't stop others. Structures of all documents, including failed ones, should be
+ *          released with @c yajp_deserialization_free().
+ * @note    Setters are called from all threads.
+ */
+int yajp_deserialize_batch(const yajp_buffer_t *inputs,
+                           size_t n,
+                           const yajp_deserialization_context_t *ctx,
+                           void *outputs,
+                           size_t stride,
+                           int *errors,
+                           void *user_data,
+                           int nthreads);
+
+#endif //YAJP_PARALLEL_H
@@ -0,0 +1,181 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * serialization.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_SERIALIZATION_H
+#define YAJP_SERIALIZATION_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+#include <yajp/deserialization.h>
+
+/**
+ * Minimal size of string run what is referenced by chain, shorter runs are cheaper to copy than to add as segment
+ */
+#define YAJP_SERIALIZATION_DEFAULT_REFERENCE_SIZE   512
+
+/**
+ * Document serialized as chain of segments for writev(). Bytes generated by serialization (names, numbers, quotes,
+ * escape sequences, short strings) are kept in blocks of chain, long runs of strings without characters to escape are
+ * referenced in memory of serialized structure.
+ */
+typedef struct yajp_serialization_chain {
+    struct iovec *segments;                 // segments of document in order
+    size_t count;                           // amount of segments
+    size_t size;                            // size of document in bytes
+    size_t capacity;                        // amount of allocated segments
+    void *blocks;                           // blocks of generated bytes
+    const yajp_allocator_t *allocator;      // allocator of segments and blocks
+} yajp_serialization_chain_t;
+
+/**
+ * Serialize structure into JSON stream by rules of deserialization context, so the same field mappings are used in
+ * both directions.
+ *
+ * Fields are written in order of rules of context, nested objects and arrays - by their rules and contexts. Document
+ * is collected in internal buffer and written to stream by big blocks.
+ *
+ * @param[in]   json        Pointer to JSON stream
+ * @param[in]   ctx         Pointer to deserialization context of structure
+ * @param[in]   address     Pointer to serializing structure
+ * @return      Result of serialization. 0 - on success, -1 with errno set otherwise: EINVAL if arguments are invalid or
+ *              value can't be represented in JSON, ENOTSUP if field has custom setter, EOVERFLOW if structure is deeper
+ *              than maximal depth of context, EIO if stream can't be written or ENOMEM
+ *
+ * @note    Values are written by setters of rules: numbers and booleans by their C types, strings as they are kept by
+ *          deserialization (with escape sequences), timestamps, enumerations and base64 fields in formats accepted by
+ *          their setters. Fields holding NULL, i.e. allocated values what weren't deserialized, are omitted.
+ * @note    Memory of buffer is allocated by allocator of context (heap if it's not set).
+ * @note    On error part of document can be written already.
+ */
+int yajp_serialize_json_stream(FILE *json, const yajp_deserialization_context_t *ctx, const void *address);
+
+/**
+ * Serialize structure into JSON string by rules of deserialization context. See @c yajp_serialize_json_stream() for
+ * details.
+ *
+ * @param[in]   ctx         Pointer to deserialization context of structure
+ * @param[in]   address     Pointer to serializing structure
+ * @param[out]  json        Pointer to receive JSON string terminated by '\0'
+ * @param[out]  json_size   Pointer to receive size of JSON string without '\0'
+ * @return      Result of serialization. 0 - on success, -1 with errno set otherwise
+ *
+ * @note    String is allocated by allocator of context (heap if it's not set) and should be released by @c free of the
+ *          same allocator. Nothing is allocated on error.
+ */
+int yajp_serialize_json_buffer(const yajp_deserialization_context_t *ctx, const void *address, char **json,
+                               size_t *json_size);
+
+/**
+ * Measure size of JSON document of structure without writing it. See @c yajp_serialize_json_stream() for details.
+ *
+ * @param[in]   ctx         Pointer to deserialization context of structure
+ * @param[in]   address     Pointer to serializing structure
+ * @param[out]  json_size   Pointer to receive size of document in bytes
+ * @return      Result of measuring. 0 - on success, -1 with errno set otherwise
+ *
+ * @note    Nothing is allocated.
+ */
+int yajp_serialize_json_size(const yajp_deserialization_context_t *ctx, const void *address, size_t *json_size);
+
+/**
+ * Serialize structure into buffer of caller, i.e. preregistered network buffer. Document is serialized in two passes:
+ * the first one measures it and caches sizes of strings and the shortest decimals of numbers, the second one fills
+ * buffer without scanning strings what have nothing to escape and without searching decimals again. See
+ * @c yajp_serialize_json_stream() for details.
+ *
+ * @param[in]   ctx         Pointer to deserialization context of structure
+ * @param[in]   address     Pointer to serializing structure
+ * @param[out]  json        Pointer to buffer. Document isn't terminated by '\0'
+ * @param[in]   capacity    Size of buffer in bytes
+ * @param[out]  json_size   Pointer to receive size of document in bytes, also if it doesn't fit into buffer
+ * @return      Result of serialization. 0 - on success, -1 with errno set otherwise: ERANGE if document doesn't fit into
+ *              buffer, see @c yajp_serialize_json_stream() for other errors
+ *
+ * @note    Cache is allocated by allocator of context (heap if it's not set) and is released before return.
+ * @note    Structure shouldn't be changed during serialization, fill pass fails with ERANGE if it was.
+ */
+int yajp_serialize_json_into(const yajp_deserialization_context_t *ctx, const void *address, char *json,
+                             size_t capacity, size_t *json_size);
+
+/**
+ * Serialize structure into chain of segments by rules of deserialization context. See @c yajp_serialize_json_stream()
+ * for details. Document isn't terminated by '\0'.
+ *
+ * @param[in]   ctx             Pointer to deserialization context of structure
+ * @param[in]   address         Pointer to serializing structure
+ * @param[in]   reference_size  Minimal size of string run referenced by chain instead of copying, i.e.
+ *                              YAJP_SERIALIZATION_DEFAULT_REFERENCE_SIZE. SIZE_MAX - to copy all strings
+ * @param[out]  chain           Pointer to receive chain
+ * @return      Result of serialization. 0 - on success, -1 with errno set otherwise
+ *
+ * @note    Segments point into strings of serialized structure, so they should be neither changed nor released until
+ *          chain is written.
+ * @note    Blocks and segments are allocated by allocator of context (heap if it's not set) and are released by
+ *          @c yajp_serialization_chain_release(). Nothing is allocated on error.
+ */
+int yajp_serialize_json_chain(const yajp_deserialization_context_t *ctx, const void *address, size_t reference_size,
+                              yajp_serialization_chain_t *chain);
+
+/**
+ * Write chain to file descriptor by writev() calls. Partially written segments and interrupted calls are continued.
+ *
+ * @param[in]   fd      File descriptor in blocking mode, i.e. of file, pipe or socket
+ * @param[in]   chain   Pointer to chain
+ * @return      Result of writing. 0 - on success, -1 with errno set by writev() otherwise. Part of document can be
+ *              written already on error
+ */
+int yajp_serialization_chain_write(int fd, const yajp_serialization_chain_t *chain);
+
+/**
+ * Release blocks and segments of chain.
+ *
+ * @param[in]   chain   Pointer to chain filled by @c yajp_serialize_json_chain() or zeroed one
+ */
+void yajp_serialization_chain_release(yajp_serialization_chain_t *chain);
+
+/**
+ * Set escaping of non-ASCII characters by serialization with this context. In this mode strings are written in pure
+ * ASCII: UTF-8 sequences are written as \uXXXX escape sequences, characters outside of Basic Multilingual Plane as
+ * surrogate pairs, invalid sequences as \ufffd replacement character.
+ * @param[in]   ctx                 Pointer to initialized deserialization context
+ * @param[in]   escape_non_ascii    true - to escape non-ASCII characters, false - to write them as they are (default)
+ * @return      Result of setting escaping mode. 0 on success
+ *
+ * @note    Only escaping mode of context passed to serialization function is used.
+ */
+int yajp_serialization_context_set_escape_non_ascii(yajp_deserialization_context_t *ctx, bool escape_non_ascii);
+
+/**
+ * Set exact size mode of @c yajp_serialize_json_buffer() with this context. In this mode document is serialized in two
+ * passes, as by @c yajp_serialize_json_into(), into string allocated at once by measured size, so string isn't grown
+ * and is exactly as big as document with '\0'.
+ * @param[in]   ctx         Pointer to initialized deserialization context
+ * @param[in]   exact_size  true - to measure document before allocation, false - to grow string geometrically (default)
+ * @return      Result of setting exact size mode. 0 on success
+ *
+ * @note    Only exact size mode of context passed to serialization function is used.
+ */
+int yajp_serialization_context_set_exact_size(yajp_deserialization_context_t *ctx, bool exact_size);
+
+#endif //YAJP_SERIALIZATION_H
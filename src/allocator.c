@@ -0,0 +1,82 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * allocator.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+
+#include "yajp/allocator.h"
+
+static void *yajp_heap_alloc(size_t size, void *user);
+
+static void *yajp_heap_realloc(void *ptr, size_t old_size, size_t new_size, void *user);
+
+static void yajp_heap_free(void *ptr, void *user);
+
+static void *yajp_arena_allocator_alloc(size_t size, void *user);
+
+static void *yajp_arena_allocator_realloc(void *ptr, size_t old_size, size_t new_size, void *user);
+
+static void yajp_arena_allocator_free(void *ptr, void *user);
+
+const yajp_allocator_t yajp_heap_allocator = {
+        .alloc = yajp_heap_alloc,
+        .realloc = yajp_heap_realloc,
+        .free = yajp_heap_free,
+        .user = NULL
+};
+
+int yajp_arena_allocator_init(yajp_arena_t *arena, yajp_allocator_t *result) {
+    result->alloc = yajp_arena_allocator_alloc;
+    result->realloc = yajp_arena_allocator_realloc;
+    result->free = yajp_arena_allocator_free;
+    result->user = arena;
+
+    return 0;
+}
+
+static void *yajp_heap_alloc(size_t size, void *user) {
+    (void) user;
+    return malloc(size);
+}
+
+static void *yajp_heap_realloc(void *ptr, size_t old_size, size_t new_size, void *user) {
+    (void) old_size;
+    (void) user;
+    return realloc(ptr, new_size);
+}
+
+static void yajp_heap_free(void *ptr, void *user) {
+    (void) user;
+    free(ptr);
+}
+
+static void *yajp_arena_allocator_alloc(size_t size, void *user) {
+    return yajp_arena_alloc(user, size);
+}
+
+static void *yajp_arena_allocator_realloc(void *ptr, size_t old_size, size_t new_size, void *user) {
+    return yajp_arena_realloc(user, ptr, old_size, new_size);
+}
+
+static void yajp_arena_allocator_free(void *ptr, void *user) {
+    // memory is released with arena
+    (void) ptr;
+    (void) user;
+}
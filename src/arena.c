@@ -0,0 +1,202 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * arena.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdalign.h>
+#include <errno.h>
+
+#include "yajp/arena.h"
+
+#define YAJP_ARENA_ALIGNMENT    alignof(max_align_t)
+#define YAJP_ARENA_ALIGN(size)  (((size) + YAJP_ARENA_ALIGNMENT - 1) & ~(YAJP_ARENA_ALIGNMENT - 1))
+
+struct yajp_arena_block {
+    yajp_arena_block_t *next;           // next block in chain
+    size_t size;                        // size of data in bytes
+    size_t used;                        // amount of used bytes
+    alignas(max_align_t) uint8_t data[];
+};
+
+static yajp_arena_block_t *yajp_arena_find_block(yajp_arena_t *arena, size_t size);
+
+int yajp_arena_init(size_t block_size, yajp_arena_t *arena) {
+    memset(arena, 0, sizeof(*arena));
+    arena->block_size = YAJP_ARENA_ALIGN((0 == block_size) ? YAJP_ARENA_DEFAULT_BLOCK_SIZE : block_size);
+
+    return 0;
+}
+
+void *yajp_arena_alloc(yajp_arena_t *arena, size_t size) {
+    yajp_arena_block_t *block;
+    void *result;
+
+    if (SIZE_MAX - YAJP_ARENA_ALIGNMENT < size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size = YAJP_ARENA_ALIGN(size);
+
+    block = yajp_arena_find_block(arena, size);
+    if (NULL == block) {
+        return NULL; // errno set
+    }
+
+    result = block->data + block->used;
+    block->used += size;
+
+    arena->last_allocation = result;
+    arena->allocations++;
+
+    return result;
+}
+
+void *yajp_arena_realloc(yajp_arena_t *arena, void *ptr, size_t old_size, size_t new_size) {
+    yajp_arena_block_t *block = arena->current;
+    size_t *capacity, offset, new_capacity;
+    uint8_t *result;
+
+    if (SIZE_MAX - 2 * YAJP_ARENA_ALIGNMENT < new_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    // capacity of resizable memory is stored in front of it
+    if (NULL != ptr) {
+        capacity = (size_t *) ((uint8_t *) ptr - YAJP_ARENA_ALIGNMENT);
+
+        if (new_size <= *capacity) {
+            return ptr;
+        }
+
+        // last allocation of current block can be grown in place
+        if ((void *) capacity == arena->last_allocation) {
+            offset = (uint8_t *) ptr - block->data;
+            if (YAJP_ARENA_ALIGN(new_size) <= block->size - offset) {
+                block->used = offset + YAJP_ARENA_ALIGN(new_size);
+                *capacity = YAJP_ARENA_ALIGN(new_size);
+                return ptr;
+            }
+        }
+
+        // memory is moved, so grow it geometrically to keep cost of series of reallocations linear
+        new_capacity = (*capacity < (SIZE_MAX - 2 * YAJP_ARENA_ALIGNMENT) / 2 && new_size < 2 * *capacity)
+                ? 2 * *capacity
+                : new_size;
+    } else {
+        new_capacity = new_size;
+    }
+
+    new_capacity = YAJP_ARENA_ALIGN(new_capacity);
+
+    result = yajp_arena_alloc(arena, YAJP_ARENA_ALIGNMENT + new_capacity);
+    if (NULL == result) {
+        return NULL; // errno set
+    }
+
+    *((size_t *) result) = new_capacity;
+    result += YAJP_ARENA_ALIGNMENT;
+
+    if (NULL != ptr) {
+        memcpy(result, ptr, (old_size < new_size) ? old_size : new_size);
+    }
+
+    return result;
+}
+
+void yajp_arena_reset(yajp_arena_t *arena) {
+    arena->current = arena->first;
+    if (NULL != arena->current) {
+        arena->current->used = 0;
+    }
+
+    arena->last_allocation = NULL;
+    arena->allocations = 0;
+}
+
+void yajp_arena_release(yajp_arena_t *arena) {
+    yajp_arena_block_t *block, *next;
+
+    for (block = arena->first; NULL != block; block = next) {
+        next = block->next;
+        free(block);
+    }
+
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->last_allocation = NULL;
+    arena->allocations = 0;
+}
+
+/**
+ * Helper function. Finds block with enough free space starting from current block. Blocks left after reset are reused,
+ * new block is allocated and added to the end of chain if there is no such block.
+ *
+ * @param arena[in]     Pointer to arena
+ * @param size[in]      Aligned size of allocation
+ *
+ * @return  Pointer to block or NULL on error
+ */
+static yajp_arena_block_t *yajp_arena_find_block(yajp_arena_t *arena, size_t size) {
+    yajp_arena_block_t *block = arena->current, *last = NULL;
+    size_t block_size;
+
+    for (; NULL != block; block = block->next) {
+        if (block != arena->current) {
+            block->used = 0; // block wasn't used since reset
+        }
+
+        if (size <= block->size - block->used) {
+            arena->current = block;
+            return block;
+        }
+
+        last = block;
+    }
+
+    block_size = (size > arena->block_size) ? size : arena->block_size;
+    if (SIZE_MAX - sizeof(*block) < block_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    block = malloc(sizeof(*block) + block_size);
+    if (NULL == block) {
+        return NULL; // errno set
+    }
+
+    block->next = NULL;
+    block->size = block_size;
+    block->used = 0;
+
+    if (NULL != last) {
+        last->next = block;
+    } else {
+        arena->first = block; // arena doesn't have blocks yet
+    }
+
+    arena->current = block;
+    arena->blocks_allocations++;
+
+    return block;
+}
@@ -0,0 +1,110 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * context_handle.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+#include "yajp/context_handle.h"
+
+/**
+ * Amount of yields of swapping thread before it starts to sleep between checks of readers
+ */
+#define YAJP_CONTEXT_HANDLE_SPINS   64
+
+static void yajp_context_handle_wait(unsigned long *readers);
+
+int yajp_context_handle_init(const yajp_deserialization_context_t *ctx, yajp_context_handle_t *handle) {
+    if (NULL == ctx) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    handle->current = ctx;
+    handle->readers[0] = 0;
+    handle->readers[1] = 0;
+    handle->epoch = 0;
+    handle->swapping = false;
+
+    return 0;
+}
+
+const yajp_deserialization_context_t *yajp_context_handle_acquire(yajp_context_handle_t *handle,
+                                                                  yajp_context_ref_t *ref) {
+    ref->slot = __atomic_load_n(&handle->epoch, __ATOMIC_SEQ_CST) & 1;
+    __atomic_fetch_add(&handle->readers[ref->slot], 1, __ATOMIC_SEQ_CST);
+
+    // counted before version is loaded, so swap what replaced loaded version waits for this reference
+    ref->ctx = __atomic_load_n(&handle->current, __ATOMIC_SEQ_CST);
+    return ref->ctx;
+}
+
+void yajp_context_handle_release(yajp_context_handle_t *handle, const yajp_context_ref_t *ref) {
+    __atomic_fetch_sub(&handle->readers[ref->slot], 1, __ATOMIC_RELEASE);
+}
+
+const yajp_deserialization_context_t *yajp_context_handle_swap(yajp_context_handle_t *handle,
+                                                               const yajp_deserialization_context_t *ctx) {
+    const yajp_deserialization_context_t *old;
+    unsigned long epoch;
+    int i;
+
+    if (NULL == ctx) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    while (__atomic_test_and_set(&handle->swapping, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+
+    old = __atomic_exchange_n(&handle->current, ctx, __ATOMIC_SEQ_CST);
+
+    // references to old version are counted in both slots: reader could load epoch before previous swap advanced
+    // it. Every slot is drained after new references were moved to another one, so readers don't starve swap
+    for (i = 0; i < 2; i++) {
+        epoch = __atomic_add_fetch(&handle->epoch, 1, __ATOMIC_SEQ_CST);
+        yajp_context_handle_wait(&handle->readers[(epoch - 1) & 1]);
+    }
+
+    __atomic_clear(&handle->swapping, __ATOMIC_RELEASE);
+
+    return old;
+}
+
+/**
+ * Helper function. Waits until all references counted by slot are released.
+ *
+ * @param readers[in]   Counter of references of slot
+ */
+static void yajp_context_handle_wait(unsigned long *readers) {
+    const struct timespec pause = { .tv_sec = 0, .tv_nsec = 100000 };
+    int spins = 0;
+
+    while (0 != __atomic_load_n(readers, __ATOMIC_SEQ_CST)) {
+        if (spins < YAJP_CONTEXT_HANDLE_SPINS) {
+            sched_yield();
+            spins++;
+        } else {
+            nanosleep(&pause, NULL);
+        }
+    }
+}
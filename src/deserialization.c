@@ -23,670 +23,2304 @@
 #include "lexer.h"
 #include "parser.h"
 #include "deserialization_misc.h"
+#include "read_ahead.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+
+/**
+ * Number of elements memory is allocated for when array gets its first element
+ */
+#define YAJP_ARRAY_INITIAL_CAPACITY     4
+
+/**
+ * Number of frames of deserialization stack kept on thread stack. Deeper documents move stack to heap
+ */
+#define YAJP_FRAMES_INLINE_CAPACITY     8
+
+/**
+ * Number of tokens kept by deserialization. Value recognized by parser is one of two last picked tokens
+ */
+#define YAJP_TOKENS_RING                3
+
+/**
+ * Lexer buffers bigger than this aren't kept by session of thread, so the single huge token doesn't pin memory
+ */
+#define YAJP_SESSION_MAX_BUFFER_SIZE    (64 * 1024)
+
+/**
+ * Frame of deserialization stack. Describes object or array (or row of array) what is being filled, so nesting of
+ * document is kept in memory of stack instead of recursion.
+ */
+typedef struct yajp_deserialization_frame {
+    const yajp_deserialization_context_t *ctx;  // context of object. NULL for array
+    const yajp_deserialization_rule_t *action;  // rule of array or of object value. NULL for root object
+    void *address;                              // filling object or array holder
+    void *slot;                                 // field where allocated object or holder is stored on success or NULL
+    bool reused;                                // allocated object or holder is taken from slot in reuse mode
+    bool reused_final_dim;                      // final dimension flag of previous array in reuse mode
+    size_t row_shift;                           // size of filled items of array in bytes
+    size_t capacity;                            // size of memory of array items in bytes
+    size_t reused_count;                        // amount of items of previous array in reuse mode
+    size_t name_frame;                          // index of frame what holds name of array
+    yajp_lexer_token_t name;                    // name of array. Held only by frame of array value
+    size_t released;                            // index of next rule or item released by unwinding
+} yajp_deserialization_frame_t;
+
+/**
+ * Value what is being deserialized by following tokens before they are passed to the top of deserialization stack
+ */
+typedef enum yajp_deserialization_pending {
+    YAJP_DESERIALIZATION_PENDING_NONE = 0,      // tokens belong to object or array on the top of stack
+    YAJP_DESERIALIZATION_PENDING_PRIMITIVE,     // value of primitive field and token terminating it
+    YAJP_DESERIALIZATION_PENDING_ARRAY,         // opening bracket of array field
+    YAJP_DESERIALIZATION_PENDING_SKIP,          // value of field without rule
+} yajp_deserialization_pending_t;
 
 typedef struct yajp_deserialization_data {
     void *user_data;
     void *parser;
     yajp_lexer_input_t *lexer_input;
+    const yajp_allocator_t *allocator;  // allocator of lexer and parser memory
+    const yajp_allocator_t *output;     // allocator of deserialized strings, arrays and objects
+    yajp_token_type_t value_end;        // token which terminated last primitive value, i.e. comma or end of object
+    bool reuse;                         // memory of previously deserialized values is reused
+    yajp_deserialization_size_hints_t *size_hints;  // sizes learned from previous documents or NULL
+    yajp_deserialization_frame_t *frames;   // deserialization stack. Allocated by allocator of lexer and parser if
+                                            // it doesn't fit into YAJP_FRAMES_INLINE_CAPACITY frames
+    size_t frames_count;                // amount of frames in stack
+    size_t frames_capacity;             // amount of frames what fit into memory of stack
+    size_t depth;                       // nesting depth of objects and arrays at current token
+    size_t max_depth;                   // maximal nesting depth of document
+    yajp_lexer_token_t tokens[YAJP_TOKENS_RING];    // the last picked tokens
+    size_t tokens_count;                // amount of picked tokens
+    yajp_deserialization_pending_t pending;         // value what takes following tokens
+    const yajp_deserialization_rule_t *pending_action;  // rule of pending value
+    void *pending_address;              // field of pending value
+    size_t pending_tokens;              // amount of tokens taken by pending value
+    size_t open_brackets;               // amount of open objects and arrays of skipped value
+    yajp_lexer_token_t name;            // key of pending value
 } yajp_deserialization_data_t;
 
+/**
+ * State of incremental deserialization. Holds everything what is kept between steps
+ */
+struct yajp_step_state {
+    const yajp_deserialization_context_t *ctx;
+    yajp_lexer_input_t lexer_input;
+    yajp_deserialization_data_t data;
+    yajp_deserialization_frame_t frames[YAJP_FRAMES_INLINE_CAPACITY];
+    int result;                         // YAJP_STEP_NEED_MORE_INPUT till document is done, then result of document
+    int error;                          // errno of failed document
+};
+
+/**
+ * Memory of lexer and parser kept between deserializations. Session of thread is used with heap allocator only,
+ * sessions of workers are owned by them
+ */
+struct yajp_deserialization_session {
+    const yajp_allocator_t *allocator;          // allocator of kept memory
+    void *parser;                               // reset parser with its grown stack
+    uint8_t *buffer;                            // lexer buffer
+    size_t buffer_size;
+    yajp_deserialization_frame_t *frames;       // heap deserialization stack
+    size_t frames_capacity;
+    bool busy;                                  // session is used by deserialization on this thread
+};
+
+static pthread_key_t yajp_session_key;                  // releases session at thread exit
+static pthread_once_t yajp_session_key_once = PTHREAD_ONCE_INIT;
+static bool yajp_session_key_created;
+static _Thread_local yajp_deserialization_session_t *yajp_thread_session;
+
 // function prototypes
+static int yajp_deserialize(FILE *json, const yajp_deserialization_context_t *ctx, void *address, void *user_data,
+                            const yajp_allocator_t *allocator, const yajp_allocator_t *output, size_t read_ahead);
+static int yajp_deserialize_in_arena(FILE *json, const yajp_deserialization_context_t *ctx, void *address,
+                                     void *user_data, yajp_arena_t *arena, size_t read_ahead);
+static int yajp_deserialize_in_session(yajp_deserialization_session_t *session, FILE *json, const char *text,
+                                       size_t text_size, const yajp_deserialization_context_t *ctx, void *address,
+                                       void *user_data, const yajp_allocator_t *allocator,
+                                       const yajp_allocator_t *output, size_t read_ahead);
+
 static int yajp_parse(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx, void *address);
 
+static void yajp_init_data(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                           yajp_lexer_input_t *lexer_input, void *parser, void *user_data,
+                           const yajp_allocator_t *allocator, const yajp_allocator_t *output,
+                           yajp_deserialization_frame_t *frames);
+
+static int yajp_parse_begin(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                            void *address);
+
+static int yajp_parse_next_token(yajp_deserialization_data_t *data);
+
+static void yajp_parse_end(yajp_deserialization_data_t *data, int result);
+
+static int yajp_parse_token(yajp_deserialization_data_t *data,
+                            yajp_token_type_t token,
+                            const yajp_parser_recognized_entity_t *recognized);
+
 static int yajp_deserialize_value(yajp_deserialization_data_t *data,
                                   const yajp_deserialization_context_t *ctx,
                                   const yajp_lexer_token_t *name,
                                   void *deserializing_struct);
 
-static int yajp_skip_json_object(yajp_deserialization_data_t *data);
+static int yajp_parse_skipped_token(yajp_deserialization_data_t *data, yajp_token_type_t token);
 
-static int yajp_parse_primitive_value(yajp_deserialization_data_t *data,
-                                      const yajp_lexer_token_t *name,
-                                      const yajp_deserialization_rule_t *action,
-                                      void *address);
+static int yajp_feed_parser(yajp_deserialization_data_t *data, const yajp_lexer_token_t *token,
+                            yajp_parser_recognized_entity_t *entity);
 
-static int yajp_parse_array_value(yajp_deserialization_data_t *data,
-                                  const yajp_lexer_token_t *name,
-                                  const yajp_deserialization_rule_t *action,
-                                  void *address);
+static int yajp_parser_stack_size(size_t depth);
+static yajp_deserialization_session_t *yajp_session_acquire(const yajp_allocator_t *allocator);
+static void yajp_session_create_key(void);
+static void yajp_session_destroy(void *session);
+static void yajp_session_release_memory(yajp_deserialization_session_t *session);
 
-static int yajp_parse_array_value_internal(yajp_deserialization_data_t *data,
-                                           const yajp_lexer_token_t *name,
-                                           const yajp_deserialization_rule_t *action,
-                                           void *address);
+static int yajp_parse_primitive_token(yajp_deserialization_data_t *data,
+                                      yajp_token_type_t token,
+                                      const yajp_parser_recognized_entity_t *recognized);
 
-static int yajp_parse_object_value(yajp_deserialization_data_t *data,
-                                   const yajp_deserialization_rule_t *action,
-                                   void *address);
+static void yajp_set_pending(yajp_deserialization_data_t *data,
+                             yajp_deserialization_pending_t pending,
+                             const yajp_deserialization_rule_t *action,
+                             void *address);
 
-static int yajp_parse_array_of_objects_value(yajp_deserialization_data_t *data,
-                                             const yajp_deserialization_rule_t *action,
-                                             void *address);
+static void yajp_end_pending(yajp_deserialization_data_t *data);
 
-static int yajp_parse_array_of_objects_value_internal(yajp_deserialization_data_t *data,
-                                                      const yajp_deserialization_rule_t *action,
-                                                      void *address);
+static void yajp_end_object(yajp_deserialization_data_t *data);
 
+static int yajp_parse_object_token(yajp_deserialization_data_t *data,
+                                   yajp_token_type_t token,
+                                   const yajp_parser_recognized_entity_t *recognized);
 
+static int yajp_parse_array_token(yajp_deserialization_data_t *data,
+                                  yajp_token_type_t token,
+                                  const yajp_parser_recognized_entity_t *recognized);
 
+static int yajp_begin_array_value(yajp_deserialization_data_t *data, yajp_token_type_t token);
 
-int yajp_deserialize_json_string(const char *json, size_t json_size, const yajp_deserialization_context_t *ctx,
-                                 void *address, void *user_data) {
-    FILE *json_stream;
-    void *parser;
-    yajp_lexer_input_t lexer_input;
-    int result;
-    yajp_deserialization_data_t deserialization_data;
+static int yajp_begin_object_value(yajp_deserialization_data_t *data,
+                                   const yajp_deserialization_rule_t *action,
+                                   void *address);
 
-#if DEBUG
-    yajp_parser_trace(stderr, "parser => ");
-#endif
+static int yajp_push_object_frame(yajp_deserialization_data_t *data,
+                                  const yajp_deserialization_context_t *ctx,
+                                  void *address,
+                                  const yajp_deserialization_rule_t *action,
+                                  void *slot,
+                                  bool reused);
 
-    // it's ok to cast from `const char *` to `char *` because stream will be created for readonly
-    json_stream = fmemopen((char *) json, json_size, "r");
+static int yajp_push_array_frame(yajp_deserialization_data_t *data,
+                                 const yajp_deserialization_rule_t *action,
+                                 void *address,
+                                 void *slot,
+                                 bool reused,
+                                 size_t name_frame);
 
-    if (NULL == json_stream) {
-        result = -1; // errno set
-        goto end;
-    }
+static yajp_deserialization_frame_t *yajp_push_frame(yajp_deserialization_data_t *data);
 
-    if (yajp_lexer_init_input(json_stream, &lexer_input)) {
-        result = -1; // errno set
-        goto release_stream;
-    }
+static void yajp_unwind_frames(yajp_deserialization_data_t *data);
 
-    parser = yajp_parser_allocate(malloc);
-    if (NULL == parser) {
-        result = -1; // errno set
-        goto release_lexer;
-    }
+static void yajp_release_nested(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                                const yajp_deserialization_rule_t *action, void *address);
 
-    yajp_parser_init(parser);
+static bool yajp_push_release_frame(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                                    const yajp_deserialization_rule_t *action, void *address, void *slot);
 
-    deserialization_data.lexer_input = &lexer_input;
-    deserialization_data.parser = parser;
-    deserialization_data.user_data = user_data;
+static void yajp_release_array_storage(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                                       void *address);
 
-    result = yajp_parse(&deserialization_data, ctx, address);
+static void yajp_move_token(yajp_lexer_token_t *destination, yajp_lexer_token_t *source);
 
-#ifdef YAJP_TRACK_STREAM
-    if (YAJP_DESERIALIZATION_RESULT_STATUS_OK != deserialization_result.status) {
-        deserialization_result.line_num = lexer_input.line_num;
-        deserialization_result.column_num = lexer_input.column_num;
-    }
-#endif
+static void *yajp_get_setter_user_data(const yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action);
 
-    yajp_parser_release(parser, free);
+static void *yajp_output_alloc(yajp_deserialization_data_t *data, size_t size);
 
-release_lexer:
-    yajp_lexer_release_input(&lexer_input);
-release_stream:
-    fclose(json_stream);
-end:
-    return result;
-}
+static void *yajp_output_realloc(yajp_deserialization_data_t *data, void *ptr, size_t old_size, size_t new_size);
 
-int yajp_deserialize_json_stream(FILE *json, const yajp_deserialization_context_t *ctx, void *address, void *user_data) {
-    void *parser;
-    yajp_lexer_input_t lexer_input;
-    int result;
-    yajp_deserialization_data_t deserialization_data;
+static void yajp_output_free(yajp_deserialization_data_t *data, void *ptr);
 
-#if DEBUG
-    yajp_parser_trace(stderr, "parser => ");
-#endif
+static void *yajp_output_reuse(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action, void *slot,
+                               size_t size);
 
-    if (yajp_lexer_init_input(json, &lexer_input)) {
-        result = -1; // errno set
-        goto end;
-    }
+static size_t *yajp_string_capacity(const yajp_deserialization_rule_t *action, void *slot);
 
-    parser = yajp_parser_allocate(malloc);
-    if (NULL == parser) {
-        result = -1; // errno set
-        goto release_lexer;
-    }
+static int yajp_output_grow(yajp_deserialization_data_t *data, void *slot, size_t *capacity, size_t size,
+                            size_t hint);
 
-    yajp_parser_init(parser);
+static size_t yajp_array_size_hint(const yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                                   bool elems, size_t capacity);
 
-    deserialization_data.lexer_input = &lexer_input;
-    deserialization_data.parser = parser;
-    deserialization_data.user_data = user_data;
+static void yajp_update_size_hint(size_t *hint, size_t size);
 
-    result = yajp_parse(&deserialization_data, ctx, address);
+static void yajp_finish_array(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                              void *address, size_t capacity, size_t size);
 
-#ifdef YAJP_TRACK_STREAM
-    if (YAJP_DESERIALIZATION_RESULT_STATUS_OK != deserialization_result.status) {
-        deserialization_result.line_num = lexer_input.line_num;
-        deserialization_result.column_num = lexer_input.column_num;
-    }
-#endif
+static void yajp_reuse_array(const yajp_deserialization_rule_t *action, void *address, size_t *capacity,
+                             size_t *reused_count);
 
-    yajp_parser_release(parser, free);
+static void yajp_reshape_array(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                               void *address, bool reused_final_dim, size_t *capacity, size_t *reused_count);
 
-release_lexer:
-    yajp_lexer_release_input(&lexer_input);
-end:
-    return result;
-}
+static void yajp_finish_reused_array(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                                     void *address, bool reused_final_dim, size_t reused_count);
 
-static int yajp_parse(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx, void *address) {
-#define TOKENS_CNT 3
-    yajp_lexer_token_t tokens[TOKENS_CNT];
-    yajp_lexer_token_t *current_token;
-    yajp_token_type_t last_token;
-    yajp_parser_recognized_entity_t recognized_entity;
-    int i = 0, ret, result = 0;
+static int yajp_fit_inline_string(const yajp_deserialization_rule_t *action, const uint8_t *value, size_t capacity,
+                                  size_t *value_size);
 
-    memset(tokens, 0, sizeof(tokens));
+static bool yajp_context_owns_memory(const yajp_deserialization_context_t *ctx);
 
-    do {
-        current_token = &tokens[i % TOKENS_CNT];
-        ret = yajp_lexer_get_next_token(data->lexer_input, current_token);
-        if (ret) {
-            result = -1; // errno set
-            goto end;
-        }
-        last_token = current_token->token;
+static void yajp_release_object(const yajp_allocator_t *allocator, const yajp_deserialization_context_t *ctx,
+                                void *address);
 
-        recognized_entity.type = YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_NONE;
-        yajp_parser_parse(data->parser, last_token, current_token, &recognized_entity);
+static void yajp_release_value(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                               void *address);
 
-        if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_KEY == recognized_entity.type) {
-            ret = yajp_deserialize_value(data, ctx, recognized_entity.token, address);
-            if (ret) {
-                result = -1;
-                goto end;
-            }
-        }
+static void yajp_release_array(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                               void *address);
 
-        i++;
-        if (i >= TOKENS_CNT) {
-            current_token = &tokens[i % TOKENS_CNT];
-            yajp_lexer_release_token(current_token);
-        }
+static void yajp_release_array_items(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                                     void *address, size_t first, size_t last);
 
-    } while ((YAJP_TOKEN_EOF != last_token) && (YAJP_TOKEN_OEND != last_token));
+static void yajp_release_memory(const yajp_allocator_t *allocator, void *slot);
 
-end:
-    for (i = 0; i < TOKENS_CNT; i++) {
-        current_token = &tokens[i % TOKENS_CNT];
-        yajp_lexer_release_token(current_token);
-    }
 
-    return result;
 
-#undef TOKENS_CNT
+
+int yajp_deserialize_json_string(const char *json, size_t json_size, const yajp_deserialization_context_t *ctx,
+                                 void *address, void *user_data) {
+    return yajp_deserialize_json_string_with_allocator(json, json_size, ctx, address, user_data, NULL);
 }
 
-static int yajp_deserialize_value(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
-                                  const yajp_lexer_token_t *name, void *address) {
-    const yajp_deserialization_rule_t *action;
-    int result;
+int yajp_deserialize_json_stream(FILE *json, const yajp_deserialization_context_t *ctx, void *address, void *user_data) {
+    return yajp_deserialize_json_stream_with_allocator(json, ctx, address, user_data, NULL);
+}
 
-    action = yajp_find_action(ctx, name->attributes.value, name->attributes.value_size);
+int yajp_deserialize_json_string_with_allocator(const char *json, size_t json_size,
+                                                const yajp_deserialization_context_t *ctx, void *address,
+                                                void *user_data, const yajp_allocator_t *allocator) {
+    FILE *json_stream;
+    int result, error;
 
-    // TODO: Add handling of unknown json items
-    if (NULL != action) {
-        address += action->field_offset;
+    // it's ok to cast from `const char *` to `char *` because stream will be created for readonly
+    json_stream = fmemopen((char *) json, json_size, "r");
 
-        switch (action->options & 0b00011111) {
-            case YAJP_DESERIALIZATION_TYPE_NUMBER:
-            case YAJP_DESERIALIZATION_TYPE_STRING:
-            case YAJP_DESERIALIZATION_TYPE_BOOLEAN:
-                result = yajp_parse_primitive_value(data, name, action, address);
-                break;
-            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER):
-            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING):
-            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_BOOLEAN):
-                result = yajp_parse_array_value(data, name, action, address);
-                break;
-            case (YAJP_DESERIALIZATION_TYPE_OBJECT):
-                result = yajp_parse_object_value(data, action, address);
-                break;
-            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT):
-                result = yajp_parse_array_of_objects_value(data, action, address);
-                break;
-            default:
-                result = -1;
-                break;
-        }
-    } else {
-        result = yajp_skip_json_object(data);
+    if (NULL == json_stream) {
+        return -1; // errno set
     }
 
-    return result;
-}
+    if (NULL == allocator) {
+        allocator = (NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+    }
 
-static int yajp_parse_primitive_value(yajp_deserialization_data_t *data, const yajp_lexer_token_t *name,
-                                      const yajp_deserialization_rule_t *action, void *address) {
-#define TOKENS_CNT 2 // 2 tokens should be enough to handle value and wait until parser recognize pair
-    yajp_lexer_token_t tokens[TOKENS_CNT];
-    yajp_lexer_token_t *current_token;
-    yajp_parser_recognized_entity_t recognized_entity;
-    size_t allocation_size;
-    int i = 0, setter_result, result = 0;
+    // string is in memory already, so it isn't read ahead
+    result = yajp_deserialize(json_stream, ctx, address, user_data, allocator, allocator, 0);
 
-    memset(tokens, 0, sizeof(tokens));
+    // memory stream has no descriptor, closing it can touch errno of failed deserialization
+    error = errno;
+    fclose(json_stream);
+    errno = error;
 
-    do {
-        current_token = &tokens[i];
-        i++;
+    return result;
+}
 
-        yajp_lexer_get_next_token(data->lexer_input, current_token);
+int yajp_deserialize_json_stream_with_allocator(FILE *json, const yajp_deserialization_context_t *ctx, void *address,
+                                                void *user_data, const yajp_allocator_t *allocator) {
+    if (NULL == allocator) {
+        allocator = (NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+    }
 
-        recognized_entity.type = YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_NONE;
-        yajp_parser_parse(data->parser, current_token->token, current_token, &recognized_entity);
+    return yajp_deserialize(json, ctx, address, user_data, allocator, allocator, ctx->read_ahead);
+}
 
-        if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_PAIR == recognized_entity.type) {
+int yajp_deserialize_json_string_in_arena(const char *json, size_t json_size, const yajp_deserialization_context_t *ctx,
+                                          void *address, void *user_data, yajp_arena_t *arena) {
+    FILE *json_stream;
+    int result, error;
 
-            if (action->allocate) {
-                allocation_size = recognized_entity.token->attributes.value_size + action->elem_size;
-                void *tmp = malloc(allocation_size);
-                if (NULL == tmp) {
-                    result = -1;
-                    goto end;
-                }
+    // it's ok to cast from `const char *` to `char *` because stream will be created for readonly
+    json_stream = fmemopen((char *) json, json_size, "r");
 
-                setter_result = action->setter(name->attributes.value, name->attributes.value_size,
-                                               recognized_entity.token->attributes.value,
-                                               recognized_entity.token->attributes.value_size, tmp, data->user_data);
+    if (NULL == json_stream) {
+        return -1; // errno set
+    }
 
-                if (0 != setter_result) {
-                    free(tmp);
-                    tmp = NULL;
-                }
+    result = yajp_deserialize_in_arena(json_stream, ctx, address, user_data, arena, 0);
 
-                *(void **) address = tmp;
+    // memory stream has no descriptor, closing it can touch errno of failed deserialization
+    error = errno;
+    fclose(json_stream);
+    errno = error;
 
-            } else {
-                setter_result = action->setter(name->attributes.value, name->attributes.value_size,
-                        recognized_entity.token->attributes.value, recognized_entity.token->attributes.value_size,
-                        address, data->user_data);
-            }
+    return result;
+}
 
-            if (0 != setter_result) {
-                result = -1;
-                goto end;
-            }
-        }
+int yajp_deserialize_json_stream_in_arena(FILE *json, const yajp_deserialization_context_t *ctx, void *address,
+                                          void *user_data, yajp_arena_t *arena) {
+    return yajp_deserialize_in_arena(json, ctx, address, user_data, arena, ctx->read_ahead);
+}
 
-    } while (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_PAIR != recognized_entity.type);
+yajp_deserialization_session_t *yajp_deserialization_session_create(const yajp_allocator_t *allocator) {
+    yajp_deserialization_session_t *session = calloc(1, sizeof(*session));
 
-end:
-    for (i = 0; i < TOKENS_CNT; i++) {
-        yajp_lexer_release_token(&tokens[i]);
+    if (NULL == session) {
+        return NULL; // errno set
     }
-    return result;
 
-#undef TOKENS_CNT
+    session->allocator = (NULL != allocator) ? allocator : &yajp_heap_allocator;
+    return session;
 }
 
-static int yajp_skip_json_object(yajp_deserialization_data_t *data) {
-    yajp_lexer_token_t picked_token = {0};
-    yajp_parser_recognized_entity_t recognized_entity;
-    yajp_token_type_t picked_token_type;
-    int open_brackets_count;
-
-    // look forward to see next token and decide strategy;
-    if (yajp_lexer_get_next_token(data->lexer_input, &picked_token)) {
-        return -1; // unrecognized token
-    }
-    picked_token_type = picked_token.token;
-
-    yajp_parser_parse(data->parser, picked_token.token, &picked_token, &recognized_entity);
-    yajp_lexer_release_token(&picked_token);
-
-    switch (picked_token_type) {
-        case YAJP_TOKEN_EOF:
-            return -1; // unexpected eof
-        case YAJP_TOKEN_OBEGIN:
-        case YAJP_TOKEN_ABEGIN: { // skipping object or array
-            open_brackets_count = 1;
-            do {
-                if (yajp_lexer_get_next_token(data->lexer_input, &picked_token)) {
-                    return -1; // unrecognized token
-                }
+int yajp_deserialize_json_text(yajp_deserialization_session_t *session, const char *json, size_t json_size,
+                               const yajp_deserialization_context_t *ctx, void *address, void *user_data) {
+    int result;
 
-                if ((YAJP_TOKEN_OBEGIN == picked_token.token) || (YAJP_TOKEN_ABEGIN == picked_token.token)) {
-                    open_brackets_count++;
-                } else if ((YAJP_TOKEN_OEND == picked_token.token) || (YAJP_TOKEN_AEND == picked_token.token)) {
-                    open_brackets_count--;
-                }
+    if (NULL != session) {
+        return yajp_deserialize_in_session(session, NULL, json, json_size, ctx, address, user_data, session->allocator,
+                                           session->allocator, 0);
+    }
 
-                yajp_parser_parse(data->parser, picked_token.token, &picked_token, &recognized_entity);
-                yajp_lexer_release_token(&picked_token);
-            } while (open_brackets_count != 0);
+    session = yajp_session_acquire(&yajp_heap_allocator);
+    result = yajp_deserialize_in_session(session, NULL, json, json_size, ctx, address, user_data, &yajp_heap_allocator,
+                                         &yajp_heap_allocator, 0);
 
-            return 0;
-        }
-        case YAJP_TOKEN_NUMBER:
-        case YAJP_TOKEN_STRING:
-        case YAJP_TOKEN_BOOLEAN:
-        case YAJP_TOKEN_NULL: { // skipping primitives
-            do {
-                if (yajp_lexer_get_next_token(data->lexer_input, &picked_token)) {
-                    return -1; // unrecognized token
-                }
-                picked_token_type = picked_token.token;
-                yajp_parser_parse(data->parser, picked_token.token, &picked_token, &recognized_entity);
-                yajp_lexer_release_token(&picked_token);
-            } while ((YAJP_TOKEN_COMMA != picked_token_type) && (YAJP_TOKEN_OEND != picked_token_type));
+    if (NULL != session) {
+        session->busy = false;
+    }
 
-            return 0;
-        }
-        default:
-            return -1; // value expected
+    return result;
+}
+
+void yajp_deserialization_session_release(yajp_deserialization_session_t *session) {
+    if (NULL != session) {
+        yajp_session_release_memory(session);
+        free(session);
     }
 }
 
-static int yajp_parse_array_value(yajp_deserialization_data_t *data, const yajp_lexer_token_t *name,
-                                  const yajp_deserialization_rule_t *action, void *address) {
-    yajp_lexer_token_t current_token;
-    yajp_parser_recognized_entity_t recognized_entity;
-    int result;
+void yajp_deserialization_release_thread_session(void) {
+    yajp_deserialization_session_t *session = yajp_thread_session;
 
-    yajp_lexer_get_next_token(data->lexer_input, &current_token);
-    if (YAJP_TOKEN_ABEGIN != current_token.token) {
-        result = -1; // expected [ token
-        goto end;
+    if (NULL != session && !session->busy) {
+        pthread_setspecific(yajp_session_key, NULL);
+        yajp_session_destroy(session);
     }
+}
 
-    yajp_parser_parse(data->parser, current_token.token, &current_token, &recognized_entity);
+void yajp_deserialization_free(const yajp_deserialization_context_t *ctx, void *address) {
+    yajp_deserialization_free_with_allocator(ctx, address, NULL);
+}
 
-    if (action->allocate) {
-        void *tmp = malloc(action->field_size);
-        if (NULL == tmp) {
-            return -1; // errno set
-        }
-        memset(tmp, 0, action->field_size);
-        result = yajp_parse_array_value_internal(data, name, action, tmp);
+void yajp_deserialization_free_with_allocator(const yajp_deserialization_context_t *ctx, void *address,
+                                              const yajp_allocator_t *allocator) {
+    yajp_deserialization_frame_t frames[YAJP_FRAMES_INLINE_CAPACITY];
+    yajp_deserialization_data_t data;
 
-        if (0 != result) {
-            free(tmp);
-            goto end;
-        } else {
-            *(void **) address = tmp;
-        }
-    } else {
-        memset(address, 0, action->field_size);
-        result = yajp_parse_array_value_internal(data, name, action, address);
+    if (NULL == allocator) {
+        allocator = (NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
     }
 
-    end:
-    yajp_lexer_release_token(&current_token);
-    return result;
+    // only stack of nested values is needed to walk structure
+    data.allocator = allocator;
+    data.output = allocator;
+    data.frames = frames;
+    data.frames_count = 0;
+    data.frames_capacity = YAJP_FRAMES_INLINE_CAPACITY;
+
+    yajp_release_nested(&data, ctx, NULL, address);
+
+    if (frames != data.frames) {
+        allocator->free(data.frames, allocator->user);
+    }
 }
 
-static int yajp_parse_array_value_internal(yajp_deserialization_data_t *data, const yajp_lexer_token_t *name,
-                                           const yajp_deserialization_rule_t *action, void *address) {
-#define TOKEN_CNT 3
-    yajp_lexer_token_t tokens[TOKEN_CNT];
-    yajp_lexer_token_t *current_token;
-    yajp_token_type_t picked_token;
+int yajp_step_start(const yajp_deserialization_context_t *ctx, void *address, void *user_data,
+                    yajp_step_state_t **state) {
+    const yajp_allocator_t *allocator = (NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+    size_t buffer_size = (NULL != ctx->size_hints)
+                         ? __atomic_load_n(&ctx->size_hints->buffer_size, __ATOMIC_RELAXED)
+                         : 0;
+    yajp_step_state_t *step;
+    void *parser;
 
-    yajp_parser_recognized_entity_t recognized_entity;
-    int i = 0, setter_result, result = 0;
-    size_t row_shift = 0;
-    void *elem_address;
+    step = allocator->alloc(sizeof(*step), allocator->user);
+    if (NULL == step) {
+        return -1; // errno set
+    }
 
-    size_t *count = address + action->counter_offset;
-    bool *final_dim = address + action->final_dym_offset;
+    parser = allocator->alloc(yajp_parser_size(), allocator->user);
+    if (NULL == parser) {
+        goto release_step;
+    }
 
-    *final_dim = true;
+    if (yajp_lexer_init_pushed_input(allocator, buffer_size, &step->lexer_input)) {
+        goto release_parser;
+    }
 
-    memset(tokens, 0, sizeof(tokens));
+    yajp_parser_init_with_stack(parser, allocator,
+                                yajp_parser_stack_size(ctx->stack_depth < ctx->max_depth
+                                                       ? ctx->stack_depth : ctx->max_depth),
+                                yajp_parser_stack_size(ctx->max_depth));
 
-    do {
-        current_token = &tokens[i % TOKEN_CNT];
-        i++;
+    yajp_init_data(&step->data, ctx, &step->lexer_input, parser, user_data, allocator, allocator, step->frames);
+    if (0 != yajp_parse_begin(&step->data, ctx, address)) {
+        yajp_parser_finalize(parser);
+        yajp_lexer_release_input(&step->lexer_input);
+        goto release_parser;
+    }
 
-        yajp_lexer_get_next_token(data->lexer_input, current_token);
-        picked_token = current_token->token;
+    step->ctx = ctx;
+    step->result = YAJP_STEP_NEED_MORE_INPUT;
+    step->error = 0;
 
-        recognized_entity.type = YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_NONE;
-        yajp_parser_parse(data->parser, picked_token, current_token, &recognized_entity);
+    *state = step;
+    return 0;
 
-        if (YAJP_TOKEN_ABEGIN == picked_token) {
-            *final_dim = false;
+release_parser:
+    allocator->free(parser, allocator->user);
+release_step:
+    allocator->free(step, allocator->user);
+    return -1; // errno set
+}
 
-            elem_address = *(void **) (address + action->rows_offset);
-            elem_address = realloc(elem_address, row_shift + action->field_size);
+int yajp_step(yajp_step_state_t *state, const char *input, size_t input_size, bool last) {
+    yajp_deserialization_data_t *data = &state->data;
+    int result = 0;
 
-            if (NULL == elem_address) {
-                result = -1; // errno set
-                goto end;
-            }
+    // document is done, steps only repeat its result
+    if (YAJP_STEP_NEED_MORE_INPUT != state->result) {
+        errno = state->error;
+        return state->result;
+    }
 
-            memset(elem_address + row_shift, 0, action->field_size);
+#if DEBUG
+    yajp_parser_trace(stderr, "parser => ");
+#endif
 
-            *(void **) (address + action->rows_offset) = elem_address;
-            elem_address += row_shift;
+    yajp_lexer_push_input(&state->lexer_input, (const uint8_t *) input, input_size, last);
 
-            result = yajp_parse_array_value_internal(data, name, action, elem_address);
-            if (0 != result) {
-                goto end;
-            }
+    while (0 == result && 0 < data->frames_count) {
+        result = yajp_parse_next_token(data);
+    }
 
-            row_shift += action->field_size;
-            (*count)++;
-        }
+    // whole input is in lexer buffer, so caller can reuse its memory
+    if (YAJP_STEP_NEED_MORE_INPUT == result) {
+        return result;
+    }
 
-        if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_VALUE == recognized_entity.type) {
-            if (action->allocate_elems) {
-                elem_address = *(void **) (address + action->elems_offset);
-                elem_address = realloc(elem_address, row_shift + action->elem_size);
+    state->error = (0 == result) ? 0 : errno;
+    yajp_parse_end(data, result);
 
-                if (NULL == elem_address) {
-                    result = -1; // errno set
-                    goto end;
-                }
+    if (NULL != state->ctx->size_hints && 0 == result) {
+        yajp_update_size_hint(&state->ctx->size_hints->buffer_size, state->lexer_input.buffer_size);
+    }
 
-                *(void **) (address + action->elems_offset) = elem_address;
-            } else {
-                elem_address = address + action->elems_offset;
-            }
+    state->result = result;
+    errno = state->error;
+    return result;
+}
 
-            elem_address += row_shift;
+void yajp_step_release(yajp_step_state_t *state) {
+    const yajp_allocator_t *allocator;
 
-            if (action->options & YAJP_DESERIALIZATION_TYPE_STRING) {
-                void *str = malloc(recognized_entity.token->attributes.value_size + action->elem_size);
-                if (NULL == str) {
-                    result = -1; // errno set
-                    goto end;
-                }
-                *(void **) (elem_address) = str;
-                elem_address = str;
-            }
+    if (NULL == state) {
+        return;
+    }
 
-            setter_result = action->setter(name->attributes.value, name->attributes.value_size,
-                                           recognized_entity.token->attributes.value,
-                                           recognized_entity.token->attributes.value_size, elem_address, data->user_data);
+    allocator = state->data.allocator;
 
-            if (0 != setter_result) {
-                result = -1;// deserialization error
-                goto end;
-            }
+    // document is abandoned in the middle, so it's released as failed one
+    if (YAJP_STEP_NEED_MORE_INPUT == state->result) {
+        yajp_parse_end(&state->data, -1);
+    }
 
-            (*count)++;
-            row_shift += action->elem_size;
-        }
+    if (state->frames != state->data.frames) {
+        allocator->free(state->data.frames, allocator->user);
+    }
 
-        if (i >= TOKEN_CNT) {
-            yajp_lexer_release_token(&tokens[i % TOKEN_CNT]);
-        }
-    } while ((YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_AEND != recognized_entity.type) &&
-             (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_PAIR != recognized_entity.type) &&
-             (YAJP_TOKEN_AEND != picked_token));
+    yajp_parser_finalize(state->data.parser);
+    allocator->free(state->data.parser, allocator->user);
+    yajp_lexer_release_input(&state->lexer_input);
+    allocator->free(state, allocator->user);
+}
+
+/**
+ * Helper function. Deserializes JSON stream with output memory allocated from arena.
+ *
+ * @param json[in]          JSON stream
+ * @param ctx[in]           Deserialization context
+ * @param address[out]      Deserializing structure
+ * @param user_data[in]     Data passed to setters
+ * @param arena[in]         Arena of output memory. NULL means allocator of context
+ * @param read_ahead[in]    Size of blocks read by reader thread. 0 - stream is read by lexer
+ *
+ * @return  Result of deserialization. 0 - on success
+ */
+static int yajp_deserialize_in_arena(FILE *json, const yajp_deserialization_context_t *ctx, void *address,
+                                     void *user_data, yajp_arena_t *arena, size_t read_ahead) {
+    const yajp_allocator_t *allocator = (NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+    yajp_allocator_t arena_allocator;
 
-    end:
-    for (i = 0; i < TOKEN_CNT; i++) {
-        yajp_lexer_release_token(&tokens[i]);
+    if (NULL == arena) {
+        return yajp_deserialize(json, ctx, address, user_data, allocator, allocator, read_ahead);
     }
-    return result;
-#undef TOKENS_CNT
+
+    yajp_arena_allocator_init(arena, &arena_allocator);
+
+    return yajp_deserialize(json, ctx, address, user_data, allocator, &arena_allocator, read_ahead);
 }
 
-static int yajp_parse_object_value(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
-                                   void *address) {
+/**
+ * Helper function. Deserializes JSON stream with specified allocators.
+ *
+ * @param json[in]          JSON stream
+ * @param ctx[in]           Deserialization context
+ * @param address[out]      Deserializing structure
+ * @param user_data[in]     Data passed to setters
+ * @param allocator[in]     Allocator of lexer and parser memory
+ * @param output[in]        Allocator of deserialized strings, arrays and objects
+ * @param read_ahead[in]    Size of blocks read by reader thread. 0 - stream is read by lexer
+ *
+ * @return  Result of deserialization. 0 - on success
+ */
+static int yajp_deserialize(FILE *json, const yajp_deserialization_context_t *ctx, void *address, void *user_data,
+                            const yajp_allocator_t *allocator, const yajp_allocator_t *output, size_t read_ahead) {
+    yajp_deserialization_session_t *session = yajp_session_acquire(allocator);
     int result;
 
-    if (action->allocate) {
-        void *tmp = malloc(action->field_size);
-        if (NULL == tmp) {
-            return -1; // errno set
-        }
-        memset(tmp, 0, action->field_size);
-        result = yajp_parse(data, action->ctx, tmp);
+    result = yajp_deserialize_in_session(session, json, NULL, 0, ctx, address, user_data, allocator, output,
+                                         read_ahead);
 
-        if (0 != result) {
-            free(tmp);
-            return result;
-        } else {
-            *(void **) address = tmp;
-        }
-    } else {
-        memset(address, 0, action->field_size);
-        result = yajp_parse(data, action->ctx, address);
+    if (NULL != session) {
+        session->busy = false;
     }
 
     return result;
 }
 
-static int yajp_parse_array_of_objects_value(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
-                                             void *address) {
-    yajp_lexer_token_t current_token;
-    yajp_parser_recognized_entity_t recognized_entity;
+/**
+ * Helper function. Deserializes JSON stream or text in memory, taking memory of lexer and parser from session.
+ *
+ * @param session[in, out]  Session what keeps memory allocated by @p allocator. NULL - to allocate it for this
+ *                          document only
+ * @param json[in]          JSON stream. NULL - to deserialize @p text
+ * @param text[in]          JSON text. Doesn't need terminating zero
+ * @param text_size[in]     Size of JSON text in bytes
+ * @param ctx[in]           Deserialization context
+ * @param address[out]      Deserializing structure
+ * @param user_data[in]     Data passed to setters
+ * @param allocator[in]     Allocator of lexer and parser memory
+ * @param output[in]        Allocator of deserialized strings, arrays and objects
+ * @param read_ahead[in]    Size of blocks read by reader thread. 0 - stream is read by lexer
+ *
+ * @return  Result of deserialization. 0 - on success
+ */
+static int yajp_deserialize_in_session(yajp_deserialization_session_t *session, FILE *json, const char *text,
+                                       size_t text_size, const yajp_deserialization_context_t *ctx, void *address,
+                                       void *user_data, const yajp_allocator_t *allocator,
+                                       const yajp_allocator_t *output, size_t read_ahead) {
+    void *parser = NULL;
+    yajp_read_ahead_t reader;
+    bool reading_ahead = false;
+    yajp_lexer_input_t lexer_input;
     int result;
+    yajp_deserialization_data_t deserialization_data;
+    yajp_deserialization_frame_t frames[YAJP_FRAMES_INLINE_CAPACITY];
+    size_t buffer_size = (NULL != ctx->size_hints)
+                         ? __atomic_load_n(&ctx->size_hints->buffer_size, __ATOMIC_RELAXED)
+                         : 0;
+    uint8_t *buffer = NULL;
+
+#if DEBUG
+    yajp_parser_trace(stderr, "parser => ");
+#endif
 
-    yajp_lexer_get_next_token(data->lexer_input, &current_token);
-    if (YAJP_TOKEN_ABEGIN != current_token.token) {
-        result = -1; // expected [ token
-        goto end;
+    // if reader thread can't be started, stream is read by lexer
+    if (NULL != json && 0 != read_ahead) {
+        reading_ahead = (0 == yajp_read_ahead_start(&reader, json, read_ahead, allocator));
     }
 
-    yajp_parser_parse(data->parser, current_token.token, &current_token, &recognized_entity);
+    // buffer of session is taken unless it's smaller than learned size
+    if (NULL != session && NULL != session->buffer) {
+        if (buffer_size <= session->buffer_size) {
+            buffer = session->buffer;
+            buffer_size = session->buffer_size;
+        } else {
+            allocator->free(session->buffer, allocator->user);
+        }
+        session->buffer = NULL;
+    }
 
-    if (action->allocate) {
-        void *tmp = malloc(action->field_size);
-        if (NULL == tmp) {
-            return -1; // errno set
+    if (NULL != json) {
+        if (yajp_lexer_init_input_with_buffer(json, allocator, buffer, buffer_size, reading_ahead ? &reader : NULL,
+                                              &lexer_input)) {
+            result = -1; // errno set
+            goto end;
         }
-        memset(tmp, 0, action->field_size);
-        result = yajp_parse_array_of_objects_value_internal(data, action, tmp);
-
-        if (0 != result) {
-            free(tmp);
+    } else {
+        // text is copied into lexer buffer by parts, the end of it is followed by '\0' recognized as end of document
+        if (yajp_lexer_init_pushed_input_with_buffer(allocator, buffer, buffer_size, &lexer_input)) {
+            result = -1; // errno set
             goto end;
-        } else {
-            *(void **) address = tmp;
         }
+        yajp_lexer_push_input(&lexer_input, (const uint8_t *) text, text_size, true);
+    }
+
+    // parser stack is limited by maximal depth too, so memory isn't exhausted if depth check is passed somehow
+    if (NULL != session && NULL != session->parser) {
+        parser = session->parser;
+        yajp_parser_resize_stack(parser,
+                                 yajp_parser_stack_size(ctx->stack_depth < ctx->max_depth
+                                                        ? ctx->stack_depth : ctx->max_depth),
+                                 yajp_parser_stack_size(ctx->max_depth));
     } else {
-        memset(address, 0, action->field_size);
-        result = yajp_parse_array_of_objects_value_internal(data, action, address);
+        parser = allocator->alloc(yajp_parser_size(), allocator->user);
+        if (NULL == parser) {
+            result = -1; // errno set
+            goto release_lexer;
+        }
+
+        yajp_parser_init_with_stack(parser, allocator,
+                                    yajp_parser_stack_size(ctx->stack_depth < ctx->max_depth
+                                                           ? ctx->stack_depth : ctx->max_depth),
+                                    yajp_parser_stack_size(ctx->max_depth));
+    }
+
+    yajp_init_data(&deserialization_data, ctx, &lexer_input, parser, user_data, allocator, output, frames);
+    if (NULL != session && NULL != session->frames) {
+        deserialization_data.frames = session->frames;
+        deserialization_data.frames_capacity = session->frames_capacity;
+        session->frames = NULL;
+    }
+
+    result = yajp_parse(&deserialization_data, ctx, address);
+
+    // lexer buffer grows only to fit the longest token, so its size is learned as well
+    if (NULL != ctx->size_hints && 0 == result) {
+        yajp_update_size_hint(&ctx->size_hints->buffer_size, lexer_input.buffer_size);
+    }
+
+#ifdef YAJP_TRACK_STREAM
+    if (YAJP_DESERIALIZATION_RESULT_STATUS_OK != deserialization_result.status) {
+        deserialization_result.line_num = lexer_input.line_num;
+        deserialization_result.column_num = lexer_input.column_num;
+    }
+#endif
+
+    if (NULL != session) {
+        if (frames != deserialization_data.frames) {
+            session->frames = deserialization_data.frames;
+            session->frames_capacity = deserialization_data.frames_capacity;
+        }
+
+        yajp_parser_reset(parser);
+        session->parser = parser;
+    } else {
+        if (frames != deserialization_data.frames) {
+            allocator->free(deserialization_data.frames, allocator->user);
+        }
+
+        yajp_parser_finalize(parser);
+        allocator->free(parser, allocator->user);
+    }
+
+release_lexer:
+    if (NULL != session) {
+        session->buffer = yajp_lexer_detach_buffer(&lexer_input, &session->buffer_size);
+        if (YAJP_SESSION_MAX_BUFFER_SIZE < session->buffer_size) {
+            allocator->free(session->buffer, allocator->user);
+            session->buffer = NULL;
+        }
+    } else {
+        yajp_lexer_release_input(&lexer_input);
+    }
+end:
+    if (reading_ahead) {
+        yajp_read_ahead_stop(&reader);
     }
 
-    end:
-    yajp_lexer_release_token(&current_token);
     return result;
 }
 
-static int yajp_parse_array_of_objects_value_internal(yajp_deserialization_data_t *data,
-                                                      const yajp_deserialization_rule_t *action, void *address) {
-#define TOKEN_CNT 3
-    int result = 0;
-    yajp_lexer_token_t tokens[TOKEN_CNT];
-    yajp_lexer_token_t *current_token;
-    yajp_token_type_t picked_token;
+static int yajp_parse(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx, void *address) {
+    int result;
+
+    if (0 != yajp_parse_begin(data, ctx, address)) {
+        return -1; // errno set
+    }
+
+    do {
+        result = yajp_parse_next_token(data);
+    } while (0 == result && 0 < data->frames_count);
+
+    yajp_parse_end(data, result);
+
+    return result;
+}
+
+/**
+ * Helper function. Initializes deserialization data of document.
+ *
+ * @param data[out]         Pointer to deserialization data
+ * @param ctx[in]           Deserialization context
+ * @param lexer_input[in]   Initialized lexer input
+ * @param parser[in]        Initialized parser
+ * @param user_data[in]     Data passed to setters
+ * @param allocator[in]     Allocator of lexer and parser memory
+ * @param output[in]        Allocator of deserialized strings, arrays and objects
+ * @param frames[in]        Memory of YAJP_FRAMES_INLINE_CAPACITY frames of deserialization stack
+ */
+static void yajp_init_data(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                           yajp_lexer_input_t *lexer_input, void *parser, void *user_data,
+                           const yajp_allocator_t *allocator, const yajp_allocator_t *output,
+                           yajp_deserialization_frame_t *frames) {
+    data->lexer_input = lexer_input;
+    data->parser = parser;
+    data->user_data = user_data;
+    data->allocator = allocator;
+    data->output = output;
+    data->reuse = ctx->reuse;
+    data->size_hints = ctx->size_hints;
+    data->frames = frames;
+    data->frames_count = 0;
+    data->frames_capacity = YAJP_FRAMES_INLINE_CAPACITY;
+    data->depth = 0;
+    data->max_depth = ctx->max_depth;
+}
+
+/**
+ * Helper function. Pushes root object to deserialization stack, so tokens of document can be passed to it.
+ *
+ * @param data[in, out]     Pointer to initialized deserialization data
+ * @param ctx[in]           Context of root object
+ * @param address[in]       Pointer to root object
+ *
+ * @return  Result of start. 0 - on success
+ */
+static int yajp_parse_begin(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                            void *address) {
+    memset(data->tokens, 0, sizeof(data->tokens));
+    memset(&data->name, 0, sizeof(data->name));
+    data->tokens_count = 0;
+    data->pending = YAJP_DESERIALIZATION_PENDING_NONE;
+
+    return yajp_push_object_frame(data, ctx, address, NULL, NULL, false);
+}
 
+/**
+ * Helper function. Picks the next token of document and passes it to parser and to deserialization. It's the only
+ * place where tokens are picked, so document can be suspended between any of them.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ *
+ * @return  Result of handling. 0 - on success, YAJP_STEP_NEED_MORE_INPUT if pushed input ends inside of token, -1 with
+ *          errno set on error
+ */
+static int yajp_parse_next_token(yajp_deserialization_data_t *data) {
+    yajp_lexer_token_t *current_token = &data->tokens[data->tokens_count % YAJP_TOKENS_RING];
     yajp_parser_recognized_entity_t recognized_entity;
-    int i = 0;
-    size_t row_shift = 0;
-    void *elem_address;
 
+    if (yajp_lexer_get_next_token(data->lexer_input, current_token)) {
+        // token is scanned again from its beginning after next push
+        if (NULL == data->lexer_input->json && EAGAIN == errno) {
+            return YAJP_STEP_NEED_MORE_INPUT;
+        }
+        return -1; // errno set
+    }
+
+    if (yajp_feed_parser(data, current_token, &recognized_entity)) {
+        return -1; // errno set
+    }
+
+    if (0 != yajp_parse_token(data, current_token->token, &recognized_entity)) {
+        return -1;
+    }
+
+    // slot of the oldest token is taken by the next one
+    data->tokens_count++;
+    yajp_lexer_release_token(&data->tokens[data->tokens_count % YAJP_TOKENS_RING]);
+
+    return 0;
+}
+
+/**
+ * Helper function. Releases tokens of document and memory of failed document.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param result[in]        Result of document. Deserialization stack is unwound if it isn't 0
+ */
+static void yajp_parse_end(yajp_deserialization_data_t *data, int result) {
+    int i;
+
+    if (0 != result) {
+        yajp_unwind_frames(data);
+    }
+
+    for (i = 0; i < YAJP_TOKENS_RING; i++) {
+        yajp_lexer_release_token(&data->tokens[i]);
+    }
+    yajp_lexer_release_token(&data->name);
+    data->pending = YAJP_DESERIALIZATION_PENDING_NONE;
+}
+
+/**
+ * Helper function. Passes token to pending value or to object or array on the top of deserialization stack.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param token[in]         Type of picked token
+ * @param recognized[in]    Entity recognized by parser on picked token
+ *
+ * @return  Result of handling. 0 - on success
+ */
+static int yajp_parse_token(yajp_deserialization_data_t *data, yajp_token_type_t token,
+                            const yajp_parser_recognized_entity_t *recognized) {
+    switch (data->pending) {
+        case YAJP_DESERIALIZATION_PENDING_PRIMITIVE:
+            return yajp_parse_primitive_token(data, token, recognized);
+        case YAJP_DESERIALIZATION_PENDING_ARRAY:
+            return yajp_begin_array_value(data, token);
+        case YAJP_DESERIALIZATION_PENDING_SKIP:
+            return yajp_parse_skipped_token(data, token);
+        case YAJP_DESERIALIZATION_PENDING_NONE:
+            break;
+    }
+
+    if (NULL != data->frames[data->frames_count - 1].ctx) {
+        return yajp_parse_object_token(data, token, recognized);
+    }
+
+    return yajp_parse_array_token(data, token, recognized);
+}
+
+/**
+ * Helper function. Handles token of object on the top of deserialization stack: starts deserialization of field by
+ * its key and pops object on its end.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param token[in]         Type of picked token
+ * @param recognized[in]    Entity recognized by parser on picked token
+ *
+ * @return  Result of handling. 0 - on success
+ */
+static int yajp_parse_object_token(yajp_deserialization_data_t *data, yajp_token_type_t token,
+                                   const yajp_parser_recognized_entity_t *recognized) {
+    yajp_deserialization_frame_t *frame = &data->frames[data->frames_count - 1];
+
+    if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_KEY == recognized->type) {
+        data->value_end = YAJP_TOKEN_COMMA;
+        return yajp_deserialize_value(data, frame->ctx, recognized->token, frame->address);
+    }
+
+    if (YAJP_TOKEN_EOF == token || YAJP_TOKEN_OEND == token) {
+        yajp_end_object(data);
+    }
+
+    return 0;
+}
+
+/**
+ * Helper function. Pops object from deserialization stack and stores it into its slot.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ */
+static void yajp_end_object(yajp_deserialization_data_t *data) {
+    yajp_deserialization_frame_t *frame = &data->frames[--data->frames_count];
+
+    if (NULL != frame->slot) {
+        *(void **) frame->slot = frame->address;
+    }
+
+    // end of this object belongs to it and must not terminate enclosing one
+    data->value_end = YAJP_TOKEN_COMMA;
+}
+
+/**
+ * Helper function. Handles token of array on the top of deserialization stack: stores primitive elements, pushes rows
+ * and objects and pops array on its end.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param token[in]         Type of picked token
+ * @param recognized[in]    Entity recognized by parser on picked token
+ *
+ * @return  Result of handling. 0 - on success
+ */
+static int yajp_parse_array_token(yajp_deserialization_data_t *data, yajp_token_type_t token,
+                                  const yajp_parser_recognized_entity_t *recognized) {
+    size_t index = data->frames_count - 1;
+    yajp_deserialization_frame_t *frame = &data->frames[index];
+    const yajp_deserialization_rule_t *action = frame->action;
+    const yajp_lexer_token_t *name;
+    void *address = frame->address, *elem_address;
     size_t *count = address + action->counter_offset;
-    bool *final_dim = address + action->final_dym_offset;
+    bool objects = action->options & YAJP_DESERIALIZATION_TYPE_OBJECT;
+    size_t value_size;
+    int setter_result;
 
-    *final_dim = true;
+    if (YAJP_TOKEN_ABEGIN == token) {
+        *(bool *) (address + action->final_dym_offset) = false;
 
-    memset(tokens, 0, sizeof(tokens));
+        if (data->reuse && 0 == *count) {
+            yajp_reshape_array(data, action, address, frame->reused_final_dim, &frame->capacity, &frame->reused_count);
+        }
 
-    do {
-        current_token = &tokens[i % TOKEN_CNT];
-        i++;
+        if (0 != yajp_output_grow(data, address + action->rows_offset, &frame->capacity,
+                                  frame->row_shift + action->field_size,
+                                  yajp_array_size_hint(data, action, false, frame->capacity))) {
+            return -1; // errno set
+        }
 
-        yajp_lexer_get_next_token(data->lexer_input, current_token);
-        picked_token = current_token->token;
+        elem_address = *(void **) (address + action->rows_offset) + frame->row_shift;
+        if (*count >= frame->reused_count) {
+            memset(elem_address, 0, action->field_size);
+        }
 
-        recognized_entity.type = YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_NONE;
-        yajp_parser_parse(data->parser, picked_token, current_token, &recognized_entity);
+        // row is counted before it's filled, so memory of failed row can be released with whole array
+        frame->row_shift += action->field_size;
+        (*count)++;
 
-        if (YAJP_TOKEN_ABEGIN == picked_token) {
-            *final_dim = false;
+        return yajp_push_array_frame(data, action, elem_address, NULL, false, frame->name_frame);
+    }
 
-            elem_address = *(void **) (address + action->rows_offset);
-            elem_address = realloc(elem_address, row_shift + action->field_size);
+    if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_VALUE == recognized->type || (objects && YAJP_TOKEN_OBEGIN == token)) {
+        if (data->reuse && 0 == *count) {
+            yajp_reshape_array(data, action, address, frame->reused_final_dim, &frame->capacity, &frame->reused_count);
+        }
 
-            if (NULL == elem_address) {
-                result = -1; // errno set
-                goto end;
+        if (action->allocate_elems) {
+            if (0 != yajp_output_grow(data, address + action->elems_offset, &frame->capacity,
+                                      frame->row_shift + action->elem_size,
+                                      yajp_array_size_hint(data, action, true, frame->capacity))) {
+                return -1; // errno set
             }
 
-            memset(elem_address + row_shift, 0, action->field_size);
+            elem_address = *(void **) (address + action->elems_offset);
+        } else {
+            elem_address = address + action->elems_offset;
+        }
 
-            *(void **) (address + action->rows_offset) = elem_address;
-            elem_address += row_shift;
+        elem_address += frame->row_shift;
 
-            result = yajp_parse_array_of_objects_value_internal(data, action, elem_address);
-            if (0 != result) {
-                goto end;
+        if (objects) {
+            if (*count >= frame->reused_count) {
+                memset(elem_address, 0, action->elem_size);
             }
 
-            row_shift += action->field_size;
             (*count)++;
-        }
+            frame->row_shift += action->elem_size;
 
-        if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_VALUE == recognized_entity.type || YAJP_TOKEN_OBEGIN == picked_token) {
-            if (action->allocate_elems) {
-                elem_address = *(void **) (address + action->elems_offset);
-                elem_address = realloc(elem_address, row_shift + action->elem_size);
+            return yajp_push_object_frame(data, action->ctx, elem_address, NULL, NULL, false);
+        }
 
-                if (NULL == elem_address) {
-                    result = -1; //errno set
-                    goto end;
-                }
+        value_size = recognized->token->attributes.value_size;
 
-                *(void **) (address + action->elems_offset) = elem_address;
-            } else {
-                elem_address = address + action->elems_offset;
+        if (action->inline_string) {
+            if (0 != yajp_fit_inline_string(action, recognized->token->attributes.value, action->elem_size,
+                                            &value_size)) {
+                return -1;
             }
+        } else if ((action->options & YAJP_DESERIALIZATION_TYPE_STRING) && !action->interned_string) {
+            // slots of previous array hold its strings, new slots are not initialized
+            void *str = (*count < frame->reused_count)
+                    ? yajp_output_reuse(data, action, elem_address, value_size + action->elem_size)
+                    : yajp_output_alloc(data, value_size + action->elem_size);
+            if (NULL == str) {
+                return -1; // errno set
+            }
+            *(void **) (elem_address) = str;
+            elem_address = str;
+        }
 
-            elem_address += row_shift;
+        // element is counted before setter, so string of failed element is released with array
+        (*count)++;
+        frame->row_shift += action->elem_size;
 
-            result = yajp_parse(data, action->ctx, elem_address);
-            if (0 != result) {
-                goto end;
-            }
+        name = &data->frames[frame->name_frame].name;
+        setter_result = action->setter(name->attributes.value, name->attributes.value_size,
+                                       recognized->token->attributes.value, value_size, elem_address,
+                                       yajp_get_setter_user_data(data, action));
 
-            (*count)++;
-            row_shift += action->elem_size;
+        if (0 != setter_result) {
+            return -1; // deserialization error
         }
+    }
 
-        if (i >= TOKEN_CNT) {
-            yajp_lexer_release_token(&tokens[i % TOKEN_CNT]);
+    if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_AEND == recognized->type ||
+        YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_PAIR == recognized->type ||
+        YAJP_TOKEN_AEND == token) {
+        if (data->reuse) {
+            yajp_finish_reused_array(data, action, address, frame->reused_final_dim, frame->reused_count);
         }
-    } while ((YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_AEND != recognized_entity.type) &&
-             (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_PAIR != recognized_entity.type) &&
-             (YAJP_TOKEN_AEND != picked_token));
 
-end:
-    for (i = 0; i < TOKEN_CNT; i++) {
-        yajp_lexer_release_token(&tokens[i]);
+        yajp_finish_array(data, action, address, frame->capacity, frame->row_shift);
+
+        if (frame->name_frame == index) {
+            yajp_lexer_release_token(&frame->name);
+        }
+
+        if (NULL != frame->slot) {
+            *(void **) frame->slot = address;
+        }
+
+        data->frames_count--;
     }
-    return result;
+
+    return 0;
+}
+
+/**
+ * Helper function. Starts deserialization of field by its rule. Objects are pushed to deserialization stack at once,
+ * primitive values, arrays and values without rule are taken by following tokens as pending value.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ * @param ctx[in]       Context of deserializing object
+ * @param name[in]      Key token of field. Its value is moved into deserialization data for setters
+ * @param address[in]   Pointer to deserializing object
+ *
+ * @return  Result of deserialization. 0 - on success
+ */
+static int yajp_deserialize_value(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                                  const yajp_lexer_token_t *name, void *address) {
+    const yajp_deserialization_rule_t *action;
+
+    action = yajp_find_action(ctx, name->attributes.value, name->attributes.value_size);
+
+    // TODO: Add handling of unknown json items
+    if (NULL != action) {
+        address += action->field_offset;
+
+        switch (action->options & 0b00011111) {
+            case YAJP_DESERIALIZATION_TYPE_NUMBER:
+            case YAJP_DESERIALIZATION_TYPE_STRING:
+            case YAJP_DESERIALIZATION_TYPE_BOOLEAN:
+                yajp_set_pending(data, YAJP_DESERIALIZATION_PENDING_PRIMITIVE, action, address);
+                break;
+            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER):
+            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING):
+            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_BOOLEAN):
+            case (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT):
+                yajp_set_pending(data, YAJP_DESERIALIZATION_PENDING_ARRAY, action, address);
+                break;
+            case (YAJP_DESERIALIZATION_TYPE_OBJECT):
+                return yajp_begin_object_value(data, action, address);
+            default:
+                return -1;
+        }
+    } else {
+        yajp_set_pending(data, YAJP_DESERIALIZATION_PENDING_SKIP, NULL, address);
+    }
+
+    // key token belongs to token ring and is overwritten by following tokens, so it's kept for setters
+    yajp_move_token(&data->name, (yajp_lexer_token_t *) name);
+
+    return 0;
+}
+
+/**
+ * Helper function. Makes value of field take following tokens.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ * @param pending[in]   Kind of value
+ * @param action[in]    Rule of field or NULL for value without rule
+ * @param address[in]   Pointer to field
+ */
+static void yajp_set_pending(yajp_deserialization_data_t *data, yajp_deserialization_pending_t pending,
+                             const yajp_deserialization_rule_t *action, void *address) {
+    data->pending = pending;
+    data->pending_action = action;
+    data->pending_address = address;
+    data->pending_tokens = 0;
+    data->open_brackets = 0;
+}
+
+/**
+ * Helper function. Finishes pending value, so following tokens are passed to the top of deserialization stack again.
+ * Object is popped if value was terminated by its end.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ */
+static void yajp_end_pending(yajp_deserialization_data_t *data) {
+    data->pending = YAJP_DESERIALIZATION_PENDING_NONE;
+    yajp_lexer_release_token(&data->name);
+
+    // primitive value is recognized only by the token after it, so end of object could be already consumed
+    if (YAJP_TOKEN_OEND == data->value_end) {
+        yajp_end_object(data);
+    }
+}
+
+/**
+ * Helper function. Handles token of pending primitive value. Value is set when parser recognizes pair, i.e. on the
+ * token after value.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param token[in]         Type of picked token
+ * @param recognized[in]    Entity recognized by parser on picked token
+ *
+ * @return  Result of handling. 0 - on success
+ */
+static int yajp_parse_primitive_token(yajp_deserialization_data_t *data, yajp_token_type_t token,
+                                      const yajp_parser_recognized_entity_t *recognized) {
+#define TOKENS_CNT 2 // 2 tokens should be enough to handle value and wait until parser recognize pair
+    const yajp_deserialization_rule_t *action = data->pending_action;
+    const yajp_lexer_token_t *name = &data->name;
+    void *address = data->pending_address;
+    size_t allocation_size, value_size, *capacity;
+    int setter_result;
+
+    if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_PAIR != recognized->type) {
+        // pair isn't recognized by value and following token, so value is missing or malformed
+        if (TOKENS_CNT <= ++data->pending_tokens) {
+            errno = EINVAL;
+            return -1;
+        }
+        return 0;
+    }
+
+    data->value_end = token;
+
+    if (action->allocate) {
+        // setters of numbers and booleans write value of field type, only strings depend on value
+        allocation_size = (action->options & YAJP_DESERIALIZATION_TYPE_STRING)
+                ? recognized->token->attributes.value_size + action->elem_size
+                : action->field_size;
+        void *tmp = data->reuse
+                ? yajp_output_reuse(data, action, address, allocation_size)
+                : yajp_output_alloc(data, allocation_size);
+        if (NULL == tmp) {
+            return -1;
+        }
+
+        capacity = yajp_string_capacity(action, address);
+        if (!data->reuse && NULL != capacity) {
+            *capacity = allocation_size / action->elem_size;
+        }
+
+        setter_result = action->setter(name->attributes.value, name->attributes.value_size,
+                                       recognized->token->attributes.value,
+                                       recognized->token->attributes.value_size, tmp,
+                                       yajp_get_setter_user_data(data, action));
+
+        if (0 != setter_result) {
+            yajp_output_free(data, tmp);
+            tmp = NULL;
+
+            if (NULL != capacity) {
+                *capacity = 0;
+            }
+        }
+
+        *(void **) address = tmp;
+
+    } else {
+        value_size = recognized->token->attributes.value_size;
+        if (action->inline_string &&
+            0 != yajp_fit_inline_string(action, recognized->token->attributes.value, action->field_size,
+                                        &value_size)) {
+            return -1;
+        }
+
+        setter_result = action->setter(name->attributes.value, name->attributes.value_size,
+                recognized->token->attributes.value, value_size,
+                address, yajp_get_setter_user_data(data, action));
+    }
+
+    if (0 != setter_result) {
+        return -1;
+    }
+
+    yajp_end_pending(data);
+
+    return 0;
+
 #undef TOKENS_CNT
 }
+
+/**
+ * Helper function. Handles token of pending value without rule: skips primitive value till comma or end of object,
+ * object or array - till its closing bracket.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param token[in]         Type of picked token
+ *
+ * @return  Result of handling. 0 - on success
+ */
+static int yajp_parse_skipped_token(yajp_deserialization_data_t *data, yajp_token_type_t token) {
+    // look at the first token to decide strategy
+    if (0 == data->pending_tokens++) {
+        switch (token) {
+            case YAJP_TOKEN_EOF:
+                return -1; // unexpected eof
+            case YAJP_TOKEN_OBEGIN:
+            case YAJP_TOKEN_ABEGIN: // skipping object or array
+                data->open_brackets = 1;
+                return 0;
+            case YAJP_TOKEN_NUMBER:
+            case YAJP_TOKEN_STRING:
+            case YAJP_TOKEN_BOOLEAN:
+            case YAJP_TOKEN_NULL: // skipping primitives
+                return 0;
+            default:
+                return -1; // value expected
+        }
+    }
+
+    if (0 < data->open_brackets) {
+        if ((YAJP_TOKEN_OBEGIN == token) || (YAJP_TOKEN_ABEGIN == token)) {
+            data->open_brackets++;
+        } else if ((YAJP_TOKEN_OEND == token) || (YAJP_TOKEN_AEND == token)) {
+            data->open_brackets--;
+        }
+
+        if (0 == data->open_brackets) {
+            yajp_end_pending(data);
+        }
+    } else if ((YAJP_TOKEN_COMMA == token) || (YAJP_TOKEN_OEND == token)) {
+        data->value_end = token;
+        yajp_end_pending(data);
+    }
+
+    return 0;
+}
+
+/**
+ * Helper function. Passes token to parser and tracks nesting depth of document.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param token[in]         Picked token
+ * @param entity[out]       Entity recognized by parser on picked token
+ *
+ * @return  Result of parsing. 0 - on success, -1 with errno set to EOVERFLOW if document is nested too deep
+ */
+static int yajp_feed_parser(yajp_deserialization_data_t *data, const yajp_lexer_token_t *token,
+                            yajp_parser_recognized_entity_t *entity) {
+    if (YAJP_TOKEN_OBEGIN == token->token || YAJP_TOKEN_ABEGIN == token->token) {
+        if (data->depth >= data->max_depth) {
+            errno = EOVERFLOW;
+            return -1;
+        }
+        data->depth++;
+    } else if ((YAJP_TOKEN_OEND == token->token || YAJP_TOKEN_AEND == token->token) && 0 < data->depth) {
+        data->depth--;
+    }
+
+    entity->type = YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_NONE;
+    yajp_parser_parse(data->parser, token->token, token, entity);
+
+    // stack can't grow, because it reached its limit or memory is exhausted
+    if (YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_OVERFLOW == entity->type) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Helper function. Converts nesting depth of document into amount of parser stack entries.
+ *
+ * @param depth[in]     Nesting depth of objects and arrays
+ *
+ * @return  Amount of parser stack entries, limited by INT_MAX
+ */
+static int yajp_parser_stack_size(size_t depth) {
+    if (depth > (INT_MAX - YAJP_PARSER_STACK_RESERVE) / YAJP_PARSER_STACK_ENTRIES_PER_LEVEL) {
+        return INT_MAX;
+    }
+
+    return (int) (depth * YAJP_PARSER_STACK_ENTRIES_PER_LEVEL + YAJP_PARSER_STACK_RESERVE);
+}
+
+/**
+ * Helper function. Handles opening bracket of pending array value: allocates its holder if it's required by rule and
+ * pushes it to deserialization stack.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ * @param token[in]     Type of picked token
+ *
+ * @return  Result of start. 0 - on success
+ */
+static int yajp_begin_array_value(yajp_deserialization_data_t *data, yajp_token_type_t token) {
+    const yajp_deserialization_rule_t *action = data->pending_action;
+    void *address = data->pending_address, *holder = address, *slot = NULL;
+    bool reused = false;
+    int result;
+
+    if (YAJP_TOKEN_ABEGIN != token) {
+        return -1; // expected [ token
+    }
+
+    if (action->allocate) {
+        holder = data->reuse ? *(void **) address : NULL;
+        reused = (NULL != holder);
+        slot = address;
+
+        if (!reused) {
+            holder = yajp_output_alloc(data, action->field_size);
+            if (NULL == holder) {
+                return -1; // errno set
+            }
+            memset(holder, 0, action->field_size);
+        }
+    } else if (!data->reuse) {
+        memset(address, 0, action->field_size);
+    }
+
+    result = yajp_push_array_frame(data, action, holder, slot, reused, data->frames_count);
+    if (0 != result) {
+        if (NULL != slot && !reused) {
+            yajp_output_free(data, holder);
+        }
+        return result;
+    }
+
+    // array takes key for setters of elements
+    yajp_move_token(&data->frames[data->frames_count - 1].name, &data->name);
+    data->pending = YAJP_DESERIALIZATION_PENDING_NONE;
+
+    return 0;
+}
+
+/**
+ * Helper function. Starts deserialization of object value: allocates it if it's required by rule and pushes it to
+ * deserialization stack.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ * @param action[in]    Rule of object
+ * @param address[in]   Pointer to object or to pointer to it
+ *
+ * @return  Result of start. 0 - on success
+ */
+static int yajp_begin_object_value(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                                   void *address) {
+    void *object = address, *slot = NULL;
+    bool reused = false;
+
+    if (action->allocate) {
+        object = data->reuse ? *(void **) address : NULL;
+        reused = (NULL != object);
+        slot = address;
+
+        if (!reused) {
+            object = yajp_output_alloc(data, action->field_size);
+            if (NULL == object) {
+                return -1; // errno set
+            }
+            memset(object, 0, action->field_size);
+        }
+    } else if (!data->reuse) {
+        memset(address, 0, action->field_size);
+    }
+
+    if (0 != yajp_push_object_frame(data, action->ctx, object, action, slot, reused)) {
+        if (NULL != slot && !reused) {
+            yajp_output_free(data, object);
+        }
+        return -1; // errno set
+    }
+
+    return 0;
+}
+
+/**
+ * Helper function. Pushes object to deserialization stack.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ * @param ctx[in]       Context of object
+ * @param address[in]   Pointer to object
+ * @param action[in]    Rule of object value or NULL
+ * @param slot[in]      Pointer to field where allocated object is stored on success or NULL if object is in place
+ * @param reused[in]    Allocated object is taken from slot in reuse mode
+ *
+ * @return  Result of push. 0 - on success, -1 if stack can't be grown
+ */
+static int yajp_push_object_frame(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                                  void *address, const yajp_deserialization_rule_t *action, void *slot, bool reused) {
+    yajp_deserialization_frame_t *frame = yajp_push_frame(data);
+
+    if (NULL == frame) {
+        return -1; // errno set
+    }
+
+    frame->ctx = ctx;
+    frame->action = action;
+    frame->address = address;
+    frame->slot = slot;
+    frame->reused = reused;
+
+    return 0;
+}
+
+/**
+ * Helper function. Pushes array or row of array to deserialization stack and prepares its holder for filling.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param action[in]        Rule of array
+ * @param address[in, out]  Pointer to array holder
+ * @param slot[in]          Pointer to field where allocated holder is stored on success or NULL if holder is in place
+ * @param reused[in]        Allocated holder is taken from slot in reuse mode
+ * @param name_frame[in]    Index of frame what holds name of array. Index of pushing frame for array value
+ *
+ * @return  Result of push. 0 - on success, -1 if stack can't be grown
+ */
+static int yajp_push_array_frame(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                                 void *address, void *slot, bool reused, size_t name_frame) {
+    yajp_deserialization_frame_t *frame = yajp_push_frame(data);
+    bool *final_dim = address + action->final_dym_offset;
+
+    if (NULL == frame) {
+        return -1; // errno set
+    }
+
+    frame->action = action;
+    frame->address = address;
+    frame->slot = slot;
+    frame->reused = reused;
+    frame->name_frame = name_frame;
+    frame->reused_final_dim = *final_dim;
+
+    if (data->reuse) {
+        yajp_reuse_array(action, address, &frame->capacity, &frame->reused_count);
+    }
+
+    *final_dim = true;
+
+    return 0;
+}
+
+/**
+ * Helper function. Adds zeroed frame to the top of deserialization stack. Stack starts on thread stack and is moved to
+ * heap when it's full, then it's grown geometrically, so it costs only few allocations for any depth of document.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ *
+ * @return  Pointer to added frame or NULL on error. Pointers to other frames are invalidated if stack is moved
+ */
+static yajp_deserialization_frame_t *yajp_push_frame(yajp_deserialization_data_t *data) {
+    yajp_deserialization_frame_t *frames = data->frames, *frame;
+    size_t capacity = data->frames_capacity, i;
+
+    if (data->frames_count == capacity) {
+        capacity *= 2;
+
+        // only inline stack has initial capacity, heap one is at least twice bigger
+        if (YAJP_FRAMES_INLINE_CAPACITY == data->frames_capacity) {
+            frames = data->allocator->realloc(NULL, 0, capacity * sizeof(*frames), data->allocator->user);
+            if (NULL != frames) {
+                memcpy(frames, data->frames, data->frames_count * sizeof(*frames));
+            }
+        } else {
+            frames = data->allocator->realloc(frames, data->frames_capacity * sizeof(*frames),
+                                              capacity * sizeof(*frames), data->allocator->user);
+        }
+
+        if (NULL == frames) {
+            return NULL; // errno set
+        }
+
+        // small names are stored inside their tokens, so they move with frames
+        for (i = 0; i < data->frames_count; i++) {
+            if (frames[i].name.attributes.value_size <= YAJP_BUFFER_SIZE) {
+                frames[i].name.attributes.value = frames[i].name.attributes.internal_buffer;
+            }
+        }
+
+        data->frames = frames;
+        data->frames_capacity = capacity;
+    }
+
+    frame = &frames[data->frames_count++];
+    memset(frame, 0, sizeof(*frame));
+
+    return frame;
+}
+
+/**
+ * Helper function. Pops all frames of failed deserialization: restores counters of reused arrays and releases objects
+ * and array holders what were allocated for the document, but haven't been stored into structure yet.
+ *
+ * @param data[in, out] Pointer to deserialization data
+ */
+static void yajp_unwind_frames(yajp_deserialization_data_t *data) {
+    yajp_deserialization_frame_t *frame;
+    size_t *count;
+    void *address;
+
+    while (0 < data->frames_count) {
+        frame = &data->frames[--data->frames_count];
+
+        if (NULL == frame->ctx) {
+            // items of previous array what weren't overwritten are still owned by array
+            count = frame->address + frame->action->counter_offset;
+            if (*count < frame->reused_count) {
+                *count = frame->reused_count;
+            }
+
+            if (frame->name_frame == data->frames_count) {
+                yajp_lexer_release_token(&frame->name);
+            }
+        }
+
+        // reused object or array stays in structure and is released with it. Popped frame is overwritten by release
+        if (NULL != frame->slot && !frame->reused) {
+            address = frame->address;
+            yajp_release_nested(data, frame->ctx, frame->action, address);
+            yajp_output_free(data, address);
+        }
+    }
+}
+
+/**
+ * Helper function. Releases memory owned by object or array holder of failed document or of deserialized structure.
+ * Values nested into it are walked by frames pushed on top of deserialization stack instead of recursion, so document
+ * of any depth is released on stack of thread of any size.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param ctx[in]           Deserialization context of object or NULL for array
+ * @param action[in]        Rule of array. Ignored for object
+ * @param address[in, out]  Pointer to object or array holder. Holder itself isn't released
+ */
+static void yajp_release_nested(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                                const yajp_deserialization_rule_t *action, void *address) {
+    const size_t base = data->frames_count;
+    const yajp_deserialization_rule_t *rule;
+    yajp_deserialization_frame_t *frame;
+    void *field, *value, *items;
+    size_t count;
+
+    if (!yajp_push_release_frame(data, ctx, action, address, NULL)) {
+        return;
+    }
+
+    while (base < data->frames_count) {
+        frame = &data->frames[data->frames_count - 1];
+
+        if (NULL != frame->ctx) {
+            if (frame->released < frame->ctx->rules_count) {
+                rule = &frame->ctx->rules_list[frame->released++];
+                field = frame->address + rule->field_offset;
+                value = rule->allocate ? *(void **) field : field;
+
+                switch (rule->options & 0b00011111) {
+                    case YAJP_DESERIALIZATION_TYPE_NUMBER:
+                    case YAJP_DESERIALIZATION_TYPE_STRING:
+                    case YAJP_DESERIALIZATION_TYPE_BOOLEAN:
+                        if (rule->allocate) {
+                            yajp_release_value(data->output, rule, field);
+                        }
+                        break;
+                    case (YAJP_DESERIALIZATION_TYPE_OBJECT):
+                        if (NULL != value) {
+                            yajp_push_release_frame(data, rule->ctx, NULL, value, rule->allocate ? field : NULL);
+                        }
+                        break;
+                    default:
+                        if (NULL != value) {
+                            yajp_push_release_frame(data, NULL, rule, value, rule->allocate ? field : NULL);
+                        }
+                        break;
+                }
+                continue;
+            }
+        } else {
+            count = *(size_t *) (frame->address + frame->action->counter_offset);
+
+            if (frame->released < count && !*(bool *) (frame->address + frame->action->final_dym_offset)) {
+                items = *(void **) (frame->address + frame->action->rows_offset);
+                yajp_push_release_frame(data, NULL, frame->action,
+                                        items + frame->released++ * frame->action->field_size, NULL);
+                continue;
+            }
+
+            // plain objects and strings have no nesting, so they are released at once
+            if (frame->released < count && (frame->action->options & YAJP_DESERIALIZATION_TYPE_OBJECT) &&
+                yajp_context_owns_memory(frame->action->ctx)) {
+                items = frame->action->allocate_elems ? *(void **) (frame->address + frame->action->elems_offset)
+                                                      : frame->address + frame->action->elems_offset;
+                yajp_push_release_frame(data, frame->action->ctx, NULL,
+                                        items + frame->released++ * frame->action->elem_size, NULL);
+                continue;
+            }
+
+            if (0 == frame->released) {
+                yajp_release_array_items(data->output, frame->action, frame->address, 0, count);
+            }
+            yajp_release_array_storage(data->output, frame->action, frame->address);
+        }
+
+        // everything owned by value is released, so value itself can be released too
+        data->frames_count--;
+        if (NULL != frame->slot) {
+            yajp_release_memory(data->output, frame->slot);
+        }
+    }
+}
+
+/**
+ * Helper function. Pushes frame what releases nested value. If stack can't be grown, value is released recursively.
+ *
+ * @param data[in, out]     Pointer to deserialization data
+ * @param ctx[in]           Deserialization context of object or NULL for array
+ * @param action[in]        Rule of array. Ignored for object
+ * @param address[in, out]  Pointer to object or array holder
+ * @param slot[in, out]     Pointer to field what holds allocated value or NULL if value is in place
+ *
+ * @return  true - if frame is pushed, false - if value is released already
+ */
+static bool yajp_push_release_frame(yajp_deserialization_data_t *data, const yajp_deserialization_context_t *ctx,
+                                    const yajp_deserialization_rule_t *action, void *address, void *slot) {
+    yajp_deserialization_frame_t *frame = yajp_push_frame(data);
+
+    if (NULL == frame) {
+        if (NULL != ctx) {
+            yajp_release_object(data->output, ctx, address);
+        } else {
+            yajp_release_array(data->output, action, address);
+        }
+
+        if (NULL != slot) {
+            yajp_release_memory(data->output, slot);
+        }
+        return false;
+    }
+
+    frame->ctx = ctx;
+    frame->action = action;
+    frame->address = address;
+    frame->slot = slot;
+
+    return true;
+}
+
+/**
+ * Helper function. Moves value of token into another one, so source token can be released without affecting it.
+ *
+ * @param destination[out]  Pointer to token receiving value
+ * @param source[in, out]   Pointer to token. It's cleared
+ */
+static void yajp_move_token(yajp_lexer_token_t *destination, yajp_lexer_token_t *source) {
+    *destination = *source;
+    if (source->attributes.value == source->attributes.internal_buffer) {
+        destination->attributes.value = destination->attributes.internal_buffer;
+    }
+
+    memset(source, 0, sizeof(*source));
+}
+
+static void *yajp_get_setter_user_data(const yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action) {
+    // data bound to rule has higher priority than user data passed to deserialization function
+    return (NULL != action->setter_data) ? (void *) action->setter_data : data->user_data;
+}
+
+/**
+ * Helper function. Checks what string value fits into array of characters of inline string field and truncates it if
+ * rule allows truncation.
+ *
+ * @param action[in]            Pointer to deserialization rule
+ * @param value[in]             Pointer to string value
+ * @param capacity[in]          Size of array of characters in bytes
+ * @param value_size[in,out]    Size of string value. Set to size of truncated value
+ *
+ * @return  0 - if value fits or was truncated, -1 - otherwise
+ *
+ * @note    Truncated value doesn't end with part of multibyte UTF-8 character or part of escape sequence
+ */
+static int yajp_fit_inline_string(const yajp_deserialization_rule_t *action, const uint8_t *value, size_t capacity,
+                                  size_t *value_size) {
+    size_t size, i;
+
+    if (*value_size < capacity) {
+        return 0; // fits together with '\0'
+    }
+
+    if (!(action->options & YAJP_DESERIALIZATION_OPTIONS_TRUNCATE) || 0 == capacity) {
+        return -1;
+    }
+
+    // first byte after truncated value shouldn't be UTF-8 continuation byte
+    for (size = capacity - 1; 0 < size && 0x80 == (value[size] & 0xC0); size--);
+
+    // escape sequences are kept as is by lexer and should be dropped completely
+    for (i = 0; i < size; i++) {
+        if ('\\' == value[i]) {
+            if (i + (('u' == value[i + 1]) ? 6 : 2) > size) {
+                size = i;
+                break;
+            }
+            i += ('u' == value[i + 1]) ? 5 : 1;
+        }
+    }
+
+    *value_size = size;
+
+    return 0;
+}
+
+/**
+ * Helper function. Allocates memory for deserialized output with output allocator of deserialization call.
+ *
+ * @param data[in]  Pointer to deserialization data
+ * @param size[in]  Size of memory in bytes
+ *
+ * @return  Pointer to memory or NULL on error
+ */
+static void *yajp_output_alloc(yajp_deserialization_data_t *data, size_t size) {
+    return data->output->alloc(size, data->output->user);
+}
+
+/**
+ * Helper function. Changes size of memory allocated by @c yajp_output_realloc()
+ *
+ * @param data[in]      Pointer to deserialization data
+ * @param ptr[in]       Pointer to memory or NULL
+ * @param old_size[in]  Current size of memory in bytes
+ * @param new_size[in]  New size of memory in bytes
+ *
+ * @return  Pointer to memory or NULL on error
+ */
+static void *yajp_output_realloc(yajp_deserialization_data_t *data, void *ptr, size_t old_size, size_t new_size) {
+    return data->output->realloc(ptr, old_size, new_size, data->output->user);
+}
+
+/**
+ * Helper function. Releases memory allocated by @c yajp_output_alloc() or @c yajp_output_realloc()
+ *
+ * @param data[in]  Pointer to deserialization data
+ * @param ptr[in]   Pointer to memory
+ */
+static void yajp_output_free(yajp_deserialization_data_t *data, void *ptr) {
+    data->output->free(ptr, data->output->user);
+}
+
+/**
+ * Helper function. Provides memory for allocated value in reuse mode. Memory of previous value what is stored in
+ * @c slot is reused if it's big enough, otherwise it's released and new memory is allocated. Numbers and booleans have
+ * size of field type, so their memory is always reused.
+ *
+ * @param data[in]      Pointer to deserialization data
+ * @param action[in]    Rule of value
+ * @param slot[in, out] Pointer to pointer to memory of previous value or to NULL. Set to NULL if memory is released
+ * @param size[in]      Required size of memory in bytes
+ *
+ * @return  Pointer to memory or NULL on error
+ */
+static void *yajp_output_reuse(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action, void *slot,
+                               size_t size) {
+    size_t *capacity = yajp_string_capacity(action, slot);
+    void *value = *(void **) slot;
+
+    if (NULL != value) {
+        if (!(action->options & YAJP_DESERIALIZATION_TYPE_STRING)) {
+            return value;
+        }
+
+        // string without capacity field was allocated with elem_size bytes more than its length
+        if (size <= ((NULL != capacity) ? *capacity * action->elem_size : strlen(value) + action->elem_size)) {
+            return value;
+        }
+
+        yajp_output_free(data, value);
+        *(void **) slot = NULL;
+    }
+
+    value = yajp_output_alloc(data, size);
+    if (NULL != value && NULL != capacity) {
+        *capacity = size / action->elem_size;
+    }
+
+    return value;
+}
+
+/**
+ * Helper function. Finds capacity field of allocated string field, see
+ * @c yajp_deserialization_rule_set_capacity_offset().
+ *
+ * @param action[in]    Rule of value
+ * @param slot[in]      Pointer to field of value
+ *
+ * @return  Pointer to capacity field in holder of field or NULL if it isn't tracked
+ */
+static size_t *yajp_string_capacity(const yajp_deserialization_rule_t *action, void *slot) {
+    if (!action->track_capacity || (action->options & YAJP_DESERIALIZATION_TYPE_ARRAY_OF)) {
+        return NULL;
+    }
+
+    return slot - action->field_offset + action->capacity_offset;
+}
+
+/**
+ * Helper function. Grows memory of array what is stored in @c slot to fit at least @c size bytes. Capacity is doubled
+ * on each growth, so array of n elements costs O(log n) reallocations and O(n) copying.
+ *
+ * @param data[in]          Pointer to deserialization data
+ * @param slot[in, out]     Pointer to pointer to memory of array. Updated if memory is moved
+ * @param capacity[in, out] Size of memory of array in bytes
+ * @param size[in]          Required size of memory in bytes
+ * @param hint[in]          Expected size of array in bytes, used as initial capacity if it's bigger. 0 - if unknown
+ *
+ * @return  Result of growth. 0 - on success, -1 on error. Memory of array is not changed on error.
+ */
+static int yajp_output_grow(yajp_deserialization_data_t *data, void *slot, size_t *capacity, size_t size,
+                            size_t hint) {
+    size_t new_capacity;
+    void *tmp;
+
+    if (size <= *capacity) {
+        return 0;
+    }
+
+    if (0 == *capacity) {
+        new_capacity = YAJP_ARRAY_INITIAL_CAPACITY * size;
+        if (new_capacity < hint) {
+            new_capacity = hint;
+        }
+    } else {
+        new_capacity = (*capacity <= SIZE_MAX / 2) ? (*capacity * 2) : size;
+    }
+
+    if (new_capacity < size) {
+        new_capacity = size;
+    }
+
+    tmp = yajp_output_realloc(data, *(void **) slot, *capacity, new_capacity);
+    if (NULL == tmp) {
+        return -1; // errno set
+    }
+
+    *(void **) slot = tmp;
+    *capacity = new_capacity;
+
+    return 0;
+}
+
+/**
+ * Helper function. Returns expected size of array items learned from previous documents. Hint is needed only by the
+ * first allocation of array, so it isn't looked up for array what has memory.
+ *
+ * @param data[in]      Pointer to deserialization data
+ * @param action[in]    Rule of array
+ * @param elems[in]     true - for elements of array, false - for rows
+ * @param capacity[in]  Size of memory of array items in bytes
+ *
+ * @return  Expected size of memory in bytes or 0 if size isn't learned or array has memory
+ */
+static size_t yajp_array_size_hint(const yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                                   bool elems, size_t capacity) {
+    const yajp_size_hint_slot_t *slot;
+
+    if (NULL == data->size_hints || 0 != capacity) {
+        return 0;
+    }
+
+    slot = yajp_size_hint_slot(data->size_hints, action, false);
+    if (NULL == slot) {
+        return 0;
+    }
+
+    return elems
+           ? __atomic_load_n(&slot->elems, __ATOMIC_RELAXED) * action->elem_size
+           : __atomic_load_n(&slot->rows, __ATOMIC_RELAXED) * action->field_size;
+}
+
+/**
+ * Helper function. Updates moving maximum of size by size seen in deserialized document. Bigger size is taken at once,
+ * smaller one reduces maximum by 1/8 of difference, so single small document doesn't drop learned size.
+ *
+ * @param hint[in, out] Pointer to moving maximum stored in size hints
+ * @param size[in]      Seen size
+ *
+ * @note    Size hints can be shared by concurrent deserializations, so they are updated with relaxed atomics. Lost
+ *          updates only affect allocation sizes.
+ */
+static void yajp_update_size_hint(size_t *hint, size_t size) {
+    size_t current = __atomic_load_n(hint, __ATOMIC_RELAXED);
+
+    if (current == size) {
+        return;
+    }
+
+    __atomic_store_n(hint, (size > current) ? size : current - (current - size + 7) / 8, __ATOMIC_RELAXED);
+}
+
+/**
+ * Helper function. Shrinks memory of deserialized array if it's required by rule and stores capacity of array into
+ * its holder.
+ *
+ * @param data[in]      Pointer to deserialization data
+ * @param action[in]    Rule of array
+ * @param address[in]   Pointer to array holder
+ * @param capacity[in]  Size of memory of array in bytes
+ * @param size[in]      Size of used memory of array in bytes
+ */
+static void yajp_finish_array(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                              void *address, size_t capacity, size_t size) {
+    yajp_size_hint_slot_t *hint = NULL;
+    void *slot, *tmp;
+    size_t item_size;
+
+    if (NULL != data->size_hints) {
+        hint = yajp_size_hint_slot(data->size_hints, action, true);
+    }
+
+    if (*(bool *) (address + action->final_dym_offset)) {
+        if (!action->allocate_elems) {
+            return; // elements are stored in place
+        }
+        slot = address + action->elems_offset;
+        item_size = action->elem_size;
+        if (NULL != hint) {
+            yajp_update_size_hint(&hint->elems, size / item_size);
+        }
+    } else {
+        slot = address + action->rows_offset;
+        item_size = action->field_size;
+        if (NULL != hint) {
+            yajp_update_size_hint(&hint->rows, size / item_size);
+        }
+    }
+
+    if (action->shrink_to_fit && 0 < size && size < capacity) {
+        tmp = yajp_output_realloc(data, *(void **) slot, capacity, size);
+        // failed shrink is not an error, array just keeps unused memory
+        if (NULL != tmp) {
+            *(void **) slot = tmp;
+            capacity = size;
+        }
+    }
+
+    if (action->track_capacity) {
+        *(size_t *) (address + action->capacity_offset) = capacity / item_size;
+    }
+}
+
+/**
+ * Helper function. Prepares previously deserialized array for reuse: takes its amount of items and capacity and resets
+ * its counter, so items are overwritten in place.
+ *
+ * @param action[in]            Rule of array
+ * @param address[in, out]      Pointer to array holder
+ * @param capacity[out]         Size of memory of elements or rows in bytes
+ * @param reused_count[out]     Amount of items of previous array
+ */
+static void yajp_reuse_array(const yajp_deserialization_rule_t *action, void *address, size_t *capacity,
+                             size_t *reused_count) {
+    size_t *count = address + action->counter_offset;
+    bool final_dim = *(bool *) (address + action->final_dym_offset);
+    void *slot = address + (final_dim ? action->elems_offset : action->rows_offset);
+    size_t item_size = final_dim ? action->elem_size : action->field_size;
+
+    *reused_count = *count;
+    *count = 0;
+
+    if ((final_dim && !action->allocate_elems) || NULL == *(void **) slot) {
+        *capacity = 0;
+    } else {
+        *capacity = (action->track_capacity ? *(size_t *) (address + action->capacity_offset) : *reused_count) * item_size;
+    }
+}
+
+/**
+ * Helper function. Called on first item of reused array. If previous array had another shape (elements instead of rows
+ * or vice versa) its content is released and array is filled from scratch.
+ *
+ * @param data[in]              Pointer to deserialization data
+ * @param action[in]            Rule of array
+ * @param address[in, out]      Pointer to array holder with final dimension flag of deserializing array
+ * @param reused_final_dim[in]  Final dimension flag of previous array
+ * @param capacity[in, out]     Size of memory of elements or rows in bytes. Reset if content is released
+ * @param reused_count[in, out] Amount of items of previous array. Reset if content is released
+ */
+static void yajp_reshape_array(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                               void *address, bool reused_final_dim, size_t *capacity, size_t *reused_count) {
+    bool *final_dim = address + action->final_dym_offset;
+    bool current_final_dim = *final_dim;
+
+    if (current_final_dim == reused_final_dim) {
+        return;
+    }
+
+    *final_dim = reused_final_dim;
+    *(size_t *) (address + action->counter_offset) = *reused_count;
+    yajp_release_array(data->output, action, address);
+
+    // rows and elements can share memory of holder
+    memset(address, 0, action->field_size);
+    *final_dim = current_final_dim;
+    *capacity = 0;
+    *reused_count = 0;
+}
+
+/**
+ * Helper function. Releases items of previous array what weren't overwritten by deserialized one.
+ *
+ * @param data[in]              Pointer to deserialization data
+ * @param action[in]            Rule of array
+ * @param address[in, out]      Pointer to array holder
+ * @param reused_final_dim[in]  Final dimension flag of previous array
+ * @param reused_count[in]      Amount of items of previous array
+ */
+static void yajp_finish_reused_array(yajp_deserialization_data_t *data, const yajp_deserialization_rule_t *action,
+                                     void *address, bool reused_final_dim, size_t reused_count) {
+    size_t count = *(size_t *) (address + action->counter_offset);
+
+    // shape of empty array is unknown, so it keeps memory of previous one
+    if (0 == count) {
+        *(bool *) (address + action->final_dym_offset) = reused_final_dim;
+    }
+
+    if (count < reused_count) {
+        yajp_release_array_items(data->output, action, address, count, reused_count);
+    }
+}
+
+/**
+ * Helper function. Checks what objects deserialized with context can own memory, i.e. context has rules which allocate
+ * memory directly or through nested objects.
+ *
+ * @param ctx[in]   Deserialization context
+ *
+ * @return  true - if objects can own memory, false - otherwise
+ */
+static bool yajp_context_owns_memory(const yajp_deserialization_context_t *ctx) {
+    const yajp_deserialization_rule_t *action;
+    size_t i;
+
+    for (i = 0; i < ctx->rules_count; i++) {
+        action = &ctx->rules_list[i];
+
+        // nested object stored in place can't refer to itself, so recursion ends
+        if (action->allocate || (action->options & YAJP_DESERIALIZATION_TYPE_ARRAY_OF) ||
+            ((action->options & YAJP_DESERIALIZATION_TYPE_OBJECT) && yajp_context_owns_memory(action->ctx))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Helper function. Releases memory owned by fields of deserialized object.
+ *
+ * @param allocator[in]     Allocator of deserialized output
+ * @param ctx[in]           Deserialization context of object
+ * @param address[in, out]  Pointer to object
+ */
+static void yajp_release_object(const yajp_allocator_t *allocator, const yajp_deserialization_context_t *ctx,
+                                void *address) {
+    size_t i;
+
+    for (i = 0; i < ctx->rules_count; i++) {
+        yajp_release_value(allocator, &ctx->rules_list[i], address + ctx->rules_list[i].field_offset);
+    }
+}
+
+/**
+ * Helper function. Releases memory owned by deserialized field.
+ *
+ * @param allocator[in]     Allocator of deserialized output
+ * @param action[in]        Rule of field
+ * @param address[in, out]  Pointer to field
+ */
+static void yajp_release_value(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                               void *address) {
+    void *value = action->allocate ? *(void **) address : address;
+    size_t *capacity;
+
+    switch (action->options & 0b00011111) {
+        case YAJP_DESERIALIZATION_TYPE_NUMBER:
+        case YAJP_DESERIALIZATION_TYPE_STRING:
+        case YAJP_DESERIALIZATION_TYPE_BOOLEAN:
+            break;
+        case (YAJP_DESERIALIZATION_TYPE_OBJECT):
+            if (NULL != value) {
+                yajp_release_object(allocator, action->ctx, value);
+            }
+            break;
+        default:
+            if (NULL != value) {
+                yajp_release_array(allocator, action, value);
+            }
+            break;
+    }
+
+    if (action->allocate) {
+        yajp_release_memory(allocator, address);
+
+        capacity = yajp_string_capacity(action, address);
+        if (NULL != capacity) {
+            *capacity = 0;
+        }
+    }
+}
+
+/**
+ * Helper function. Releases rows, elements and strings of deserialized array.
+ *
+ * @param allocator[in]     Allocator of deserialized output
+ * @param action[in]        Rule of array
+ * @param address[in, out]  Pointer to array holder
+ */
+static void yajp_release_array(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                               void *address) {
+    yajp_release_array_items(allocator, action, address, 0, *(size_t *) (address + action->counter_offset));
+    yajp_release_array_storage(allocator, action, address);
+}
+
+/**
+ * Helper function. Releases memory of rows or elements of array whose items are released already and empties array.
+ *
+ * @param allocator[in]     Allocator of deserialized output
+ * @param action[in]        Rule of array
+ * @param address[in, out]  Pointer to array holder
+ */
+static void yajp_release_array_storage(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                                       void *address) {
+    if (!*(bool *) (address + action->final_dym_offset)) {
+        yajp_release_memory(allocator, address + action->rows_offset);
+    } else if (action->allocate_elems) {
+        yajp_release_memory(allocator, address + action->elems_offset);
+    }
+
+    *(size_t *) (address + action->counter_offset) = 0;
+    if (action->track_capacity) {
+        *(size_t *) (address + action->capacity_offset) = 0;
+    }
+}
+
+/**
+ * Helper function. Releases memory owned by items of deserialized array, but not memory of items themselves.
+ *
+ * @param allocator[in]     Allocator of deserialized output
+ * @param action[in]        Rule of array
+ * @param address[in, out]  Pointer to array holder
+ * @param first[in]         Index of first released item
+ * @param last[in]          Index of item after last released one
+ */
+static void yajp_release_array_items(const yajp_allocator_t *allocator, const yajp_deserialization_rule_t *action,
+                                     void *address, size_t first, size_t last) {
+    void *items;
+    size_t i;
+
+    if (!*(bool *) (address + action->final_dym_offset)) {
+        items = *(void **) (address + action->rows_offset);
+        for (i = first; i < last; i++) {
+            yajp_release_array(allocator, action, items + i * action->field_size);
+        }
+    } else {
+        items = action->allocate_elems ? *(void **) (address + action->elems_offset) : address + action->elems_offset;
+
+        if (action->options & YAJP_DESERIALIZATION_TYPE_OBJECT) {
+            // plain objects are not walked one by one
+            if (first < last && yajp_context_owns_memory(action->ctx)) {
+                for (i = first; i < last; i++) {
+                    yajp_release_object(allocator, action->ctx, items + i * action->elem_size);
+                }
+            }
+        } else if ((action->options & YAJP_DESERIALIZATION_TYPE_STRING) && !action->inline_string &&
+                   !action->interned_string) {
+            for (i = first; i < last; i++) {
+                yajp_release_memory(allocator, items + i * action->elem_size);
+            }
+        }
+    }
+}
+
+/**
+ * Helper function. Releases memory what is stored in @c slot and sets slot to NULL.
+ *
+ * @param allocator[in]     Allocator of deserialized output
+ * @param slot[in, out]     Pointer to pointer to memory. Nothing is released if it points to NULL
+ */
+static void yajp_release_memory(const yajp_allocator_t *allocator, void *slot) {
+    if (NULL != *(void **) slot) {
+        allocator->free(*(void **) slot, allocator->user);
+        *(void **) slot = NULL;
+    }
+}
+
+/**
+ * Helper function. Takes session of calling thread, creating it on first use. Session keeps memory allocated by heap
+ * allocator only, because custom allocator can be gone before thread exits.
+ *
+ * @param allocator[in]     Allocator of lexer and parser memory
+ *
+ * @return  Session marked as busy, or NULL if memory can't be kept or session is used by outer deserialization, i.e.
+ *          setter of this thread deserializes another document
+ */
+static yajp_deserialization_session_t *yajp_session_acquire(const yajp_allocator_t *allocator) {
+    yajp_deserialization_session_t *session = yajp_thread_session;
+
+    if (&yajp_heap_allocator != allocator) {
+        return NULL;
+    }
+
+    if (NULL == session) {
+        pthread_once(&yajp_session_key_once, yajp_session_create_key);
+        if (!yajp_session_key_created) {
+            return NULL;
+        }
+
+        session = yajp_deserialization_session_create(&yajp_heap_allocator);
+        if (NULL == session) {
+            return NULL;
+        }
+
+        if (0 != pthread_setspecific(yajp_session_key, session)) {
+            free(session);
+            return NULL;
+        }
+
+        yajp_thread_session = session;
+    }
+
+    if (session->busy) {
+        return NULL;
+    }
+
+    session->busy = true;
+    return session;
+}
+
+/**
+ * Helper function. Creates key what releases sessions of exiting threads.
+ */
+static void yajp_session_create_key(void) {
+    yajp_session_key_created = (0 == pthread_key_create(&yajp_session_key, yajp_session_destroy));
+}
+
+/**
+ * Helper function. Releases session of thread with all memory kept by it.
+ *
+ * @param session[in]   Session of thread
+ */
+static void yajp_session_destroy(void *session) {
+    yajp_deserialization_session_release(session);
+
+    yajp_thread_session = NULL;
+}
+
+/**
+ * Helper function. Releases memory kept by session, but not session itself.
+ *
+ * @param session[in, out]  Session
+ */
+static void yajp_session_release_memory(yajp_deserialization_session_t *session) {
+    const yajp_allocator_t *allocator = session->allocator;
+
+    if (NULL != session->parser) {
+        yajp_parser_finalize(session->parser);
+        allocator->free(session->parser, allocator->user);
+    }
+
+    if (NULL != session->buffer) {
+        allocator->free(session->buffer, allocator->user);
+    }
+
+    if (NULL != session->frames) {
+        allocator->free(session->frames, allocator->user);
+    }
+}
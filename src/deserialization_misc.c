@@ -21,9 +21,12 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
 #include "khash.h"
 #include "deserialization_misc.h"
+#include "serialization_misc.h"
+#include "yajp/deserialization_routine.h"
 
 field_key_t yajp_calculate_hash(const uint8_t *data, size_t data_size) {
     return __ac_X31_hash_string(data, data_size);
@@ -47,7 +50,7 @@ const yajp_deserialization_rule_t *yajp_find_action(const yajp_deserialization_c
 }
 
 int yajp_deserialization_context_init(yajp_deserialization_rule_t *acts, int count, yajp_deserialization_context_t *ctx) {
-    int ret, i;
+    int ret = 1, i;
     khash_t(yajp) *hashmap = kh_init(yajp);
     field_key_t key;
     khiter_t iterator;
@@ -66,12 +69,154 @@ int yajp_deserialization_context_init(yajp_deserialization_rule_t *acts, int cou
         kh_value(hashmap, iterator) = &acts[i];
     }
 
+    ctx->fields = yajp_serialization_fields_init(acts, count);
+    if (NULL == ctx->fields) {
+        kh_destroy(yajp, hashmap);
+        ret = 0;
+        goto end;
+    }
+
     ctx->rules = hashmap;
+    ctx->rules_list = acts;
+    ctx->rules_count = count;
+    ctx->allocator = NULL;
+    ctx->reuse = false;
+    ctx->size_hints = NULL;
+    ctx->max_depth = YAJP_DESERIALIZATION_DEFAULT_MAX_DEPTH;
+    ctx->stack_depth = 0;
+    ctx->read_ahead = 0;
+    ctx->escape_non_ascii = false;
+    ctx->exact_size = false;
 
 end:
     return (!ret) ? -1 : 0;
 }
 
+void yajp_deserialization_context_release(yajp_deserialization_context_t *ctx) {
+    kh_destroy(yajp, (khash_t(yajp) *)ctx->rules);
+    yajp_serialization_fields_release(ctx->fields);
+    ctx->rules = NULL;
+    ctx->fields = NULL;
+    ctx->rules_list = NULL;
+    ctx->rules_count = 0;
+}
+
+int yajp_deserialization_context_set_allocator(yajp_deserialization_context_t *ctx, const yajp_allocator_t *allocator) {
+    ctx->allocator = allocator;
+    return 0;
+}
+
+int yajp_deserialization_context_set_reuse(yajp_deserialization_context_t *ctx, bool reuse) {
+    ctx->reuse = reuse;
+    return 0;
+}
+
+int yajp_deserialization_context_set_size_hints(yajp_deserialization_context_t *ctx,
+                                                yajp_deserialization_size_hints_t *hints) {
+    ctx->size_hints = hints;
+    return 0;
+}
+
+int yajp_deserialization_size_hints_init(size_t expected_count, yajp_deserialization_size_hints_t *result) {
+    size_t count = 16;
+
+    // table is kept at most half full, so probes are short
+    while (count < expected_count * 2) {
+        count <<= 1;
+    }
+
+    result->slots = calloc(count, sizeof(yajp_size_hint_slot_t));
+    if (NULL == result->slots) {
+        return -1; // errno set
+    }
+
+    result->slots_mask = count - 1;
+    result->buffer_size = 0;
+
+    return 0;
+}
+
+void yajp_deserialization_size_hints_release(yajp_deserialization_size_hints_t *hints) {
+    free(hints->slots);
+    hints->slots = NULL;
+    hints->slots_mask = 0;
+    hints->buffer_size = 0;
+}
+
+int yajp_deserialization_size_hints_get(const yajp_deserialization_size_hints_t *hints,
+                                        const yajp_deserialization_rule_t *rule, size_t *rows, size_t *elems) {
+    const yajp_size_hint_slot_t *slot = yajp_size_hint_slot(hints, rule, false);
+
+    if (NULL == slot) {
+        return -1;
+    }
+
+    if (NULL != rows) {
+        *rows = __atomic_load_n(&slot->rows, __ATOMIC_RELAXED);
+    }
+    if (NULL != elems) {
+        *elems = __atomic_load_n(&slot->elems, __ATOMIC_RELAXED);
+    }
+
+    return 0;
+}
+
+yajp_size_hint_slot_t *yajp_size_hint_slot(const yajp_deserialization_size_hints_t *hints,
+                                           const yajp_deserialization_rule_t *rule, bool insert) {
+    yajp_size_hint_slot_t *slots = hints->slots, *slot;
+    const yajp_deserialization_rule_t *key;
+    size_t hash, i;
+
+    if (NULL == slots) {
+        return NULL;
+    }
+
+    // rules are aligned, so low bits of address are mixed by multiplication
+    hash = (size_t) (((uint64_t) (uintptr_t) rule * 0x9e3779b97f4a7c15ull) >> 32);
+
+    for (i = 0; i <= hints->slots_mask; i++) {
+        slot = &slots[(hash + i) & hints->slots_mask];
+        key = __atomic_load_n(&slot->rule, __ATOMIC_ACQUIRE);
+
+        if (NULL == key) {
+            if (!insert) {
+                return NULL;
+            }
+
+            // failed exchange loads rule of other thread, which can be the same rule
+            if (__atomic_compare_exchange_n(&slot->rule, &key, rule, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                return slot;
+            }
+        }
+
+        if (key == rule) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+int yajp_deserialization_context_set_max_depth(yajp_deserialization_context_t *ctx, size_t max_depth) {
+    if (0 == max_depth) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    ctx->max_depth = max_depth;
+    return 0;
+}
+
+int yajp_deserialization_context_set_stack_depth(yajp_deserialization_context_t *ctx, size_t depth) {
+    ctx->stack_depth = depth;
+    return 0;
+}
+
+int yajp_deserialization_context_set_read_ahead(yajp_deserialization_context_t *ctx, size_t block_size) {
+    ctx->read_ahead = block_size;
+    return 0;
+}
+
 int yajp_deserialization_rule_init(const char *name,
                                    size_t name_size,
                                    size_t field_offset,
@@ -87,16 +232,29 @@ int yajp_deserialization_rule_init(const char *name,
                                    yajp_deserialization_rule_t *result) {
 
     result->options = options;
-#if DEBUG
     result->field_name = name;
     result->field_name_size = name_size;
-#endif
     result->field_key = yajp_calculate_hash((const uint8_t *)name, name_size);
     result->field_size = field_size;
     result->field_offset = field_offset;
 
     result->allocate = options & (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE | YAJP_DESERIALIZATION_TYPE_NULLABLE);
     result->allocate_elems = options & YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS;
+    result->inline_string = options & (YAJP_DESERIALIZATION_OPTIONS_INLINE | YAJP_DESERIALIZATION_OPTIONS_TRUNCATE);
+    result->interned_string = yajp_set_interned_string == setter;
+    result->shrink_to_fit = options & YAJP_DESERIALIZATION_OPTIONS_SHRINK_TO_FIT;
+    result->track_capacity = false;
+    result->capacity_offset = 0;
+
+    // inline strings are stored in place, so they can't be allocated and can't be NULL
+    if (result->inline_string && (result->allocate || !(options & YAJP_DESERIALIZATION_TYPE_STRING))) {
+        return -1;
+    }
+
+    // interned strings are set by pointer into pool, so field or element can't hold allocated string or inline one
+    if (result->interned_string && (result->allocate || result->inline_string)) {
+        return -1;
+    }
 
     if (options & YAJP_DESERIALIZATION_TYPE_ARRAY_OF) {
         result->counter_offset = counter_offset;
@@ -109,6 +267,8 @@ int yajp_deserialization_rule_init(const char *name,
             ? elem_size
             : 0;
 
+    result->setter_data = NULL;
+
     if ((NULL == setter) ^ (NULL == ctx)) {
         if (setter) {
             result->setter = setter;
@@ -120,4 +280,27 @@ int yajp_deserialization_rule_init(const char *name,
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+int yajp_deserialization_rule_set_setter_data(yajp_deserialization_rule_t *rule, const void *setter_data) {
+    // bound data has sense only for rules with setter
+    if (rule->options & YAJP_DESERIALIZATION_TYPE_OBJECT) {
+        return -1;
+    }
+
+    rule->setter_data = setter_data;
+    return 0;
+}
+
+int yajp_deserialization_rule_set_capacity_offset(yajp_deserialization_rule_t *rule, size_t capacity_offset) {
+    bool allocated_string = rule->allocate && (rule->options & YAJP_DESERIALIZATION_TYPE_STRING) &&
+                            0 < rule->elem_size;
+
+    if (!(rule->options & YAJP_DESERIALIZATION_TYPE_ARRAY_OF) && !allocated_string) {
+        return -1;
+    }
+
+    rule->track_capacity = true;
+    rule->capacity_offset = capacity_offset;
+    return 0;
+}
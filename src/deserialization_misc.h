@@ -45,4 +45,64 @@ field_key_t yajp_calculate_hash(const uint8_t *data, size_t data_size);
 const yajp_deserialization_rule_t *yajp_find_action(const yajp_deserialization_context_t *ctx, const uint8_t *name,
                                                     size_t name_size);
 
+/**
+ * Learned sizes of array rule in table of size hints
+ */
+typedef struct yajp_size_hint_slot {
+    const yajp_deserialization_rule_t *rule;    // key of slot. NULL - slot is free
+    size_t rows;                                // moving maximum of amount of rows
+    size_t elems;                               // moving maximum of amount of elements
+} yajp_size_hint_slot_t;
+
+/**
+ * Finds slot of array rule in table of size hints. Lookup is lock free.
+ *
+ * @param hints[in]     Pointer to size hints
+ * @param rule[in]      Array rule
+ * @param insert[in]    true - to take free slot for rule if it's not found
+ *
+ * @return  Slot of rule or NULL if rule isn't found or table is full
+ */
+yajp_size_hint_slot_t *yajp_size_hint_slot(const yajp_deserialization_size_hints_t *hints,
+                                           const yajp_deserialization_rule_t *rule, bool insert);
+
+/**
+ * Memory of lexer and parser kept between deserializations
+ */
+typedef struct yajp_deserialization_session yajp_deserialization_session_t;
+
+/**
+ * Creates session what keeps memory of lexer and parser between deserializations of texts, so thread deserializing
+ * many small documents allocates it once.
+ *
+ * @param allocator[in]     Allocator of lexer and parser memory and of deserialized values. NULL means heap
+ *
+ * @return  Session or NULL with errno set
+ */
+yajp_deserialization_session_t *yajp_deserialization_session_create(const yajp_allocator_t *allocator);
+
+/**
+ * Deserializes JSON text in memory with parser, lexer buffer and deserialization stack of session. Text isn't copied
+ * into stream and doesn't need terminating zero.
+ *
+ * @param session[in, out]  Session. Shouldn't be used by other threads at the same time. NULL - to use session of
+ *                          calling thread with heap allocator, what is kept till thread exits
+ * @param json[in]          JSON text
+ * @param json_size[in]     Size of JSON text in bytes
+ * @param ctx[in]           Deserialization context
+ * @param address[out]      Deserializing structure
+ * @param user_data[in]     Data passed to setters
+ *
+ * @return  Result of deserialization. 0 - on success, -1 with errno set otherwise
+ */
+int yajp_deserialize_json_text(yajp_deserialization_session_t *session, const char *json, size_t json_size,
+                               const yajp_deserialization_context_t *ctx, void *address, void *user_data);
+
+/**
+ * Releases session with all memory kept by it.
+ *
+ * @param session[in]   Session. NULL is ignored
+ */
+void yajp_deserialization_session_release(yajp_deserialization_session_t *session);
+
 #endif //YAJP_DESERIALIZATION_MISC_H
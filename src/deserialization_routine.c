@@ -23,9 +23,90 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
 
 #include "yajp/deserialization_routine.h"
 
+/* helper function prototypes */
+static bool yajp_is_timestamp_layout_valid(const uint8_t *value);
+
+static int64_t yajp_days_from_civil(int year, unsigned month, unsigned day);
+
+static uint64_t yajp_enum_hash(const uint8_t *data, size_t data_size, uint64_t seed);
+
+static size_t yajp_enum_slot(uint64_t hash, uint32_t displacement, size_t slots_mask);
+
+static int yajp_enum_build(yajp_deserialization_enum_t *enumeration, uint64_t *hashes, size_t *order, size_t buckets);
+
+/**
+ * String stored in pool of interned strings
+ */
+typedef struct yajp_interned_string yajp_interned_string_t;
+struct yajp_interned_string {
+    yajp_interned_string_t *next;       // next string in bucket chain. Immutable after string is published
+    uint64_t hash;                      // hash of string
+    size_t size;                        // size of string without '\0'
+    char value[];                       // '\0' terminated string
+};
+
+typedef _Atomic(yajp_interned_string_t *) yajp_intern_bucket_t;
+
+static const yajp_interned_string_t *yajp_intern_find(const yajp_interned_string_t *head,
+                                                      const yajp_interned_string_t *stop, uint64_t hash,
+                                                      const uint8_t *value, size_t value_size);
+
+static int yajp_base64_decode(const uint8_t *digits, bool url, const uint8_t *value, size_t value_size,
+                              uint8_t *result, size_t capacity, size_t *result_size);
+
+/**
+ * Values of base64 digits for each alphabet. 0xFF marks characters what aren't digits of alphabet
+ */
+static const uint8_t yajp_base64_digits[2][256] = {
+        {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+            0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+            0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+            0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        },
+        {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF,
+            0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+            0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0x3F,
+            0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+            0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+        },
+};
+
 int yajp_set_short(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field,
                    void *user_data) {
     uint8_t *pend;
@@ -270,4 +351,797 @@ int yajp_set_string(const uint8_t *name, size_t name_size, const uint8_t *value,
     ((char *) field)[value_size] = '\0';
 
     return 0;
-}
\ No newline at end of file
+}
+
+int yajp_set_timestamp(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field,
+                       void *user_data) {
+#define DIGIT(pos) ((int) (value[(pos)] - '0'))
+#define TIMESTAMP_MIN_SIZE  20  // YYYY-MM-DDTHH:MM:SSZ
+#define NANOSECONDS         1000000000LL
+    static const unsigned char days_in_month[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+    const uint8_t *cursor, *end;
+    int year, month, day, hour, minute, second, offset_hour, offset_minute, offset = 0, fraction_digits = 0;
+    int64_t fraction = 0, seconds;
+    bool leap;
+
+    (void) name;
+    (void) name_size;
+    (void) user_data;
+
+    if (NULL == value || TIMESTAMP_MIN_SIZE > value_size || !yajp_is_timestamp_layout_valid(value)) {
+        return -1;
+    }
+
+    year = DIGIT(0) * 1000 + DIGIT(1) * 100 + DIGIT(2) * 10 + DIGIT(3);
+    month = DIGIT(5) * 10 + DIGIT(6);
+    day = DIGIT(8) * 10 + DIGIT(9);
+    hour = DIGIT(11) * 10 + DIGIT(12);
+    minute = DIGIT(14) * 10 + DIGIT(15);
+    second = DIGIT(17) * 10 + DIGIT(18);
+
+    leap = (0 == year % 4) && ((0 != year % 100) || (0 == year % 400));
+
+    // second 60 is allowed for leap seconds and handled in the same way as timegm() does
+    if (month < 1 || month > 12 || day < 1 || hour > 23 || minute > 59 || second > 60 ||
+        day > days_in_month[month - 1] + ((2 == month && leap) ? 1 : 0)) {
+        return -1;
+    }
+
+    cursor = value + 19;
+    end = value + value_size;
+
+    if ('.' == *cursor) {
+        cursor++;
+        if (cursor == end || (unsigned) (*cursor - '0') > 9) {
+            return -1; // at least one digit expected after decimal point
+        }
+
+        for (; cursor != end && (unsigned) (*cursor - '0') <= 9; cursor++) {
+            if (fraction_digits < 9) {
+                fraction = fraction * 10 + (*cursor - '0');
+                fraction_digits++;
+            }
+        }
+
+        for (; fraction_digits < 9; fraction_digits++) {
+            fraction *= 10;
+        }
+    }
+
+    if (cursor == end) {
+        return -1; // time offset expected
+    }
+
+    switch (*cursor) {
+        case 'Z':
+        case 'z':
+            cursor++;
+            break;
+        case '+':
+        case '-':
+            if (end - cursor != 6 || ':' != cursor[3] ||
+                (unsigned) (cursor[1] - '0') > 9 || (unsigned) (cursor[2] - '0') > 9 ||
+                (unsigned) (cursor[4] - '0') > 9 || (unsigned) (cursor[5] - '0') > 9) {
+                return -1;
+            }
+
+            offset_hour = (cursor[1] - '0') * 10 + (cursor[2] - '0');
+            offset_minute = (cursor[4] - '0') * 10 + (cursor[5] - '0');
+            if (offset_hour > 23 || offset_minute > 59) {
+                return -1;
+            }
+
+            offset = offset_hour * 60 + offset_minute;
+            offset = ('-' == *cursor) ? -offset : offset;
+            cursor += 6;
+            break;
+        default:
+            return -1;
+    }
+
+    if (cursor != end) {
+        return -1; // trailing garbage
+    }
+
+    seconds = yajp_days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset * 60;
+
+    // check that result fits into int64_t nanoseconds
+    if (seconds > INT64_MAX / NANOSECONDS - 1 || seconds < INT64_MIN / NANOSECONDS + 1) {
+        return -1;
+    }
+
+    *((int64_t *) field) = seconds * NANOSECONDS + fraction;
+    return 0;
+
+#undef DIGIT
+#undef TIMESTAMP_MIN_SIZE
+#undef NANOSECONDS
+}
+
+int yajp_deserialization_enum_init(const yajp_deserialization_enum_item_t *items, size_t count, bool use_default,
+                                   int default_value, yajp_deserialization_enum_t *result) {
+#define SEED_ATTEMPTS   16
+    uint64_t *hashes;
+    size_t *order, buckets = 1, slots = 1, i;
+    int attempt, ret = -1;
+
+    memset(result, 0, sizeof(*result));
+
+    if ((NULL == items && 0 != count) || INT32_MAX < count) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    result->items = items;
+    result->count = count;
+    result->use_default = use_default;
+    result->default_value = default_value;
+
+    // about one item per bucket and load factor of slots table not greater than 0.5
+    while (buckets < count) {
+        buckets <<= 1;
+    }
+    while (slots < 2 * count) {
+        slots <<= 1;
+    }
+
+    result->buckets_mask = buckets - 1;
+    result->slots_mask = slots - 1;
+    result->displacements = calloc(buckets, sizeof(*result->displacements));
+    result->slots = malloc(slots * sizeof(*result->slots));
+    hashes = malloc((count + 1) * sizeof(*hashes));
+    order = malloc((count + 1) * sizeof(*order));
+
+    if (NULL == result->displacements || NULL == result->slots || NULL == hashes || NULL == order) {
+        free(hashes);
+        free(order);
+        yajp_deserialization_enum_release(result);
+        return -1; // errno set by malloc
+    }
+
+    for (attempt = 0; attempt < SEED_ATTEMPTS && 0 != ret; attempt++) {
+        result->seed = 0x9E3779B97F4A7C15ULL * (attempt + 1);
+
+        for (i = 0; i < count; i++) {
+            hashes[i] = yajp_enum_hash((const uint8_t *) items[i].name, items[i].name_size, result->seed);
+        }
+
+        ret = yajp_enum_build(result, hashes, order, buckets);
+        if (0 > ret) {
+            break; // duplicated items
+        }
+    }
+
+    free(hashes);
+    free(order);
+
+    if (0 != ret) {
+        yajp_deserialization_enum_release(result);
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+#undef SEED_ATTEMPTS
+}
+
+void yajp_deserialization_enum_release(yajp_deserialization_enum_t *enumeration) {
+    free(enumeration->displacements);
+    free(enumeration->slots);
+    memset(enumeration, 0, sizeof(*enumeration));
+}
+
+int yajp_set_enum(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field,
+                  void *user_data) {
+    const yajp_deserialization_enum_t *enumeration = user_data;
+    const yajp_deserialization_enum_item_t *item;
+    uint64_t hash;
+    int32_t index;
+
+    (void) name;
+    (void) name_size;
+
+    if (NULL == enumeration || NULL == enumeration->slots || (NULL == value && 0 != value_size)) {
+        return -1;
+    }
+
+    hash = yajp_enum_hash(value, value_size, enumeration->seed);
+    index = enumeration->slots[yajp_enum_slot(hash,
+                                              enumeration->displacements[(hash >> 32) & enumeration->buckets_mask],
+                                              enumeration->slots_mask)];
+
+    if (0 <= index) {
+        item = &enumeration->items[index];
+        if (item->name_size == value_size && 0 == memcmp(item->name, value, value_size)) {
+            *((int *) field) = item->value;
+            return 0;
+        }
+    }
+
+    if (enumeration->use_default) {
+        *((int *) field) = enumeration->default_value;
+        return 0;
+    }
+
+    return -1;
+}
+
+int yajp_set_base64(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field,
+                    void *user_data) {
+    const yajp_deserialization_base64_t *base64 = user_data;
+    size_t decoded_size;
+
+    (void) name;
+    (void) name_size;
+
+    if (NULL == base64 || (NULL == value && 0 != value_size) ||
+        YAJP_DESERIALIZATION_BASE64_URL < (unsigned) base64->alphabet) {
+        return -1;
+    }
+
+    if (0 != yajp_base64_decode(yajp_base64_digits[base64->alphabet],
+                                YAJP_DESERIALIZATION_BASE64_URL == base64->alphabet, value, value_size, field,
+                                base64->capacity, &decoded_size)) {
+        return -1;
+    }
+
+    *((size_t *) ((uint8_t *) field + base64->size_offset)) = decoded_size;
+
+    return 0;
+}
+
+int yajp_deserialization_intern_pool_init(size_t expected_count, yajp_deserialization_intern_pool_t *result) {
+    yajp_intern_bucket_t *buckets;
+    size_t count = 16, i;
+
+    // chains of about one string per bucket
+    while (count < expected_count) {
+        count <<= 1;
+    }
+
+    buckets = malloc(count * sizeof(*buckets));
+    if (NULL == buckets) {
+        return -1; // errno set
+    }
+
+    for (i = 0; i < count; i++) {
+        atomic_init(&buckets[i], NULL);
+    }
+
+    result->buckets_mask = count - 1;
+    result->buckets = buckets;
+
+    return 0;
+}
+
+void yajp_deserialization_intern_pool_release(yajp_deserialization_intern_pool_t *pool) {
+    yajp_intern_bucket_t *buckets = pool->buckets;
+    yajp_interned_string_t *string, *next;
+    size_t i;
+
+    if (NULL == buckets) {
+        return;
+    }
+
+    for (i = 0; i <= pool->buckets_mask; i++) {
+        for (string = atomic_load_explicit(&buckets[i], memory_order_relaxed); NULL != string; string = next) {
+            next = string->next;
+            free(string);
+        }
+    }
+
+    free(buckets);
+    pool->buckets = NULL;
+    pool->buckets_mask = 0;
+}
+
+const char *yajp_deserialization_intern(yajp_deserialization_intern_pool_t *pool, const uint8_t *value,
+                                        size_t value_size) {
+    yajp_intern_bucket_t *bucket;
+    yajp_interned_string_t *head, *string = NULL;
+    const yajp_interned_string_t *found;
+    uint64_t hash;
+
+    if (NULL == pool || NULL == pool->buckets || (NULL == value && 0 != value_size)) {
+        return NULL;
+    }
+
+    hash = yajp_enum_hash(value, value_size, 0);
+    bucket = &((yajp_intern_bucket_t *) pool->buckets)[hash & pool->buckets_mask];
+
+    // fast path: string is already published, acquire pairs with release of publishing thread
+    head = atomic_load_explicit(bucket, memory_order_acquire);
+    found = yajp_intern_find(head, NULL, hash, value, value_size);
+    if (NULL != found) {
+        return found->value;
+    }
+
+    string = malloc(sizeof(*string) + value_size + 1);
+    if (NULL == string) {
+        return NULL; // errno set
+    }
+
+    string->hash = hash;
+    string->size = value_size;
+    memcpy(string->value, value, value_size);
+    string->value[value_size] = '\0';
+
+    // publish string. If other threads published strings meanwhile, check only them before retry
+    do {
+        string->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(bucket, &head, string, memory_order_release, memory_order_acquire) &&
+             NULL == (found = yajp_intern_find(head, string->next, hash, value, value_size)));
+
+    if (NULL != found) {
+        free(string);
+        return found->value;
+    }
+
+    return string->value;
+}
+
+int yajp_set_interned_string(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size,
+                             void *field, void *user_data) {
+    const char *interned;
+
+    (void) name;
+    (void) name_size;
+
+    interned = yajp_deserialization_intern(user_data, value, value_size);
+    if (NULL == interned) {
+        return -1;
+    }
+
+    *((const char **) field) = interned;
+
+    return 0;
+}
+
+/**
+ * Helper function. Validates fixed layout @c YYYY-MM-DDTHH:MM:SS of timestamp.
+ *
+ * @param value[in]     Pointer to string with at least 19 bytes
+ *
+ * @return  true if all digits and separators are on their places
+ *
+ * @note    First 16 bytes are validated with two 64-bit words at once (SWAR). Bytes on separator positions are
+ *          compared with template and bytes on digit positions are replaced with '0' before check. Masks are built
+ *          with memcpy() from byte arrays, so check doesn't depend on byte order.
+ */
+static bool yajp_is_timestamp_layout_valid(const uint8_t *value) {
+    // 0xFF - digit position, 0x00 - separator position. Date and time separator (offset 10) is checked separately
+    static const uint8_t digits_mask[16] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0x00, 0xFF, 0xFF, 0x00, 0xFF, 0xFF
+    };
+    static const uint8_t separators[16] = {
+            '0', '0', '0', '0', '-', '0', '0', '-', '0', '0', 'T', '0', '0', ':', '0', '0'
+    };
+    static const uint8_t separators_mask[16] = {
+            0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00, 0x00
+    };
+    uint64_t words[2], mask[2], template[2], sep_mask[2], digits;
+    int i;
+
+    memcpy(words, value, sizeof(words));
+    memcpy(mask, digits_mask, sizeof(mask));
+    memcpy(template, separators, sizeof(template));
+    memcpy(sep_mask, separators_mask, sizeof(sep_mask));
+
+    for (i = 0; i < 2; i++) {
+        if ((words[i] & sep_mask[i]) != (template[i] & sep_mask[i])) {
+            return false;
+        }
+
+        // replace non digit positions with '0' and check that each byte is in range ['0', '9']
+        digits = (words[i] & mask[i]) | (0x3030303030303030ULL & ~mask[i]);
+        if (((digits + 0x4646464646464646ULL) | (digits - 0x3030303030303030ULL)) & 0x8080808080808080ULL) {
+            return false;
+        }
+    }
+
+    return ('T' == value[10] || 't' == value[10] || ' ' == value[10]) &&
+           ':' == value[16] && (unsigned) (value[17] - '0') <= 9 && (unsigned) (value[18] - '0') <= 9;
+}
+
+/**
+ * Helper function. Calculates number of days since 1970-01-01 for date in proleptic Gregorian calendar.
+ *
+ * @param year[in]      Year
+ * @param month[in]     Month in range [1, 12]
+ * @param day[in]       Day of month in range [1, 31]
+ *
+ * @return  Number of days since Unix epoch. Negative for dates before epoch.
+ *
+ * @note    Implementation of days_from_civil() algorithm by Howard Hinnant
+ */
+static int64_t yajp_days_from_civil(int year, unsigned month, unsigned day) {
+    int64_t era;
+    unsigned year_of_era, day_of_year, day_of_era;
+
+    year -= (month <= 2);
+    era = (year >= 0 ? year : year - 399) / 400;
+    year_of_era = (unsigned) (year - era * 400);
+    day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+
+    return era * 146097 + (int64_t) day_of_era - 719468;
+}
+
+/**
+ * Helper function. Calculates 64-bit hash of enumeration item name.
+ *
+ * @param data[in]          Pointer to name
+ * @param data_size[in]     Size of name in bytes
+ * @param seed[in]          Seed of hash function
+ *
+ * @return  Hash value. Upper 32 bits are used to select bucket, lower 32 bits to select slot.
+ *
+ * @note    FNV-1a over name bytes finalized with MurmurHash3 fmix64
+ */
+static uint64_t yajp_enum_hash(const uint8_t *data, size_t data_size, uint64_t seed) {
+    uint64_t hash = 0xCBF29CE484222325ULL ^ seed;
+    size_t i;
+
+    for (i = 0; i < data_size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+/**
+ * Helper function. Calculates slot of enumeration item.
+ *
+ * @param hash[in]          Hash of item name
+ * @param displacement[in]  Displacement of bucket item belongs to
+ * @param slots_mask[in]    Number of slots - 1
+ *
+ * @return  Index of slot
+ */
+static size_t yajp_enum_slot(uint64_t hash, uint32_t displacement, size_t slots_mask) {
+    uint32_t slot = (uint32_t) hash + displacement * 0x9E3779B9U;
+
+    slot ^= slot >> 16;
+    slot *= 0x85EBCA6BU;
+    slot ^= slot >> 13;
+
+    return slot & slots_mask;
+}
+
+/**
+ * Helper function. Builds perfect hash table using "hash and displace" algorithm.
+ *
+ * @param enumeration[in,out]   Enumeration with allocated tables
+ * @param hashes[in]            Hashes of items names
+ * @param order[in]             Buffer for @c count + 1 indexes
+ * @param buckets[in]           Number of buckets
+ *
+ * @return  0 - on success, 1 - if displacements for current seed wasn't found, -1 - if items have duplicates
+ *
+ * @note    Items are grouped in buckets by upper part of hash. Buckets are processed starting from largest one and for
+ *          each of them displacement is searched what places all items of bucket into free slots.
+ */
+static int yajp_enum_build(yajp_deserialization_enum_t *enumeration, uint64_t *hashes, size_t *order, size_t buckets) {
+#define MAX_DISPLACEMENT    (1U << 16)
+    const size_t count = enumeration->count;
+    size_t i, j, k, bucket, tmp, placed, size, max_bucket_size = 0;
+    uint32_t displacement;
+    size_t slot;
+
+    for (i = 0; i <= enumeration->slots_mask; i++) {
+        enumeration->slots[i] = -1;
+    }
+    memset(enumeration->displacements, 0, buckets * sizeof(*enumeration->displacements));
+
+    // group items by bucket using insertion sort. Enumerations are small
+    for (i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    for (i = 1; i < count; i++) {
+        tmp = order[i];
+        for (j = i; j > 0 && ((hashes[order[j - 1]] >> 32) & (buckets - 1)) > ((hashes[tmp] >> 32) & (buckets - 1)); j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = tmp;
+    }
+
+    // check what items of one bucket have distinct hashes and find size of largest bucket
+    for (i = 0; i < count; i = j) {
+        bucket = (hashes[order[i]] >> 32) & (buckets - 1);
+        for (j = i + 1; j < count && ((hashes[order[j]] >> 32) & (buckets - 1)) == bucket; j++) {
+            // the same hash for two items in one bucket means what they will collide with any displacement
+            for (k = i; k < j; k++) {
+                if (hashes[order[k]] == hashes[order[j]]) {
+                    if (enumeration->items[order[k]].name_size == enumeration->items[order[j]].name_size &&
+                        0 == memcmp(enumeration->items[order[k]].name, enumeration->items[order[j]].name,
+                                    enumeration->items[order[j]].name_size)) {
+                        return -1;
+                    }
+                    return 1;
+                }
+            }
+        }
+        max_bucket_size = (j - i > max_bucket_size) ? j - i : max_bucket_size;
+    }
+
+    // place buckets starting from largest ones while there are many free slots
+    for (size = max_bucket_size; size > 0; size--) {
+        for (i = 0; i < count; i = j) {
+            bucket = (hashes[order[i]] >> 32) & (buckets - 1);
+            for (j = i + 1; j < count && ((hashes[order[j]] >> 32) & (buckets - 1)) == bucket; j++);
+            if (j - i != size) {
+                continue;
+            }
+
+            for (displacement = 0; displacement < MAX_DISPLACEMENT; displacement++) {
+                for (placed = 0; placed < size; placed++) {
+                    slot = yajp_enum_slot(hashes[order[i + placed]], displacement, enumeration->slots_mask);
+                    if (0 <= enumeration->slots[slot]) {
+                        break;
+                    }
+                    enumeration->slots[slot] = (int32_t) order[i + placed];
+                }
+
+                if (placed == size) {
+                    enumeration->displacements[bucket] = displacement;
+                    break;
+                }
+
+                // rollback placed items of bucket
+                for (k = 0; k < placed; k++) {
+                    slot = yajp_enum_slot(hashes[order[i + k]], displacement, enumeration->slots_mask);
+                    enumeration->slots[slot] = -1;
+                }
+            }
+
+            if (MAX_DISPLACEMENT == displacement) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+#undef MAX_DISPLACEMENT
+}
+
+/**
+ * Helper function. Decodes base64 string.
+ *
+ * @param digits[in]        Table with values of alphabet digits
+ * @param url[in]           true - if @p digits is URL alphabet, false - if it's standard one
+ * @param value[in]         Pointer to encoded string
+ * @param value_size[in]    Size of encoded string
+ * @param result[out]       Pointer to buffer for decoded bytes
+ * @param capacity[in]      Size of buffer in bytes
+ * @param result_size[out]  Amount of decoded bytes
+ *
+ * @return  0 - on success, -1 - if string isn't valid base64 string or decoded bytes don't fit into buffer
+ *
+ * @note    With AVX2 or SSSE3 blocks of 32 or 16 digits are decoded first: digits are validated and translated by
+ *          nibble lookups of standard alphabet (URL one is mapped onto it) and packed by multiply-add. Then fast path
+ *          decodes 8 digits into 6 bytes per iteration and checks digits validity once per iteration with OR of digits
+ *          values, so it has no data dependent branches. Both stop on padding, escaped solidus or invalid digit and
+ *          slow path decodes rest of string digit by digit.
+ */
+static int yajp_base64_decode(const uint8_t *digits, bool url, const uint8_t *value, size_t value_size,
+                              uint8_t *result, size_t capacity, size_t *result_size) {
+    const uint8_t *cursor = value, *end = value + value_size;
+    uint8_t *output = result, *output_end = result + capacity;
+    uint32_t a, b, c, d, e, f, g, h, bits = 0;
+    size_t sextets = 0, padding = 0;
+    uint8_t digit;
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+    // digit is valid if bit of its high nibble is set in mask of its low nibble
+    const __m128i valid_masks = _mm_setr_epi8((char) 0xa8, (char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+                                              (char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8, (char) 0xf8,
+                                              (char) 0xf0, 0x54, 0x50, 0x50, 0x50, 0x54);
+    const __m128i high_bits = _mm_setr_epi8(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char) 0x80,
+                                            0, 0, 0, 0, 0, 0, 0, 0);
+    // added to digit by its high nibble, '/' shares nibble with '+' and takes index 1
+    const __m128i shifts = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    // 3 bytes of every 4 are reversed into big endian order
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+#endif
+
+#if defined(__AVX2__)
+    const __m256i masks256 = _mm256_broadcastsi128_si256(valid_masks), bits256 = _mm256_broadcastsi128_si256(high_bits);
+    const __m256i shifts256 = _mm256_broadcastsi128_si256(shifts), pack256 = _mm256_broadcastsi128_si256(pack);
+    const __m256i nibble = _mm256_set1_epi8(0x0f), zero = _mm256_setzero_si256();
+    __m256i chunk, high, invalid;
+
+    while (32 <= end - cursor && 24 <= output_end - output) {
+        chunk = _mm256_loadu_si256((const __m256i *) cursor);
+        invalid = zero;
+
+        // '+' and '/' aren't digits of URL alphabet, '-' and '_' are mapped onto them
+        if (url) {
+            invalid = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('+')),
+                                      _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('/')));
+            chunk = _mm256_add_epi8(chunk, _mm256_and_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('-')),
+                                                            _mm256_set1_epi8('+' - '-')));
+            chunk = _mm256_add_epi8(chunk, _mm256_and_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_')),
+                                                            _mm256_set1_epi8('/' - '_')));
+        }
+
+        high = _mm256_and_si256(_mm256_srli_epi32(chunk, 4), nibble);
+        invalid = _mm256_or_si256(invalid, _mm256_cmpeq_epi8(zero, _mm256_and_si256(
+                _mm256_shuffle_epi8(masks256, _mm256_and_si256(chunk, nibble)), _mm256_shuffle_epi8(bits256, high))));
+        if (0 != _mm256_movemask_epi8(invalid)) {
+            break;
+        }
+
+        chunk = _mm256_add_epi8(chunk, _mm256_shuffle_epi8(shifts256, _mm256_add_epi8(
+                high, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('/')))));
+
+        // pairs of sextets are merged into 12 bits, pairs of them into 24 bits of every 4 bytes
+        chunk = _mm256_maddubs_epi16(chunk, _mm256_set1_epi32(0x01400140));
+        chunk = _mm256_madd_epi16(chunk, _mm256_set1_epi32(0x00011000));
+        chunk = _mm256_shuffle_epi8(chunk, pack256);
+        chunk = _mm256_permutevar8x32_epi32(chunk, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+
+        _mm_storeu_si128((__m128i *) output, _mm256_castsi256_si128(chunk));
+        _mm_storel_epi64((__m128i *) (output + 16), _mm256_extracti128_si256(chunk, 1));
+
+        cursor += 32;
+        output += 24;
+    }
+#elif defined(__SSSE3__)
+    const __m128i nibble = _mm_set1_epi8(0x0f), zero = _mm_setzero_si128();
+    __m128i chunk, high, invalid;
+    uint32_t tail;
+
+    while (16 <= end - cursor && 12 <= output_end - output) {
+        chunk = _mm_loadu_si128((const __m128i *) cursor);
+        invalid = zero;
+
+        // '+' and '/' aren't digits of URL alphabet, '-' and '_' are mapped onto them
+        if (url) {
+            invalid = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('+')),
+                                   _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/')));
+            chunk = _mm_add_epi8(chunk, _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('-')),
+                                                      _mm_set1_epi8('+' - '-')));
+            chunk = _mm_add_epi8(chunk, _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')),
+                                                      _mm_set1_epi8('/' - '_')));
+        }
+
+        high = _mm_and_si128(_mm_srli_epi32(chunk, 4), nibble);
+        invalid = _mm_or_si128(invalid, _mm_cmpeq_epi8(zero, _mm_and_si128(
+                _mm_shuffle_epi8(valid_masks, _mm_and_si128(chunk, nibble)), _mm_shuffle_epi8(high_bits, high))));
+        if (0 != _mm_movemask_epi8(invalid)) {
+            break;
+        }
+
+        chunk = _mm_add_epi8(chunk, _mm_shuffle_epi8(shifts, _mm_add_epi8(high,
+                                                                           _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/')))));
+
+        // pairs of sextets are merged into 12 bits, pairs of them into 24 bits of every 4 bytes
+        chunk = _mm_maddubs_epi16(chunk, _mm_set1_epi32(0x01400140));
+        chunk = _mm_madd_epi16(chunk, _mm_set1_epi32(0x00011000));
+        chunk = _mm_shuffle_epi8(chunk, pack);
+
+        _mm_storel_epi64((__m128i *) output, chunk);
+        tail = (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(chunk, 8));
+        memcpy(output + 8, &tail, sizeof(tail));
+
+        cursor += 16;
+        output += 12;
+    }
+#else
+    (void) url;
+#endif
+
+    while (8 <= end - cursor && 6 <= output_end - output) {
+        a = digits[cursor[0]];
+        b = digits[cursor[1]];
+        c = digits[cursor[2]];
+        d = digits[cursor[3]];
+        e = digits[cursor[4]];
+        f = digits[cursor[5]];
+        g = digits[cursor[6]];
+        h = digits[cursor[7]];
+
+        if (0x80 & (a | b | c | d | e | f | g | h)) {
+            break;
+        }
+
+        bits = (a << 18) | (b << 12) | (c << 6) | d;
+        output[0] = (uint8_t) (bits >> 16);
+        output[1] = (uint8_t) (bits >> 8);
+        output[2] = (uint8_t) bits;
+
+        bits = (e << 18) | (f << 12) | (g << 6) | h;
+        output[3] = (uint8_t) (bits >> 16);
+        output[4] = (uint8_t) (bits >> 8);
+        output[5] = (uint8_t) bits;
+
+        cursor += 8;
+        output += 6;
+    }
+
+    for (bits = 0; cursor < end && '=' != *cursor; cursor++) {
+        if ('\\' == *cursor && end - cursor > 1 && '/' == cursor[1]) {
+            cursor++; // JSON allows to escape solidus
+        }
+
+        digit = digits[*cursor];
+        if (0x80 & digit) {
+            return -1;
+        }
+
+        bits = (bits << 6) | digit;
+        sextets++;
+
+        if (4 == sextets) {
+            if (3 > output_end - output) {
+                return -1;
+            }
+
+            output[0] = (uint8_t) (bits >> 16);
+            output[1] = (uint8_t) (bits >> 8);
+            output[2] = (uint8_t) bits;
+            output += 3;
+            bits = 0;
+            sextets = 0;
+        }
+    }
+
+    for (; cursor < end; cursor++, padding++) {
+        if ('=' != *cursor) {
+            return -1;
+        }
+    }
+
+    // single digit can't encode byte, padding should complete last group of two or three digits
+    if (1 == sextets || (0 != padding && (2 > sextets || 4 != sextets + padding))) {
+        return -1;
+    }
+
+    if (1 < sextets) {
+        if ((size_t) (output_end - output) < sextets - 1) {
+            return -1;
+        }
+
+        bits <<= 6 * (4 - sextets);
+        output[0] = (uint8_t) (bits >> 16);
+        if (3 == sextets) {
+            output[1] = (uint8_t) (bits >> 8);
+        }
+        output += sextets - 1;
+    }
+
+    *result_size = output - result;
+
+    return 0;
+}
+
+/**
+ * Helper function. Looks for string in chain of interned strings.
+ *
+ * @param head[in]          First string of chain
+ * @param stop[in]          String of chain where search should be stopped. NULL to search till end of chain
+ * @param hash[in]          Hash of searching string
+ * @param value[in]         Pointer to searching string
+ * @param value_size[in]    Size of searching string
+ *
+ * @return  Interned string or NULL if it's not found
+ */
+static const yajp_interned_string_t *yajp_intern_find(const yajp_interned_string_t *head,
+                                                      const yajp_interned_string_t *stop, uint64_t hash,
+                                                      const uint8_t *value, size_t value_size) {
+    for (; stop != head; head = head->next) {
+        if (hash == head->hash && value_size == head->size && 0 == memcmp(head->value, value, value_size)) {
+            return head;
+        }
+    }
+
+    return NULL;
+}
@@ -27,6 +27,7 @@
 #include <stdbool.h>
 
 #include "token_type.h"
+#include "yajp/allocator.h"
 
 /**
  * Size of buffers in bytes
@@ -48,13 +49,19 @@ typedef struct yajp_lexer_token {
                                                                     */
         uint8_t internal_buffer[YAJP_BUFFER_SIZE / sizeof(uint8_t)];/* Token buffer used to store small values */
     } attributes;                                                   /* Token attributes */
+    const yajp_allocator_t *allocator;                              /* Allocator of value if it doesn't point to
+                                                                     * internal_buffer. NULL means heap
+                                                                     */
 } yajp_lexer_token_t;
 
+struct yajp_read_ahead;
+
 /**
  * Represent lexer input
  */
 typedef struct yajp_lexer_input {
     FILE *json;         /* Pointer to stream with json */
+    struct yajp_read_ahead *read_ahead; /* Reader thread of stream. NULL means stream is read by lexer itself */
     uint8_t *buffer;    /* Buffer of scanning chars */
     size_t buffer_size; /* Size of buffer in bytes */
 
@@ -65,6 +72,12 @@ typedef struct yajp_lexer_input {
 
     bool eof;           /* End of file reached */
 
+    const uint8_t *pushed;  /* Pushed input what isn't copied into buffer yet. Used if json is NULL */
+    size_t pushed_size;     /* Size of pushed input in bytes */
+    bool pushed_last;       /* Pushed input is the end of document */
+
+    const yajp_allocator_t *allocator;  /* Allocator of buffer and big token values. NULL means heap */
+
 #ifdef YAJP_TRACK_STREAM
     int line_num;       /* Number of reading line */
     int column_num;     /* Number of reading column */
@@ -89,6 +102,81 @@ bool yajp_lexer_is_token_primitive(yajp_token_type_t token);
  */
 int yajp_lexer_init_input(FILE *json, yajp_lexer_input_t *input);
 
+/**
+ * Initialize lexer input from stream using specified allocator for lexer buffer and token values.
+ * @param json [in]
+ * @param allocator [in]    Allocator of lexer memory. NULL means heap
+ * @param input [out]
+ * @return  Returns result of lexer input initialization. 0 - success
+ *
+ * @note    See yajp_lexer_init_input()
+ */
+int yajp_lexer_init_input_with_allocator(FILE *json, const yajp_allocator_t *allocator, yajp_lexer_input_t *input);
+
+/**
+ * Initialize lexer input from stream with buffer of specified initial size.
+ * @param json [in]
+ * @param allocator [in]    Allocator of lexer memory. NULL means heap
+ * @param buffer_size [in]  Initial size of lexer buffer in bytes. Rounded up to YAJP_BUFFER_SIZE granularity, sizes
+ *                          less than YAJP_BUFFER_SIZE are replaced by it
+ * @param input [out]
+ * @return  Returns result of lexer input initialization. 0 - success
+ *
+ * @note    Buffer still grows if some token doesn't fit into it. See yajp_lexer_init_input()
+ */
+int yajp_lexer_init_input_with_buffer_size(FILE *json, const yajp_allocator_t *allocator, size_t buffer_size,
+                                           yajp_lexer_input_t *input);
+
+/**
+ * Initialize lexer input from stream with buffer kept from previous input, optionally read by reader thread.
+ * @param json [in]
+ * @param allocator [in]    Allocator of lexer memory. NULL means heap
+ * @param buffer [in]       Buffer allocated by allocator and owned by input since now. NULL - to allocate new one
+ * @param buffer_size [in]  Size of passed buffer in bytes, or initial size of new buffer. See
+ *                          yajp_lexer_init_input_with_buffer_size()
+ * @param read_ahead [in]   Started read-ahead buffer of stream. NULL means stream is read directly
+ * @param input [out]
+ * @return  Returns result of lexer input initialization. 0 - success. Passed buffer is released on failure
+ *
+ * @note    Read-ahead buffer isn't stopped by yajp_lexer_release_input()
+ */
+int yajp_lexer_init_input_with_buffer(FILE *json, const yajp_allocator_t *allocator, uint8_t *buffer,
+                                      size_t buffer_size, struct yajp_read_ahead *read_ahead,
+                                      yajp_lexer_input_t *input);
+
+/**
+ * Initialize lexer input what is pushed by caller instead of being read from stream.
+ * @param allocator [in]    Allocator of lexer memory. NULL means heap
+ * @param buffer_size [in]  Initial size of lexer buffer in bytes. See yajp_lexer_init_input_with_buffer_size()
+ * @param input [out]
+ * @return  Returns result of lexer input initialization. 0 - success
+ *
+ * @note    Lexer returns -1 with errno set to EAGAIN if token doesn't fit into pushed input, so scanning can be
+ *          continued from the beginning of this token after next push.
+ */
+int yajp_lexer_init_pushed_input(const yajp_allocator_t *allocator, size_t buffer_size, yajp_lexer_input_t *input);
+
+/**
+ * Initialize pushed lexer input with buffer kept from previous input.
+ * @param allocator [in]    Allocator of lexer memory. NULL means heap
+ * @param buffer [in]       Buffer allocated by allocator and owned by input since now. NULL - to allocate new one
+ * @param buffer_size [in]  Size of passed buffer in bytes, or initial size of new buffer. See
+ *                          yajp_lexer_init_pushed_input()
+ * @param input [out]
+ * @return  Returns result of lexer input initialization. 0 - success. Passed buffer is never released
+ */
+int yajp_lexer_init_pushed_input_with_buffer(const yajp_allocator_t *allocator, uint8_t *buffer, size_t buffer_size,
+                                             yajp_lexer_input_t *input);
+
+/**
+ * Push next part of input initialized by yajp_lexer_init_pushed_input().
+ * @param input [in, out]
+ * @param data [in]     Pointer to part of input. Should be alive till lexer returns EAGAIN
+ * @param size [in]     Size of part in bytes
+ * @param last [in]     true - if part is the end of document. Lexer sees '\0' after it
+ */
+void yajp_lexer_push_input(yajp_lexer_input_t *input, const uint8_t *data, size_t size, bool last);
+
 /**
  * Release resources initialized by yajp_lexer_init_input().
  * @param input[in]
@@ -97,6 +185,14 @@ int yajp_lexer_init_input(FILE *json, yajp_lexer_input_t *input);
  */
 int yajp_lexer_release_input(yajp_lexer_input_t *input);
 
+/**
+ * Release resources initialized by yajp_lexer_init_input() except of buffer, so it can be passed to next input.
+ * @param input[in]
+ * @param buffer_size[out]  Size of returned buffer in bytes
+ * @return  Buffer of input. Should be released by allocator of input
+ */
+uint8_t *yajp_lexer_detach_buffer(yajp_lexer_input_t *input, size_t *buffer_size);
+
 /**
  * Returns next recognized token in stream.
  *
@@ -25,15 +25,23 @@
 
 #include "lexer.h"
 #include "lexer_misc.h"
+#include "read_ahead.h"
 
 /* helper function prototypes */
 static ssize_t yajp_lexer_extend_buffer(yajp_lexer_input_t *input, size_t need);
 
-static int yajp_lexer_read_buffer(FILE *js, uint8_t *buffer, size_t need);
+static int yajp_lexer_read_buffer(const yajp_lexer_input_t *input, uint8_t *buffer, size_t need);
+
+static int yajp_lexer_fill_pushed_input(yajp_lexer_input_t *input, size_t need);
+
+static const yajp_allocator_t *yajp_lexer_allocator(const yajp_allocator_t *allocator);
 
 int yajp_lexer_fill_input(yajp_lexer_input_t *input, size_t need) {
-    size_t free, shift, allocated;
-    uint8_t *buf_ptr;
+    size_t free, shift;
+
+    if (NULL == input->json) {
+        return yajp_lexer_fill_pushed_input(input, need);
+    }
 
     if (input->eof) {
         return -1;
@@ -41,44 +49,61 @@ int yajp_lexer_fill_input(yajp_lexer_input_t *input, size_t need) {
 
     // shift buffer left if possible. can happened if buffer contains recognized tokens in the beginning
     free = input->token - input->buffer;
-    buf_ptr = input->limit - free;
+    shift = input->limit - input->token;
 
     if (0 < free) {
-        shift = input->limit - input->token;
         memmove(input->buffer, input->token, shift);
         input->token -= free;
         input->cursor -= free;
         input->marker -= free;
     }
 
-    if (free < need) {
-        allocated = yajp_lexer_extend_buffer(input, need);
-        if (allocated <= 0) {
-            return -1;
-        }
-        buf_ptr = input->cursor;
-        free = allocated;
+    if (free < need && yajp_lexer_extend_buffer(input, need) <= 0) {
+        return -1;
     }
 
-    return yajp_lexer_read_buffer(input->json, buf_ptr, free);
+    // everything after unrecognized part of stream is filled, including extended memory
+    return yajp_lexer_read_buffer(input, input->buffer + shift, input->buffer_size - shift);
 }
 
 int yajp_lexer_init_input(FILE *js, yajp_lexer_input_t *input) {
+    return yajp_lexer_init_input_with_allocator(js, NULL, input);
+}
+
+int yajp_lexer_init_input_with_allocator(FILE *js, const yajp_allocator_t *allocator, yajp_lexer_input_t *input) {
+    return yajp_lexer_init_input_with_buffer_size(js, allocator, YAJP_BUFFER_SIZE, input);
+}
+
+int yajp_lexer_init_input_with_buffer_size(FILE *js, const yajp_allocator_t *allocator, size_t buffer_size,
+                                           yajp_lexer_input_t *input) {
+    return yajp_lexer_init_input_with_buffer(js, allocator, NULL, buffer_size, NULL, input);
+}
+
+int yajp_lexer_init_input_with_buffer(FILE *js, const yajp_allocator_t *allocator, uint8_t *buffer,
+                                      size_t buffer_size, struct yajp_read_ahead *read_ahead,
+                                      yajp_lexer_input_t *input) {
     ssize_t allocated;
 
     input->json = js;
-    input->eof = (0 != feof(js));
-    input->buffer = NULL;
-    input->buffer_size = 0;
+    input->read_ahead = read_ahead;
+    // stream is owned by reader thread, its end is reported by read-ahead buffer
+    input->eof = (NULL == read_ahead) && (0 != feof(js));
+    input->buffer = buffer;
+    input->buffer_size = (NULL != buffer) ? buffer_size : 0;
+    input->allocator = allocator;
 
 #ifdef YAJP_TRACK_STREAM
     input->column_num = 1;
     input->line_num = 1;
 #endif
 
-    allocated = yajp_lexer_extend_buffer(input, YAJP_BUFFER_SIZE);
-    if (allocated <= 0) {
-        return -1;
+    if (NULL != buffer) {
+        allocated = (ssize_t) buffer_size;
+    } else {
+        allocated = yajp_lexer_extend_buffer(input, (YAJP_BUFFER_SIZE < buffer_size) ? buffer_size : YAJP_BUFFER_SIZE);
+        if (allocated <= 0) {
+            return -1;
+        }
     }
 
     input->limit = input->buffer + (allocated / sizeof(*input->buffer));
@@ -86,17 +111,57 @@ int yajp_lexer_init_input(FILE *js, yajp_lexer_input_t *input) {
     input->marker = input->buffer;
     input->token = input->buffer;
 
-    if (yajp_lexer_read_buffer(js, input->buffer, allocated)) {
-        free(input->buffer);
+    if (yajp_lexer_read_buffer(input, input->buffer, allocated)) {
+        allocator = yajp_lexer_allocator(allocator);
+        allocator->free(input->buffer, allocator->user);
         return -1;
     }
 
     return 0;
 }
 
+int yajp_lexer_init_pushed_input(const yajp_allocator_t *allocator, size_t buffer_size, yajp_lexer_input_t *input) {
+    return yajp_lexer_init_pushed_input_with_buffer(allocator, NULL, buffer_size, input);
+}
+
+int yajp_lexer_init_pushed_input_with_buffer(const yajp_allocator_t *allocator, uint8_t *buffer, size_t buffer_size,
+                                             yajp_lexer_input_t *input) {
+    memset(input, 0, sizeof(*input));
+    input->allocator = allocator;
+
+#ifdef YAJP_TRACK_STREAM
+    input->column_num = 1;
+    input->line_num = 1;
+#endif
+
+    if (NULL != buffer) {
+        input->buffer = buffer;
+        input->buffer_size = buffer_size;
+    } else {
+        if (yajp_lexer_extend_buffer(input, (YAJP_BUFFER_SIZE < buffer_size) ? buffer_size : YAJP_BUFFER_SIZE) <= 0) {
+            return -1;
+        }
+    }
+
+    // buffer is empty till the first push
+    input->limit = input->buffer;
+    input->cursor = input->buffer;
+    input->marker = input->buffer;
+    input->token = input->buffer;
+
+    return 0;
+}
+
+void yajp_lexer_push_input(yajp_lexer_input_t *input, const uint8_t *data, size_t size, bool last) {
+    input->pushed = data;
+    input->pushed_size = size;
+    input->pushed_last = last;
+}
+
 int yajp_lexer_pick_token(yajp_token_type_t tok_type, const yajp_lexer_input_t *input, yajp_lexer_token_t *tok) {
     size_t tok_size;
     uint8_t *tmp = NULL;
+    const yajp_allocator_t *allocator;
     uint8_t *tok_start = input->token;
     uint8_t *tok_end = input->cursor;
 
@@ -113,11 +178,13 @@ int yajp_lexer_pick_token(yajp_token_type_t tok_type, const yajp_lexer_input_t *
         case YAJP_TOKEN_NUMBER: {
             tok_size = tok_end - tok_start;
             if (tok_size > YAJP_BUFFER_SIZE) {
-                tmp = malloc(tok_size);
+                allocator = yajp_lexer_allocator(input->allocator);
+                tmp = allocator->alloc(tok_size, allocator->user);
                 if (NULL == tmp) {
                     return -1;
                 }
                 tok->attributes.value = tmp;
+                tok->allocator = allocator;
             }
 
             memmove(tok->attributes.value, tok_start, tok_size);
@@ -129,8 +196,18 @@ int yajp_lexer_pick_token(yajp_token_type_t tok_type, const yajp_lexer_input_t *
     return 0;
 }
 
+uint8_t *yajp_lexer_detach_buffer(yajp_lexer_input_t *input, size_t *buffer_size) {
+    uint8_t *buffer = input->buffer;
+
+    *buffer_size = input->buffer_size;
+    memset(input, 0, sizeof(*input));
+    return buffer;
+}
+
 int yajp_lexer_release_input(yajp_lexer_input_t *input) {
-    free(input->buffer);
+    const yajp_allocator_t *allocator = yajp_lexer_allocator(input->allocator);
+
+    allocator->free(input->buffer, allocator->user);
     memset(input, 0, sizeof(*input));
     return 0;
 }
@@ -156,8 +233,11 @@ bool yajp_lexer_is_token_primitive(yajp_token_type_t token) {
 }
 
 int yajp_lexer_release_token(yajp_lexer_token_t *token) {
-    if (token->attributes.value != token->attributes.internal_buffer) {
-        free(token->attributes.value);
+    const yajp_allocator_t *allocator;
+
+    if (NULL != token->attributes.value && token->attributes.value != token->attributes.internal_buffer) {
+        allocator = yajp_lexer_allocator(token->allocator);
+        allocator->free(token->attributes.value, allocator->user);
     }
 
     memset(token, 0, sizeof(*token));
@@ -174,13 +254,14 @@ int yajp_lexer_release_token(yajp_lexer_token_t *token) {
  *
  * @note    This function will calculate amount of free place in buffer and if it's less than 'need'. Size of buffer
  *          extension should multiples by YAJP_BUFFER_SIZE.
- *          This function calls realloc(). According to documentation if partition of memory pointed by realloc's first
+ *          This function calls realloc() of lexer allocator. According to documentation if partition of memory pointed by realloc's first
  *          parameter will overlay other memory partition function will allocate new partition and move content to it.
  *          This actually means that pointers used by lexer to work with buffer can become invalid. In case if this
  *          happened function will initialize this pointers according to new location of buffer.
  */
 static ssize_t yajp_lexer_extend_buffer(yajp_lexer_input_t *input, size_t need) {
     uint8_t *tmp;
+    const yajp_allocator_t *allocator = yajp_lexer_allocator(input->allocator);
     const size_t size = input->buffer_size;
     size_t new_size = size;
 
@@ -189,7 +270,7 @@ static ssize_t yajp_lexer_extend_buffer(yajp_lexer_input_t *input, size_t need)
         new_size += YAJP_BUFFER_SIZE;
     } while (size + need > new_size);
 
-    tmp = realloc(input->buffer, new_size);
+    tmp = allocator->realloc(input->buffer, size, new_size, allocator->user);
     if (NULL == tmp) {
         return -1;
     }
@@ -198,11 +279,13 @@ static ssize_t yajp_lexer_extend_buffer(yajp_lexer_input_t *input, size_t need)
         // fix pointers because realloc changed address of new buffer
         input->token = tmp + (input->token - input->buffer) / sizeof(*input->token);
         input->marker = tmp + (input->marker - input->buffer) / sizeof(*input->marker);
-        input->limit = tmp + new_size / sizeof(*input->limit) / sizeof(*input->limit);
         input->cursor = tmp + (input->cursor - input->buffer) / sizeof(*input->cursor);
         input->buffer = tmp;
     }
 
+    // limit moves even if buffer is extended in place
+    input->limit = tmp + new_size / sizeof(*input->limit);
+
     input->buffer_size = new_size;
     return new_size - size;
 }
@@ -210,7 +293,7 @@ static ssize_t yajp_lexer_extend_buffer(yajp_lexer_input_t *input, size_t need)
 /**
  * Reads requested amount of bytes from stream into buffer
  *
- * @param js[in]            Stream to be read
+ * @param input[in]         Lexer input what stream or read-ahead buffer is read
  * @param buffer[in,out]    Buffer to be filled
  * @param need[in]          Amount of bytes what will be read from stream
  *
@@ -218,9 +301,14 @@ static ssize_t yajp_lexer_extend_buffer(yajp_lexer_input_t *input, size_t need)
  *
  * @note    This function handles possible interrupts of read() and will recall read() to read remaining amount of data
  */
-static int yajp_lexer_read_buffer(FILE *js, uint8_t *buffer, size_t need) {
+static int yajp_lexer_read_buffer(const yajp_lexer_input_t *input, uint8_t *buffer, size_t need) {
+    FILE *js = input->json;
     size_t bytes_read;
 
+    if (NULL != input->read_ahead) {
+        return (0 <= yajp_read_ahead_read(input->read_ahead, buffer, need)) ? 0 : -1;
+    }
+
     while (need != 0 && (bytes_read = fread(buffer, 1, need, js))) {
         if (bytes_read == -1) { /* Check out what happened */
             if (errno == EINTR) {
@@ -237,4 +325,70 @@ static int yajp_lexer_read_buffer(FILE *js, uint8_t *buffer, size_t need) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * Helper function. Moves pushed input into buffer, so at least requested amount of bytes follows cursor
+ *
+ * @param input[in, out]    Lexer input initialized by yajp_lexer_init_pushed_input()
+ * @param need[in]          Amount of bytes required after cursor
+ *
+ * @return  Result of filling. 0 - on success, -1 with errno set to EAGAIN if pushed input is exhausted. Then cursor is
+ *          moved back to the beginning of token, so token is scanned again after next push
+ *
+ * @note    Unlike stream input, limit of pushed input points after the last copied byte. The end of the last part is
+ *          followed by '\0' bytes, which are recognized as the end of document.
+ */
+static int yajp_lexer_fill_pushed_input(yajp_lexer_input_t *input, size_t need) {
+    size_t free = input->token - input->buffer, used, copied;
+
+    // unrecognized part of buffer is kept, everything before the current token is dropped
+    if (0 < free) {
+        memmove(input->buffer, input->token, input->limit - input->token);
+        input->token -= free;
+        input->cursor -= free;
+        input->marker -= free;
+        input->limit -= free;
+    }
+
+    used = input->limit - input->buffer;
+    if (input->buffer_size - used < need) {
+        if (yajp_lexer_extend_buffer(input, need - (input->buffer_size - used)) <= 0) {
+            return -1; // errno set
+        }
+        input->limit = input->buffer + used;
+    }
+
+    copied = (input->pushed_size < input->buffer_size - used) ? input->pushed_size : input->buffer_size - used;
+    if (0 < copied) {
+        memcpy(input->limit, input->pushed, copied);
+        input->pushed += copied;
+        input->pushed_size -= copied;
+        input->limit += copied;
+    }
+
+    if ((size_t) (input->limit - input->cursor) >= need) {
+        return 0;
+    }
+
+    if (input->pushed_last) {
+        memset(input->limit, 0, need - (input->limit - input->cursor));
+        input->limit = input->cursor + need;
+        return 0;
+    }
+
+    input->cursor = input->token;
+    errno = EAGAIN;
+    return -1;
+}
+
+/**
+ * Helper function. Returns allocator which should be used instead of passed one
+ *
+ * @param allocator[in]     Allocator of lexer input or token
+ *
+ * @return  Passed allocator or heap allocator if NULL is passed
+ */
+static const yajp_allocator_t *yajp_lexer_allocator(const yajp_allocator_t *allocator) {
+    return (NULL != allocator) ? allocator : &yajp_heap_allocator;
+}
@@ -0,0 +1,382 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * number_format.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "number_format.h"
+#include "number_format_tables.h"
+
+#define YAJP_DOUBLE_MANTISSA_BITS   52
+#define YAJP_DOUBLE_EXPONENT_BITS   11
+#define YAJP_DOUBLE_BIAS            1023
+#define YAJP_FLOAT_MANTISSA_BITS    23
+#define YAJP_FLOAT_EXPONENT_BITS    8
+#define YAJP_FLOAT_BIAS             127
+
+/**
+ * Decimal point positions of the first and the last number written in fixed notation
+ */
+#define YAJP_FIXED_MIN_POINT        (-5)
+#define YAJP_FIXED_MAX_POINT        21
+
+static const char yajp_digit_pairs[200] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+static const uint64_t yajp_powers_of_10[20] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+        10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+        1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL,
+};
+
+static void yajp_shortest_decimal(uint64_t ieee_mantissa, uint32_t ieee_exponent, uint32_t mantissa_bits, int32_t bias,
+                                  yajp_decimal_t *decimal);
+
+static uint64_t yajp_mul_shift(uint64_t m, const uint64_t *mul, int32_t j);
+
+static bool yajp_is_multiple_of_power_of_5(uint64_t value, uint32_t p);
+
+static uint32_t yajp_decimal_length(uint64_t value);
+
+static void yajp_write_digits(uint64_t value, uint32_t length, char *result);
+
+void yajp_decimal_of_double(double value, yajp_decimal_t *decimal) {
+    uint64_t bits, ieee_mantissa;
+    uint32_t ieee_exponent;
+
+    memcpy(&bits, &value, sizeof(bits));
+    ieee_mantissa = bits & ((1ULL << YAJP_DOUBLE_MANTISSA_BITS) - 1);
+    ieee_exponent = (uint32_t) (bits >> YAJP_DOUBLE_MANTISSA_BITS) & ((1U << YAJP_DOUBLE_EXPONENT_BITS) - 1);
+
+    if (0 == ieee_exponent && 0 == ieee_mantissa) {
+        decimal->mantissa = 0;
+        decimal->exponent = 0;
+    } else {
+        yajp_shortest_decimal(ieee_mantissa, ieee_exponent, YAJP_DOUBLE_MANTISSA_BITS, YAJP_DOUBLE_BIAS, decimal);
+    }
+
+    decimal->negative = 0 != (bits >> (YAJP_DOUBLE_MANTISSA_BITS + YAJP_DOUBLE_EXPONENT_BITS));
+}
+
+void yajp_decimal_of_float(float value, yajp_decimal_t *decimal) {
+    uint32_t bits, ieee_mantissa, ieee_exponent;
+
+    memcpy(&bits, &value, sizeof(bits));
+    ieee_mantissa = bits & ((1U << YAJP_FLOAT_MANTISSA_BITS) - 1);
+    ieee_exponent = (bits >> YAJP_FLOAT_MANTISSA_BITS) & ((1U << YAJP_FLOAT_EXPONENT_BITS) - 1);
+
+    if (0 == ieee_exponent && 0 == ieee_mantissa) {
+        decimal->mantissa = 0;
+        decimal->exponent = 0;
+    } else {
+        yajp_shortest_decimal(ieee_mantissa, ieee_exponent, YAJP_FLOAT_MANTISSA_BITS, YAJP_FLOAT_BIAS, decimal);
+    }
+
+    decimal->negative = 0 != (bits >> (YAJP_FLOAT_MANTISSA_BITS + YAJP_FLOAT_EXPONENT_BITS));
+}
+
+size_t yajp_format_decimal(const yajp_decimal_t *decimal, char *result) {
+    uint32_t length = yajp_decimal_length(decimal->mantissa), exponent_length;
+    int32_t point = (int32_t) length + decimal->exponent, exponent;
+    char *cursor = result;
+
+    if (decimal->negative) {
+        *cursor++ = '-';
+    }
+
+    // fixed notation if decimal point is in [YAJP_FIXED_MIN_POINT, YAJP_FIXED_MAX_POINT], exponential one otherwise
+    if (0 < point && YAJP_FIXED_MAX_POINT >= point) {
+        yajp_write_digits(decimal->mantissa, length, cursor);
+        if (0 <= decimal->exponent) {
+            // integer, 1500
+            memset(cursor + length, '0', decimal->exponent);
+            cursor += length + decimal->exponent;
+        } else {
+            // point inside of digits, 12.5
+            memmove(cursor + point + 1, cursor + point, length - point);
+            cursor[point] = '.';
+            cursor += length + 1;
+        }
+    } else if (YAJP_FIXED_MIN_POINT <= point && 0 >= point) {
+        // leading zeros after point, 0.0125
+        cursor[0] = '0';
+        cursor[1] = '.';
+        memset(cursor + 2, '0', -point);
+        yajp_write_digits(decimal->mantissa, length, cursor + 2 - point);
+        cursor += 2 - point + length;
+    } else {
+        // the first digit before point, 1.25e-7
+        yajp_write_digits(decimal->mantissa, length, cursor + 1);
+        cursor[0] = cursor[1];
+        if (1 < length) {
+            cursor[1] = '.';
+            cursor += length + 1;
+        } else {
+            cursor++;
+        }
+
+        exponent = point - 1;
+        *cursor++ = 'e';
+        *cursor++ = (0 > exponent) ? '-' : '+';
+        exponent = (0 > exponent) ? -exponent : exponent;
+        exponent_length = yajp_decimal_length((uint64_t) exponent);
+        yajp_write_digits((uint64_t) exponent, exponent_length, cursor);
+        cursor += exponent_length;
+    }
+
+    return cursor - result;
+}
+
+size_t yajp_format_integer(int64_t value, char *result) {
+    // negation in unsigned arithmetic is defined for the minimal value too
+    uint64_t magnitude = (0 > value) ? 0 - (uint64_t) value : (uint64_t) value;
+    size_t sign = (0 > value) ? 1 : 0;
+    uint32_t length = yajp_decimal_length(magnitude);
+
+    result[0] = '-';
+    yajp_write_digits(magnitude, length, result + sign);
+
+    return sign + length;
+}
+
+/**
+ * Helper function. Finds the shortest decimal in the interval of numbers rounded to binary floating point value, by
+ * Ryu algorithm of Ulf Adams (https://github.com/ulfjack/ryu). Bounds of interval are multiplied by power of 5 from
+ * table with enough precision to know their decimal digits, then digits are removed while bounds differ. The same
+ * tables serve double and float, because float mantissa is shorter.
+ *
+ * @param ieee_mantissa[in] Mantissa bits of value
+ * @param ieee_exponent[in] Biased exponent of value. Value isn't zero, infinity or NaN
+ * @param mantissa_bits[in] Amount of mantissa bits of floating point type
+ * @param bias[in]          Exponent bias of floating point type
+ * @param decimal[out]      Pointer to receive the shortest decimal
+ */
+static void yajp_shortest_decimal(uint64_t ieee_mantissa, uint32_t ieee_exponent, uint32_t mantissa_bits, int32_t bias,
+                                  yajp_decimal_t *decimal) {
+    int32_t e2, e10, i, j, k, removed = 0;
+    uint64_t m2, mv, vr, vp, vm, output;
+    uint32_t mm_shift, q, last_removed_digit = 0;
+    bool accept_bounds, vm_is_trailing_zeros = false, vr_is_trailing_zeros = false, round_up = false;
+
+    // value is m2 * 2^e2, e2 is lowered by 2 more to keep bounds of interval integer
+    if (0 == ieee_exponent) {
+        e2 = 1 - bias - (int32_t) mantissa_bits - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (int32_t) ieee_exponent - bias - (int32_t) mantissa_bits - 2;
+        m2 = (1ULL << mantissa_bits) | ieee_mantissa;
+    }
+
+    // bounds are included by round-half-to-even of parser if mantissa is even
+    accept_bounds = 0 == (m2 & 1);
+
+    // interval is [mv - 1 - mm_shift, mv + 2] / 4, the lower half is narrower at powers of 2
+    mv = 4 * m2;
+    mm_shift = (0 != ieee_mantissa || 1 >= ieee_exponent) ? 1 : 0;
+
+    if (0 <= e2) {
+        // q = log10(2^e2) - 1 for e2 > 3
+        q = (((uint32_t) e2 * 78913) >> 18) - (3 < e2 ? 1 : 0);
+        e10 = (int32_t) q;
+
+        // bit length of 5^q is ((q * 1217359) >> 19) + 1
+        k = YAJP_POW5_INV_BITCOUNT + (int32_t) ((q * 1217359) >> 19);
+        i = -e2 + (int32_t) q + k;
+
+        vr = yajp_mul_shift(mv, yajp_pow5_inv_split[q], i);
+        vp = yajp_mul_shift(mv + 2, yajp_pow5_inv_split[q], i);
+        vm = yajp_mul_shift(mv - 1 - mm_shift, yajp_pow5_inv_split[q], i);
+
+        // only one of vp, vr and vm can be multiple of 5 and none for bigger q
+        if (21 >= q) {
+            if (0 == mv % 5) {
+                vr_is_trailing_zeros = yajp_is_multiple_of_power_of_5(mv, q);
+            } else if (accept_bounds) {
+                vm_is_trailing_zeros = yajp_is_multiple_of_power_of_5(mv - 1 - mm_shift, q);
+            } else {
+                vp -= yajp_is_multiple_of_power_of_5(mv + 2, q) ? 1 : 0;
+            }
+        }
+    } else {
+        // q = log10(5^-e2) - 1 for e2 < -1
+        q = (((uint32_t) -e2 * 732923) >> 20) - (-1 > e2 ? 1 : 0);
+        e10 = (int32_t) q + e2;
+
+        i = -e2 - (int32_t) q;
+        k = (int32_t) (((uint32_t) i * 1217359) >> 19) + 1 - YAJP_POW5_BITCOUNT;
+        j = (int32_t) q - k;
+
+        vr = yajp_mul_shift(mv, yajp_pow5_split[i], j);
+        vp = yajp_mul_shift(mv + 2, yajp_pow5_split[i], j);
+        vm = yajp_mul_shift(mv - 1 - mm_shift, yajp_pow5_split[i], j);
+
+        if (1 >= q) {
+            // mv, mp and mm are multiples of 2^q as q trailing bits of mv are zero
+            vr_is_trailing_zeros = true;
+            if (accept_bounds) {
+                vm_is_trailing_zeros = 1 == mm_shift;
+            } else {
+                vp--;
+            }
+        } else if (63 > q) {
+            vr_is_trailing_zeros = 0 == (mv & ((1ULL << q) - 1));
+        }
+    }
+
+    if (vm_is_trailing_zeros || vr_is_trailing_zeros) {
+        // rare case, lower bound or exact value ends with zeros and tie breaking needs removed digits
+        while (vp / 10 > vm / 10) {
+            vm_is_trailing_zeros &= 0 == vm % 10;
+            vr_is_trailing_zeros &= 0 == last_removed_digit;
+            last_removed_digit = (uint32_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+
+        if (vm_is_trailing_zeros) {
+            while (0 == vm % 10) {
+                vr_is_trailing_zeros &= 0 == last_removed_digit;
+                last_removed_digit = (uint32_t) (vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+
+        // exact value is ...50..0, round half to even
+        if (vr_is_trailing_zeros && 5 == last_removed_digit && 0 == vr % 2) {
+            last_removed_digit = 4;
+        }
+
+        output = vr + (((vr == vm && (!accept_bounds || !vm_is_trailing_zeros)) || 5 <= last_removed_digit) ? 1 : 0);
+    } else {
+        // common case, two digits are removed at once while possible
+        if (vp / 100 > vm / 100) {
+            round_up = 50 <= vr % 100;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+
+        while (vp / 10 > vm / 10) {
+            round_up = 5 <= vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+
+        output = vr + ((vr == vm || round_up) ? 1 : 0);
+    }
+
+    decimal->mantissa = output;
+    decimal->exponent = e10 + removed;
+}
+
+/**
+ * Helper function. Multiplies number by 128-bit multiplier and shifts product right.
+ *
+ * @param m[in]     Number below 2^62
+ * @param mul[in]   Pointer to { low, high } halves of multiplier
+ * @param j[in]     Shift, at least 64
+ *
+ * @return  (m * mul) >> j
+ */
+static uint64_t yajp_mul_shift(uint64_t m, const uint64_t *mul, int32_t j) {
+    unsigned __int128 low = (unsigned __int128) m * mul[0];
+    unsigned __int128 high = (unsigned __int128) m * mul[1];
+
+    return (uint64_t) (((low >> 64) + high) >> (j - 64));
+}
+
+/**
+ * Helper function. Checks if number is divisible by 5^p.
+ *
+ * @param value[in] Number, not zero
+ * @param p[in]     Power of 5
+ *
+ * @return  true if @p value is divisible by 5^p
+ */
+static bool yajp_is_multiple_of_power_of_5(uint64_t value, uint32_t p) {
+    uint32_t count = 0;
+
+    while (0 == value % 5) {
+        value /= 5;
+        count++;
+    }
+
+    return count >= p;
+}
+
+/**
+ * Helper function. Counts decimal digits of number without loop: length is estimated by bit length multiplied by
+ * log10(2) ~ 1233 / 4096 and corrected by one comparison.
+ *
+ * @param value[in] Number
+ *
+ * @return  Amount of decimal digits, 1 for zero
+ */
+static uint32_t yajp_decimal_length(uint64_t value) {
+    // the lowest bit doesn't change amount of digits, but makes zero one digit long
+    uint64_t odd = value | 1;
+    uint32_t estimate = ((uint32_t) (64 - __builtin_clzll(odd)) * 1233) >> 12;
+
+    return estimate + (odd >= yajp_powers_of_10[estimate] ? 1 : 0);
+}
+
+/**
+ * Helper function. Writes digits of number from the end of result by pairs.
+ *
+ * @param value[in]     Number
+ * @param length[in]    Amount of digits of number
+ * @param result[out]   Pointer to buffer of at least @p length bytes
+ */
+static void yajp_write_digits(uint64_t value, uint32_t length, char *result) {
+    char *cursor = result + length;
+    uint64_t pair;
+
+    while (100 <= value) {
+        pair = value % 100;
+        value /= 100;
+        cursor -= 2;
+        memcpy(cursor, yajp_digit_pairs + 2 * pair, 2);
+    }
+
+    if (10 <= value) {
+        memcpy(cursor - 2, yajp_digit_pairs + 2 * value, 2);
+    } else {
+        cursor[-1] = (char) ('0' + value);
+    }
+}
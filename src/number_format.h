@@ -0,0 +1,80 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * number_format.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_NUMBER_FORMAT_H
+#define YAJP_NUMBER_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Maximal size of formatted number: sign, 17 significant digits, point and exponent or, in fixed notation, sign and 21
+ * digits
+ */
+#define YAJP_NUMBER_FORMAT_SIZE     32
+
+/**
+ * Number represented as (-1)^negative * mantissa * 10^exponent
+ */
+typedef struct yajp_decimal {
+    uint64_t mantissa;
+    int32_t exponent;
+    bool negative;
+} yajp_decimal_t;
+
+/**
+ * Find the shortest decimal what is read back to the same double by @c strtod(). Among decimals of the same length the
+ * closest to value is chosen.
+ *
+ * @param[in]   value   Finite number
+ * @param[out]  decimal Pointer to receive decimal
+ */
+void yajp_decimal_of_double(double value, yajp_decimal_t *decimal);
+
+/**
+ * Find the shortest decimal what is read back to the same float by @c strtof(). See @c yajp_decimal_of_double().
+ *
+ * @param[in]   value   Finite number
+ * @param[out]  decimal Pointer to receive decimal
+ */
+void yajp_decimal_of_float(float value, yajp_decimal_t *decimal);
+
+/**
+ * Format decimal. Numbers with decimal point position in range (-6, 21] are written in fixed notation, other ones in
+ * exponential notation, as JavaScript does: 0.1, 1500, 1.5e-7, 1e+21.
+ *
+ * @param[in]   decimal Pointer to decimal
+ * @param[out]  result  Pointer to buffer of at least YAJP_NUMBER_FORMAT_SIZE bytes. Result isn't terminated by '\0'
+ * @return      Size of result in bytes
+ */
+size_t yajp_format_decimal(const yajp_decimal_t *decimal, char *result);
+
+/**
+ * Format integer in decimal.
+ *
+ * @param[in]   value   Number
+ * @param[out]  result  Pointer to buffer of at least YAJP_NUMBER_FORMAT_SIZE bytes. Result isn't terminated by '\0'
+ * @return      Size of result in bytes
+ */
+size_t yajp_format_integer(int64_t value, char *result);
+
+#endif //YAJP_NUMBER_FORMAT_H
@@ -0,0 +1,803 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * parallel.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "yajp/parallel.h"
+#include "deserialization_misc.h"
+#include "worker_pool.h"
+
+/**
+ * Amount of input bytes claimed by worker at once. Batch is extended to the end of its last line
+ */
+#define YAJP_NDJSON_BATCH_SIZE      (64 * 1024)
+
+/**
+ * Error of line without record, i.e. empty one
+ */
+#define YAJP_NDJSON_EMPTY_LINE      (-1)
+
+/**
+ * Amount of array elements taken by worker at once. Worker what runs out of elements steals from others
+ */
+#define YAJP_ARRAY_GRAIN            64
+
+/**
+ * Amount of documents of batch taken by worker at once. Documents of batches are usually small messages
+ */
+#define YAJP_BATCH_GRAIN            16
+
+/**
+ * Deserialization of newline-delimited JSON shared by workers
+ */
+typedef struct yajp_ndjson_job {
+    const char *input;
+    size_t input_size;
+    const yajp_deserialization_context_t *ctx;
+    size_t elem_size;
+    yajp_ndjson_callback_t callback;
+    void *user_data;
+    bool ordered;
+
+    pthread_mutex_t lock;               // guards fields below
+    pthread_cond_t delivered_cond;      // signaled when batch is delivered or job is stopped
+    size_t cursor;                      // offset of first unclaimed byte of input
+    size_t lines;                       // amount of claimed lines
+    size_t batches;                     // amount of claimed batches
+    size_t delivered;                   // amount of delivered batches. Used in ordered mode
+    bool stopped;                       // callback stopped deserialization or worker failed
+    int error;                          // errno of deserialization
+} yajp_ndjson_job_t;
+
+/**
+ * Buffers of worker, reused by all its batches
+ */
+typedef struct yajp_ndjson_session {
+    yajp_deserialization_session_t *deserialization;    // parser and lexer of lines
+    const yajp_allocator_t *allocator;  // allocator of records and errors
+    uint8_t *records;                   // records of batch
+    int *errors;                        // errors of records of batch
+    size_t records_capacity;
+} yajp_ndjson_session_t;
+
+/**
+ * Boundaries of element of array in input
+ */
+typedef struct yajp_array_slice {
+    size_t begin;                       // offset of opening brace
+    size_t end;                         // offset of byte following closing brace
+} yajp_array_slice_t;
+
+/**
+ * Deserialization of array of objects shared by workers
+ */
+typedef struct yajp_array_job {
+    const char *json;
+    const yajp_array_slice_t *slices;
+    const yajp_deserialization_context_t *ctx;
+    uint8_t *elements;
+    size_t elem_size;
+    void *user_data;
+    yajp_deserialization_session_t **sessions;  // parsers and lexers of workers, indexed by worker
+    int error;                          // errno of failed element what was noticed first. Elements after it are skipped
+} yajp_array_job_t;
+
+/**
+ * Deserialization of batch of documents shared by workers
+ */
+typedef struct yajp_batch_job {
+    const yajp_buffer_t *inputs;
+    const yajp_deserialization_context_t *ctx;
+    uint8_t *outputs;
+    size_t stride;
+    int *errors;
+    void *user_data;
+    yajp_deserialization_session_t **sessions;  // parsers and lexers of workers, indexed by worker
+    int error;                          // errno of failed document what was noticed first
+} yajp_batch_job_t;
+
+static void yajp_ndjson_worker(int worker, void *arg);
+
+static bool yajp_ndjson_claim_batch(yajp_ndjson_job_t *job, size_t *begin, size_t *end, size_t *batch,
+                                    size_t *first_line, size_t *count);
+
+static int yajp_ndjson_deserialize_batch(yajp_ndjson_job_t *job, yajp_ndjson_session_t *session, size_t begin,
+                                         size_t end, size_t count);
+
+static void yajp_ndjson_deliver_batch(yajp_ndjson_job_t *job, yajp_ndjson_session_t *session, size_t batch,
+                                      size_t first_line, size_t count);
+
+static void yajp_ndjson_stop(yajp_ndjson_job_t *job, int error);
+
+static int yajp_ndjson_reserve(yajp_ndjson_session_t *session, size_t elem_size, size_t count);
+
+static void yajp_ndjson_release_buffers(yajp_ndjson_session_t *session);
+
+static bool yajp_ndjson_is_blank(const char *line, size_t size);
+
+static int yajp_array_scan(const char *json, size_t json_size, yajp_array_slice_t **slices, size_t *count);
+
+static size_t yajp_skip_whitespaces(const char *json, size_t json_size, size_t offset);
+
+static void yajp_array_worker(int worker, size_t begin, size_t end, void *arg);
+
+static void yajp_batch_worker(int worker, size_t begin, size_t end, void *arg);
+
+static bool yajp_thread_sessions(const yajp_deserialization_context_t *ctx);
+
+static int yajp_deserialize_text(yajp_deserialization_session_t **session, const yajp_deserialization_context_t *ctx,
+                                 const char *text, size_t size, void *address, void *user_data, int *error);
+
+int yajp_deserialize_ndjson(const char *input, size_t input_size, const yajp_deserialization_context_t *ctx,
+                            size_t elem_size, yajp_ndjson_callback_t callback, void *user_data, int nthreads,
+                            bool ordered) {
+    yajp_ndjson_job_t job;
+
+    if ((NULL == input && 0 != input_size) || NULL == ctx || 0 == elem_size || NULL == callback) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.input = input;
+    job.input_size = input_size;
+    job.ctx = ctx;
+    job.elem_size = elem_size;
+    job.callback = callback;
+    job.user_data = user_data;
+    job.ordered = ordered;
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.delivered_cond, NULL);
+
+    yajp_worker_pool_run(yajp_worker_pool_size(nthreads), yajp_ndjson_worker, &job);
+
+    pthread_cond_destroy(&job.delivered_cond);
+    pthread_mutex_destroy(&job.lock);
+
+    if (0 != job.error) {
+        errno = job.error;
+        return -1;
+    }
+
+    return 0;
+}
+
+int yajp_deserialize_array_parallel(const char *json, size_t json_size, const yajp_deserialization_context_t *ctx,
+                                    size_t elem_size, void **elements, size_t *count, void *user_data, int nthreads) {
+    const yajp_allocator_t *allocator;
+    yajp_array_slice_t *slices = NULL;
+    yajp_array_job_t job;
+    size_t slices_count, i;
+    int nworkers, ret = -1;
+
+    if (NULL == json || NULL == ctx || 0 == elem_size || NULL == elements || NULL == count) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (0 != yajp_array_scan(json, json_size, &slices, &slices_count)) {
+        return -1; // errno set
+    }
+
+    *elements = NULL;
+    *count = 0;
+    if (0 == slices_count) {
+        free(slices);
+        return 0;
+    }
+
+    allocator = (NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+    nworkers = yajp_worker_pool_size(nthreads);
+
+    memset(&job, 0, sizeof(job));
+    job.json = json;
+    job.slices = slices;
+    job.ctx = ctx;
+    job.elem_size = elem_size;
+    job.user_data = user_data;
+    job.elements = allocator->alloc(slices_count * elem_size, allocator->user);
+    job.sessions = yajp_thread_sessions(ctx) ? NULL : calloc(nworkers, sizeof(*job.sessions));
+
+    if (NULL == job.elements || (NULL == job.sessions && !yajp_thread_sessions(ctx))) {
+        goto end;
+    }
+
+    // elements what aren't deserialized because of failure stay zeroed, so all of them can be released
+    memset(job.elements, 0, slices_count * elem_size);
+
+    if (0 != yajp_worker_pool_run_ranges(nworkers, slices_count, YAJP_ARRAY_GRAIN, yajp_array_worker, &job)) {
+        goto end;
+    }
+
+    if (0 != job.error) {
+        errno = job.error;
+        goto end;
+    }
+
+    *elements = job.elements;
+    *count = slices_count;
+    job.elements = NULL;
+    ret = 0;
+
+end:
+    if (NULL != job.elements) {
+        for (i = 0; i < slices_count; i++) {
+            yajp_deserialization_free(ctx, job.elements + i * elem_size);
+        }
+        allocator->free(job.elements, allocator->user);
+    }
+
+    for (i = 0; NULL != job.sessions && i < (size_t) nworkers; i++) {
+        yajp_deserialization_session_release(job.sessions[i]);
+    }
+    free(job.sessions);
+    free(slices);
+
+    return ret;
+}
+
+int yajp_deserialize_batch(const yajp_buffer_t *inputs, size_t n, const yajp_deserialization_context_t *ctx,
+                           void *outputs, size_t stride, int *errors, void *user_data, int nthreads) {
+    yajp_batch_job_t job;
+    int nworkers, i, ret = -1;
+
+    if ((0 != n && (NULL == inputs || NULL == outputs || 0 == stride)) || NULL == ctx) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (0 == n) {
+        return 0;
+    }
+
+    // there is no point in workers without documents
+    nworkers = yajp_worker_pool_size(nthreads);
+    if ((size_t) nworkers > (n + YAJP_BATCH_GRAIN - 1) / YAJP_BATCH_GRAIN) {
+        nworkers = (int) ((n + YAJP_BATCH_GRAIN - 1) / YAJP_BATCH_GRAIN);
+    }
+
+    memset(&job, 0, sizeof(job));
+    job.inputs = inputs;
+    job.ctx = ctx;
+    job.outputs = outputs;
+    job.stride = stride;
+    job.errors = errors;
+    job.user_data = user_data;
+    job.sessions = yajp_thread_sessions(ctx) ? NULL : calloc(nworkers, sizeof(*job.sessions));
+
+    if ((NULL == job.sessions && !yajp_thread_sessions(ctx)) ||
+        0 != yajp_worker_pool_run_ranges(nworkers, n, YAJP_BATCH_GRAIN, yajp_batch_worker, &job)) {
+        goto end;
+    }
+
+    if (0 != job.error) {
+        errno = job.error;
+        goto end;
+    }
+
+    ret = 0;
+
+end:
+    for (i = 0; NULL != job.sessions && i < nworkers; i++) {
+        yajp_deserialization_session_release(job.sessions[i]);
+    }
+    free(job.sessions);
+
+    return ret;
+}
+
+/**
+ * Helper function. Routine of worker: claims batches of lines, deserializes and delivers them until input ends.
+ *
+ * @param worker[in]    Index of worker
+ * @param arg[in]       Pointer to job
+ */
+static void yajp_ndjson_worker(int worker, void *arg) {
+    yajp_ndjson_job_t *job = arg;
+    yajp_ndjson_session_t session = { 0 };
+    size_t begin, end, batch, first_line, count;
+
+    (void) worker;
+
+    session.allocator = (NULL != job->ctx->allocator) ? job->ctx->allocator : &yajp_heap_allocator;
+
+    while (yajp_ndjson_claim_batch(job, &begin, &end, &batch, &first_line, &count)) {
+        if (0 != yajp_ndjson_reserve(&session, job->elem_size, count)) {
+            yajp_ndjson_stop(job, errno);
+            count = 0; // batch is still passed, so following batches aren't waiting for it in ordered mode
+        } else if (0 != yajp_ndjson_deserialize_batch(job, &session, begin, end, count)) {
+            yajp_ndjson_stop(job, errno);
+        }
+
+        yajp_ndjson_deliver_batch(job, &session, batch, first_line, count);
+    }
+
+    yajp_deserialization_session_release(session.deserialization);
+    yajp_ndjson_release_buffers(&session);
+}
+
+/**
+ * Helper function. Claims next batch of lines of input.
+ *
+ * @param job[in, out]      Pointer to job
+ * @param begin[out]        Offset of first byte of batch
+ * @param end[out]          Offset of byte following batch
+ * @param batch[out]        Sequence number of batch
+ * @param first_line[out]   Number of first line of batch
+ * @param count[out]        Amount of lines in batch
+ *
+ * @return  true - if batch is claimed, false - if input ended or job is stopped
+ */
+static bool yajp_ndjson_claim_batch(yajp_ndjson_job_t *job, size_t *begin, size_t *end, size_t *batch,
+                                    size_t *first_line, size_t *count) {
+    const char *newline, *line;
+    bool claimed = false;
+
+    pthread_mutex_lock(&job->lock);
+
+    if (!job->stopped && job->cursor < job->input_size) {
+        *begin = job->cursor;
+        *end = *begin + YAJP_NDJSON_BATCH_SIZE;
+
+        if (*end >= job->input_size) {
+            *end = job->input_size;
+        } else {
+            newline = memchr(job->input + *end, '\n', job->input_size - *end);
+            *end = (NULL != newline) ? (size_t) (newline - job->input) + 1 : job->input_size;
+        }
+
+        // lines are counted here, so every batch knows number of its first line
+        *count = 0;
+        for (line = job->input + *begin; line < job->input + *end; (*count)++) {
+            newline = memchr(line, '\n', job->input + *end - line);
+            line = (NULL != newline) ? newline + 1 : job->input + *end;
+        }
+
+        *batch = job->batches++;
+        *first_line = job->lines;
+        job->lines += *count;
+        job->cursor = *end;
+        claimed = true;
+    }
+
+    pthread_mutex_unlock(&job->lock);
+
+    return claimed;
+}
+
+/**
+ * Helper function. Deserializes lines of batch into records of session.
+ *
+ * @param job[in]           Pointer to job
+ * @param session[in, out]  Pointer to session of worker. Should have memory for @p count records
+ * @param begin[in]         Offset of first byte of batch
+ * @param end[in]           Offset of byte following batch
+ * @param count[in]         Amount of lines in batch
+ *
+ * @return  Result of deserialization. 0 - on success, -1 with errno set if session can't be allocated. Errors
+ *          of records are stored in session
+ */
+static int yajp_ndjson_deserialize_batch(yajp_ndjson_job_t *job, yajp_ndjson_session_t *session, size_t begin,
+                                         size_t end, size_t count) {
+    const char *line = job->input + begin, *newline;
+    uint8_t *record;
+    size_t size, i;
+
+    for (i = 0; i < count; i++) {
+        newline = memchr(line, '\n', job->input + end - line);
+        size = (NULL != newline) ? (size_t) (newline - line) : (size_t) (job->input + end - line);
+        record = session->records + i * job->elem_size;
+
+        memset(record, 0, job->elem_size);
+
+        if (yajp_ndjson_is_blank(line, size)) {
+            session->errors[i] = YAJP_NDJSON_EMPTY_LINE;
+        } else if (0 != yajp_deserialize_text(yajp_thread_sessions(job->ctx) ? NULL : &session->deserialization,
+                                              job->ctx, line, size, record, job->user_data, &session->errors[i])) {
+            // records deserialized so far are released by delivery of stopped job, the rest are skipped
+            for (; i < count; i++) {
+                session->errors[i] = YAJP_NDJSON_EMPTY_LINE;
+            }
+            return -1; // errno set
+        }
+
+        line = (NULL != newline) ? newline + 1 : job->input + end;
+    }
+
+    return 0;
+}
+
+/**
+ * Helper function. Passes records of batch to callback. In ordered mode waits until previous batches are delivered.
+ * Records of stopped job are released instead.
+ *
+ * @param job[in, out]      Pointer to job
+ * @param session[in]       Pointer to session of worker holding records of batch
+ * @param batch[in]         Sequence number of batch
+ * @param first_line[in]    Number of first line of batch
+ * @param count[in]         Amount of lines in batch
+ */
+static void yajp_ndjson_deliver_batch(yajp_ndjson_job_t *job, yajp_ndjson_session_t *session, size_t batch,
+                                      size_t first_line, size_t count) {
+    void *record;
+    bool stopped;
+    size_t i;
+
+    pthread_mutex_lock(&job->lock);
+    if (job->ordered) {
+        while (!job->stopped && job->delivered != batch) {
+            pthread_cond_wait(&job->delivered_cond, &job->lock);
+        }
+    }
+    stopped = job->stopped;
+    pthread_mutex_unlock(&job->lock);
+
+    for (i = 0; i < count; i++) {
+        if (YAJP_NDJSON_EMPTY_LINE == session->errors[i]) {
+            continue;
+        }
+
+        record = session->records + i * job->elem_size;
+
+        if (!stopped && !job->ordered) {
+            stopped = __atomic_load_n(&job->stopped, __ATOMIC_RELAXED);
+        }
+
+        if (stopped) {
+            yajp_deserialization_free(job->ctx, record);
+        } else if (0 != job->callback(first_line + i, record, session->errors[i], job->user_data)) {
+            yajp_ndjson_stop(job, ECANCELED);
+            stopped = true;
+        }
+    }
+
+    if (job->ordered) {
+        pthread_mutex_lock(&job->lock);
+        job->delivered++;
+        pthread_cond_broadcast(&job->delivered_cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+/**
+ * Helper function. Stops job: workers don't claim new batches and release records instead of delivering them.
+ *
+ * @param job[in, out]  Pointer to job
+ * @param error[in]     Errno returned by deserialization. Only the first error is kept
+ */
+static void yajp_ndjson_stop(yajp_ndjson_job_t *job, int error) {
+    pthread_mutex_lock(&job->lock);
+    if (0 == job->error) {
+        job->error = error;
+    }
+    __atomic_store_n(&job->stopped, true, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&job->delivered_cond);
+    pthread_mutex_unlock(&job->lock);
+}
+
+/**
+ * Helper function. Grows buffers of records of session with allocator of session. Buffers are filled by every batch
+ * anew, so old content isn't kept.
+ *
+ * @param session[in, out]  Pointer to session of worker
+ * @param elem_size[in]     Size of record in bytes
+ * @param count[in]         Amount of records
+ *
+ * @return  Result of growth. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_ndjson_reserve(yajp_ndjson_session_t *session, size_t elem_size, size_t count) {
+    const yajp_allocator_t *allocator = session->allocator;
+
+    if (count <= session->records_capacity) {
+        return 0;
+    }
+
+    yajp_ndjson_release_buffers(session);
+
+    session->errors = allocator->alloc(count * sizeof(*session->errors), allocator->user);
+    session->records = allocator->alloc(count * elem_size, allocator->user);
+
+    if (NULL == session->errors || NULL == session->records) {
+        yajp_ndjson_release_buffers(session);
+        return -1; // errno set
+    }
+
+    session->records_capacity = count;
+
+    return 0;
+}
+
+/**
+ * Helper function. Releases buffers of records of session.
+ *
+ * @param session[in, out]  Pointer to session of worker
+ */
+static void yajp_ndjson_release_buffers(yajp_ndjson_session_t *session) {
+    const yajp_allocator_t *allocator = session->allocator;
+
+    if (NULL != session->errors) {
+        allocator->free(session->errors, allocator->user);
+        session->errors = NULL;
+    }
+
+    if (NULL != session->records) {
+        allocator->free(session->records, allocator->user);
+        session->records = NULL;
+    }
+
+    session->records_capacity = 0;
+}
+
+/**
+ * Helper function. Checks if line contains only whitespaces. Terminating zero of string passed as input is a
+ * whitespace too.
+ *
+ * @param line[in]  Pointer to line
+ * @param size[in]  Size of line in bytes
+ *
+ * @return  true - if line is blank
+ */
+static bool yajp_ndjson_is_blank(const char *line, size_t size) {
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        switch (line[i]) {
+            case ' ':
+            case '\t':
+            case '\r':
+            case '\0':
+                break;
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Helper function. Checks if texts of context are deserialized in sessions of threads. They keep memory of heap
+ * allocator only, and threads of pool keep them between calls.
+ *
+ * @param ctx[in]   Deserialization context
+ *
+ * @return  true - if sessions of threads are used, false - if workers need their own sessions
+ */
+static bool yajp_thread_sessions(const yajp_deserialization_context_t *ctx) {
+    return NULL == ctx->allocator || &yajp_heap_allocator == ctx->allocator;
+}
+
+/**
+ * Helper function. Deserializes JSON text what isn't terminated by zero, i.e. line, element of array or document of
+ * batch. Parser and lexer buffer of worker are reused by all its texts.
+ *
+ * @param session[in, out]  Pointer to deserialization session of worker. Created on first use. NULL - to use session
+ *                          of calling thread
+ * @param ctx[in]           Deserialization context
+ * @param text[in]          Pointer to text
+ * @param size[in]          Size of text in bytes
+ * @param address[out]      Deserializing structure
+ * @param user_data[in]     Data passed to setters
+ * @param error[out]        0 - if text was deserialized, errno of deserialization otherwise
+ *
+ * @return  0 - on success, -1 with errno set if session can't be allocated. Then structure isn't touched
+ */
+static int yajp_deserialize_text(yajp_deserialization_session_t **session, const yajp_deserialization_context_t *ctx,
+                                 const char *text, size_t size, void *address, void *user_data, int *error) {
+    if (NULL != session && NULL == *session) {
+        *session = yajp_deserialization_session_create(ctx->allocator);
+        if (NULL == *session) {
+            return -1; // errno set
+        }
+    }
+
+    errno = 0;
+    *error = (0 == yajp_deserialize_json_text((NULL != session) ? *session : NULL, text, size, ctx, address,
+                                              user_data))
+            ? 0
+            : ((0 != errno) ? errno : EINVAL);
+
+    return 0;
+}
+
+/**
+ * Helper function. Finds boundaries of elements of top-level array of objects. Only brackets and strings are
+ * recognized, content of elements is checked by their deserialization.
+ *
+ * @param json[in]          Pointer to JSON
+ * @param json_size[in]     Size of JSON in bytes
+ * @param slices[out]       Pointer to receive boundaries of elements. Allocated on heap
+ * @param count[out]        Pointer to receive amount of elements
+ *
+ * @return  Result of scan. 0 - on success, -1 with errno set to EINVAL if JSON isn't array of objects or to ENOMEM
+ */
+static int yajp_array_scan(const char *json, size_t json_size, yajp_array_slice_t **slices, size_t *count) {
+    yajp_array_slice_t *tmp;
+    size_t capacity = 0, offset, depth;
+    bool in_string;
+
+    *slices = NULL;
+    *count = 0;
+
+    offset = yajp_skip_whitespaces(json, json_size, 0);
+    if (offset >= json_size || '[' != json[offset]) {
+        goto invalid;
+    }
+
+    offset = yajp_skip_whitespaces(json, json_size, offset + 1);
+    if (offset < json_size && ']' == json[offset]) {
+        offset++;
+        goto tail;
+    }
+
+    while (offset < json_size) {
+        if ('{' != json[offset]) {
+            goto invalid;
+        }
+
+        if (*count == capacity) {
+            capacity = (0 == capacity) ? 1024 : capacity * 2;
+            tmp = realloc(*slices, capacity * sizeof(*tmp));
+            if (NULL == tmp) {
+                goto fail;
+            }
+            *slices = tmp;
+        }
+        (*slices)[*count].begin = offset;
+
+        // find closing brace of element
+        for (depth = 0, in_string = false; offset < json_size; offset++) {
+            if (in_string) {
+                if ('\\' == json[offset]) {
+                    offset++;
+                } else if ('"' == json[offset]) {
+                    in_string = false;
+                }
+            } else if ('"' == json[offset]) {
+                in_string = true;
+            } else if ('{' == json[offset] || '[' == json[offset]) {
+                depth++;
+            } else if (('}' == json[offset] || ']' == json[offset]) && 0 == --depth) {
+                break;
+            }
+        }
+
+        if (offset >= json_size) {
+            goto invalid;
+        }
+
+        (*slices)[(*count)++].end = ++offset;
+
+        offset = yajp_skip_whitespaces(json, json_size, offset);
+        if (offset < json_size && ']' == json[offset]) {
+            offset++;
+            goto tail;
+        } else if (offset >= json_size || ',' != json[offset]) {
+            goto invalid;
+        }
+
+        offset = yajp_skip_whitespaces(json, json_size, offset + 1);
+    }
+
+invalid:
+    errno = EINVAL;
+fail:
+    free(*slices);
+    *slices = NULL;
+    *count = 0;
+    return -1;
+
+tail:
+    // only whitespaces can follow array. Terminating zero of string passed as input is a whitespace too
+    for (; offset < json_size; offset++) {
+        if ('\0' != json[offset] && yajp_skip_whitespaces(json, json_size, offset) == offset) {
+            goto invalid;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Helper function. Skips JSON whitespaces.
+ *
+ * @param json[in]          Pointer to JSON
+ * @param json_size[in]     Size of JSON in bytes
+ * @param offset[in]        Offset to start from
+ *
+ * @return  Offset of first non-whitespace byte or json_size
+ */
+static size_t yajp_skip_whitespaces(const char *json, size_t json_size, size_t offset) {
+    while (offset < json_size &&
+           (' ' == json[offset] || '\n' == json[offset] || '\r' == json[offset] || '\t' == json[offset])) {
+        offset++;
+    }
+
+    return offset;
+}
+
+/**
+ * Helper function. Routine of worker: deserializes range of elements of array.
+ *
+ * @param worker[in]    Index of worker. Selects its session
+ * @param begin[in]     Index of first element
+ * @param end[in]       Index of element following range
+ * @param arg[in]       Pointer to job
+ */
+static void yajp_array_worker(int worker, size_t begin, size_t end, void *arg) {
+    yajp_array_job_t *job = arg;
+    const yajp_array_slice_t *slice;
+    int error = 0, expected = 0;
+    size_t i;
+
+    for (i = begin; i < end && 0 == __atomic_load_n(&job->error, __ATOMIC_RELAXED); i++) {
+        slice = &job->slices[i];
+
+        if (0 != yajp_deserialize_text((NULL != job->sessions) ? &job->sessions[worker] : NULL, job->ctx,
+                                       job->json + slice->begin,
+                                       slice->end - slice->begin, job->elements + i * job->elem_size,
+                                       job->user_data, &error)) {
+            error = errno;
+        }
+
+        if (0 != error) {
+            __atomic_compare_exchange_n(&job->error, &expected, error, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Helper function. Routine of worker: deserializes range of documents of batch. Failed document doesn't stop others.
+ *
+ * @param worker[in]    Index of worker. Selects its session
+ * @param begin[in]     Index of first document
+ * @param end[in]       Index of document following range
+ * @param arg[in]       Pointer to job
+ */
+static void yajp_batch_worker(int worker, size_t begin, size_t end, void *arg) {
+    yajp_batch_job_t *job = arg;
+    int error = 0, expected;
+    size_t i;
+
+    for (i = begin; i < end; i++) {
+        if (0 != yajp_deserialize_text((NULL != job->sessions) ? &job->sessions[worker] : NULL, job->ctx,
+                                       job->inputs[i].data,
+                                       job->inputs[i].size, job->outputs + i * job->stride, job->user_data,
+                                       &error)) {
+            error = errno;
+        }
+
+        if (NULL != job->errors) {
+            job->errors[i] = error;
+        }
+
+        // failed exchange loads stored error into expected, so it's reset to keep the first error
+        if (0 != error) {
+            expected = 0;
+            __atomic_compare_exchange_n(&job->error, &expected, error, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+    }
+}
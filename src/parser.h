@@ -51,8 +51,20 @@ typedef enum yajp_parser_recognized_entity_type {
     YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_AEND,
     YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_OBJECT,
     YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_KEY,
+    YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_OVERFLOW,  // parser stack reached its maximal size, parsing can't continue
 } yajp_parser_recognized_entity_type_t;
 
+/**
+ * Parser stack entries taken by one level of nesting: object holds its beginning, content, key and colon of pair being
+ * parsed, array holds less
+ */
+#define YAJP_PARSER_STACK_ENTRIES_PER_LEVEL     4
+
+/**
+ * Parser stack entries taken regardless of nesting
+ */
+#define YAJP_PARSER_STACK_RESERVE               4
+
 /**
  * Recognized parser actions. Retur
  */
@@ -67,6 +79,37 @@ typedef struct yajp_parser_recognized_entity {
  */
 void yajp_parser_init(void *yyp);
 
+/**
+ * \brief   Initialize a new parser that has already been allocated, with stack of custom size
+ *
+ * \details Stack is embedded into parser structure while it is small, and is allocated with @p allocator when it grows.
+ * When stack reaches @p max_stack_size entries parser reports YAJP_PARSER_RECOGNIZED_ENTITY_TYPE_OVERFLOW.
+ *
+ * \param[in]   yyp             The parser to be initialized
+ * \param[in]   allocator       Allocator of stack memory. Heap allocator is used when NULL. Should outlive parser
+ * \param[in]   stack_size      Count of stack entries allocated right away
+ * \param[in]   max_stack_size  Maximal count of stack entries. 0 - unlimited
+ */
+void yajp_parser_init_with_stack(void *yyp, const yajp_allocator_t *allocator, int stack_size, int max_stack_size);
+
+/**
+ * \brief   Return parser to initial state, so it can parse next document. Grown stack is kept
+ *
+ * \param[in]   yyp     The parser to be reset
+ */
+void yajp_parser_reset(void *yyp);
+
+/**
+ * \brief   Change stack sizes of parser what has been reset, so it can parse next document with other limits
+ *
+ * \details Grown stack is kept while it fits into @p max_stack_size entries, otherwise it's released.
+ *
+ * \param[in]   yyp             The parser to be changed
+ * \param[in]   stack_size      Count of stack entries allocated right away
+ * \param[in]   max_stack_size  Maximal count of stack entries. 0 - unlimited
+ */
+void yajp_parser_resize_stack(void *yyp, int stack_size, int max_stack_size);
+
 /**
  * \brief   This function allocates a new parser.
  *
@@ -76,6 +119,13 @@ void yajp_parser_init(void *yyp);
  */
 void *yajp_parser_allocate(void *(*mallocProc)(size_t));
 
+/**
+ * \brief   Returns size of parser structure. Used to allocate parser with custom allocator.
+ *
+ * \return  Size of parser structure in bytes. Allocated memory should be initialized with yajp_parser_init()
+ */
+size_t yajp_parser_size(void);
+
 /**
  * \brief   Clear all secondary memory allocations from the parser
  *
@@ -0,0 +1,261 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * read_ahead.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <errno.h>
+
+#include "read_ahead.h"
+
+static void *yajp_read_ahead_main(void *arg);
+
+static size_t yajp_read_ahead_fill(yajp_read_ahead_t *read_ahead, yajp_read_ahead_block_t *block, int *error);
+
+static void yajp_read_ahead_sleep(yajp_read_ahead_t *read_ahead, bool *waiting, bool (*ready)(yajp_read_ahead_t *));
+
+static bool yajp_read_ahead_has_block(yajp_read_ahead_t *read_ahead);
+
+static bool yajp_read_ahead_has_room(yajp_read_ahead_t *read_ahead);
+
+static void yajp_read_ahead_notify(yajp_read_ahead_t *read_ahead, bool *waiting);
+
+int yajp_read_ahead_start(yajp_read_ahead_t *read_ahead, FILE *json, size_t block_size,
+                          const yajp_allocator_t *allocator) {
+    int i, ret;
+
+    memset(read_ahead, 0, sizeof(*read_ahead));
+    read_ahead->json = json;
+    read_ahead->block_size = block_size;
+    read_ahead->allocator = allocator;
+
+    for (i = 0; i < YAJP_READ_AHEAD_BLOCKS; i++) {
+        read_ahead->blocks[i].data = allocator->alloc(block_size, allocator->user);
+        if (NULL == read_ahead->blocks[i].data) {
+            goto fail;
+        }
+    }
+
+    pthread_mutex_init(&read_ahead->lock, NULL);
+    pthread_cond_init(&read_ahead->cond, NULL);
+
+    ret = pthread_create(&read_ahead->thread, NULL, yajp_read_ahead_main, read_ahead);
+    if (0 != ret) {
+        pthread_cond_destroy(&read_ahead->cond);
+        pthread_mutex_destroy(&read_ahead->lock);
+        errno = ret;
+        goto fail;
+    }
+
+    return 0;
+
+fail:
+    for (i = 0; i < YAJP_READ_AHEAD_BLOCKS; i++) {
+        allocator->free(read_ahead->blocks[i].data, allocator->user);
+    }
+    return -1; // errno set
+}
+
+ssize_t yajp_read_ahead_read(yajp_read_ahead_t *read_ahead, uint8_t *buffer, size_t need) {
+    yajp_read_ahead_block_t *block;
+    size_t read = 0, size;
+
+    while (read < need) {
+        if (read_ahead->consumed == __atomic_load_n(&read_ahead->filled, __ATOMIC_ACQUIRE)) {
+            // the last block is counted before reader finishes, so finished reader has nothing more
+            if (__atomic_load_n(&read_ahead->finished, __ATOMIC_ACQUIRE) &&
+                read_ahead->consumed == __atomic_load_n(&read_ahead->filled, __ATOMIC_ACQUIRE)) {
+                if (0 != read_ahead->error) {
+                    errno = read_ahead->error;
+                    return -1;
+                }
+                break;
+            }
+
+            yajp_read_ahead_sleep(read_ahead, &read_ahead->consumer_waiting, yajp_read_ahead_has_block);
+            continue;
+        }
+
+        block = &read_ahead->blocks[read_ahead->consumed % YAJP_READ_AHEAD_BLOCKS];
+        size = block->size - read_ahead->offset;
+        if (size > need - read) {
+            size = need - read;
+        }
+
+        memcpy(buffer + read, block->data + read_ahead->offset, size);
+        read += size;
+        read_ahead->offset += size;
+
+        if (read_ahead->offset == block->size) {
+            read_ahead->offset = 0;
+            __atomic_store_n(&read_ahead->consumed, read_ahead->consumed + 1, __ATOMIC_RELEASE);
+            yajp_read_ahead_notify(read_ahead, &read_ahead->reader_waiting);
+        }
+    }
+
+    return (ssize_t) read;
+}
+
+void yajp_read_ahead_stop(yajp_read_ahead_t *read_ahead) {
+    int i;
+
+    __atomic_store_n(&read_ahead->stopped, true, __ATOMIC_RELEASE);
+    yajp_read_ahead_notify(read_ahead, &read_ahead->reader_waiting);
+
+    pthread_join(read_ahead->thread, NULL);
+    pthread_cond_destroy(&read_ahead->cond);
+    pthread_mutex_destroy(&read_ahead->lock);
+
+    for (i = 0; i < YAJP_READ_AHEAD_BLOCKS; i++) {
+        read_ahead->allocator->free(read_ahead->blocks[i].data, read_ahead->allocator->user);
+    }
+}
+
+/**
+ * Helper function. Routine of reader thread: fills free blocks until end of stream, failure or stop.
+ *
+ * @param arg[in]   Read-ahead buffer
+ *
+ * @return  NULL
+ */
+static void *yajp_read_ahead_main(void *arg) {
+    yajp_read_ahead_t *read_ahead = arg;
+    yajp_read_ahead_block_t *block;
+    int error = 0;
+
+    while (!__atomic_load_n(&read_ahead->stopped, __ATOMIC_ACQUIRE)) {
+        if (read_ahead->filled - __atomic_load_n(&read_ahead->consumed, __ATOMIC_ACQUIRE) == YAJP_READ_AHEAD_BLOCKS) {
+            yajp_read_ahead_sleep(read_ahead, &read_ahead->reader_waiting, yajp_read_ahead_has_room);
+            continue;
+        }
+
+        block = &read_ahead->blocks[read_ahead->filled % YAJP_READ_AHEAD_BLOCKS];
+        block->size = yajp_read_ahead_fill(read_ahead, block, &error);
+
+        if (0 < block->size) {
+            __atomic_store_n(&read_ahead->filled, read_ahead->filled + 1, __ATOMIC_RELEASE);
+        }
+
+        if (block->size < read_ahead->block_size) {
+            read_ahead->error = error;
+            __atomic_store_n(&read_ahead->finished, true, __ATOMIC_RELEASE);
+        }
+
+        yajp_read_ahead_notify(read_ahead, &read_ahead->consumer_waiting);
+
+        if (block->size < read_ahead->block_size) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Helper function. Reads block of stream. Interrupted reads are repeated.
+ *
+ * @param read_ahead[in]    Read-ahead buffer
+ * @param block[out]        Filling block
+ * @param error[out]        errno of failed read or 0
+ *
+ * @return  Amount of read bytes. Less than block size at the end of stream or on failure
+ */
+static size_t yajp_read_ahead_fill(yajp_read_ahead_t *read_ahead, yajp_read_ahead_block_t *block, int *error) {
+    size_t size = 0, bytes_read;
+
+    while (size < read_ahead->block_size) {
+        bytes_read = fread(block->data + size, 1, read_ahead->block_size - size, read_ahead->json);
+        size += bytes_read;
+
+        if (0 == bytes_read || ferror(read_ahead->json)) {
+            if (ferror(read_ahead->json) && EINTR == errno) {
+                clearerr(read_ahead->json);
+                continue;
+            }
+
+            *error = ferror(read_ahead->json) ? ((0 != errno) ? errno : EIO) : 0;
+            break;
+        }
+    }
+
+    return size;
+}
+
+/**
+ * Helper function. Sleeps until other side of read-ahead buffer makes it ready. Waiting flag is raised before
+ * readiness is checked under lock, so other side either sees the flag or its change is seen here.
+ *
+ * @param read_ahead[in]    Read-ahead buffer
+ * @param waiting[out]      Waiting flag of sleeping side
+ * @param ready[in]         Checks if sleeping side can continue
+ */
+static void yajp_read_ahead_sleep(yajp_read_ahead_t *read_ahead, bool *waiting, bool (*ready)(yajp_read_ahead_t *)) {
+    pthread_mutex_lock(&read_ahead->lock);
+    __atomic_store_n(waiting, true, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    while (!ready(read_ahead)) {
+        pthread_cond_wait(&read_ahead->cond, &read_ahead->lock);
+    }
+
+    __atomic_store_n(waiting, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&read_ahead->lock);
+}
+
+/**
+ * Helper function. Checks if consumer can continue: block is filled or reader is finished.
+ *
+ * @param read_ahead[in]    Read-ahead buffer
+ *
+ * @return  true - if consumer doesn't need to sleep
+ */
+static bool yajp_read_ahead_has_block(yajp_read_ahead_t *read_ahead) {
+    return read_ahead->consumed != __atomic_load_n(&read_ahead->filled, __ATOMIC_ACQUIRE) ||
+           __atomic_load_n(&read_ahead->finished, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Helper function. Checks if reader can continue: block is free or reader is stopped.
+ *
+ * @param read_ahead[in]    Read-ahead buffer
+ *
+ * @return  true - if reader doesn't need to sleep
+ */
+static bool yajp_read_ahead_has_room(yajp_read_ahead_t *read_ahead) {
+    return read_ahead->filled - __atomic_load_n(&read_ahead->consumed, __ATOMIC_ACQUIRE) != YAJP_READ_AHEAD_BLOCKS ||
+           __atomic_load_n(&read_ahead->stopped, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Helper function. Wakes other side of read-ahead buffer if it announced that it sleeps. Change of counters or flags
+ * is published before the call, so lock is taken only when other side can miss it.
+ *
+ * @param read_ahead[in]    Read-ahead buffer
+ * @param waiting[in]       Waiting flag of other side
+ */
+static void yajp_read_ahead_notify(yajp_read_ahead_t *read_ahead, bool *waiting) {
+    // pairs with fence of sleeping side: either it sees published change or its flag is seen here
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(waiting, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&read_ahead->lock);
+        pthread_cond_signal(&read_ahead->cond);
+        pthread_mutex_unlock(&read_ahead->lock);
+    }
+}
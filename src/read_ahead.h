@@ -0,0 +1,105 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * read_ahead.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_READ_AHEAD_H
+#define YAJP_READ_AHEAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "yajp/allocator.h"
+
+/**
+ * Amount of blocks of read-ahead buffer: lexer consumes one block while reader fills another
+ */
+#define YAJP_READ_AHEAD_BLOCKS      2
+
+/**
+ * Block of stream read by reader thread
+ */
+typedef struct yajp_read_ahead_block {
+    uint8_t *data;
+    size_t size;                        // amount of read bytes. Less than block size only for the last block
+} yajp_read_ahead_block_t;
+
+/**
+ * Single-producer single-consumer buffer of stream filled by reader thread. Blocks are handed over by counters of
+ * filled and consumed blocks without locks, mutex is taken only to sleep when buffer is full or empty, and to wake
+ * the side what announced that it sleeps.
+ */
+typedef struct yajp_read_ahead {
+    FILE *json;
+    const yajp_allocator_t *allocator;
+    size_t block_size;
+    yajp_read_ahead_block_t blocks[YAJP_READ_AHEAD_BLOCKS];
+
+    size_t filled;                      // amount of filled blocks. Written only by reader
+    size_t consumed;                    // amount of consumed blocks. Written only by consumer
+    size_t offset;                      // offset of the first unconsumed byte of current block. Used by consumer
+    bool finished;                      // reader reached end of stream or failed. Set after the last block is filled
+    int error;                          // errno of failed read. Written before finished
+    bool stopped;                       // consumer doesn't need more blocks
+    bool reader_waiting;                // reader sleeps on full buffer. Set and cleared under lock by reader
+    bool consumer_waiting;              // consumer sleeps on empty buffer. Set and cleared under lock by consumer
+
+    pthread_mutex_t lock;               // guards sleeping only
+    pthread_cond_t cond;                // signaled when block is filled or consumed, or reader is stopped. Other side
+                                        // never sleeps when one side signals, so it has the only waiter
+    pthread_t thread;
+} yajp_read_ahead_t;
+
+/**
+ * Start reader thread what reads stream by blocks ahead of consumer.
+ *
+ * @param[out]  read_ahead  Read-ahead buffer
+ * @param[in]   json        Stream. Shouldn't be used by others until read-ahead is stopped
+ * @param[in]   block_size  Size of block in bytes
+ * @param[in]   allocator   Allocator of blocks
+ * @return      Result of start. 0 - on success, -1 with errno set if blocks can't be allocated or thread can't be
+ *              started
+ */
+int yajp_read_ahead_start(yajp_read_ahead_t *read_ahead, FILE *json, size_t block_size,
+                          const yajp_allocator_t *allocator);
+
+/**
+ * Read bytes of stream from read-ahead buffer. Waits for reader if buffer is empty.
+ *
+ * @param[in, out]  read_ahead  Read-ahead buffer
+ * @param[out]      buffer      Buffer to be filled
+ * @param[in]       need        Amount of bytes to read
+ * @return          Amount of read bytes. Less than @p need only at the end of stream, -1 with errno set if reading
+ *                  of stream failed
+ */
+ssize_t yajp_read_ahead_read(yajp_read_ahead_t *read_ahead, uint8_t *buffer, size_t need);
+
+/**
+ * Stop reader thread and release blocks. Unconsumed bytes of stream are lost.
+ *
+ * @param[in, out]  read_ahead  Read-ahead buffer
+ *
+ * @note    Reader can't be interrupted while it's blocked in read of stream, so stop waits for it.
+ */
+void yajp_read_ahead_stop(yajp_read_ahead_t *read_ahead);
+
+#endif //YAJP_READ_AHEAD_H
@@ -0,0 +1,1563 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * serialization.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "yajp/serialization.h"
+#include "yajp/deserialization_routine.h"
+#include "serialization_misc.h"
+#include "number_format.h"
+
+/**
+ * Size of buffer of stream output. Stream is written by blocks of this size
+ */
+#define YAJP_SERIALIZATION_BUFFER_SIZE      (64 * 1024)
+/**
+ * Initial size of buffer of document serialized into memory. Buffer grows geometrically
+ */
+#define YAJP_SERIALIZATION_INITIAL_SIZE     4096
+/**
+ * Amount of segments of chain passed to one writev() call
+ */
+#define YAJP_SERIALIZATION_WRITE_BATCH      256
+/**
+ * Initial amount of segments of chain. Array of segments grows geometrically
+ */
+#define YAJP_SERIALIZATION_INITIAL_SEGMENTS 16
+/**
+ * Initial amount of entries of cache of two-pass serialization. Cache grows geometrically
+ */
+#define YAJP_SERIALIZATION_INITIAL_CACHE    64
+/**
+ * Size of buffer of measure pass. Bytes generated into it are only counted
+ */
+#define YAJP_SERIALIZATION_SCRATCH_SIZE     256
+/**
+ * Size of buffer of one formatted number or timestamp
+ */
+#define YAJP_SERIALIZATION_VALUE_SIZE       64
+
+/**
+ * Block of bytes generated by serialization into chain. Blocks aren't moved, so segments of chain point into them
+ */
+typedef struct yajp_serialization_block yajp_serialization_block_t;
+struct yajp_serialization_block {
+    yajp_serialization_block_t *next;
+    uint8_t data[];
+};
+
+/**
+ * Result of measure pass of two-pass serialization used by fill pass. Entries follow order of strings and numbers in
+ * document
+ */
+typedef union yajp_serialization_cached {
+    size_t size;                                // size of written string without quotes
+    yajp_decimal_t decimal;                     // the shortest decimal of float or double
+} yajp_serialization_cached_t;
+
+/**
+ * Output of serialization. Document is collected in buffer, which is written to stream when it's full, is replaced by
+ * new block if document is collected into chain, is counted and dropped by measure pass or is grown otherwise. Buffer
+ * of fill pass is sized by measure pass and isn't grown
+ */
+typedef struct yajp_serialization_output {
+    uint8_t *buffer;
+    size_t size;                                // amount of bytes in buffer
+    size_t capacity;                            // size of buffer
+    FILE *stream;                               // stream of document or NULL if document is kept in buffer
+    const yajp_allocator_t *allocator;          // allocator of buffer
+    size_t depth;                               // nesting depth of current value
+    size_t max_depth;                           // maximal nesting depth of document
+    bool escape_non_ascii;                      // non-ASCII characters are written as \u escape sequences
+    yajp_serialization_chain_t *chain;          // chain of segments of document or NULL
+    size_t segment_start;                       // offset of bytes of buffer what aren't added to chain yet
+    size_t reference_size;                      // minimal size of string run referenced by chain instead of copying
+    bool measure;                               // measure pass, bytes are only counted
+    bool fixed;                                 // fill pass, buffer can't grow
+    size_t flushed;                             // amount of bytes written before buffer
+    yajp_serialization_cached_t *cache;         // cache of measure pass or NULL
+    size_t cache_count;                         // amount of entries of cache
+    size_t cache_capacity;                      // amount of allocated entries of cache
+    size_t cache_next;                          // entry of cache used next by fill pass
+    bool cached;                                // measure pass fills cache, fill pass uses it
+    uint8_t scratch[YAJP_SERIALIZATION_SCRATCH_SIZE];
+} yajp_serialization_output_t;
+
+static int yajp_serialize(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                          const void *address);
+
+static int yajp_serialize_measure(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                                  const void *address, bool cached, size_t *size);
+
+static int yajp_serialize_fill(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                               const void *address, uint8_t *buffer, size_t capacity);
+
+static int yajp_serialize_exact_buffer(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                                       const void *address, char **json, size_t *json_size);
+
+static yajp_serialization_value_t yajp_serialization_value_of(const yajp_deserialization_rule_t *rule);
+
+static int yajp_write_object(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                             const void *address);
+
+static int yajp_write_array(yajp_serialization_output_t *out, const yajp_deserialization_rule_t *rule,
+                            yajp_serialization_value_t kind, const void *address);
+
+static int yajp_write_value(yajp_serialization_output_t *out, const yajp_deserialization_rule_t *rule,
+                            yajp_serialization_value_t kind, const void *value, size_t capacity);
+
+static int yajp_write_string(yajp_serialization_output_t *out, const char *string, size_t size);
+
+static size_t yajp_escape_sequence_size(const char *string, size_t size);
+
+static size_t yajp_escape_scan(const uint8_t *string, size_t size, bool non_ascii);
+
+static size_t yajp_write_ascii_escape(uint8_t *escape, uint8_t c);
+
+static size_t yajp_write_unicode_escape(uint8_t *escape, uint32_t code_point);
+
+static size_t yajp_utf8_decode(const uint8_t *string, size_t size, uint32_t *code_point);
+
+static int yajp_write_number(yajp_serialization_output_t *out, yajp_serialization_value_t kind, const void *value);
+
+static int yajp_write_timestamp(yajp_serialization_output_t *out, int64_t timestamp);
+
+static int yajp_write_enum(yajp_serialization_output_t *out, const yajp_deserialization_enum_t *enumeration,
+                           int value);
+
+static int yajp_write_base64(yajp_serialization_output_t *out, const yajp_deserialization_base64_t *base64,
+                             const uint8_t *value);
+
+static int yajp_enter(yajp_serialization_output_t *out);
+
+static uint8_t *yajp_output_reserve(yajp_serialization_output_t *out, size_t size);
+
+static int yajp_output_write(yajp_serialization_output_t *out, const void *data, size_t size);
+
+static int yajp_output_reference(yajp_serialization_output_t *out, const void *data, size_t size);
+
+static int yajp_output_put(yajp_serialization_output_t *out, uint8_t c);
+
+static int yajp_output_flush(yajp_serialization_output_t *out);
+
+static int yajp_output_grow(yajp_serialization_output_t *out, size_t size);
+
+static int yajp_output_next_block(yajp_serialization_output_t *out, size_t size);
+
+static int yajp_output_close_segment(yajp_serialization_output_t *out);
+
+static int yajp_chain_append(yajp_serialization_chain_t *chain, const void *data, size_t size);
+
+static yajp_serialization_cached_t *yajp_cache_push(yajp_serialization_output_t *out);
+
+static yajp_serialization_cached_t *yajp_cache_next(yajp_serialization_output_t *out);
+
+int yajp_serialize_json_stream(FILE *json, const yajp_deserialization_context_t *ctx, const void *address) {
+    yajp_serialization_output_t out = { 0 };
+    int result;
+
+    if (NULL == json) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    out.stream = json;
+    out.allocator = (NULL != ctx && NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+    out.buffer = out.allocator->alloc(YAJP_SERIALIZATION_BUFFER_SIZE, out.allocator->user);
+    if (NULL == out.buffer) {
+        return -1; // errno set
+    }
+    out.capacity = YAJP_SERIALIZATION_BUFFER_SIZE;
+
+    result = yajp_serialize(&out, ctx, address);
+    if (0 == result) {
+        result = yajp_output_flush(&out);
+    }
+
+    out.allocator->free(out.buffer, out.allocator->user);
+
+    return result;
+}
+
+int yajp_serialize_json_buffer(const yajp_deserialization_context_t *ctx, const void *address, char **json,
+                               size_t *json_size) {
+    yajp_serialization_output_t out = { 0 };
+
+    if (NULL == json || NULL == json_size) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    out.allocator = (NULL != ctx && NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+
+    if (NULL != ctx && ctx->exact_size) {
+        return yajp_serialize_exact_buffer(&out, ctx, address, json, json_size);
+    }
+
+    // document is terminated by '\0', which isn't counted in its size
+    if (0 != yajp_serialize(&out, ctx, address) || 0 != yajp_output_put(&out, '\0')) {
+        if (NULL != out.buffer) {
+            out.allocator->free(out.buffer, out.allocator->user);
+        }
+        return -1; // errno set
+    }
+
+    *json = (char *) out.buffer;
+    *json_size = out.size - 1;
+
+    return 0;
+}
+
+int yajp_serialize_json_size(const yajp_deserialization_context_t *ctx, const void *address, size_t *json_size) {
+    yajp_serialization_output_t out = { 0 };
+
+    if (NULL == json_size) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    return yajp_serialize_measure(&out, ctx, address, false, json_size);
+}
+
+int yajp_serialize_json_into(const yajp_deserialization_context_t *ctx, const void *address, char *json,
+                             size_t capacity, size_t *json_size) {
+    yajp_serialization_output_t out = { 0 };
+    int result;
+
+    if (NULL == json || NULL == json_size) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    out.allocator = (NULL != ctx && NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+
+    result = yajp_serialize_measure(&out, ctx, address, true, json_size);
+    if (0 == result && capacity < *json_size) {
+        errno = ERANGE;
+        result = -1;
+    }
+
+    if (0 == result) {
+        result = yajp_serialize_fill(&out, ctx, address, (uint8_t *) json, capacity);
+    }
+
+    if (NULL != out.cache) {
+        out.allocator->free(out.cache, out.allocator->user);
+    }
+
+    return result;
+}
+
+int yajp_serialize_json_chain(const yajp_deserialization_context_t *ctx, const void *address, size_t reference_size,
+                              yajp_serialization_chain_t *chain) {
+    yajp_serialization_output_t out = { 0 };
+
+    if (NULL == chain) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(chain, 0, sizeof(*chain));
+    chain->allocator = (NULL != ctx && NULL != ctx->allocator) ? ctx->allocator : &yajp_heap_allocator;
+
+    out.allocator = chain->allocator;
+    out.chain = chain;
+    out.reference_size = reference_size;
+
+    if (0 != yajp_serialize(&out, ctx, address) || 0 != yajp_output_close_segment(&out)) {
+        yajp_serialization_chain_release(chain);
+        return -1; // errno set
+    }
+
+    return 0;
+}
+
+int yajp_serialization_chain_write(int fd, const yajp_serialization_chain_t *chain) {
+    struct iovec batch[YAJP_SERIALIZATION_WRITE_BATCH];
+    size_t index = 0, skip = 0, count, rest, i;
+    ssize_t written;
+
+    if (NULL == chain) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    while (index < chain->count) {
+        count = chain->count - index;
+        count = (YAJP_SERIALIZATION_WRITE_BATCH < count) ? YAJP_SERIALIZATION_WRITE_BATCH : count;
+        for (i = 0; i < count; i++) {
+            batch[i] = chain->segments[index + i];
+        }
+
+        // the first segment can be written partially by previous call
+        batch[0].iov_base = (uint8_t *) batch[0].iov_base + skip;
+        batch[0].iov_len -= skip;
+
+        written = writev(fd, batch, (int) count);
+        if (0 > written) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return -1; // errno set
+        }
+
+        while (0 < written) {
+            rest = chain->segments[index].iov_len - skip;
+            if ((size_t) written < rest) {
+                skip += written;
+                break;
+            }
+
+            written -= (ssize_t) rest;
+            skip = 0;
+            index++;
+        }
+    }
+
+    return 0;
+}
+
+void yajp_serialization_chain_release(yajp_serialization_chain_t *chain) {
+    yajp_serialization_block_t *block, *next;
+
+    if (NULL == chain || NULL == chain->allocator) {
+        return;
+    }
+
+    for (block = chain->blocks; NULL != block; block = next) {
+        next = block->next;
+        chain->allocator->free(block, chain->allocator->user);
+    }
+
+    if (NULL != chain->segments) {
+        chain->allocator->free(chain->segments, chain->allocator->user);
+    }
+
+    memset(chain, 0, sizeof(*chain));
+}
+
+int yajp_serialization_context_set_escape_non_ascii(yajp_deserialization_context_t *ctx, bool escape_non_ascii) {
+    ctx->escape_non_ascii = escape_non_ascii;
+    return 0;
+}
+
+int yajp_serialization_context_set_exact_size(yajp_deserialization_context_t *ctx, bool exact_size) {
+    ctx->exact_size = exact_size;
+    return 0;
+}
+
+yajp_serialization_field_t *yajp_serialization_fields_init(const yajp_deserialization_rule_t *rules, size_t count) {
+    yajp_serialization_field_t *fields;
+    size_t names_size = 0, i;
+    uint8_t *name;
+
+    for (i = 0; i < count; i++) {
+        names_size += rules[i].field_name_size + 3; // quotes and colon
+    }
+
+    // names follow fields in the same memory, one byte is added for context without rules
+    fields = malloc(count * sizeof(*fields) + names_size + 1);
+    if (NULL == fields) {
+        return NULL; // errno set
+    }
+
+    name = (uint8_t *) (fields + count);
+    for (i = 0; i < count; i++) {
+        fields[i].name = name;
+        fields[i].name_size = rules[i].field_name_size + 3;
+        fields[i].value = yajp_serialization_value_of(&rules[i]);
+
+        *name++ = '"';
+        if (0 < rules[i].field_name_size) {
+            memcpy(name, rules[i].field_name, rules[i].field_name_size);
+            name += rules[i].field_name_size;
+        }
+        *name++ = '"';
+        *name++ = ':';
+    }
+
+    return fields;
+}
+
+void yajp_serialization_fields_release(const yajp_serialization_field_t *fields) {
+    free((void *) fields);
+}
+
+/**
+ * Helper function. Serializes structure as root object of document.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param ctx[in]       Context of structure
+ * @param address[in]   Pointer to structure
+ *
+ * @return  Result of serialization. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_serialize(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                          const void *address) {
+    if (NULL == ctx || NULL == ctx->fields || NULL == address) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    out->max_depth = ctx->max_depth;
+    out->escape_non_ascii = ctx->escape_non_ascii;
+
+    return yajp_write_object(out, ctx, address);
+}
+
+/**
+ * Helper function. Measure pass of two-pass serialization. Bytes are counted without copying, strings and numbers
+ * are cached if @p cached is set, so fill pass doesn't scan strings without characters to escape and doesn't search
+ * for the shortest decimals again.
+ *
+ * @param out[in, out]  Pointer to zero initialized output. Its allocator is used by cache
+ * @param ctx[in]       Context of structure
+ * @param address[in]   Pointer to structure
+ * @param cached[in]    Cache should be collected
+ * @param size[out]     Pointer to receive size of document
+ *
+ * @return  Result of measuring. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_serialize_measure(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                                  const void *address, bool cached, size_t *size) {
+    out->measure = true;
+    out->cached = cached;
+    out->buffer = out->scratch;
+    out->capacity = sizeof(out->scratch);
+
+    if (0 != yajp_serialize(out, ctx, address)) {
+        return -1; // errno set
+    }
+
+    *size = out->flushed + out->size;
+
+    return 0;
+}
+
+/**
+ * Helper function. Fill pass of two-pass serialization. Document is written into buffer by cache of measure pass.
+ *
+ * @param out[in, out]  Pointer to output after measure pass
+ * @param ctx[in]       Context of structure
+ * @param address[in]   Pointer to structure
+ * @param buffer[out]   Pointer to buffer
+ * @param capacity[in]  Size of buffer, at least size of document
+ *
+ * @return  Result of filling. 0 - on success, -1 with errno set to ERANGE if document doesn't fit into buffer, i.e.
+ *          structure was changed after measure pass
+ */
+static int yajp_serialize_fill(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                               const void *address, uint8_t *buffer, size_t capacity) {
+    out->measure = false;
+    out->fixed = true;
+    out->buffer = buffer;
+    out->capacity = capacity;
+    out->size = 0;
+    out->flushed = 0;
+    out->depth = 0;
+    out->cache_next = 0;
+
+    return yajp_serialize(out, ctx, address);
+}
+
+/**
+ * Helper function. Serializes structure into string allocated at once by size of measure pass.
+ *
+ * @param out[in, out]      Pointer to zero initialized output with allocator
+ * @param ctx[in]           Context of structure
+ * @param address[in]       Pointer to structure
+ * @param json[out]         Pointer to receive string terminated by '\0'
+ * @param json_size[out]    Pointer to receive size of string without '\0'
+ *
+ * @return  Result of serialization. 0 - on success, -1 with errno set otherwise. Nothing is allocated on error
+ */
+static int yajp_serialize_exact_buffer(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                                       const void *address, char **json, size_t *json_size) {
+    uint8_t *buffer = NULL;
+    int result;
+
+    result = yajp_serialize_measure(out, ctx, address, true, json_size);
+    if (0 == result && NULL == (buffer = out->allocator->alloc(*json_size + 1, out->allocator->user))) {
+        result = -1; // errno set
+    }
+
+    // document is terminated by '\0', which isn't counted in its size
+    if (0 == result &&
+        (0 != yajp_serialize_fill(out, ctx, address, buffer, *json_size + 1) || 0 != yajp_output_put(out, '\0'))) {
+        out->allocator->free(buffer, out->allocator->user);
+        result = -1; // errno set
+    }
+
+    if (NULL != out->cache) {
+        out->allocator->free(out->cache, out->allocator->user);
+    }
+
+    if (0 == result) {
+        *json = (char *) buffer;
+    }
+
+    return result;
+}
+
+/**
+ * Helper function. Chooses writer of field value by its rule. Writer of primitive value is found by setter, because
+ * fields with the same JSON type can have different C types.
+ *
+ * @param rule[in]  Pointer to rule of field
+ *
+ * @return  Writer of field value
+ */
+static yajp_serialization_value_t yajp_serialization_value_of(const yajp_deserialization_rule_t *rule) {
+    yajp_value_setter_t setter = rule->setter;
+
+    if (rule->options & YAJP_DESERIALIZATION_TYPE_OBJECT) {
+        return YAJP_SERIALIZATION_VALUE_OBJECT;
+    } else if (yajp_set_short == setter) {
+        return YAJP_SERIALIZATION_VALUE_SHORT;
+    } else if (yajp_set_int == setter) {
+        return YAJP_SERIALIZATION_VALUE_INT;
+    } else if (yajp_set_long_int == setter) {
+        return YAJP_SERIALIZATION_VALUE_LONG;
+    } else if (yajp_set_long_long_int == setter) {
+        return YAJP_SERIALIZATION_VALUE_LONG_LONG;
+    } else if (yajp_set_float == setter) {
+        return YAJP_SERIALIZATION_VALUE_FLOAT;
+    } else if (yajp_set_double == setter) {
+        return YAJP_SERIALIZATION_VALUE_DOUBLE;
+    } else if (yajp_set_long_double == setter) {
+        return YAJP_SERIALIZATION_VALUE_LONG_DOUBLE;
+    } else if (yajp_set_bool == setter) {
+        return YAJP_SERIALIZATION_VALUE_BOOL;
+    } else if (yajp_set_string == setter) {
+        return YAJP_SERIALIZATION_VALUE_STRING;
+    } else if (yajp_set_interned_string == setter) {
+        return YAJP_SERIALIZATION_VALUE_INTERNED_STRING;
+    } else if (yajp_set_timestamp == setter) {
+        return YAJP_SERIALIZATION_VALUE_TIMESTAMP;
+    } else if (yajp_set_enum == setter) {
+        return YAJP_SERIALIZATION_VALUE_ENUM;
+    } else if (yajp_set_base64 == setter) {
+        return YAJP_SERIALIZATION_VALUE_BASE64;
+    }
+
+    return YAJP_SERIALIZATION_VALUE_UNKNOWN;
+}
+
+/**
+ * Helper function. Writes object with its fields in order of rules of context. Fields what hold NULL, i.e. allocated
+ * values what weren't deserialized, are omitted.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param ctx[in]       Context of object
+ * @param address[in]   Pointer to object
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_write_object(yajp_serialization_output_t *out, const yajp_deserialization_context_t *ctx,
+                             const void *address) {
+    const yajp_serialization_field_t *fields = ctx->fields;
+    const yajp_deserialization_rule_t *rule;
+    const void *value;
+    bool first = true;
+    size_t i;
+
+    if (0 != yajp_enter(out) || 0 != yajp_output_put(out, '{')) {
+        return -1; // errno set
+    }
+
+    for (i = 0; i < ctx->rules_count; i++) {
+        rule = &ctx->rules_list[i];
+        value = address + rule->field_offset;
+
+        if (rule->allocate || YAJP_SERIALIZATION_VALUE_INTERNED_STRING == fields[i].value) {
+            value = *(const void **) value;
+            if (NULL == value) {
+                continue;
+            }
+        }
+
+        if ((!first && 0 != yajp_output_put(out, ',')) ||
+            0 != yajp_output_write(out, fields[i].name, fields[i].name_size)) {
+            return -1; // errno set
+        }
+        first = false;
+
+        if (rule->options & YAJP_DESERIALIZATION_TYPE_ARRAY_OF) {
+            if (0 != yajp_write_array(out, rule, fields[i].value, value)) {
+                return -1;
+            }
+        } else if (0 != yajp_write_value(out, rule, fields[i].value, value,
+                                         rule->inline_string ? rule->field_size : SIZE_MAX)) {
+            return -1;
+        }
+    }
+
+    out->depth--;
+
+    return yajp_output_put(out, '}');
+}
+
+/**
+ * Helper function. Writes array by its holder. Sub-arrays are written by holders of rows.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param rule[in]      Pointer to rule of array
+ * @param kind[in]      Writer of array elements
+ * @param address[in]   Pointer to array holder
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_write_array(yajp_serialization_output_t *out, const yajp_deserialization_rule_t *rule,
+                            yajp_serialization_value_t kind, const void *address) {
+    size_t count = *(const size_t *) (address + rule->counter_offset), i;
+    const void *items, *item;
+    int result;
+
+    if (0 != yajp_enter(out) || 0 != yajp_output_put(out, '[')) {
+        return -1; // errno set
+    }
+
+    if (!*(const bool *) (address + rule->final_dym_offset)) {
+        items = *(const void **) (address + rule->rows_offset);
+        for (i = 0; i < count; i++) {
+            if ((0 < i && 0 != yajp_output_put(out, ',')) ||
+                0 != yajp_write_array(out, rule, kind, items + i * rule->field_size)) {
+                return -1; // errno set
+            }
+        }
+    } else {
+        items = rule->allocate_elems ? *(const void **) (address + rule->elems_offset) : address + rule->elems_offset;
+        for (i = 0; i < count; i++) {
+            if (0 < i && 0 != yajp_output_put(out, ',')) {
+                return -1; // errno set
+            }
+
+            item = items + i * rule->elem_size;
+            if (rule->inline_string) {
+                result = yajp_write_value(out, rule, kind, item, rule->elem_size);
+            } else {
+                // allocated and interned strings are stored by pointers, NULL is left only by failed element
+                if (YAJP_SERIALIZATION_VALUE_STRING == kind || YAJP_SERIALIZATION_VALUE_INTERNED_STRING == kind) {
+                    item = *(const void **) item;
+                }
+
+                result = (NULL != item)
+                        ? yajp_write_value(out, rule, kind, item, SIZE_MAX)
+                        : yajp_output_write(out, "null", sizeof("null") - 1);
+            }
+
+            if (0 != result) {
+                return -1; // errno set
+            }
+        }
+    }
+
+    out->depth--;
+
+    return yajp_output_put(out, ']');
+}
+
+/**
+ * Helper function. Writes object or primitive value.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param rule[in]      Pointer to rule of value
+ * @param kind[in]      Writer of value
+ * @param value[in]     Pointer to value, i.e. to object, number or to the first character of string
+ * @param capacity[in]  Capacity of inline string. SIZE_MAX for strings terminated by '\0'
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set to ENOTSUP if value has custom setter or to EINVAL if
+ *          value can't be represented in JSON
+ */
+static int yajp_write_value(yajp_serialization_output_t *out, const yajp_deserialization_rule_t *rule,
+                            yajp_serialization_value_t kind, const void *value, size_t capacity) {
+    switch (kind) {
+        case YAJP_SERIALIZATION_VALUE_OBJECT:
+            return yajp_write_object(out, rule->ctx, value);
+        case YAJP_SERIALIZATION_VALUE_BOOL:
+            return *(const bool *) value
+                    ? yajp_output_write(out, "true", sizeof("true") - 1)
+                    : yajp_output_write(out, "false", sizeof("false") - 1);
+        case YAJP_SERIALIZATION_VALUE_STRING:
+        case YAJP_SERIALIZATION_VALUE_INTERNED_STRING:
+            return yajp_write_string(out, value, strnlen(value, capacity));
+        case YAJP_SERIALIZATION_VALUE_TIMESTAMP:
+            return yajp_write_timestamp(out, *(const int64_t *) value);
+        case YAJP_SERIALIZATION_VALUE_ENUM:
+            return yajp_write_enum(out, rule->setter_data, *(const int *) value);
+        case YAJP_SERIALIZATION_VALUE_BASE64:
+            return yajp_write_base64(out, rule->setter_data, value);
+        case YAJP_SERIALIZATION_VALUE_UNKNOWN:
+            errno = ENOTSUP;
+            return -1;
+        default:
+            return yajp_write_number(out, kind, value);
+    }
+}
+
+/**
+ * Helper function. Writes string in quotes. Strings are kept by deserialization as they are in JSON, i.e. with escape
+ * sequences, so valid escape sequences are written as is. Quotes, control characters and backslashes what don't start
+ * escape sequence are escaped, non-ASCII characters too if output escapes them. Characters to escape are found by
+ * @c yajp_escape_scan(), runs between them are copied at once.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param string[in]    Pointer to string
+ * @param size[in]      Size of string in bytes
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_write_string(yajp_serialization_output_t *out, const char *string, size_t size) {
+    const uint8_t *chars = (const uint8_t *) string;
+    size_t run = 0, i = 0, start = out->flushed + out->size, sequence, escape_size;
+    yajp_serialization_cached_t *cached;
+    uint8_t escape[12];
+    uint32_t code_point;
+
+    // string of the same size in measure pass has nothing to escape
+    if (out->cached && !out->measure) {
+        if (NULL == (cached = yajp_cache_next(out))) {
+            return -1; // errno set
+        }
+
+        if (cached->size == size) {
+            if (0 != yajp_output_put(out, '"') || 0 != yajp_output_write(out, string, size)) {
+                return -1; // errno set
+            }
+            return yajp_output_put(out, '"');
+        }
+    }
+
+    if (0 != yajp_output_put(out, '"')) {
+        return -1; // errno set
+    }
+
+    for (;;) {
+        i += yajp_escape_scan(chars + i, size - i, out->escape_non_ascii);
+        if (i == size) {
+            break;
+        }
+
+        if ('\\' == chars[i] && 0 != (sequence = yajp_escape_sequence_size(string + i, size - i))) {
+            i += sequence;
+            continue;
+        }
+
+        // clean run is copied at once or referenced by chain
+        if (0 != yajp_output_reference(out, chars + run, i - run)) {
+            return -1; // errno set
+        }
+
+        if (0x80 <= chars[i]) {
+            i += yajp_utf8_decode(chars + i, size - i, &code_point);
+            escape_size = yajp_write_unicode_escape(escape, code_point);
+        } else {
+            escape_size = yajp_write_ascii_escape(escape, chars[i++]);
+        }
+
+        if (0 != yajp_output_write(out, escape, escape_size)) {
+            return -1; // errno set
+        }
+
+        run = i;
+    }
+
+    if (0 != yajp_output_reference(out, chars + run, size - run)) {
+        return -1; // errno set
+    }
+
+    if (out->cached && out->measure) {
+        if (NULL == (cached = yajp_cache_push(out))) {
+            return -1; // errno set
+        }
+        cached->size = out->flushed + out->size - start - 1;
+    }
+
+    return yajp_output_put(out, '"');
+}
+
+/**
+ * Helper function. Finds the first character what should be escaped or starts escape sequence: quote, backslash,
+ * control character and, if @p non_ascii is set, byte of non-ASCII character. String is compared by 16 bytes at once
+ * with SSE2 or NEON instructions, the tail and targets without them are compared by bytes.
+ *
+ * @param string[in]    Pointer to string
+ * @param size[in]      Size of string in bytes
+ * @param non_ascii[in] Bytes of non-ASCII characters should be found too
+ *
+ * @return  Offset of the first found character or @p size if there is no such character
+ */
+static size_t yajp_escape_scan(const uint8_t *string, size_t size, bool non_ascii) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), control = _mm_set1_epi8(0x1f);
+    const __m128i high = _mm_set1_epi8(non_ascii ? (char) 0x80 : 0);
+    __m128i chunk, found;
+    int mask;
+
+    for (; i + 16 <= size; i += 16) {
+        chunk = _mm_loadu_si128((const __m128i *) (string + i));
+
+        // control characters are the ones not changed by unsigned maximum with 0x1f
+        found = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+        found = _mm_or_si128(found, _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+        found = _mm_or_si128(found, _mm_and_si128(chunk, high));
+
+        mask = _mm_movemask_epi8(found);
+        if (0 != mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t quote = vdupq_n_u8('"'), backslash = vdupq_n_u8('\\'), control = vdupq_n_u8(0x20);
+    const uint8x16_t high = vdupq_n_u8(non_ascii ? 0x80 : 0);
+    uint8x16_t chunk, found;
+
+    for (; i + 16 <= size; i += 16) {
+        chunk = vld1q_u8(string + i);
+
+        found = vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash));
+        found = vorrq_u8(found, vcltq_u8(chunk, control));
+        found = vorrq_u8(found, vandq_u8(chunk, high));
+
+        // position in block is found by bytes, block with found character is rare
+        if (0 != vmaxvq_u8(found)) {
+            break;
+        }
+    }
+#endif
+
+    for (; i < size; i++) {
+        if ('"' == string[i] || '\\' == string[i] || 0x20 > string[i] || (non_ascii && 0x80 <= string[i])) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+/**
+ * Helper function. Writes escape sequence of ASCII character.
+ *
+ * @param escape[out]   Pointer to at least 6 bytes of output
+ * @param c[in]         Quote, backslash or control character
+ *
+ * @return  Size of escape sequence in bytes
+ */
+static size_t yajp_write_ascii_escape(uint8_t *escape, uint8_t c) {
+    escape[0] = '\\';
+    switch (c) {
+        case '"': escape[1] = '"'; return 2;
+        case '\\': escape[1] = '\\'; return 2;
+        case '\b': escape[1] = 'b'; return 2;
+        case '\f': escape[1] = 'f'; return 2;
+        case '\n': escape[1] = 'n'; return 2;
+        case '\r': escape[1] = 'r'; return 2;
+        case '\t': escape[1] = 't'; return 2;
+        default: return yajp_write_unicode_escape(escape, c);
+    }
+}
+
+/**
+ * Helper function. Writes \uXXXX escape sequence of Unicode character, characters outside of Basic Multilingual Plane
+ * are written as surrogate pair.
+ *
+ * @param escape[out]       Pointer to at least 12 bytes of output
+ * @param code_point[in]    Code point of character
+ *
+ * @return  Size of escape sequence in bytes
+ */
+static size_t yajp_write_unicode_escape(uint8_t *escape, uint32_t code_point) {
+    static const char hex[] = "0123456789abcdef";
+    uint32_t units[2];
+    size_t count = 1, i;
+
+    if (0x10000 <= code_point) {
+        units[0] = 0xd800 + ((code_point - 0x10000) >> 10);
+        units[1] = 0xdc00 + ((code_point - 0x10000) & 0x3ff);
+        count = 2;
+    } else {
+        units[0] = code_point;
+    }
+
+    for (i = 0; i < count; i++, escape += 6) {
+        escape[0] = '\\';
+        escape[1] = 'u';
+        escape[2] = hex[units[i] >> 12];
+        escape[3] = hex[(units[i] >> 8) & 0x0f];
+        escape[4] = hex[(units[i] >> 4) & 0x0f];
+        escape[5] = hex[units[i] & 0x0f];
+    }
+
+    return count * 6;
+}
+
+/**
+ * Helper function. Decodes UTF-8 sequence. Invalid sequence, i.e. overlong, surrogate, truncated one or stray
+ * continuation byte, is decoded as U+FFFD replacement character by one byte.
+ *
+ * @param string[in]        Pointer to the first byte of sequence, not ASCII one
+ * @param size[in]          Amount of bytes till the end of string
+ * @param code_point[out]   Pointer to receive code point of character
+ *
+ * @return  Size of decoded sequence in bytes
+ */
+static size_t yajp_utf8_decode(const uint8_t *string, size_t size, uint32_t *code_point) {
+    uint8_t lead = string[0], low = 0x80, high = 0xbf;
+    size_t length, i;
+
+    if (0xc2 <= lead && 0xdf >= lead) {
+        length = 2;
+        *code_point = lead & 0x1f;
+    } else if (0xe0 <= lead && 0xef >= lead) {
+        length = 3;
+        *code_point = lead & 0x0f;
+        low = (0xe0 == lead) ? 0xa0 : low;
+        high = (0xed == lead) ? 0x9f : high;
+    } else if (0xf0 <= lead && 0xf4 >= lead) {
+        length = 4;
+        *code_point = lead & 0x07;
+        low = (0xf0 == lead) ? 0x90 : low;
+        high = (0xf4 == lead) ? 0x8f : high;
+    } else {
+        length = 0;
+    }
+
+    if (0 == length || length > size) {
+        *code_point = 0xfffd;
+        return 1;
+    }
+
+    // only the second byte has narrower range, what excludes overlong sequences, surrogates and code points above
+    // U+10FFFF
+    for (i = 1; i < length; i++) {
+        if (string[i] < low || string[i] > high) {
+            *code_point = 0xfffd;
+            return 1;
+        }
+        *code_point = (*code_point << 6) | (string[i] & 0x3f);
+        low = 0x80;
+        high = 0xbf;
+    }
+
+    return length;
+}
+
+/**
+ * Helper function. Checks whether backslash starts valid JSON escape sequence.
+ *
+ * @param string[in]    Pointer to backslash
+ * @param size[in]      Amount of bytes from backslash till the end of string
+ *
+ * @return  Size of escape sequence in bytes or 0 if it's invalid
+ */
+static size_t yajp_escape_sequence_size(const char *string, size_t size) {
+    size_t i;
+
+    if (2 > size) {
+        return 0;
+    }
+
+    switch (string[1]) {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            return 2;
+        case 'u':
+            if (6 > size) {
+                return 0;
+            }
+            for (i = 2; i < 6; i++) {
+                if (!(('0' <= string[i] && '9' >= string[i]) || ('a' <= (string[i] | 0x20) && 'f' >= (string[i] | 0x20)))) {
+                    return 0;
+                }
+            }
+            return 6;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Helper function. Writes number.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param kind[in]      Writer of number, defines C type of value
+ * @param value[in]     Pointer to number
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set to EINVAL if number is infinite or NaN
+ */
+static int yajp_write_number(yajp_serialization_output_t *out, yajp_serialization_value_t kind, const void *value) {
+    char cursor[YAJP_SERIALIZATION_VALUE_SIZE];
+    yajp_serialization_cached_t *cached;
+    yajp_decimal_t decimal;
+    long double real;
+    size_t size;
+
+    switch (kind) {
+        case YAJP_SERIALIZATION_VALUE_SHORT:
+            size = yajp_format_integer(*(const short *) value, cursor);
+            break;
+        case YAJP_SERIALIZATION_VALUE_INT:
+            size = yajp_format_integer(*(const int *) value, cursor);
+            break;
+        case YAJP_SERIALIZATION_VALUE_LONG:
+            size = yajp_format_integer(*(const long *) value, cursor);
+            break;
+        case YAJP_SERIALIZATION_VALUE_LONG_LONG:
+            size = yajp_format_integer(*(const long long *) value, cursor);
+            break;
+        default:
+            real = (YAJP_SERIALIZATION_VALUE_FLOAT == kind) ? *(const float *) value
+                 : (YAJP_SERIALIZATION_VALUE_DOUBLE == kind) ? *(const double *) value
+                 : *(const long double *) value;
+
+            // JSON has no infinities and NaN
+            if (!isfinite(real)) {
+                errno = EINVAL;
+                return -1;
+            }
+
+            if (YAJP_SERIALIZATION_VALUE_LONG_DOUBLE == kind) {
+                // the shortest representation isn't searched for extended precision, precision is enough to read it
+                size = snprintf(cursor, YAJP_SERIALIZATION_VALUE_SIZE, "%.21Lg", real);
+                break;
+            }
+
+            // the shortest representations are read back to the same value by setters, fill pass takes them from
+            // measure pass
+            if (out->cached && !out->measure) {
+                if (NULL == (cached = yajp_cache_next(out))) {
+                    return -1; // errno set
+                }
+                decimal = cached->decimal;
+            } else {
+                if (YAJP_SERIALIZATION_VALUE_FLOAT == kind) {
+                    yajp_decimal_of_float(*(const float *) value, &decimal);
+                } else {
+                    yajp_decimal_of_double(*(const double *) value, &decimal);
+                }
+
+                if (out->cached) {
+                    if (NULL == (cached = yajp_cache_push(out))) {
+                        return -1; // errno set
+                    }
+                    cached->decimal = decimal;
+                }
+            }
+
+            size = yajp_format_decimal(&decimal, cursor);
+            break;
+    }
+
+    return yajp_output_write(out, cursor, size);
+}
+
+/**
+ * Helper function. Writes timestamp as UTC time in format accepted by @c yajp_set_timestamp(). Fraction is written
+ * without trailing zeros and is omitted for whole seconds.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param timestamp[in] Nanoseconds since the epoch
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_write_timestamp(yajp_serialization_output_t *out, int64_t timestamp) {
+#define NANOSECONDS         1000000000LL
+#define SECONDS_PER_DAY     86400LL
+    char cursor[YAJP_SERIALIZATION_VALUE_SIZE];
+    int64_t seconds = timestamp / NANOSECONDS, fraction = timestamp % NANOSECONDS, days, era, day_of_era, year_of_era;
+    int64_t day_of_year, month_index, year, month, day, size, digits = 9;
+
+    if (0 > fraction) {
+        fraction += NANOSECONDS;
+        seconds--;
+    }
+
+    days = seconds / SECONDS_PER_DAY;
+    seconds %= SECONDS_PER_DAY;
+    if (0 > seconds) {
+        seconds += SECONDS_PER_DAY;
+        days--;
+    }
+
+    // civil date of days since the epoch in proleptic Gregorian calendar, eras of 400 years start on March 1
+    days += 719468;
+    era = (0 <= days ? days : days - 146096) / 146097;
+    day_of_era = days - era * 146097;
+    year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    month_index = (5 * day_of_year + 2) / 153;
+    day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    month = (10 > month_index) ? month_index + 3 : month_index - 9;
+    year = year_of_era + era * 400 + (2 >= month ? 1 : 0);
+
+    size = snprintf(cursor, YAJP_SERIALIZATION_VALUE_SIZE, "\"%04d-%02d-%02dT%02d:%02d:%02d", (int) year, (int) month,
+                    (int) day, (int) (seconds / 3600), (int) (seconds / 60 % 60), (int) (seconds % 60));
+
+    if (0 != fraction) {
+        while (0 == fraction % 10) {
+            fraction /= 10;
+            digits--;
+        }
+        size += snprintf(cursor + size, YAJP_SERIALIZATION_VALUE_SIZE - size, ".%0*d", (int) digits, (int) fraction);
+    }
+
+    cursor[size++] = 'Z';
+    cursor[size++] = '"';
+
+    return yajp_output_write(out, cursor, size);
+
+#undef SECONDS_PER_DAY
+#undef NANOSECONDS
+}
+
+/**
+ * Helper function. Writes name of enumeration item by its value.
+ *
+ * @param out[in, out]      Pointer to output
+ * @param enumeration[in]   Pointer to enumeration bound to rule
+ * @param value[in]         Value of field
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set to EINVAL if enumeration has no item with the value
+ */
+static int yajp_write_enum(yajp_serialization_output_t *out, const yajp_deserialization_enum_t *enumeration,
+                           int value) {
+    size_t i;
+
+    if (NULL == enumeration) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (i = 0; i < enumeration->count; i++) {
+        if (enumeration->items[i].value == value) {
+            // names of items are compared with JSON strings as they are, so they are written without escaping
+            if (0 != yajp_output_put(out, '"') ||
+                0 != yajp_output_write(out, enumeration->items[i].name, enumeration->items[i].name_size)) {
+                return -1; // errno set
+            }
+            return yajp_output_put(out, '"');
+        }
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+/**
+ * Helper function. Writes binary field in base64 encoding with padding.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param base64[in]    Pointer to description of field bound to rule
+ * @param value[in]     Pointer to array of bytes
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_write_base64(yajp_serialization_output_t *out, const yajp_deserialization_base64_t *base64,
+                             const uint8_t *value) {
+    static const char digits[2][65] = {
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+    };
+    const char *alphabet;
+    size_t size, i;
+    uint32_t group;
+    uint8_t *cursor;
+
+    if (NULL == base64 || YAJP_DESERIALIZATION_BASE64_URL < (unsigned) base64->alphabet) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    alphabet = digits[base64->alphabet];
+    size = *(const size_t *) (value + base64->size_offset);
+    if (size > base64->capacity) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (0 != yajp_output_put(out, '"')) {
+        return -1; // errno set
+    }
+
+    for (i = 0; i < size; i += 3) {
+        cursor = yajp_output_reserve(out, 4);
+        if (NULL == cursor) {
+            return -1; // errno set
+        }
+
+        group = (uint32_t) value[i] << 16;
+        if (i + 1 < size) {
+            group |= (uint32_t) value[i + 1] << 8;
+        }
+        if (i + 2 < size) {
+            group |= value[i + 2];
+        }
+
+        cursor[0] = alphabet[(group >> 18) & 0x3f];
+        cursor[1] = alphabet[(group >> 12) & 0x3f];
+        cursor[2] = (i + 1 < size) ? alphabet[(group >> 6) & 0x3f] : '=';
+        cursor[3] = (i + 2 < size) ? alphabet[group & 0x3f] : '=';
+        out->size += 4;
+    }
+
+    return yajp_output_put(out, '"');
+}
+
+/**
+ * Helper function. Counts nesting level of object or array what is written.
+ *
+ * @param out[in, out]  Pointer to output
+ *
+ * @return  0 - if level is allowed, -1 with errno set to EOVERFLOW if document is deeper than maximal depth of
+ *          context, i.e. structures are linked in cycle
+ */
+static int yajp_enter(yajp_serialization_output_t *out) {
+    if (out->depth >= out->max_depth) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+
+    out->depth++;
+
+    return 0;
+}
+
+/**
+ * Helper function. Provides space for bytes in output. Bytes are written directly to buffer and counted by caller.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param size[in]      Amount of bytes. Should be less than size of stream buffer
+ *
+ * @return  Pointer to space or NULL with errno set
+ */
+static uint8_t *yajp_output_reserve(yajp_serialization_output_t *out, size_t size) {
+    if (out->capacity - out->size < size) {
+        if (NULL != out->stream || out->measure) {
+            if (0 != yajp_output_flush(out)) {
+                return NULL; // errno set
+            }
+        } else if (out->fixed) {
+            errno = ERANGE;
+            return NULL;
+        } else if (NULL != out->chain) {
+            if (0 != yajp_output_next_block(out, size)) {
+                return NULL; // errno set
+            }
+        } else if (0 != yajp_output_grow(out, size)) {
+            return NULL; // errno set
+        }
+    }
+
+    return out->buffer + out->size;
+}
+
+/**
+ * Helper function. Writes bytes to output. Data bigger than stream buffer is written to stream directly, measure pass
+ * only counts bytes.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param data[in]      Pointer to bytes
+ * @param size[in]      Amount of bytes
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_output_write(yajp_serialization_output_t *out, const void *data, size_t size) {
+    if (out->measure) {
+        out->flushed += size;
+        return 0;
+    }
+
+    if (out->capacity - out->size < size) {
+        if (out->fixed) {
+            errno = ERANGE;
+            return -1;
+        } else if (NULL != out->chain) {
+            if (0 != yajp_output_next_block(out, size)) {
+                return -1; // errno set
+            }
+        } else if (NULL == out->stream) {
+            if (0 != yajp_output_grow(out, size)) {
+                return -1; // errno set
+            }
+        } else {
+            if (0 != yajp_output_flush(out)) {
+                return -1; // errno set
+            }
+
+            if (out->capacity < size) {
+                if (size != fwrite(data, 1, size, out->stream)) {
+                    errno = EIO;
+                    return -1;
+                }
+                out->flushed += size;
+                return 0;
+            }
+        }
+    }
+
+    if (0 < size) {
+        memcpy(out->buffer + out->size, data, size);
+        out->size += size;
+    }
+
+    return 0;
+}
+
+/**
+ * Helper function. Writes bytes what stay unchanged till the end of serialization, i.e. run of string of serialized
+ * structure. Chain references run if it's long enough, so it's not copied, other outputs copy it.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param data[in]      Pointer to bytes
+ * @param size[in]      Amount of bytes
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_output_reference(yajp_serialization_output_t *out, const void *data, size_t size) {
+    if (NULL == out->chain || out->reference_size > size || 0 == size) {
+        return yajp_output_write(out, data, size);
+    }
+
+    // bytes generated before run become segment of their own
+    if (0 != yajp_output_close_segment(out)) {
+        return -1; // errno set
+    }
+
+    return yajp_chain_append(out->chain, data, size);
+}
+
+/**
+ * Helper function. Writes one byte to output.
+ *
+ * @param out[in, out]  Pointer to output
+ * @param c[in]         Byte
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_output_put(yajp_serialization_output_t *out, uint8_t c) {
+    uint8_t *cursor = yajp_output_reserve(out, 1);
+
+    if (NULL == cursor) {
+        return -1; // errno set
+    }
+
+    *cursor = c;
+    out->size++;
+
+    return 0;
+}
+
+/**
+ * Helper function. Writes buffer of output to stream or counts it by measure pass.
+ *
+ * @param out[in, out]  Pointer to output with stream or of measure pass
+ *
+ * @return  Result of writing. 0 - on success, -1 with errno set to EIO if stream can't be written
+ */
+static int yajp_output_flush(yajp_serialization_output_t *out) {
+    if (NULL != out->stream && 0 < out->size && out->size != fwrite(out->buffer, 1, out->size, out->stream)) {
+        errno = EIO;
+        return -1;
+    }
+
+    out->flushed += out->size;
+    out->size = 0;
+
+    return 0;
+}
+
+/**
+ * Helper function. Grows buffer of document kept in memory geometrically.
+ *
+ * @param out[in, out]  Pointer to output without stream
+ * @param size[in]      Amount of bytes what should fit into buffer after its used part
+ *
+ * @return  Result of growing. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_output_grow(yajp_serialization_output_t *out, size_t size) {
+    size_t capacity = (0 < out->capacity) ? out->capacity : YAJP_SERIALIZATION_INITIAL_SIZE;
+    uint8_t *buffer;
+
+    while (capacity - out->size < size) {
+        capacity *= 2;
+    }
+
+    buffer = out->allocator->realloc(out->buffer, out->capacity, capacity, out->allocator->user);
+    if (NULL == buffer) {
+        return -1; // errno set
+    }
+
+    out->buffer = buffer;
+    out->capacity = capacity;
+
+    return 0;
+}
+
+/**
+ * Helper function. Starts new block of chain, bytes of current block become segment. Blocks grow geometrically up to
+ * size of stream buffer.
+ *
+ * @param out[in, out]  Pointer to output with chain
+ * @param size[in]      Amount of bytes what should fit into new block
+ *
+ * @return  Result of allocation. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_output_next_block(yajp_serialization_output_t *out, size_t size) {
+    size_t capacity = (0 < out->capacity) ? 2 * out->capacity : YAJP_SERIALIZATION_INITIAL_SIZE;
+    yajp_serialization_block_t *block;
+
+    if (0 != yajp_output_close_segment(out)) {
+        return -1; // errno set
+    }
+
+    capacity = (YAJP_SERIALIZATION_BUFFER_SIZE < capacity) ? YAJP_SERIALIZATION_BUFFER_SIZE : capacity;
+    capacity = (size > capacity) ? size : capacity;
+
+    block = out->allocator->alloc(sizeof(*block) + capacity, out->allocator->user);
+    if (NULL == block) {
+        return -1; // errno set
+    }
+
+    block->next = out->chain->blocks;
+    out->chain->blocks = block;
+
+    out->buffer = block->data;
+    out->capacity = capacity;
+    out->size = 0;
+    out->segment_start = 0;
+
+    return 0;
+}
+
+/**
+ * Helper function. Adds bytes written to current block since the last segment to chain as segment.
+ *
+ * @param out[in, out]  Pointer to output with chain
+ *
+ * @return  Result of adding. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_output_close_segment(yajp_serialization_output_t *out) {
+    if (out->size == out->segment_start) {
+        return 0;
+    }
+
+    if (0 != yajp_chain_append(out->chain, out->buffer + out->segment_start, out->size - out->segment_start)) {
+        return -1; // errno set
+    }
+
+    out->segment_start = out->size;
+
+    return 0;
+}
+
+/**
+ * Helper function. Adds segment to the end of chain.
+ *
+ * @param chain[in, out]    Pointer to chain
+ * @param data[in]          Pointer to bytes of segment
+ * @param size[in]          Amount of bytes of segment
+ *
+ * @return  Result of adding. 0 - on success, -1 with errno set otherwise
+ */
+static int yajp_chain_append(yajp_serialization_chain_t *chain, const void *data, size_t size) {
+    size_t capacity;
+    struct iovec *segments;
+
+    if (chain->count == chain->capacity) {
+        capacity = (0 < chain->capacity) ? 2 * chain->capacity : YAJP_SERIALIZATION_INITIAL_SEGMENTS;
+        segments = chain->allocator->realloc(chain->segments, chain->capacity * sizeof(*segments),
+                                             capacity * sizeof(*segments), chain->allocator->user);
+        if (NULL == segments) {
+            return -1; // errno set
+        }
+
+        chain->segments = segments;
+        chain->capacity = capacity;
+    }
+
+    chain->segments[chain->count].iov_base = (void *) data;
+    chain->segments[chain->count].iov_len = size;
+    chain->count++;
+    chain->size += size;
+
+    return 0;
+}
+
+/**
+ * Helper function. Adds entry to the end of cache of measure pass.
+ *
+ * @param out[in, out]  Pointer to output of measure pass
+ *
+ * @return  Pointer to entry or NULL with errno set
+ */
+static yajp_serialization_cached_t *yajp_cache_push(yajp_serialization_output_t *out) {
+    size_t capacity;
+    yajp_serialization_cached_t *cache;
+
+    if (out->cache_count == out->cache_capacity) {
+        capacity = (0 < out->cache_capacity) ? 2 * out->cache_capacity : YAJP_SERIALIZATION_INITIAL_CACHE;
+        cache = out->allocator->realloc(out->cache, out->cache_capacity * sizeof(*cache), capacity * sizeof(*cache),
+                                        out->allocator->user);
+        if (NULL == cache) {
+            return NULL; // errno set
+        }
+
+        out->cache = cache;
+        out->cache_capacity = capacity;
+    }
+
+    return &out->cache[out->cache_count++];
+}
+
+/**
+ * Helper function. Takes the next entry of cache by fill pass.
+ *
+ * @param out[in, out]  Pointer to output of fill pass
+ *
+ * @return  Pointer to entry or NULL with errno set to ERANGE if cache is over, i.e. structure was changed after
+ *          measure pass
+ */
+static yajp_serialization_cached_t *yajp_cache_next(yajp_serialization_output_t *out) {
+    if (out->cache_next == out->cache_count) {
+        errno = ERANGE;
+        return NULL;
+    }
+
+    return &out->cache[out->cache_next++];
+}
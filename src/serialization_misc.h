@@ -0,0 +1,77 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * serialization_misc.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_SERIALIZATION_MISC_H
+#define YAJP_SERIALIZATION_MISC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "yajp/deserialization.h"
+
+/**
+ * Writer of value of field. Is chosen by setter of rule, because setter defines C type of field
+ */
+typedef enum yajp_serialization_value {
+    YAJP_SERIALIZATION_VALUE_UNKNOWN = 0,       // custom setter, value can't be written
+    YAJP_SERIALIZATION_VALUE_SHORT,
+    YAJP_SERIALIZATION_VALUE_INT,
+    YAJP_SERIALIZATION_VALUE_LONG,
+    YAJP_SERIALIZATION_VALUE_LONG_LONG,
+    YAJP_SERIALIZATION_VALUE_FLOAT,
+    YAJP_SERIALIZATION_VALUE_DOUBLE,
+    YAJP_SERIALIZATION_VALUE_LONG_DOUBLE,
+    YAJP_SERIALIZATION_VALUE_BOOL,
+    YAJP_SERIALIZATION_VALUE_STRING,            // array of characters or pointer to it if rule allocates value
+    YAJP_SERIALIZATION_VALUE_INTERNED_STRING,   // pointer to string owned by pool
+    YAJP_SERIALIZATION_VALUE_TIMESTAMP,
+    YAJP_SERIALIZATION_VALUE_ENUM,
+    YAJP_SERIALIZATION_VALUE_BASE64,
+    YAJP_SERIALIZATION_VALUE_OBJECT,
+} yajp_serialization_value_t;
+
+/**
+ * Field of serialized object. Fields of context are stored in order of its rules
+ */
+typedef struct yajp_serialization_field {
+    const uint8_t *name;                        // pre-encoded "name": of field
+    size_t name_size;                           // size of encoded name in bytes
+    yajp_serialization_value_t value;           // writer of field value
+} yajp_serialization_field_t;
+
+/**
+ * Encode names of rules and choose writers of their values. Fields and their names are allocated at once.
+ *
+ * @param rules[in]     Pointer to array of rules of context
+ * @param count[in]     Amount of rules
+ *
+ * @return  Pointer to array of @p count fields or NULL with errno set if memory can't be allocated
+ */
+yajp_serialization_field_t *yajp_serialization_fields_init(const yajp_deserialization_rule_t *rules, size_t count);
+
+/**
+ * Release fields created by @c yajp_serialization_fields_init()
+ *
+ * @param fields[in]    Pointer to array of fields or NULL
+ */
+void yajp_serialization_fields_release(const yajp_serialization_field_t *fields);
+
+#endif //YAJP_SERIALIZATION_MISC_H
@@ -0,0 +1,374 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * worker_pool.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "worker_pool.h"
+
+typedef struct yajp_worker {
+    pthread_t thread;
+    int index;
+    yajp_worker_routine_t routine;
+    void *arg;
+} yajp_worker_t;
+
+/**
+ * Threads kept between runs. Thread with index i works in run with at least i + 1 workers
+ */
+typedef struct yajp_worker_pool {
+    pthread_mutex_t lock;               // guards fields below
+    pthread_cond_t run_cond;            // signaled when run starts
+    pthread_cond_t done_cond;           // signaled when the last thread of run finishes
+    bool busy;                          // run is in progress
+    int threads;                        // amount of started threads
+    unsigned long generation;           // incremented by every run
+    int helpers;                        // amount of threads what work in current run
+    int running;                        // amount of threads what haven't finished current run yet
+    yajp_worker_routine_t routine;
+    void *arg;
+} yajp_worker_pool_t;
+
+/**
+ * Start argument of pool thread
+ */
+typedef struct yajp_pool_thread {
+    int index;
+    unsigned long generation;           // generation of the last run before thread start
+} yajp_pool_thread_t;
+
+static yajp_worker_pool_t yajp_pool = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .run_cond = PTHREAD_COND_INITIALIZER,
+        .done_cond = PTHREAD_COND_INITIALIZER,
+};
+
+/**
+ * Part of items owned by worker. Aligned by cache line, so workers don't share lines of their parts
+ */
+typedef struct yajp_work_range {
+    alignas(64) pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+} yajp_work_range_t;
+
+typedef struct yajp_range_job {
+    yajp_work_range_t *ranges;
+    int nworkers;
+    size_t grain;
+    yajp_range_routine_t routine;
+    void *arg;
+} yajp_range_job_t;
+
+static int yajp_worker_pool_spawn(int nworkers, yajp_worker_routine_t routine, void *arg);
+
+static void yajp_worker_pool_grow(int nthreads);
+
+static void *yajp_pool_thread_main(void *arg);
+
+static void *yajp_worker_main(void *arg);
+
+static void yajp_range_worker(int worker, void *arg);
+
+static bool yajp_take_range(yajp_work_range_t *range, size_t grain, size_t *begin, size_t *end);
+
+static bool yajp_steal_range(yajp_range_job_t *job, int thief);
+
+int yajp_worker_pool_size(int nthreads) {
+    long online;
+
+    if (0 >= nthreads) {
+        online = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (0 < online && YAJP_WORKER_POOL_MAX_SIZE > online) ? (int) online : YAJP_WORKER_POOL_MAX_SIZE;
+    }
+
+    return (YAJP_WORKER_POOL_MAX_SIZE > nthreads) ? nthreads : YAJP_WORKER_POOL_MAX_SIZE;
+}
+
+int yajp_worker_pool_run(int nworkers, yajp_worker_routine_t routine, void *arg) {
+    int helpers;
+
+    if (1 >= nworkers) {
+        routine(0, arg);
+        return 1;
+    }
+
+    pthread_mutex_lock(&yajp_pool.lock);
+    if (yajp_pool.busy) {
+        pthread_mutex_unlock(&yajp_pool.lock);
+        return yajp_worker_pool_spawn(nworkers, routine, arg);
+    }
+
+    yajp_pool.busy = true;
+    yajp_worker_pool_grow(nworkers - 1);
+
+    // threads what can't be started are skipped, calling thread does their work
+    helpers = (yajp_pool.threads < nworkers - 1) ? yajp_pool.threads : nworkers - 1;
+    yajp_pool.helpers = helpers;
+    yajp_pool.running = helpers;
+    yajp_pool.routine = routine;
+    yajp_pool.arg = arg;
+    yajp_pool.generation++;
+    pthread_cond_broadcast(&yajp_pool.run_cond);
+    pthread_mutex_unlock(&yajp_pool.lock);
+
+    routine(0, arg);
+
+    pthread_mutex_lock(&yajp_pool.lock);
+    while (0 < yajp_pool.running) {
+        pthread_cond_wait(&yajp_pool.done_cond, &yajp_pool.lock);
+    }
+    yajp_pool.busy = false;
+    pthread_mutex_unlock(&yajp_pool.lock);
+
+    return helpers + 1;
+}
+
+/**
+ * Helper function. Runs routine on threads started for this run only. Used when pool is busy.
+ *
+ * @param nworkers[in]  Amount of workers
+ * @param routine[in]   Routine of workers
+ * @param arg[in]       Argument passed to routine
+ *
+ * @return  Amount of workers what were run
+ */
+static int yajp_worker_pool_spawn(int nworkers, yajp_worker_routine_t routine, void *arg) {
+    yajp_worker_t *workers = NULL;
+    int started = 0, i;
+
+    if (1 < nworkers) {
+        workers = malloc((nworkers - 1) * sizeof(*workers));
+    }
+
+    // threads what can't be started are skipped, calling thread does their work
+    for (i = 0; NULL != workers && i < nworkers - 1; i++) {
+        workers[started].index = started + 1;
+        workers[started].routine = routine;
+        workers[started].arg = arg;
+
+        if (0 == pthread_create(&workers[started].thread, NULL, yajp_worker_main, &workers[started])) {
+            started++;
+        }
+    }
+
+    routine(0, arg);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    free(workers);
+
+    return started + 1;
+}
+
+int yajp_worker_pool_run_ranges(int nworkers, size_t count, size_t grain, yajp_range_routine_t routine, void *arg) {
+    yajp_range_job_t job;
+    int i;
+
+    job.ranges = aligned_alloc(alignof(yajp_work_range_t), nworkers * sizeof(*job.ranges));
+    if (NULL == job.ranges) {
+        return -1; // errno set
+    }
+
+    job.nworkers = nworkers;
+    job.grain = grain;
+    job.routine = routine;
+    job.arg = arg;
+
+    for (i = 0; i < nworkers; i++) {
+        pthread_mutex_init(&job.ranges[i].lock, NULL);
+        job.ranges[i].begin = count / nworkers * i + ((size_t) i < count % nworkers ? (size_t) i : count % nworkers);
+        job.ranges[i].end = job.ranges[i].begin + count / nworkers + ((size_t) i < count % nworkers);
+    }
+
+    // parts of workers what weren't started are stolen by others
+    yajp_worker_pool_run(nworkers, yajp_range_worker, &job);
+
+    for (i = 0; i < nworkers; i++) {
+        pthread_mutex_destroy(&job.ranges[i].lock);
+    }
+    free(job.ranges);
+
+    return 0;
+}
+
+/**
+ * Helper function. Starts threads of pool up to requested amount. Called under lock of pool.
+ *
+ * @param nthreads[in]  Requested amount of threads
+ */
+static void yajp_worker_pool_grow(int nthreads) {
+    yajp_pool_thread_t *start;
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (YAJP_WORKER_POOL_MAX_SIZE - 1 < nthreads) {
+        nthreads = YAJP_WORKER_POOL_MAX_SIZE - 1;
+    }
+
+    if (yajp_pool.threads >= nthreads || 0 != pthread_attr_init(&attr)) {
+        return;
+    }
+
+    // threads live till process exits, nobody joins them
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (yajp_pool.threads < nthreads) {
+        start = malloc(sizeof(*start));
+        if (NULL == start) {
+            break;
+        }
+
+        start->index = yajp_pool.threads + 1;
+        start->generation = yajp_pool.generation;
+
+        if (0 != pthread_create(&thread, &attr, yajp_pool_thread_main, start)) {
+            free(start);
+            break;
+        }
+        yajp_pool.threads++;
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+/**
+ * Helper function. Main function of pool thread: waits for runs and works in those what need it.
+ *
+ * @param arg[in]   Pointer to start argument. Released by thread
+ *
+ * @return  Never returns
+ */
+static void *yajp_pool_thread_main(void *arg) {
+    yajp_pool_thread_t *start = arg;
+    int index = start->index;
+    unsigned long generation = start->generation;
+    yajp_worker_routine_t routine;
+    void *routine_arg;
+
+    free(start);
+
+    pthread_mutex_lock(&yajp_pool.lock);
+    for (;;) {
+        while (generation == yajp_pool.generation) {
+            pthread_cond_wait(&yajp_pool.run_cond, &yajp_pool.lock);
+        }
+        generation = yajp_pool.generation;
+
+        if (index > yajp_pool.helpers) {
+            continue;
+        }
+
+        routine = yajp_pool.routine;
+        routine_arg = yajp_pool.arg;
+        pthread_mutex_unlock(&yajp_pool.lock);
+
+        routine(index, routine_arg);
+
+        pthread_mutex_lock(&yajp_pool.lock);
+        if (0 == --yajp_pool.running) {
+            pthread_cond_signal(&yajp_pool.done_cond);
+        }
+    }
+
+    return NULL;
+}
+
+static void *yajp_worker_main(void *arg) {
+    yajp_worker_t *worker = arg;
+
+    worker->routine(worker->index, worker->arg);
+    return NULL;
+}
+
+static void yajp_range_worker(int worker, void *arg) {
+    yajp_range_job_t *job = arg;
+    yajp_work_range_t *own = &job->ranges[worker];
+    size_t begin, end;
+
+    while (yajp_take_range(own, job->grain, &begin, &end) || yajp_steal_range(job, worker)) {
+        if (begin < end) {
+            job->routine(worker, begin, end, job->arg);
+        }
+    }
+}
+
+/**
+ * Helper function. Takes items from front of part of worker.
+ *
+ * @param range[in, out]    Part of worker
+ * @param grain[in]         Amount of items taken at once
+ * @param begin[out]        Index of first taken item
+ * @param end[out]          Index of item following taken ones
+ *
+ * @return  true - if items were taken, false - if part is empty
+ */
+static bool yajp_take_range(yajp_work_range_t *range, size_t grain, size_t *begin, size_t *end) {
+    pthread_mutex_lock(&range->lock);
+    *begin = range->begin;
+    *end = (range->end - range->begin > grain) ? range->begin + grain : range->end;
+    range->begin = *end;
+    pthread_mutex_unlock(&range->lock);
+
+    return *begin < *end;
+}
+
+/**
+ * Helper function. Moves back half of part of the first non-empty worker after thief into part of thief.
+ *
+ * @param job[in, out]  Pointer to job
+ * @param thief[in]     Index of worker what ran out of items
+ *
+ * @return  true - if items were stolen, false - if parts of all workers are empty
+ */
+static bool yajp_steal_range(yajp_range_job_t *job, int thief) {
+    yajp_work_range_t *victim, *own = &job->ranges[thief];
+    size_t begin, end;
+    int i;
+
+    for (i = 1; i < job->nworkers; i++) {
+        victim = &job->ranges[(thief + i) % job->nworkers];
+
+        pthread_mutex_lock(&victim->lock);
+        end = victim->end;
+        begin = end - (end - victim->begin) / 2;
+        if (begin == end && victim->begin < end) {
+            begin = victim->begin; // the last item
+        }
+        victim->end = begin;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (begin < end) {
+            pthread_mutex_lock(&own->lock);
+            own->begin = begin;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+
+    return false;
+}
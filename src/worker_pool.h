@@ -0,0 +1,86 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * worker_pool.h
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#ifndef YAJP_WORKER_POOL_H
+#define YAJP_WORKER_POOL_H
+
+#include <stddef.h>
+
+/**
+ * Maximal amount of workers, including calling thread. Bigger requests are clamped
+ */
+#define YAJP_WORKER_POOL_MAX_SIZE   64
+
+/**
+ * Routine run by every worker of pool
+ *
+ * @param[in]   worker  Index of worker, from 0 to amount of workers - 1. Calling thread is worker 0
+ * @param[in]   arg     Argument passed to pool
+ */
+typedef void (*yajp_worker_routine_t)(int worker, void *arg);
+
+/**
+ * Get amount of workers pool runs for requested amount of threads.
+ *
+ * @param[in]   nthreads    Requested amount of threads. 0 or less - amount of online processors
+ * @return      Amount of workers, from 1 to YAJP_WORKER_POOL_MAX_SIZE
+ */
+int yajp_worker_pool_size(int nthreads);
+
+/**
+ * Run routine on pool of workers and wait until all of them finish. Calling thread works as one of workers, so pool of
+ * single worker doesn't start threads. Threads of pool are started on first use and wait for the next run after it,
+ * so they keep their thread-local memory between runs. Run what finds pool busy, i.e. nested run or run of another
+ * thread, starts its own threads for this run only.
+ *
+ * @param[in]   nworkers    Amount of workers. Should be at least 1
+ * @param[in]   routine     Routine of workers
+ * @param[in]   arg         Argument passed to routine
+ * @return      Amount of workers what were run. Less than @p nworkers if some threads couldn't be started, so
+ *              routines should share work dynamically instead of relying on amount of workers
+ */
+int yajp_worker_pool_run(int nworkers, yajp_worker_routine_t routine, void *arg);
+
+/**
+ * Routine run by worker of pool on range of items
+ *
+ * @param[in]   worker  Index of worker
+ * @param[in]   begin   Index of first item of range
+ * @param[in]   end     Index of item following range
+ * @param[in]   arg     Argument passed to pool
+ */
+typedef void (*yajp_range_routine_t)(int worker, size_t begin, size_t end, void *arg);
+
+/**
+ * Run routine on items from 0 to @p count - 1 on pool of workers with work stealing. Every worker owns contiguous part
+ * of items and takes from its front by @p grain items, worker what runs out of items steals back half of part of
+ * other worker. So neighbour items are usually handled by one worker, and slow items don't stall pool.
+ *
+ * @param[in]   nworkers    Amount of workers. Should be at least 1
+ * @param[in]   count       Amount of items
+ * @param[in]   grain       Amount of items taken at once. Should be at least 1
+ * @param[in]   routine     Routine of workers
+ * @param[in]   arg         Argument passed to routine
+ * @return      Result of run. 0 - on success, -1 with errno set if memory can't be allocated. Then routine isn't called
+ */
+int yajp_worker_pool_run_ranges(int nworkers, size_t count, size_t grain, yajp_range_routine_t routine, void *arg);
+
+#endif //YAJP_WORKER_POOL_H
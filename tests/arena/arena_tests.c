@@ -0,0 +1,203 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * arena_tests.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test_common.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdalign.h>
+#include <string.h>
+
+#include "yajp/arena.h"
+
+/* test cases prototypes */
+static test_result_t yajp_arena_test_alloc_alignment();
+static test_result_t yajp_arena_test_alloc_new_block();
+static test_result_t yajp_arena_test_alloc_large();
+static test_result_t yajp_arena_test_realloc_in_place();
+static test_result_t yajp_arena_test_realloc_copy();
+static test_result_t yajp_arena_test_reset();
+
+/* test suite declaration and initialization */
+const test_case_t test_suite[] = {
+        REGISTER_TEST_CASE(yajp_arena_test_alloc_alignment, 1, yajp_arena_alloc, "when allocations have different sizes"),
+        REGISTER_TEST_CASE(yajp_arena_test_alloc_new_block, 2, yajp_arena_alloc, "when block doesn't have enough space"),
+        REGISTER_TEST_CASE(yajp_arena_test_alloc_large, 3, yajp_arena_alloc, "when allocation is larger than block"),
+        REGISTER_TEST_CASE(yajp_arena_test_realloc_in_place, 4, yajp_arena_realloc, "when last allocation is grown"),
+        REGISTER_TEST_CASE(yajp_arena_test_realloc_copy, 5, yajp_arena_realloc, "when not last allocation is grown"),
+        REGISTER_TEST_CASE(yajp_arena_test_reset, 6, yajp_arena_reset, "when arena is reused after reset"),
+};
+
+/* test suite tests count declaration and initialization */
+const long test_count = sizeof(test_suite) / sizeof(test_suite[0]);
+
+
+static test_result_t yajp_arena_test_alloc_alignment() {
+    static const size_t sizes[] = { 1, 3, 8, 17, 0, 100 };
+    yajp_arena_t arena;
+    uint8_t *ptr, *prev = NULL;
+    int ret;
+    size_t i;
+
+    ret = yajp_arena_init(0, &arena);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_arena_init)" returned error");
+
+    for (i = 0; i < ARR_LEN(sizes); i++) {
+        ptr = yajp_arena_alloc(&arena, sizes[i]);
+
+        test_is_not_null(ptr, FUNC_NAME(yajp_arena_alloc)" returned NULL");
+        test_is_equal((uintptr_t) ptr % alignof(max_align_t), 0, FUNC_NAME(yajp_arena_alloc)" returned unaligned pointer");
+        test_is_true(NULL == prev || ptr >= prev + sizes[i - 1], FUNC_NAME(yajp_arena_alloc)" returned overlapping memory");
+
+        memset(ptr, 0xAB, sizes[i]);
+        prev = ptr;
+    }
+
+    test_is_equal(arena.allocations, ARR_LEN(sizes), "Wrong number of allocations: %zu", arena.allocations);
+    test_is_equal(arena.blocks_allocations, 1, "Wrong number of blocks: %zu", arena.blocks_allocations);
+
+    yajp_arena_release(&arena);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_arena_test_alloc_new_block() {
+    yajp_arena_t arena;
+    uint8_t *ptr1, *ptr2;
+
+    yajp_arena_init(64, &arena);
+
+    ptr1 = yajp_arena_alloc(&arena, 48);
+    ptr2 = yajp_arena_alloc(&arena, 48);
+
+    test_is_not_null(ptr1, FUNC_NAME(yajp_arena_alloc)" returned NULL");
+    test_is_not_null(ptr2, FUNC_NAME(yajp_arena_alloc)" returned NULL");
+    test_is_equal(arena.blocks_allocations, 2, "Wrong number of blocks: %zu", arena.blocks_allocations);
+
+    memset(ptr1, 1, 48);
+    memset(ptr2, 2, 48);
+    test_is_equal(ptr1[47], 1, "Allocations overlap");
+
+    yajp_arena_release(&arena);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_arena_test_alloc_large() {
+    yajp_arena_t arena;
+    uint8_t *small, *large;
+
+    yajp_arena_init(64, &arena);
+
+    small = yajp_arena_alloc(&arena, 16);
+    large = yajp_arena_alloc(&arena, 4096);
+
+    test_is_not_null(small, FUNC_NAME(yajp_arena_alloc)" returned NULL");
+    test_is_not_null(large, FUNC_NAME(yajp_arena_alloc)" returned NULL");
+
+    memset(large, 0xCD, 4096);
+    test_is_equal(arena.blocks_allocations, 2, "Wrong number of blocks: %zu", arena.blocks_allocations);
+
+    yajp_arena_release(&arena);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_arena_test_realloc_in_place() {
+    yajp_arena_t arena;
+    int *ptr, *grown;
+    int i;
+
+    yajp_arena_init(1024, &arena);
+
+    ptr = yajp_arena_realloc(&arena, NULL, 0, sizeof(int));
+    test_is_not_null(ptr, FUNC_NAME(yajp_arena_realloc)" returned NULL");
+    *ptr = 0;
+
+    for (i = 1; i < 100; i++) {
+        grown = yajp_arena_realloc(&arena, ptr, i * sizeof(int), (i + 1) * sizeof(int));
+
+        test_is_equal(grown, ptr, FUNC_NAME(yajp_arena_realloc)" moved last allocation");
+        grown[i] = i;
+    }
+
+    for (i = 0; i < 100; i++) {
+        test_is_equal(ptr[i], i, "Wrong value of element %d", i);
+    }
+
+    test_is_equal(arena.allocations, 1, "Wrong number of allocations: %zu", arena.allocations);
+
+    yajp_arena_release(&arena);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_arena_test_realloc_copy() {
+    static const char value[] = "arena";
+    yajp_arena_t arena;
+    char *ptr, *other, *grown;
+
+    yajp_arena_init(1024, &arena);
+
+    ptr = yajp_arena_realloc(&arena, NULL, 0, sizeof(value));
+    memcpy(ptr, value, sizeof(value));
+    other = yajp_arena_alloc(&arena, 8);
+
+    grown = yajp_arena_realloc(&arena, ptr, sizeof(value), 20);
+
+    test_is_not_null(grown, FUNC_NAME(yajp_arena_realloc)" returned NULL");
+    test_is_not_equal(grown, ptr, FUNC_NAME(yajp_arena_realloc)" grew allocation what isn't last in place");
+    test_is_not_equal(grown, other, FUNC_NAME(yajp_arena_realloc)" returned memory of other allocation");
+    test_is_equal(strcmp(grown, value), 0, FUNC_NAME(yajp_arena_realloc)" didn't copy data");
+
+    // moved memory has spare capacity, so next growth doesn't move it again
+    other = yajp_arena_alloc(&arena, 8);
+    test_is_equal(yajp_arena_realloc(&arena, grown, 20, 30), grown, FUNC_NAME(yajp_arena_realloc)" moved memory what has enough capacity");
+
+    yajp_arena_release(&arena);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_arena_test_reset() {
+    yajp_arena_t arena;
+    void *first[4], *second[4];
+    size_t i;
+
+    yajp_arena_init(64, &arena);
+
+    for (i = 0; i < ARR_LEN(first); i++) {
+        first[i] = yajp_arena_alloc(&arena, 48);
+    }
+    test_is_equal(arena.blocks_allocations, 4, "Wrong number of blocks: %zu", arena.blocks_allocations);
+
+    yajp_arena_reset(&arena);
+    test_is_equal(arena.allocations, 0, FUNC_NAME(yajp_arena_reset)" didn't reset counter of allocations");
+
+    for (i = 0; i < ARR_LEN(second); i++) {
+        second[i] = yajp_arena_alloc(&arena, 48);
+        test_is_equal(second[i], first[i], FUNC_NAME(yajp_arena_reset)" didn't reuse block %d", i);
+    }
+    test_is_equal(arena.blocks_allocations, 4, FUNC_NAME(yajp_arena_reset)" allocated new blocks");
+
+    yajp_arena_release(&arena);
+
+    return TEST_RESULT_PASSED;
+}
@@ -0,0 +1,250 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * context_handle_tests.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "yajp/context_handle.h"
+#include "yajp/deserialization_routine.h"
+
+/* test cases prototypes */
+static test_result_t yajp_context_handle_test_swap();
+static test_result_t yajp_context_handle_test_concurrent_swap();
+
+/* test suite declaration and initialization */
+const test_case_t test_suite[] = {
+        REGISTER_TEST_CASE(yajp_context_handle_test_swap, 1, yajp_context_handle_swap, "where references are taken and released by one thread"),
+        REGISTER_TEST_CASE(yajp_context_handle_test_concurrent_swap, 2, yajp_context_handle_swap, "where versions are swapped while other threads deserialize"),
+};
+
+/* test suite tests count declaration and initialization */
+const long test_count = sizeof(test_suite) / sizeof(test_suite[0]);
+
+#define READERS_COUNT   4
+#define SWAPS_COUNT     50
+
+typedef struct {
+    int id;
+    char *name;
+} record_t;
+
+/*
+ * Version of field mappings. Even versions take id from "id" field, odd ones - from "key" field
+ */
+typedef struct {
+    yajp_deserialization_context_t ctx;     // the first field, so version is found by its context
+    yajp_deserialization_rule_t rules[2];
+    int number;
+    bool released;
+} version_t;
+
+typedef struct {
+    yajp_context_handle_t *handle;
+    bool *stop;
+    size_t documents;           // amount of deserialized documents
+    size_t failed;              // amount of failed deserializations
+    size_t wrong;               // amount of documents deserialized not by mapping of taken version
+    size_t released;            // amount of taken versions what were released already
+} reader_t;
+
+static version_t *create_version(int number) {
+    version_t *version = calloc(1, sizeof(*version));
+    const char *id_name = (0 == number % 2) ? "id" : "key";
+
+    if (NULL == version) {
+        return NULL;
+    }
+
+    version->number = number;
+
+    if (0 != yajp_deserialization_rule_init(id_name, strlen(id_name), offsetof(record_t, id), sizeof(int),
+                                            YAJP_DESERIALIZATION_TYPE_NUMBER, 0, 0, 0, 0, 0, yajp_set_int, NULL,
+                                            &version->rules[0]) ||
+        0 != yajp_deserialization_rule_init("name", sizeof("name") - 1, offsetof(record_t, name), sizeof(char *),
+                                            YAJP_DESERIALIZATION_TYPE_STRING | YAJP_DESERIALIZATION_OPTIONS_ALLOCATE,
+                                            0, 0, 0, 0, sizeof(char), yajp_set_string, NULL, &version->rules[1]) ||
+        0 != yajp_deserialization_context_init(version->rules, 2, &version->ctx)) {
+        free(version);
+        return NULL;
+    }
+
+    return version;
+}
+
+static void release_version(version_t *version) {
+    __atomic_store_n(&version->released, true, __ATOMIC_SEQ_CST);
+    yajp_deserialization_context_release(&version->ctx);
+}
+
+static void *reader_main(void *arg) {
+    static const char json[] = "{\"id\":1, \"name\":\"record\", \"key\":2}";
+    reader_t *reader = arg;
+    yajp_context_ref_t ref;
+    const version_t *version;
+    record_t record;
+
+    while (!__atomic_load_n(reader->stop, __ATOMIC_RELAXED)) {
+        version = (const version_t *) yajp_context_handle_acquire(reader->handle, &ref);
+        memset(&record, 0, sizeof(record));
+
+        if (0 != yajp_deserialize_json_string(json, sizeof(json), ref.ctx, &record, NULL)) {
+            reader->failed++;
+        } else if (record.id != ((0 == version->number % 2) ? 1 : 2) || NULL == record.name) {
+            reader->wrong++;
+        }
+
+        yajp_deserialization_free(ref.ctx, &record);
+
+        if (__atomic_load_n(&version->released, __ATOMIC_SEQ_CST)) {
+            reader->released++;
+        }
+
+        yajp_context_handle_release(reader->handle, &ref);
+        reader->documents++;
+    }
+
+    return NULL;
+}
+
+static test_result_t yajp_context_handle_test_swap() {
+    yajp_context_handle_t handle;
+    yajp_context_ref_t ref, nested_ref;
+    version_t *first = create_version(0), *second = create_version(1);
+    const yajp_deserialization_context_t *ctx;
+    int ret;
+
+    test_is_not_null(first, "Can't create first version");
+    test_is_not_null(second, "Can't create second version");
+
+    errno = 0;
+    ret = yajp_context_handle_init(NULL, &handle);
+    test_is_equal(ret, -1, "Handle was initialized without context");
+    test_is_equal(errno, EINVAL, "Expected errno %d, got %d", EINVAL, errno);
+
+    ret = yajp_context_handle_init(&first->ctx, &handle);
+    test_is_equal(ret, 0, "Can't initialize handle");
+
+    ctx = yajp_context_handle_acquire(&handle, &ref);
+    test_is_equal(ctx, &first->ctx, "Handle returned wrong version");
+    test_is_equal(ref.ctx, &first->ctx, "Reference holds wrong version");
+
+    // references can be nested
+    ctx = yajp_context_handle_acquire(&handle, &nested_ref);
+    test_is_equal(ctx, &first->ctx, "Handle returned wrong nested version");
+    yajp_context_handle_release(&handle, &nested_ref);
+    yajp_context_handle_release(&handle, &ref);
+
+    ctx = yajp_context_handle_swap(&handle, &second->ctx);
+    test_is_equal(ctx, &first->ctx, "Swap returned wrong old version");
+
+    ctx = yajp_context_handle_acquire(&handle, &ref);
+    test_is_equal(ctx, &second->ctx, "Handle returned old version after swap");
+    yajp_context_handle_release(&handle, &ref);
+
+    errno = 0;
+    ctx = yajp_context_handle_swap(&handle, NULL);
+    test_is_null(ctx, "Handle was swapped with NULL");
+    test_is_equal(errno, EINVAL, "Expected errno %d, got %d", EINVAL, errno);
+
+    ctx = yajp_context_handle_acquire(&handle, &ref);
+    test_is_equal(ctx, &second->ctx, "Failed swap changed version");
+    yajp_context_handle_release(&handle, &ref);
+
+    yajp_deserialization_context_release(&first->ctx);
+    test_is_null(first->ctx.rules, "Released context still has rules");
+    test_is_equal(first->ctx.rules_count, 0, "Released context still has %zu rules", first->ctx.rules_count);
+
+    yajp_deserialization_context_release(&second->ctx);
+    free(first);
+    free(second);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_context_handle_test_concurrent_swap() {
+    yajp_context_handle_t handle;
+    reader_t readers[READERS_COUNT];
+    pthread_t threads[READERS_COUNT];
+    version_t *version = create_version(0), *next, *old;
+    size_t documents = 0, failed = 0, wrong = 0, released = 0;
+    bool stop = false;
+    int started = 0, swaps, i;
+
+    test_is_not_null(version, "Can't create version");
+    test_is_equal(yajp_context_handle_init(&version->ctx, &handle), 0, "Can't initialize handle");
+
+    for (i = 0; i < READERS_COUNT; i++) {
+        memset(&readers[i], 0, sizeof(readers[i]));
+        readers[i].handle = &handle;
+        readers[i].stop = &stop;
+
+        if (0 == pthread_create(&threads[i], NULL, reader_main, &readers[i])) {
+            started++;
+        }
+    }
+
+    for (swaps = 0; swaps < SWAPS_COUNT && 0 < started; swaps++) {
+        next = create_version(swaps + 1);
+        if (NULL == next) {
+            break;
+        }
+
+        // old version is released at once, readers what still use it would see released flag
+        old = (version_t *) yajp_context_handle_swap(&handle, &next->ctx);
+        release_version(old);
+        free(old);
+        version = next;
+
+        if (0 == swaps % 16) {
+            sched_yield();
+        }
+    }
+
+    __atomic_store_n(&stop, true, __ATOMIC_RELAXED);
+    for (i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+        documents += readers[i].documents;
+        failed += readers[i].failed;
+        wrong += readers[i].wrong;
+        released += readers[i].released;
+    }
+
+    old = (version_t *) yajp_context_handle_swap(&handle, &version->ctx);
+    test_is_equal(old, version, "Handle doesn't hold the last version");
+    release_version(version);
+    free(version);
+
+    test_is_equal(started, READERS_COUNT, "Only %d readers were started", started);
+    test_is_equal(swaps, SWAPS_COUNT, "Only %d versions were swapped", swaps);
+    test_is_gt(documents, 0, "Readers didn't deserialize documents");
+    test_is_equal(failed, 0, "%zu deserializations failed", failed);
+    test_is_equal(wrong, 0, "%zu documents were deserialized by wrong mapping", wrong);
+    test_is_equal(released, 0, "%zu documents were deserialized with released version", released);
+
+    return TEST_RESULT_PASSED;
+}
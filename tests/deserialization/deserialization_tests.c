@@ -21,6 +21,12 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <pthread.h>
 
 #include "test_common.h"
 
@@ -37,6 +43,26 @@ static test_result_t yajp_deserialize_json_test_cube_of_primitives();
 static test_result_t yajp_deserialize_json_test_inherited_object();
 static test_result_t yajp_deserialize_json_test_array_of_objects();
 static test_result_t yajp_deserialize_json_test_full_example();
+static test_result_t yajp_deserialize_json_test_enum_fields();
+static test_result_t yajp_deserialize_json_test_inline_string_fields();
+static test_result_t yajp_deserialize_json_test_truncated_string_fields();
+static test_result_t yajp_deserialize_json_test_arena();
+static test_result_t yajp_deserialize_json_test_array_of_objects_ending_with_primitive();
+static test_result_t yajp_deserialize_json_test_allocator();
+static test_result_t yajp_deserialize_json_test_array_capacity();
+static test_result_t yajp_deserialize_json_test_free();
+static test_result_t yajp_deserialize_json_test_reuse();
+static test_result_t yajp_deserialize_json_test_size_hints();
+static test_result_t yajp_deserialize_json_test_deep_nesting();
+static test_result_t yajp_deserialize_json_test_max_depth();
+static test_result_t yajp_deserialize_json_test_read_ahead();
+static test_result_t yajp_deserialize_json_test_thread_session();
+static test_result_t yajp_deserialize_json_test_step();
+static test_result_t yajp_deserialize_json_test_step_errors();
+static test_result_t yajp_deserialize_json_test_interned_array();
+static test_result_t yajp_deserialize_json_test_step_deep_abort();
+static test_result_t yajp_deserialize_json_test_step_deep_free();
+static test_result_t yajp_deserialize_json_test_reuse_steady_state();
 
 /* test suite declaration and initialization */
 const test_case_t test_suite[] = {
@@ -49,6 +75,26 @@ const test_case_t test_suite[] = {
         REGISTER_TEST_CASE(yajp_deserialize_json_test_inherited_object, 7, yajp_deserialize_json_string, "where JSON values are objects"),
         REGISTER_TEST_CASE(yajp_deserialize_json_test_array_of_objects, 8, yajp_deserialize_json_string, "where JSON values are arrays of objects"),
         REGISTER_TEST_CASE(yajp_deserialize_json_test_full_example, 9, yajp_deserialize_json_string, "with all possible combinations"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_enum_fields, 10, yajp_deserialize_json_string, "where JSON values are strings mapped to enumeration items by setter data"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_inline_string_fields, 11, yajp_deserialize_json_string, "where JSON values are strings stored in place with bounds check"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_truncated_string_fields, 12, yajp_deserialize_json_string, "where JSON values are strings stored in place with truncation"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_arena, 13, yajp_deserialize_json_string_in_arena, "where all output memory is allocated from arena"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_array_of_objects_ending_with_primitive, 14, yajp_deserialize_json_string, "where objects in array end with primitive or skipped values"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_allocator, 15, yajp_deserialize_json_string_with_allocator, "where memory is allocated by allocators of context and call"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_array_capacity, 16, yajp_deserialize_json_string, "where capacity of arrays is stored and arrays are shrunk to fit"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_free, 17, yajp_deserialization_free, "where all memory of deserialized structure is released by rules"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_reuse, 18, yajp_deserialize_json_string, "where memory of previously deserialized structure is reused"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_size_hints, 19, yajp_deserialize_json_string, "where memory is presized by sizes learned from previous documents"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_deep_nesting, 20, yajp_deserialize_json_string, "where nested objects and arrays are deeper than inline deserialization stack"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_max_depth, 21, yajp_deserialize_json_string, "where nesting depth of document is limited by context"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_read_ahead, 22, yajp_deserialize_json_stream, "where stream is read by helper thread"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_thread_session, 23, yajp_deserialize_json_string, "where parser and buffers are kept by thread between documents"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_step, 24, yajp_step, "where document is passed by parts of any size"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_step_errors, 25, yajp_step, "where document is broken or abandoned"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_interned_array, 26, yajp_set_interned_string, "where JSON values are arrays of interned strings"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_step_deep_abort, 27, yajp_step_release, "where abandoned document is deeper than stack of thread allows to recurse"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_step_deep_free, 28, yajp_deserialization_free, "where deserialized structure is deeper than stack of thread allows to recurse"),
+        REGISTER_TEST_CASE(yajp_deserialize_json_test_reuse_steady_state, 29, yajp_deserialize_json_string, "where strings of varying length, numbers and booleans are reused without allocations"),
 };
 
 /* test suite tests count declaration and initialization */
@@ -1187,3 +1233,2326 @@ static test_result_t yajp_deserialize_json_test_full_example() {
 
     return TEST_RESULT_PASSED;
 }
+
+static test_result_t yajp_deserialize_json_test_enum_fields() {
+    enum { COLOR_UNKNOWN, COLOR_RED, COLOR_GREEN, COLOR_BLUE };
+
+    typedef struct {
+        int id;
+        int color;
+        int background;
+    } test_struct_t;
+
+    static const yajp_deserialization_enum_item_t color_items[] = {
+            { "red", sizeof("red") - 1, COLOR_RED },
+            { "green", sizeof("green") - 1, COLOR_GREEN },
+            { "blue", sizeof("blue") - 1, COLOR_BLUE },
+    };
+    static const char js[] = "{"
+                             "  \"id\":7,"
+                             "  \"color\":\"green\","
+                             "  \"background\":\"purple\""
+                             "}";
+    static const size_t js_size = sizeof(js);
+
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_enum_t colors;
+
+    int ret;
+    yajp_deserialization_rule_t actions[3] = { 0 };
+    test_struct_t test_struct = { 0 };
+
+    ret = yajp_deserialization_enum_init(color_items, ARR_LEN(color_items), true, COLOR_UNKNOWN, &colors);
+    test_is_equal(ret, 0, "Failed to initialize enumeration");
+
+    // declare rules for test_struct_t.id
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.color
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          color
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_enum
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &colors
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.background
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          background
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_enum
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &colors
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialize_json_string(js, js_size, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    test_is_equal(test_struct.id, 7, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.color, COLOR_GREEN, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.background, COLOR_UNKNOWN, "Structure wasn't deserialized correctly");
+
+    yajp_deserialization_enum_release(&colors);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_inline_string_fields() {
+    typedef struct {
+        char code[4];
+        char country[16];
+    } test_struct_t;
+
+    static const char js[] = "{ \"code\":\"USA\", \"country\":\"United States\" }";
+    static const size_t js_size = sizeof(js);
+    static const char overflow_js[] = "{ \"code\":\"USAA\", \"country\":\"United States\" }";
+    static const size_t overflow_js_size = sizeof(overflow_js);
+
+    yajp_deserialization_context_t ctx;
+    int ret;
+    yajp_deserialization_rule_t actions[2];
+    test_struct_t test_struct = { 0 };
+
+    // declare rules for test_struct_t.code
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          code
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_INLINE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    test_is_equal(actions[0].field_size, sizeof(test_struct.code), "Capacity of inline string wasn't taken from field");
+    // ==========================================
+
+    // declare rules for test_struct_t.country
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          country
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_INLINE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialize_json_string(js, js_size, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    test_is_equal(strcmp(test_struct.code, "USA"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(strcmp(test_struct.country, "United States"), 0, "Structure wasn't deserialized correctly");
+
+    memset(&test_struct, 0, sizeof(test_struct));
+    ret = yajp_deserialize_json_string(overflow_js, overflow_js_size, &ctx, &test_struct, NULL);
+    test_is_not_equal(ret, 0, "Deserialization of too long string succeeded");
+    test_is_equal(test_struct.code[0], '\0', "Too long string was stored");
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_truncated_string_fields() {
+    typedef struct {
+        char elems[3][8];
+        bool final_dim;
+        size_t count;
+    } codes_handle_t;
+
+    typedef struct {
+        char city[8];
+        char note[8];
+        codes_handle_t codes;
+    } test_struct_t;
+
+    static const char js[] = "{"
+                             "  \"city\":\"Zurich \xC3\xBC\","        // 'ü' is encoded by 2 bytes and crosses capacity
+                             "  \"note\":\"abcd\\u00e9f\","
+                             "  \"codes\":[\"DE\", \"AT-1234567\", \"CH\"]"
+                             "}";
+    static const size_t js_size = sizeof(js);
+
+    yajp_deserialization_context_t ctx;
+    int ret;
+    yajp_deserialization_rule_t actions[3];
+    test_struct_t test_struct = { 0 };
+
+    // declare rules for test_struct_t.city
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          city
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_TRUNCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.note
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          note
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_TRUNCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.codes
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          codes
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_TRUNCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         char[8]
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 elems
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialize_json_string(js, js_size, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    test_is_equal(strcmp(test_struct.city, "Zurich "), 0, "Structure wasn't deserialized correctly: '%s'", test_struct.city);
+    test_is_equal(strcmp(test_struct.note, "abcd"), 0, "Structure wasn't deserialized correctly: '%s'", test_struct.note);
+    test_is_equal(test_struct.codes.count, 3, "Structure wasn't deserialized correctly");
+    test_is_equal(strcmp(test_struct.codes.elems[0], "DE"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(strcmp(test_struct.codes.elems[1], "AT-1234"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(strcmp(test_struct.codes.elems[2], "CH"), 0, "Structure wasn't deserialized correctly");
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_arena() {
+    typedef struct {
+        int id;
+    } inner_struct_t;
+
+    typedef struct {
+        char *name;
+        array_handle_t tags;
+        inner_struct_t *inner;
+    } test_struct_t;
+
+    static const char js[] = "{"
+                             "  \"name\":\"arena\","
+                             "  \"tags\":[\"a\", \"bb\", \"ccc\"],"
+                             "  \"inner\":{ \"id\":42 }"
+                             "}";
+    static const size_t js_size = sizeof(js);
+    static const char *tags[] = { "a", "bb", "ccc" };
+
+    yajp_deserialization_context_t ctx, inner_ctx;
+    yajp_arena_t arena;
+    int ret;
+    size_t i;
+    yajp_deserialization_rule_t actions[3], inner_actions[1];
+    test_struct_t test_struct = { 0 };
+
+    // declare rules for inner_struct_t.id
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   inner_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &inner_actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(inner_actions, ARR_LEN(inner_actions), &inner_ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // declare rules for test_struct_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.tags
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          tags
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         char *
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.inner
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          inner
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &inner_ctx
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_arena_init(0, &arena);
+    test_is_equal(ret, 0, "Failed to initialize arena");
+
+    ret = yajp_deserialize_json_string_in_arena(js, js_size, &ctx, &test_struct, NULL, &arena);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    test_is_equal(strcmp(test_struct.name, "arena"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.tags.count, ARR_LEN(tags), "Structure wasn't deserialized correctly");
+    for (i = 0; i < ARR_LEN(tags); i++) {
+        test_is_equal(strcmp(((char **) test_struct.tags.elems)[i], tags[i]), 0, "Structure wasn't deserialized correctly");
+    }
+    test_is_not_null(test_struct.inner, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.inner->id, 42, "Structure wasn't deserialized correctly");
+
+    // name, tags array (initial capacity fits all of them), 3 tags and inner object
+    test_is_equal(arena.allocations, 6, "Output wasn't allocated from arena: %zu", arena.allocations);
+    test_is_equal(arena.blocks_allocations, 1, "Arena allocated more than one block: %zu", arena.blocks_allocations);
+
+    yajp_arena_release(&arena);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_array_of_objects_ending_with_primitive() {
+#define arr_cnt 3
+
+    typedef struct {
+        array_handle_t arr1;
+        int f3;
+    } test_struct_t;
+
+    // closing brace of each object is consumed together with its last primitive value
+    static const char js[] = "{\"arr1\":[{\"f2\":[1],\"f1\":10},{\"f2\":[2],\"f1\":-10,\"unknown\":true},{\"f1\":12}],"
+                             "\"f3\":7}";
+    static const size_t js_size = sizeof(js);
+
+    static const int f1_vals[arr_cnt] = { 10, -10, 12 };
+    static const size_t f2_counts[arr_cnt] = { 1, 1, 0 };
+    inner_object_t *arr_elem;
+
+    yajp_deserialization_context_t ctx, inner_obj_ctx;
+    yajp_deserialization_rule_t actions[2], inner_obj_actions[2];
+    int ret, i;
+    test_struct_t test_struct;
+
+    memset(&test_struct, 0, sizeof(test_struct));
+
+    // declare rules for inner_object_t.f1
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   inner_object_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          f1
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &inner_obj_actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for inner_object_t.f2
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   inner_object_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          f2
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &inner_obj_actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(inner_obj_actions, ARR_LEN(inner_obj_actions), &inner_obj_ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // declare rules for test_struct_t.arr1
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          arr1
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &inner_obj_ctx
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         inner_object_t
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.f3
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          f3
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialize_json_string(js, js_size, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    test_is_equal(test_struct.arr1.count, arr_cnt, "Objects after the first one were merged into it");
+    test_is_equal(test_struct.f3, 7, "Field after array of objects wasn't deserialized");
+
+    for (i = 0; i < arr_cnt; i++) {
+        arr_elem = &((inner_object_t *)test_struct.arr1.elems)[i];
+        test_is_equal(arr_elem->f1, f1_vals[i], "");
+        test_is_equal(arr_elem->f2.count, f2_counts[i], "");
+
+        free(arr_elem->f2.elems);
+    }
+
+    free(test_struct.arr1.elems);
+
+#undef arr_cnt
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_allocator() {
+    typedef struct {
+        char *name;
+        array_handle_t values;
+    } test_struct_t;
+
+    static const char js[] = "{"
+                             "  \"name\":\"string which is longer than internal buffer of lexer token\","
+                             "  \"values\":[1, 2, 3]"
+                             "}";
+    static const size_t js_size = sizeof(js);
+
+    yajp_deserialization_context_t ctx;
+    counting_allocator_stat_t ctx_stat = { 0 }, call_stat = { 0 };
+    yajp_allocator_t ctx_allocator = { counting_alloc, counting_realloc, counting_free, &ctx_stat };
+    yajp_allocator_t call_allocator = { counting_alloc, counting_realloc, counting_free, &call_stat };
+    yajp_deserialization_rule_t actions[2];
+    test_struct_t test_struct = { 0 };
+    int ret;
+
+    // declare rules for test_struct_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.values
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          values
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &ctx_allocator);
+    test_is_equal(ret, 0, "Failed to set allocator of deserialization context");
+
+    // allocator of context is used if call doesn't specify one
+    ret = yajp_deserialize_json_string_with_allocator(js, js_size, &ctx, &test_struct, NULL, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_equal(strcmp(test_struct.name, "string which is longer than internal buffer of lexer token"), 0,
+                  "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.values.count, 3, "Structure wasn't deserialized correctly");
+
+    // lexer buffer, long token, parser, name and values
+    test_is_equal(ctx_stat.allocations, 5, "Unexpected number of allocations: %zu", ctx_stat.allocations);
+    test_is_equal(ctx_stat.releases, 3, "Temporary memory wasn't released: %zu", ctx_stat.releases);
+
+    ctx_allocator.free(test_struct.name, ctx_allocator.user);
+    ctx_allocator.free(test_struct.values.elems, ctx_allocator.user);
+
+    // allocator of call has priority over allocator of context
+    memset(&test_struct, 0, sizeof(test_struct));
+    ret = yajp_deserialize_json_string_with_allocator(js, js_size, &ctx, &test_struct, NULL, &call_allocator);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_equal(ctx_stat.allocations, 5, "Allocator of context was used");
+    test_is_equal(call_stat.allocations, 5, "Unexpected number of allocations: %zu", call_stat.allocations);
+
+    call_allocator.free(test_struct.name, call_allocator.user);
+    call_allocator.free(test_struct.values.elems, call_allocator.user);
+    test_is_equal(call_stat.allocations, call_stat.releases, "Not all memory was released");
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_array_capacity() {
+    typedef struct {
+        int *elems;
+        size_t count;
+        size_t capacity;
+        bool final_dim;
+    } int_array_t;
+
+    typedef struct {
+        int_array_t grown;
+        int_array_t shrunk;
+    } test_struct_t;
+
+    static const char js[] = "{"
+                             "  \"grown\":[1, 2, 3, 4, 5],"
+                             "  \"shrunk\":[1, 2, 3, 4, 5]"
+                             "}";
+    static const size_t js_size = sizeof(js);
+    static const int values[] = { 1, 2, 3, 4, 5 };
+
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    test_struct_t test_struct = { 0 };
+    int ret;
+
+    // declare rules for test_struct_t.grown
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          grown
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 elems
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+    #define YAJP_DESERIALIZATION_ARRAY_CAPACITY             capacity
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.shrunk
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          shrunk
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS | YAJP_DESERIALIZATION_OPTIONS_SHRINK_TO_FIT)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 elems
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+    #define YAJP_DESERIALIZATION_ARRAY_CAPACITY             capacity
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialize_json_string(js, js_size, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    test_is_equal(test_struct.grown.count, ARR_LEN(values), "Structure wasn't deserialized correctly");
+    test_is_equal(memcmp(test_struct.grown.elems, values, sizeof(values)), 0, "Structure wasn't deserialized correctly");
+    // initial capacity of 4 elements is doubled once
+    test_is_equal(test_struct.grown.capacity, 8, "Unexpected capacity: %zu", test_struct.grown.capacity);
+
+    test_is_equal(test_struct.shrunk.count, ARR_LEN(values), "Structure wasn't deserialized correctly");
+    test_is_equal(memcmp(test_struct.shrunk.elems, values, sizeof(values)), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.shrunk.capacity, ARR_LEN(values), "Array wasn't shrunk: %zu", test_struct.shrunk.capacity);
+
+    free(test_struct.grown.elems);
+    free(test_struct.shrunk.elems);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_free() {
+    typedef struct {
+        char *name;
+        const char *region;
+        char code[4];
+        array_handle_t *tags;
+        array_handle_t matrix;
+        inner_object_t *inner;
+        array_handle_t items;
+    } test_struct_t;
+
+    static const char js[] = "{"
+                             "  \"name\":\"string which is longer than internal buffer of lexer token\","
+                             "  \"region\":\"eu-west\","
+                             "  \"code\":\"abc\","
+                             "  \"tags\":[\"first\", \"second\"],"
+                             "  \"matrix\":[[1, 2], [3]],"
+                             "  \"inner\":{\"f1\":1, \"f2\":[1, 2]},"
+                             "  \"items\":[{\"f1\":2, \"f2\":[3]}, {\"f1\":3, \"f2\":[4, 5]}]"
+                             "}";
+    static const size_t js_size = sizeof(js);
+
+    // deserialization fails inside of allocated object and inside of element of array of objects
+    static const char *const broken_js[] = {
+            "{\"name\":\"name\", \"tags\":[\"tag\"], \"inner\":{\"f1\":1, \"f2\":[1, \"x\"]}}",
+            "{\"matrix\":[[1], [2]], \"items\":[{\"f1\":2, \"f2\":[3]}, {\"f1\":3, \"f2\":[4, \"x\"]}]}",
+    };
+
+    yajp_deserialization_context_t ctx, inner_obj_ctx;
+    yajp_deserialization_rule_t actions[7], inner_obj_actions[2];
+    yajp_deserialization_intern_pool_t pool;
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    test_struct_t test_struct = { 0 };
+    const char *region;
+    size_t i;
+    int ret;
+
+    ret = yajp_deserialization_intern_pool_init(4, &pool);
+    test_is_equal(ret, 0, "Failed to initialize pool");
+
+    // declare rules for inner_object_t.f1
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   inner_object_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          f1
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &inner_obj_actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for inner_object_t.f2
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   inner_object_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          f2
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &inner_obj_actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(inner_obj_actions, ARR_LEN(inner_obj_actions), &inner_obj_ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // declare rules for test_struct_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.region
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          region
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_interned_string
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &pool
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.code
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          code
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_INLINE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.tags
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          tags
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE | YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         char *
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[3]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.matrix
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          matrix
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[4]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.inner
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          inner
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &inner_obj_ctx
+    #define YAJP_DESERIALIZATION_RULE                       &actions[5]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.items
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          items
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &inner_obj_ctx
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         inner_object_t
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[6]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator of deserialization context");
+
+    ret = yajp_deserialize_json_string(js, js_size, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_equal(((inner_object_t *) test_struct.items.elems)[1].f2.count, 2, "Structure wasn't deserialized correctly");
+    region = test_struct.region;
+
+    yajp_deserialization_free(&ctx, &test_struct);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    // released pointers are reset, interned and inline strings are kept
+    test_is_equal(test_struct.name, NULL, "Released pointer wasn't reset");
+    test_is_equal(test_struct.tags, NULL, "Released pointer wasn't reset");
+    test_is_equal(test_struct.inner, NULL, "Released pointer wasn't reset");
+    test_is_equal(test_struct.matrix.rows, NULL, "Released pointer wasn't reset");
+    test_is_equal(test_struct.items.count, 0, "Counter of released array wasn't reset");
+    test_is_equal(test_struct.region, region, "Interned string was released");
+    test_is_equal(strcmp(test_struct.code, "abc"), 0, "Inline string was changed");
+
+    // structure of failed deserialization is released as well
+    for (i = 0; i < ARR_LEN(broken_js); i++) {
+        memset(&test_struct, 0, sizeof(test_struct));
+        ret = yajp_deserialize_json_string(broken_js[i], strlen(broken_js[i]) + 1, &ctx, &test_struct, NULL);
+        test_is_not_equal(ret, 0, "Deserialization of broken JSON succeeded");
+
+        yajp_deserialization_free(&ctx, &test_struct);
+        test_is_equal(stat.allocations, stat.releases, "Not all memory of failed deserialization was released: "
+                      "%zu of %zu", stat.releases, stat.allocations);
+    }
+
+    yajp_deserialization_intern_pool_release(&pool);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_reuse() {
+    typedef struct {
+        char *name;
+        array_handle_t *tags;
+        array_handle_t matrix;
+        inner_object_t *inner;
+        array_handle_t items;
+    } test_struct_t;
+
+    static const char *const js[] = {
+            "{\"name\":\"first name\", \"tags\":[\"alpha\", \"beta\", \"gamma\"], \"matrix\":[[1, 2], [3, 4]],"
+            " \"inner\":{\"f1\":1, \"f2\":[1, 2, 3]}, \"items\":[{\"f1\":1, \"f2\":[1, 2]}, {\"f1\":2, \"f2\":[3]}]}",
+            // same document again, all memory is reused
+            "{\"name\":\"first name\", \"tags\":[\"alpha\", \"beta\", \"gamma\"], \"matrix\":[[1, 2], [3, 4]],"
+            " \"inner\":{\"f1\":1, \"f2\":[1, 2, 3]}, \"items\":[{\"f1\":1, \"f2\":[1, 2]}, {\"f1\":2, \"f2\":[3]}]}",
+            // smaller document, all memory is reused and surplus items are released
+            "{\"name\":\"second\", \"tags\":[\"a\", \"b\"], \"matrix\":[[5], [6]],"
+            " \"inner\":{\"f1\":2, \"f2\":[4]}, \"items\":[{\"f1\":3, \"f2\":[5]}]}",
+            // bigger document with another shape of matrix
+            "{\"name\":\"third name is the longest\", \"tags\":[\"a\", \"bb\", \"ccc\", \"dddd\"], \"matrix\":[7, 8, 9],"
+            " \"inner\":{\"f1\":3, \"f2\":[5, 6, 7, 8, 9]}, \"items\":[{\"f1\":4, \"f2\":[6]}, {\"f1\":5, \"f2\":[]},"
+            " {\"f1\":6, \"f2\":[7, 8]}]}",
+    };
+
+    yajp_deserialization_context_t ctx, inner_obj_ctx, empty_ctx;
+    yajp_deserialization_rule_t actions[5], inner_obj_actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    test_struct_t test_struct = { 0 };
+    counting_allocator_stat_t before, transient;
+    size_t i;
+    int ret;
+
+    // declare rules for inner_object_t.f1
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   inner_object_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          f1
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &inner_obj_actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for inner_object_t.f2
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   inner_object_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          f2
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &inner_obj_actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(inner_obj_actions, ARR_LEN(inner_obj_actions), &inner_obj_ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // declare rules for test_struct_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.tags
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          tags
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE | YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         char *
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.matrix
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          matrix
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.inner
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          inner
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &inner_obj_ctx
+    #define YAJP_DESERIALIZATION_RULE                       &actions[3]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.items
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          items
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &inner_obj_ctx
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         inner_object_t
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[4]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator of deserialization context");
+
+    ret = yajp_deserialization_context_set_reuse(&ctx, true);
+    test_is_equal(ret, 0, "Failed to set reuse mode of deserialization context");
+
+    // context without rules skips whole document, so it allocates only memory of lexer and parser
+    ret = yajp_deserialization_context_init(actions, 0, &empty_ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+    yajp_deserialization_context_set_allocator(&empty_ctx, &allocator);
+
+    for (i = 0; i < 3; i++) {
+        before = stat;
+        ret = yajp_deserialize_json_string(js[i], strlen(js[i]) + 1, &empty_ctx, &test_struct, NULL);
+        test_is_equal(ret, 0, "Deserialization failed");
+        transient.allocations = stat.allocations - before.allocations;
+        transient.reallocations = stat.reallocations - before.reallocations;
+
+        before = stat;
+        ret = yajp_deserialize_json_string(js[i], strlen(js[i]) + 1, &ctx, &test_struct, NULL);
+        test_is_equal(ret, 0, "Deserialization failed");
+
+        if (1 == i || 2 == i) {
+            test_is_equal(stat.allocations - before.allocations, transient.allocations,
+                          "Output memory was allocated for document %zu", i);
+            test_is_equal(stat.reallocations - before.reallocations, transient.reallocations,
+                          "Output memory was reallocated for document %zu", i);
+        }
+    }
+
+    ////////// check smaller document
+    test_is_equal(strcmp(test_struct.name, "second"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.tags->count, 2, "Structure wasn't deserialized correctly");
+    test_is_equal(strcmp(((char **) test_struct.tags->elems)[1], "b"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.matrix.final_dim, false, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.matrix.count, 2, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.matrix.rows[1].count, 1, "Structure wasn't deserialized correctly");
+    test_is_equal(((int *) test_struct.matrix.rows[1].elems)[0], 6, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.inner->f2.count, 1, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.items.count, 1, "Structure wasn't deserialized correctly");
+    test_is_equal(((int *) ((inner_object_t *) test_struct.items.elems)[0].f2.elems)[0], 5,
+                  "Structure wasn't deserialized correctly");
+    ////////// ==========================================
+
+    ////////// check bigger document
+    ret = yajp_deserialize_json_string(js[3], strlen(js[3]) + 1, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    test_is_equal(strcmp(test_struct.name, "third name is the longest"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.tags->count, 4, "Structure wasn't deserialized correctly");
+    test_is_equal(strcmp(((char **) test_struct.tags->elems)[3], "dddd"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.matrix.final_dim, true, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.matrix.count, 3, "Structure wasn't deserialized correctly");
+    test_is_equal(((int *) test_struct.matrix.elems)[2], 9, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.inner->f1, 3, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.inner->f2.count, 5, "Structure wasn't deserialized correctly");
+    test_is_equal(((int *) test_struct.inner->f2.elems)[4], 9, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.items.count, 3, "Structure wasn't deserialized correctly");
+    test_is_equal(((inner_object_t *) test_struct.items.elems)[1].f2.count, 0, "Structure wasn't deserialized correctly");
+    test_is_equal(((int *) ((inner_object_t *) test_struct.items.elems)[2].f2.elems)[1], 8,
+                  "Structure wasn't deserialized correctly");
+    ////////// ==========================================
+
+    yajp_deserialization_free(&ctx, &test_struct);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_size_hints() {
+    typedef struct {
+        char *name;
+        array_handle_t values;
+    } test_struct_t;
+
+#define BIG_COUNT   100
+#define SMALL_COUNT 10
+#define NAME_SIZE   200
+
+    char big_js[1024], small_js[256], name[NAME_SIZE + 1];
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    yajp_deserialization_size_hints_t hints;
+    test_struct_t test_struct = { 0 };
+    size_t i, used, reallocations, elems;
+    int ret;
+
+    memset(name, 'n', NAME_SIZE);
+    name[NAME_SIZE] = '\0';
+
+    used = sprintf(big_js, "{\"name\":\"%s\", \"values\":[", name);
+    for (i = 0; i < BIG_COUNT; i++) {
+        used += sprintf(big_js + used, (i + 1 < BIG_COUNT) ? "%zu," : "%zu]}", i);
+    }
+
+    used = sprintf(small_js, "{\"name\":\"small\", \"values\":[");
+    for (i = 0; i < SMALL_COUNT; i++) {
+        used += sprintf(small_js + used, (i + 1 < SMALL_COUNT) ? "%zu," : "%zu]}", i);
+    }
+
+    // declare rules for test_struct_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.values
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          values
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator of deserialization context");
+
+    ret = yajp_deserialization_size_hints_init(1, &hints);
+    test_is_equal(ret, 0, "Failed to initialize size hints");
+
+    ret = yajp_deserialization_context_set_size_hints(&ctx, &hints);
+    test_is_equal(ret, 0, "Failed to set size hints mode of deserialization context");
+
+    ret = yajp_deserialization_size_hints_get(&hints, &actions[1], NULL, &elems);
+    test_is_equal(ret, -1, "Sizes are learned before deserialization");
+
+    ////////// first document grows memory step by step and teaches context
+    ret = yajp_deserialize_json_string(big_js, strlen(big_js) + 1, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_not_equal(stat.reallocations, 0, "Memory of first document wasn't grown");
+    ret = yajp_deserialization_size_hints_get(&hints, &actions[1], NULL, &elems);
+    test_is_equal(ret, 0, "Sizes of array rule weren't learned");
+    test_is_equal(elems, BIG_COUNT, "Amount of elements wasn't learned: %zu", elems);
+    test_is_true(hints.buffer_size > NAME_SIZE, "Size of lexer buffer wasn't learned: %zu", hints.buffer_size);
+    yajp_deserialization_free(&ctx, &test_struct);
+    ////////// ==========================================
+
+    ////////// same document is deserialized without growth of memory
+    reallocations = stat.reallocations;
+    ret = yajp_deserialize_json_string(big_js, strlen(big_js) + 1, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_equal(stat.reallocations, reallocations, "Memory was grown in spite of size hints");
+    test_is_equal(strcmp(test_struct.name, name), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.values.count, BIG_COUNT, "Structure wasn't deserialized correctly");
+    test_is_equal(((int *) test_struct.values.elems)[BIG_COUNT - 1], BIG_COUNT - 1,
+                  "Structure wasn't deserialized correctly");
+    yajp_deserialization_free(&ctx, &test_struct);
+    ////////// ==========================================
+
+    ////////// smaller document doesn't drop learned sizes at once
+    ret = yajp_deserialize_json_string(small_js, strlen(small_js) + 1, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_equal(test_struct.values.count, SMALL_COUNT, "Structure wasn't deserialized correctly");
+    yajp_deserialization_size_hints_get(&hints, &actions[1], NULL, &elems);
+    test_is_equal(elems, BIG_COUNT - (BIG_COUNT - SMALL_COUNT + 7) / 8, "Amount of elements decayed incorrectly: %zu",
+                  elems);
+    yajp_deserialization_free(&ctx, &test_struct);
+
+    for (i = 0; i < 100; i++) {
+        ret = yajp_deserialize_json_string(small_js, strlen(small_js) + 1, &ctx, &test_struct, NULL);
+        test_is_equal(ret, 0, "Deserialization failed");
+        yajp_deserialization_free(&ctx, &test_struct);
+    }
+    yajp_deserialization_size_hints_get(&hints, &actions[1], NULL, &elems);
+    test_is_equal(elems, SMALL_COUNT, "Amount of elements didn't decay: %zu", elems);
+    ////////// ==========================================
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    yajp_deserialization_size_hints_release(&hints);
+
+    return TEST_RESULT_PASSED;
+
+#undef BIG_COUNT
+#undef SMALL_COUNT
+#undef NAME_SIZE
+}
+
+static test_result_t yajp_deserialize_json_test_deep_nesting() {
+    typedef struct node node_t;
+    struct node {
+        int value;
+        node_t *child;
+        array_handle_t matrix;
+    };
+
+#define DEPTH       20
+#define DIMENSIONS  12
+
+    char js[1024];
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[3];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    node_t root = { 0 }, *node;
+    array_handle_t *row;
+    size_t used = 0, i;
+    int ret;
+
+    // {"value":0, "child":{"value":1, "child":{ ... "matrix":[[[ ... [1, 2] ... ]]]}}}
+    for (i = 0; i < DEPTH; i++) {
+        used += sprintf(js + used, (0 == i) ? "{\"value\":%zu" : ", \"child\":{\"value\":%zu", i);
+    }
+    used += sprintf(js + used, ", \"matrix\":");
+    for (i = 0; i < DIMENSIONS - 1; i++) {
+        used += sprintf(js + used, "[");
+    }
+    used += sprintf(js + used, "[1, 2]");
+    for (i = 0; i < DIMENSIONS - 1; i++) {
+        used += sprintf(js + used, "]");
+    }
+    for (i = 0; i < DEPTH; i++) {
+        used += sprintf(js + used, "}");
+    }
+
+    // declare rules for node_t.value
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          value
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for node_t.child, it's deserialized by the same context
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          child
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &ctx
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for node_t.matrix
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          matrix
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator of deserialization context");
+
+    ////////// check deep document
+    ret = yajp_deserialize_json_string(js, used + 1, &ctx, &root, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    for (i = 0, node = &root; i + 1 < DEPTH; i++, node = node->child) {
+        test_is_equal(node->value, i, "Structure wasn't deserialized correctly");
+        test_is_not_null(node->child, "Structure wasn't deserialized correctly");
+    }
+    test_is_equal(node->value, DEPTH - 1, "Structure wasn't deserialized correctly");
+    test_is_null(node->child, "Structure wasn't deserialized correctly");
+
+    for (i = 0, row = &node->matrix; i + 1 < DIMENSIONS; i++, row = row->rows) {
+        test_is_equal(row->final_dim, false, "Structure wasn't deserialized correctly");
+        test_is_equal(row->count, 1, "Structure wasn't deserialized correctly");
+    }
+    test_is_equal(row->final_dim, true, "Structure wasn't deserialized correctly");
+    test_is_equal(row->count, 2, "Structure wasn't deserialized correctly");
+    test_is_equal(((int *) row->elems)[1], 2, "Structure wasn't deserialized correctly");
+
+    yajp_deserialization_free(&ctx, &root);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    ////////// check document broken inside of matrix
+    memcpy(strstr(js, "[1, 2]"), "[1, x]", sizeof("[1, x]") - 1);
+    memset(&root, 0, sizeof(root));
+
+    ret = yajp_deserialize_json_string(js, used + 1, &ctx, &root, NULL);
+    test_is_not_equal(ret, 0, "Broken document was deserialized");
+
+    // children what weren't stored into structure are released by deserialization
+    yajp_deserialization_free(&ctx, &root);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    return TEST_RESULT_PASSED;
+
+#undef DEPTH
+#undef DIMENSIONS
+}
+
+static test_result_t yajp_deserialize_json_test_max_depth() {
+    typedef struct node node_t;
+    struct node {
+        int value;
+        node_t *child;
+        array_handle_t matrix;
+    };
+
+#define DEPTH       300
+#define DIMENSIONS  40
+
+    static char js[16384];
+    static const char skipped_js[] = "{\"value\":1, \"unknown\":[[[[[[1]]]]]]}";
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[3];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    node_t root = { 0 }, *node;
+    array_handle_t *row;
+    size_t used = 0, i;
+    int ret;
+
+    // {"value":0, "child":{"value":1, "child":{ ... "matrix":[[[ ... [1, 2] ... ]]]}}}
+    for (i = 0; i < DEPTH; i++) {
+        used += sprintf(js + used, (0 == i) ? "{\"value\":%zu" : ", \"child\":{\"value\":%zu", i);
+    }
+    used += sprintf(js + used, ", \"matrix\":");
+    for (i = 0; i < DIMENSIONS - 1; i++) {
+        used += sprintf(js + used, "[");
+    }
+    used += sprintf(js + used, "[1, 2]");
+    for (i = 0; i < DIMENSIONS - 1; i++) {
+        used += sprintf(js + used, "]");
+    }
+    for (i = 0; i < DEPTH; i++) {
+        used += sprintf(js + used, "}");
+    }
+
+    // declare rules for node_t.value
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          value
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for node_t.child, it's deserialized by the same context
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          child
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &ctx
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for node_t.matrix
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          matrix
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator of deserialization context");
+
+    ret = yajp_deserialization_context_set_max_depth(&ctx, 0);
+    test_is_equal(ret, -1, "Zero depth was accepted");
+    test_is_equal(errno, EINVAL, "Unexpected errno: %d", errno);
+    test_is_equal(ctx.max_depth, YAJP_DESERIALIZATION_DEFAULT_MAX_DEPTH, "Default depth was changed");
+
+    ////////// check document deeper than fixed parser stack of old versions with default limit, then with exact one
+    for (i = 0; i < 2; i++) {
+        if (1 == i) {
+            ret = yajp_deserialization_context_set_max_depth(&ctx, DEPTH + DIMENSIONS);
+            test_is_equal(ret, 0, "Failed to set maximal depth");
+        }
+
+        memset(&root, 0, sizeof(root));
+        ret = yajp_deserialize_json_string(js, used + 1, &ctx, &root, NULL);
+        test_is_equal(ret, 0, "Deserialization failed");
+
+        for (node = &root; NULL != node->child; node = node->child);
+        test_is_equal(node->value, DEPTH - 1, "Structure wasn't deserialized correctly");
+
+        for (row = &node->matrix; !row->final_dim; row = row->rows);
+        test_is_equal(((int *) row->elems)[1], 2, "Structure wasn't deserialized correctly");
+
+        yajp_deserialization_free(&ctx, &root);
+        test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                      stat.allocations);
+    }
+    ////////// ==========================================
+
+    ////////// check presized parser stack
+    ret = yajp_deserialization_context_set_stack_depth(&ctx, DEPTH + DIMENSIONS);
+    test_is_equal(ret, 0, "Failed to set parser stack depth");
+
+    memset(&root, 0, sizeof(root));
+    ret = yajp_deserialize_json_string(js, used + 1, &ctx, &root, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    yajp_deserialization_free(&ctx, &root);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    ////////// check document deeper than limit
+    ret = yajp_deserialization_context_set_max_depth(&ctx, DEPTH + DIMENSIONS - 1);
+    test_is_equal(ret, 0, "Failed to set maximal depth");
+
+    memset(&root, 0, sizeof(root));
+    errno = 0;
+    ret = yajp_deserialize_json_string(js, used + 1, &ctx, &root, NULL);
+    test_is_equal(ret, -1, "Too deep document was deserialized");
+    test_is_equal(errno, EOVERFLOW, "Unexpected errno: %d", errno);
+
+    yajp_deserialization_free(&ctx, &root);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    ////////// check skipped value deeper than limit
+    ret = yajp_deserialization_context_set_max_depth(&ctx, 4);
+    test_is_equal(ret, 0, "Failed to set maximal depth");
+
+    memset(&root, 0, sizeof(root));
+    errno = 0;
+    ret = yajp_deserialize_json_string(skipped_js, sizeof(skipped_js), &ctx, &root, NULL);
+    test_is_equal(ret, -1, "Too deep document was deserialized");
+    test_is_equal(errno, EOVERFLOW, "Unexpected errno: %d", errno);
+
+    yajp_deserialization_free(&ctx, &root);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    return TEST_RESULT_PASSED;
+
+#undef DEPTH
+#undef DIMENSIONS
+}
+
+static test_result_t yajp_deserialize_json_test_read_ahead() {
+    typedef struct {
+        char *name;
+        array_handle_t values;
+    } document_t;
+
+#define ELEMENTS_COUNT  20000
+#define BLOCK_SIZE      1024
+
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    document_t document;
+    size_t used = 0, written, i;
+    char *js;
+    FILE *json;
+    int ret, fds[2], status;
+    pid_t writer;
+
+    // {"name":"read ahead", "values":[0, 1, ... ]} with terminating zero, so it spans many blocks
+    js = malloc(ELEMENTS_COUNT * 8 + 64);
+    test_is_not_null(js, "Failed to allocate document");
+
+    used += sprintf(js + used, "{\"name\":\"read ahead\", \"values\":[");
+    for (i = 0; i < ELEMENTS_COUNT; i++) {
+        used += sprintf(js + used, (i + 1 < ELEMENTS_COUNT) ? "%zu, " : "%zu]}", i);
+    }
+    used++;
+
+    // declare rules for document_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for document_t.values
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          values
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator of deserialization context");
+
+    ret = yajp_deserialization_context_set_read_ahead(&ctx, BLOCK_SIZE);
+    test_is_equal(ret, 0, "Failed to set read-ahead mode");
+
+    ////////// check pipe what is written slower than it's parsed
+    ret = pipe(fds);
+    test_is_equal(ret, 0, "Failed to create pipe");
+
+    writer = fork();
+    test_is_not_equal(writer, -1, "Failed to start writer");
+
+    if (0 == writer) {
+        close(fds[0]);
+        for (written = 0, i = 0; written < used; written += BLOCK_SIZE / 3, i++) {
+            if (write(fds[1], js + written, (used - written < BLOCK_SIZE / 3) ? used - written : BLOCK_SIZE / 3) < 0) {
+                _exit(EXIT_FAILURE);
+            }
+            if (0 == i % 16) {
+                usleep(1000);
+            }
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+    json = fdopen(fds[0], "r");
+    test_is_not_null(json, "Failed to open pipe");
+
+    memset(&document, 0, sizeof(document));
+    ret = yajp_deserialize_json_stream(json, &ctx, &document, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    fclose(json);
+    waitpid(writer, &status, 0);
+    test_is_true(WIFEXITED(status) && EXIT_SUCCESS == WEXITSTATUS(status), "Writer failed");
+
+    test_is_equal(strcmp(document.name, "read ahead"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(document.values.count, ELEMENTS_COUNT, "Structure wasn't deserialized correctly");
+    for (i = 0; i < ELEMENTS_COUNT; i++) {
+        test_is_equal(((int *) document.values.elems)[i], (int) i, "Element %zu wasn't deserialized correctly", i);
+    }
+
+    yajp_deserialization_free(&ctx, &document);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    ////////// check file what is broken in the middle: reader is stopped before end of stream
+    json = tmpfile();
+    test_is_not_null(json, "Failed to create file");
+
+    js[used / 2] = '?';
+    written = fwrite(js, 1, used, json);
+    test_is_equal(written, used, "Failed to write file");
+    rewind(json);
+
+    memset(&document, 0, sizeof(document));
+    errno = 0;
+    ret = yajp_deserialize_json_stream(json, &ctx, &document, NULL);
+    test_is_equal(ret, -1, "Broken document was deserialized");
+    test_is_not_equal(errno, 0, "Errno isn't set");
+
+    fclose(json);
+
+    yajp_deserialization_free(&ctx, &document);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    free(js);
+
+    return TEST_RESULT_PASSED;
+
+#undef ELEMENTS_COUNT
+#undef BLOCK_SIZE
+}
+
+typedef struct session_node session_node_t;
+struct session_node {
+    int value;
+    session_node_t *child;
+    int nested;
+};
+
+/*
+ * Setter deserializes another document while outer one is being deserialized on the same thread
+ */
+static int nested_deserialization_setter(const uint8_t *name, size_t name_size, const uint8_t *value,
+                                         size_t value_size, void *field, void *user_data) {
+    static const char nested_js[] = "{\"value\":42}";
+    session_node_t nested = { 0 };
+    int ret;
+
+    (void) name;
+    (void) name_size;
+    (void) value;
+    (void) value_size;
+
+    ret = yajp_deserialize_json_string(nested_js, sizeof(nested_js), user_data, &nested, NULL);
+    *((int *) field) = nested.value;
+
+    return ret;
+}
+
+static test_result_t yajp_deserialize_json_test_thread_session() {
+#define DEPTH       300
+
+    static char js[16384];
+    static const char nested_js[] = "{\"value\":1, \"nested\":0}";
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[3];
+    session_node_t root = { 0 }, *node;
+    size_t used = 0, i;
+    int ret;
+
+    // {"value":0, "child":{"value":1, "child":{ ... }}}
+    for (i = 0; i < DEPTH; i++) {
+        used += sprintf(js + used, (0 == i) ? "{\"value\":%zu" : ", \"child\":{\"value\":%zu", i);
+    }
+    for (i = 0; i < DEPTH; i++) {
+        used += sprintf(js + used, "}");
+    }
+
+    // declare rules for session_node_t.value
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   session_node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          value
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for session_node_t.child, it's deserialized by the same context
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   session_node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          child
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &ctx
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for session_node_t.nested
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   session_node_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          nested
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     nested_deserialization_setter
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // context without allocator uses heap, so its deserializations keep memory in session of thread
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ////////// check that grown stack of kept parser doesn't lift lower limit of next document
+    for (i = 0; i < 3; i++) {
+        ret = yajp_deserialization_context_set_max_depth(&ctx, (1 == i) ? DEPTH - 1 : DEPTH);
+        test_is_equal(ret, 0, "Failed to set maximal depth");
+
+        memset(&root, 0, sizeof(root));
+        errno = 0;
+        ret = yajp_deserialize_json_string(js, used + 1, &ctx, &root, NULL);
+        if (1 == i) {
+            test_is_equal(ret, -1, "Too deep document was deserialized with kept parser");
+            test_is_equal(errno, EOVERFLOW, "Unexpected errno: %d", errno);
+        } else {
+            test_is_equal(ret, 0, "Deserialization failed");
+            for (node = &root; NULL != node->child; node = node->child);
+            test_is_equal(node->value, DEPTH - 1, "Structure wasn't deserialized correctly");
+        }
+
+        yajp_deserialization_free(&ctx, &root);
+    }
+    ////////// ==========================================
+
+    ////////// check deserialization started by setter while session is used by outer one
+    memset(&root, 0, sizeof(root));
+    ret = yajp_deserialize_json_string(nested_js, sizeof(nested_js), &ctx, &root, &ctx);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_equal(root.value, 1, "Structure wasn't deserialized correctly");
+    test_is_equal(root.nested, 42, "Nested structure wasn't deserialized correctly");
+    ////////// ==========================================
+
+    ////////// check released session is created again
+    yajp_deserialization_release_thread_session();
+    yajp_deserialization_release_thread_session();
+
+    memset(&root, 0, sizeof(root));
+    ret = yajp_deserialize_json_string(js, used + 1, &ctx, &root, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    yajp_deserialization_free(&ctx, &root);
+
+    yajp_deserialization_release_thread_session();
+    ////////// ==========================================
+
+    return TEST_RESULT_PASSED;
+
+#undef DEPTH
+}
+
+typedef struct step_document step_document_t;
+struct step_document {
+    int id;
+    char *name;
+    array_handle_t values;
+    step_document_t *child;
+};
+
+static int init_step_context(yajp_deserialization_rule_t *actions, yajp_deserialization_context_t *ctx) {
+    int ret;
+
+    // declare rules for step_document_t.id
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   step_document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for step_document_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   step_document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for step_document_t.values
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   step_document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          values
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for step_document_t.child, it's deserialized by the same context
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   step_document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          child
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             ctx
+    #define YAJP_DESERIALIZATION_RULE                       &actions[3]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    return yajp_deserialization_context_init(actions, 4, ctx);
+}
+
+/*
+ * Document of step tests. Tokens are longer than parts of input and than buffer of lexer, skipped values hold
+ * brackets inside of strings
+ */
+static const char step_js[] = "{\"id\":1, \"name\":\"string which is longer than internal buffer of lexer token\","
+                              " \"skipped\":{\"a\":[1, {\"b\":\"}]\"}]}, \"values\":[1, 2, 3, 4, 5, 6, 7, 8, 9, 10],"
+                              " \"child\":{\"id\":2, \"unknown\":true, \"name\":\"child\", \"values\":[],"
+                              " \"child\":{\"id\":-3}}, \"tail\":-1.5e+10}";
+
+static bool step_document_is_valid(const step_document_t *document) {
+    return 1 == document->id &&
+           NULL != document->name &&
+           0 == strcmp(document->name, "string which is longer than internal buffer of lexer token") &&
+           10 == document->values.count &&
+           10 == ((int *) document->values.elems)[9] &&
+           NULL != document->child &&
+           2 == document->child->id &&
+           NULL != document->child->name &&
+           0 == strcmp(document->child->name, "child") &&
+           0 == document->child->values.count &&
+           NULL != document->child->child &&
+           -3 == document->child->child->id &&
+           NULL == document->child->child->child;
+}
+
+static test_result_t yajp_deserialize_json_test_step() {
+#define STATES_COUNT    3
+
+    static const size_t part_sizes[] = { 1, 7, sizeof(step_js) - 1 };
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[4];
+    yajp_step_state_t *states[STATES_COUNT];
+    step_document_t documents[STATES_COUNT];
+    size_t offset, part_size, i, j;
+    bool done;
+    int ret;
+
+    ret = init_step_context(actions, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ////////// check document passed by parts of different sizes
+    for (i = 0; i < ARR_LEN(part_sizes); i++) {
+        memset(&documents[0], 0, sizeof(documents[0]));
+        ret = yajp_step_start(&ctx, &documents[0], NULL, &states[0]);
+        test_is_equal(ret, 0, "Failed to start deserialization");
+
+        for (offset = 0; offset < sizeof(step_js) - 1; offset += part_size) {
+            part_size = (sizeof(step_js) - 1 - offset < part_sizes[i]) ? sizeof(step_js) - 1 - offset : part_sizes[i];
+            ret = yajp_step(states[0], step_js + offset, part_size, false);
+            test_is_equal(ret, YAJP_STEP_NEED_MORE_INPUT, "Unexpected result %d of part at %zu", ret, offset);
+        }
+
+        // closing bracket can't be told from the beginning of longer token till the end of input
+        ret = yajp_step(states[0], NULL, 0, true);
+        test_is_equal(ret, 0, "Deserialization by parts of %zu bytes failed", part_sizes[i]);
+        test_is_true(step_document_is_valid(&documents[0]), "Structure wasn't deserialized correctly");
+
+        ret = yajp_step(states[0], "{", 1, true);
+        test_is_equal(ret, 0, "Finished document changed its result");
+
+        yajp_step_release(states[0]);
+        yajp_deserialization_free(&ctx, &documents[0]);
+    }
+    ////////// ==========================================
+
+    ////////// check interleaved documents
+    for (i = 0; i < STATES_COUNT; i++) {
+        memset(&documents[i], 0, sizeof(documents[i]));
+        ret = yajp_step_start(&ctx, &documents[i], NULL, &states[i]);
+        test_is_equal(ret, 0, "Failed to start deserialization");
+    }
+
+    // document of every state is split by parts of its own size, so their tokens are split in different places
+    for (offset = 0, done = false; !done; offset++) {
+        done = true;
+        for (i = 0; i < STATES_COUNT; i++) {
+            part_size = 3 + i;
+            j = offset * part_size;
+            if (j >= sizeof(step_js) - 1) {
+                continue;
+            }
+
+            part_size = (sizeof(step_js) - 1 - j < part_size) ? sizeof(step_js) - 1 - j : part_size;
+            ret = yajp_step(states[i], step_js + j, part_size, j + part_size == sizeof(step_js) - 1);
+            test_is_not_equal(ret, -1, "Interleaved deserialization failed with errno %d", errno);
+            done = false;
+        }
+    }
+
+    for (i = 0; i < STATES_COUNT; i++) {
+        test_is_true(step_document_is_valid(&documents[i]), "Interleaved structure wasn't deserialized correctly");
+        yajp_step_release(states[i]);
+        yajp_deserialization_free(&ctx, &documents[i]);
+    }
+    ////////// ==========================================
+
+    return TEST_RESULT_PASSED;
+
+#undef STATES_COUNT
+}
+
+static test_result_t yajp_deserialize_json_test_step_errors() {
+    static const char broken_js[] = "{\"id\":1, \"values\":[1, 2], \"name\":}";
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[4];
+    yajp_step_state_t *state;
+    step_document_t document;
+    size_t offset;
+    int ret, error;
+
+    ret = init_step_context(actions, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator");
+
+    ////////// check broken document fails as it fails in one piece
+    memset(&document, 0, sizeof(document));
+    errno = 0;
+    ret = yajp_deserialize_json_string(broken_js, sizeof(broken_js), &ctx, &document, NULL);
+    error = errno;
+    test_is_equal(ret, -1, "Broken document was deserialized");
+    yajp_deserialization_free(&ctx, &document);
+
+    memset(&document, 0, sizeof(document));
+    ret = yajp_step_start(&ctx, &document, NULL, &state);
+    test_is_equal(ret, 0, "Failed to start deserialization");
+
+    for (offset = 0, ret = YAJP_STEP_NEED_MORE_INPUT; YAJP_STEP_NEED_MORE_INPUT == ret; offset += 3) {
+        errno = 0;
+        ret = yajp_step(state, broken_js + offset, (offset + 3 < sizeof(broken_js) - 1) ? 3 : sizeof(broken_js) - 1 - offset,
+                        offset + 3 >= sizeof(broken_js) - 1);
+    }
+    test_is_equal(ret, -1, "Broken document was deserialized by parts");
+    test_is_equal(errno, error, "Expected errno %d, got %d", error, errno);
+
+    errno = 0;
+    ret = yajp_step(state, "}", 1, true);
+    test_is_equal(ret, -1, "Failed document changed its result");
+    test_is_equal(errno, error, "Failed document changed its errno to %d", errno);
+
+    yajp_step_release(state);
+    yajp_deserialization_free(&ctx, &document);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    ////////// check document abandoned inside of nested object and array
+    memset(&document, 0, sizeof(document));
+    ret = yajp_step_start(&ctx, &document, NULL, &state);
+    test_is_equal(ret, 0, "Failed to start deserialization");
+
+    offset = strstr(step_js, "\"values\":[]") - step_js + 2;
+    ret = yajp_step(state, step_js, offset, false);
+    test_is_equal(ret, YAJP_STEP_NEED_MORE_INPUT, "Unexpected result %d of incomplete document", ret);
+
+    yajp_step_release(state);
+    yajp_deserialization_free(&ctx, &document);
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+    ////////// ==========================================
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_interned_array() {
+    typedef struct {
+        const char *primary;
+        array_handle_t regions;
+    } test_struct_t;
+
+    static const char js[] = "{ \"primary\":\"eu\", \"regions\":[\"eu\", \"us\", \"eu\", \"ap\"] }";
+    static const size_t js_size = sizeof(js);
+
+    yajp_deserialization_intern_pool_t pool;
+    yajp_deserialization_context_t ctx;
+    int ret;
+    yajp_deserialization_rule_t actions[2], rejected;
+    test_struct_t test_struct = { 0 };
+    const char **regions;
+
+    ret = yajp_deserialization_intern_pool_init(4, &pool);
+    test_is_equal(ret, 0, "Failed to initialize pool");
+
+    // declare rules for test_struct_t.primary
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          primary
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_interned_string
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &pool
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.regions
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          regions
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_interned_string
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &pool
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         const char *
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // interned string is owned by pool, so it can't be stored in allocated field
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          primary
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_interned_string
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &pool
+    #define YAJP_DESERIALIZATION_RULE                       &rejected
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_not_equal(ret, 0, "Allocated field of interned string was accepted");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialize_json_string(js, js_size, &ctx, &test_struct, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    // elements point into pool, equal strings share the same copy
+    regions = test_struct.regions.elems;
+    test_is_equal(test_struct.regions.count, 4, "Expected 4 regions, got %zu", test_struct.regions.count);
+    test_is_equal(strcmp(regions[1], "us"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(strcmp(regions[3], "ap"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(regions[0], test_struct.primary, "Element isn't interned");
+    test_is_equal(regions[2], test_struct.primary, "Element isn't interned");
+    test_is_equal(regions[1], yajp_deserialization_intern(&pool, (const uint8_t *) "us", 2), "Element isn't interned");
+
+    // elements are released with array, strings stay in pool
+    yajp_deserialization_free(&ctx, &test_struct);
+    test_is_null(test_struct.regions.elems, "Released pointer wasn't reset");
+    test_is_equal(test_struct.regions.count, 0, "Counter of released array wasn't reset");
+    test_is_equal(strcmp(test_struct.primary, "eu"), 0, "Interned string was released");
+
+    yajp_deserialization_context_release(&ctx);
+    yajp_deserialization_intern_pool_release(&pool);
+
+    return TEST_RESULT_PASSED;
+}
+
+#define DEEP_DEPTH          1000
+#define DEEP_STACK_SIZE     (32 * 1024)
+
+/*
+ * Document deserialized by steps on thread with small stack, where release of deep nesting by recursion overflows it
+ */
+typedef struct {
+    const yajp_deserialization_context_t *ctx;
+    const char *js;
+    size_t js_size;
+    bool last;
+    int result;
+    size_t depth;       // depth of "child" chain of complete document
+} step_deep_t;
+
+static void *step_deep_routine(void *arg) {
+    step_deep_t *deep = arg;
+    yajp_step_state_t *state;
+    step_document_t document;
+    step_document_t *child;
+
+    memset(&document, 0, sizeof(document));
+    if (0 != yajp_step_start(deep->ctx, &document, NULL, &state)) {
+        deep->result = -1;
+        return NULL;
+    }
+
+    deep->result = yajp_step(state, deep->js, deep->js_size, deep->last);
+    yajp_step_release(state);
+
+    for (child = document.child; NULL != child; child = child->child) {
+        deep->depth++;
+    }
+
+    yajp_deserialization_free(deep->ctx, &document);
+
+    return NULL;
+}
+
+/*
+ * Write {"id":0, "child":{"id":1, "child":{"child":{ ... {"id":2} ... }}, "name":"deep"} or, if document isn't
+ * complete, abandon it in the last string, when deep "child" chain is done
+ */
+static size_t write_deep_document(char *js, bool complete) {
+    size_t used = 0, i;
+
+    used += sprintf(js + used, "{\"id\":0, \"child\":{\"id\":1, \"child\":");
+    for (i = 0; i < DEEP_DEPTH; i++) {
+        used += sprintf(js + used, "{\"child\":");
+    }
+    used += sprintf(js + used, "{\"id\":2}");
+    for (i = 0; i < DEEP_DEPTH; i++) {
+        used += sprintf(js + used, "}");
+    }
+    used += sprintf(js + used, complete ? ", \"name\":\"deep\"}}" : ", \"name\":\"abandoned");
+
+    return used;
+}
+
+static test_result_t run_deep_document(bool complete, step_deep_t *deep) {
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[4];
+    pthread_attr_t attr;
+    pthread_t thread;
+    char *js;
+    int ret;
+
+    ret = init_step_context(actions, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    test_is_equal(ret, 0, "Failed to set allocator");
+
+    ret = yajp_deserialization_context_set_max_depth(&ctx, DEEP_DEPTH + 8);
+    test_is_equal(ret, 0, "Failed to set maximal depth");
+
+    js = malloc(DEEP_DEPTH * 16 + 64);
+    test_is_not_null(js, "Failed to allocate document");
+
+    memset(deep, 0, sizeof(*deep));
+    deep->ctx = &ctx;
+    deep->js = js;
+    deep->js_size = write_deep_document(js, complete);
+    deep->last = complete;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, DEEP_STACK_SIZE);
+    ret = pthread_create(&thread, &attr, step_deep_routine, deep);
+    pthread_attr_destroy(&attr);
+    test_is_equal(ret, 0, "Failed to start thread");
+    pthread_join(thread, NULL);
+
+    free(js);
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_step_deep_abort() {
+    step_deep_t deep;
+    test_result_t result;
+
+    // document is abandoned in allocated object "child" of root, so release of failed object walks the whole chain
+    result = run_deep_document(false, &deep);
+    if (TEST_RESULT_PASSED != result) {
+        return result;
+    }
+
+    test_is_equal(deep.result, YAJP_STEP_NEED_MORE_INPUT, "Unexpected result %d of incomplete document", deep.result);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_json_test_step_deep_free() {
+    step_deep_t deep;
+    test_result_t result;
+
+    // complete document is released by yajp_deserialization_free() on the same small stack
+    result = run_deep_document(true, &deep);
+    if (TEST_RESULT_PASSED != result) {
+        return result;
+    }
+
+    test_is_equal(deep.result, 0, "Deserialization failed with errno %d", errno);
+    test_is_equal(deep.depth, DEEP_DEPTH + 2, "Expected chain of %d objects, got %zu", DEEP_DEPTH + 2, deep.depth);
+
+    return TEST_RESULT_PASSED;
+}
+
+#undef DEEP_STACK_SIZE
+#undef DEEP_DEPTH
+
+static test_result_t yajp_deserialize_json_test_reuse_steady_state() {
+    typedef struct {
+        char *name;
+        size_t name_capacity;
+        int *id;
+        bool *active;
+    } test_struct_t;
+
+    // strings of varying length and allocated numbers and booleans
+    static const char *const js[] = {
+            "{\"name\":\"aaaaaaaa\", \"id\":1, \"active\":true}",
+            "{\"name\":\"a\", \"id\":1234567, \"active\":false}",
+    };
+
+    yajp_deserialization_context_t ctx, empty_ctx;
+    yajp_deserialization_rule_t actions[3];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    test_struct_t test_struct = { 0 };
+    counting_allocator_stat_t before, transient;
+    size_t i;
+    int ret;
+
+    // declare rules for test_struct_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_STRING_CAPACITY            name_capacity
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.id
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    // declare rules for test_struct_t.active
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   test_struct_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          active
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_BOOLEAN)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_bool
+    #define YAJP_DESERIALIZATION_RULE                       &actions[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    test_is_equal(ret, 0, "Failed to initialize action");
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, ARR_LEN(actions), &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+    yajp_deserialization_context_set_allocator(&ctx, &allocator);
+    yajp_deserialization_context_set_reuse(&ctx, true);
+
+    // context without rules skips whole document, so it allocates only memory of lexer and parser
+    ret = yajp_deserialization_context_init(actions, 0, &empty_ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+    yajp_deserialization_context_set_allocator(&empty_ctx, &allocator);
+
+    // the first document is warm-up, then lengths of name alternate without allocations of output
+    for (i = 0; i < 6; i++) {
+        before = stat;
+        ret = yajp_deserialize_json_string(js[i % 2], strlen(js[i % 2]) + 1, &empty_ctx, &test_struct, NULL);
+        test_is_equal(ret, 0, "Deserialization failed");
+        transient.allocations = stat.allocations - before.allocations;
+        transient.reallocations = stat.reallocations - before.reallocations;
+
+        before = stat;
+        ret = yajp_deserialize_json_string(js[i % 2], strlen(js[i % 2]) + 1, &ctx, &test_struct, NULL);
+        test_is_equal(ret, 0, "Deserialization failed");
+
+        if (0 < i) {
+            test_is_equal(stat.allocations - before.allocations, transient.allocations,
+                          "Output memory was allocated for document %zu", i);
+            test_is_equal(stat.reallocations - before.reallocations, transient.reallocations,
+                          "Output memory was reallocated for document %zu", i);
+        }
+    }
+
+    test_is_equal(strcmp(test_struct.name, "a"), 0, "Structure wasn't deserialized correctly");
+    test_is_equal(test_struct.name_capacity, 9, "Expected capacity 9, got %zu", test_struct.name_capacity);
+    test_is_equal(*test_struct.id, 1234567, "Structure wasn't deserialized correctly");
+    test_is_equal(*test_struct.active, false, "Structure wasn't deserialized correctly");
+
+    yajp_deserialization_free(&ctx, &test_struct);
+    test_is_null(test_struct.name, "Released pointer wasn't reset");
+    test_is_equal(test_struct.name_capacity, 0, "Capacity of released string wasn't reset");
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    return TEST_RESULT_PASSED;
+}
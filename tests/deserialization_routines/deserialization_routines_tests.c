@@ -22,6 +22,8 @@
 
 #include <limits.h>
 #include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "yajp/deserialization_routine.h"
 
@@ -73,6 +75,32 @@ static test_result_t yajp_set_bool_test_false();
 static test_result_t yajp_set_bool_test_invalid_string();
 static test_result_t yajp_set_bool_test_valid_in_content_but_invalid_as_value();
 
+static test_result_t yajp_set_timestamp_test_null();
+static test_result_t yajp_set_timestamp_test_utc();
+static test_result_t yajp_set_timestamp_test_fraction_and_offset();
+static test_result_t yajp_set_timestamp_test_before_epoch();
+static test_result_t yajp_set_timestamp_test_invalid_layout();
+static test_result_t yajp_set_timestamp_test_invalid_date();
+static test_result_t yajp_set_timestamp_test_out_of_range();
+
+static test_result_t yajp_set_enum_test_init_duplicates();
+static test_result_t yajp_set_enum_test_known_values();
+static test_result_t yajp_set_enum_test_unknown_value();
+static test_result_t yajp_set_enum_test_unknown_value_with_default();
+static test_result_t yajp_set_enum_test_many_values();
+
+static test_result_t yajp_set_base64_test_standard();
+static test_result_t yajp_set_base64_test_url();
+static test_result_t yajp_set_base64_test_escaped_solidus();
+static test_result_t yajp_set_base64_test_invalid_string();
+static test_result_t yajp_set_base64_test_too_long_value();
+static test_result_t yajp_set_base64_test_every_digit();
+
+static test_result_t yajp_set_interned_string_test_same_value();
+static test_result_t yajp_set_interned_string_test_different_values();
+static test_result_t yajp_set_interned_string_test_many_values();
+static test_result_t yajp_set_interned_string_test_concurrent_values();
+
 /* test suite declaration and initialization */
 const test_case_t test_suite[] = {
         REGISTER_TEST_CASE(yajp_set_short_test_null, 1, yajp_set_short, "when value is NULL"),
@@ -121,6 +149,32 @@ const test_case_t test_suite[] = {
         REGISTER_TEST_CASE(yajp_set_bool_test_false, 4, yajp_set_short, "when value is 'false'"),
         REGISTER_TEST_CASE(yajp_set_bool_test_invalid_string, 5, yajp_set_short, "when value is invalid string"),
         REGISTER_TEST_CASE(yajp_set_bool_test_valid_in_content_but_invalid_as_value, 6, yajp_set_short, "when value have valid content but not valid as expected value, i.e. 'tRUe'"),
+
+        REGISTER_TEST_CASE(yajp_set_timestamp_test_null, 1, yajp_set_timestamp, "when value is NULL"),
+        REGISTER_TEST_CASE(yajp_set_timestamp_test_utc, 2, yajp_set_timestamp, "when value is UTC timestamp"),
+        REGISTER_TEST_CASE(yajp_set_timestamp_test_fraction_and_offset, 3, yajp_set_timestamp, "when value have fraction of second and time offset"),
+        REGISTER_TEST_CASE(yajp_set_timestamp_test_before_epoch, 4, yajp_set_timestamp, "when value is before Unix epoch"),
+        REGISTER_TEST_CASE(yajp_set_timestamp_test_invalid_layout, 5, yajp_set_timestamp, "when value have invalid layout"),
+        REGISTER_TEST_CASE(yajp_set_timestamp_test_invalid_date, 6, yajp_set_timestamp, "when value have invalid date, i.e. '2021-02-29'"),
+        REGISTER_TEST_CASE(yajp_set_timestamp_test_out_of_range, 7, yajp_set_timestamp, "when value can't be represented in nanoseconds"),
+
+        REGISTER_TEST_CASE(yajp_set_enum_test_init_duplicates, 1, yajp_deserialization_enum_init, "when enumeration have duplicated names"),
+        REGISTER_TEST_CASE(yajp_set_enum_test_known_values, 2, yajp_set_enum, "when value is enumeration item"),
+        REGISTER_TEST_CASE(yajp_set_enum_test_unknown_value, 3, yajp_set_enum, "when value isn't enumeration item"),
+        REGISTER_TEST_CASE(yajp_set_enum_test_unknown_value_with_default, 4, yajp_set_enum, "when value isn't enumeration item and default value is used"),
+        REGISTER_TEST_CASE(yajp_set_enum_test_many_values, 5, yajp_set_enum, "when enumeration have many items"),
+
+        REGISTER_TEST_CASE(yajp_set_base64_test_standard, 1, yajp_set_base64, "when value is encoded with standard alphabet"),
+        REGISTER_TEST_CASE(yajp_set_base64_test_url, 2, yajp_set_base64, "when value is encoded with URL and filename safe alphabet"),
+        REGISTER_TEST_CASE(yajp_set_base64_test_escaped_solidus, 3, yajp_set_base64, "when value contains escaped solidus"),
+        REGISTER_TEST_CASE(yajp_set_base64_test_invalid_string, 4, yajp_set_base64, "when value is invalid base64 string"),
+        REGISTER_TEST_CASE(yajp_set_base64_test_too_long_value, 5, yajp_set_base64, "when decoded value is larger than field"),
+        REGISTER_TEST_CASE(yajp_set_base64_test_every_digit, 6, yajp_set_base64, "when every character is placed at different offsets of long value"),
+
+        REGISTER_TEST_CASE(yajp_set_interned_string_test_same_value, 1, yajp_set_interned_string, "when value is already interned"),
+        REGISTER_TEST_CASE(yajp_set_interned_string_test_different_values, 2, yajp_set_interned_string, "when values differ"),
+        REGISTER_TEST_CASE(yajp_set_interned_string_test_many_values, 3, yajp_deserialization_intern, "when pool has more values than buckets"),
+        REGISTER_TEST_CASE(yajp_set_interned_string_test_concurrent_values, 4, yajp_deserialization_intern, "when values are interned by multiple threads"),
 };
 
 /* test suite tests count declaration and initialization */
@@ -718,3 +772,589 @@ static test_result_t yajp_set_bool_test_valid_in_content_but_invalid_as_value()
 
     return TEST_RESULT_PASSED;
 }
+
+static test_result_t yajp_set_timestamp_test_null() {
+    static const char *value = NULL;
+    static const size_t value_size = 0;
+    int64_t result = -1;
+    int ret;
+
+    ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) value, value_size, &result, NULL);
+
+    test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned 0");
+    test_is_equal(result, -1, FUNC_NAME(yajp_set_timestamp)" set 'result'");
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_timestamp_test_utc() {
+    static const char value[] = "2021-03-14T15:09:26Z";
+    static const size_t value_size = str_size_without_null(value);
+    int64_t result = -1;
+    int ret;
+
+    ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) value, value_size, &result, NULL);
+
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned error");
+    test_is_equal(result, 1615734566000000000LL, FUNC_NAME(yajp_set_timestamp)" set wrong 'result': %lld", (long long) result);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_timestamp_test_fraction_and_offset() {
+    static const char value1[] = "2020-02-29 23:59:59.123456789123+03:30";
+    static const char value2[] = "2020-02-29t20:29:59.5z";
+    int64_t result = -1;
+    int ret;
+
+    ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) value1, str_size_without_null(value1), &result, NULL);
+
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned error");
+    test_is_equal(result, 1583008199123456789LL, FUNC_NAME(yajp_set_timestamp)" set wrong 'result': %lld", (long long) result);
+
+    ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) value2, str_size_without_null(value2), &result, NULL);
+
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned error");
+    test_is_equal(result, 1583008199500000000LL, FUNC_NAME(yajp_set_timestamp)" set wrong 'result': %lld", (long long) result);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_timestamp_test_before_epoch() {
+    static const char value[] = "1969-12-31T23:59:59.25-00:00";
+    static const size_t value_size = str_size_without_null(value);
+    int64_t result = -1;
+    int ret;
+
+    ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) value, value_size, &result, NULL);
+
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned error");
+    test_is_equal(result, -750000000LL, FUNC_NAME(yajp_set_timestamp)" set wrong 'result': %lld", (long long) result);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_timestamp_test_invalid_layout() {
+    static const char *values[] = {
+            "2021-03-14T15:09:26",          // no offset
+            "2021-03-14T15:09:26.Z",        // no fraction digits
+            "2021/03/14T15:09:26Z",         // bad date separator
+            "2021-03-14X15:09:26Z",         // bad date and time separator
+            "2021-03-1a T15:09:26Z",        // not a digit
+            "2021-03-14T15:09:26+0300",     // bad offset
+            "2021-03-14T15:09:26Z ",        // trailing garbage
+    };
+    int64_t result = -1;
+    int ret;
+    size_t i;
+
+    for (i = 0; i < ARR_LEN(values); i++) {
+        ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) values[i], strlen(values[i]), &result, NULL);
+
+        test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned 0 for '%s'", values[i]);
+        test_is_equal(result, -1, FUNC_NAME(yajp_set_timestamp)" set 'result'");
+    }
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_timestamp_test_invalid_date() {
+    static const char *values[] = {
+            "2021-02-29T00:00:00Z",
+            "1900-02-29T00:00:00Z",
+            "2021-13-01T00:00:00Z",
+            "2021-04-31T00:00:00Z",
+            "2021-04-30T24:00:00Z",
+            "2021-04-30T23:60:00Z",
+            "2021-04-30T23:00:00+24:00",
+    };
+    int64_t result = -1;
+    int ret;
+    size_t i;
+
+    for (i = 0; i < ARR_LEN(values); i++) {
+        ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) values[i], strlen(values[i]), &result, NULL);
+
+        test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned 0 for '%s'", values[i]);
+        test_is_equal(result, -1, FUNC_NAME(yajp_set_timestamp)" set 'result'");
+    }
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_timestamp_test_out_of_range() {
+    static const char value[] = "2300-01-01T00:00:00Z";
+    static const size_t value_size = str_size_without_null(value);
+    int64_t result = -1;
+    int ret;
+
+    ret = yajp_set_timestamp(NULL, 0, (const uint8_t *) value, value_size, &result, NULL);
+
+    test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_timestamp)" returned 0");
+    test_is_equal(result, -1, FUNC_NAME(yajp_set_timestamp)" set 'result'");
+
+    return TEST_RESULT_PASSED;
+}
+
+#define ENUM_ITEM(name, value) { name, str_size_without_null(name), value }
+
+static const yajp_deserialization_enum_item_t colors[] = {
+        ENUM_ITEM("red", 1),
+        ENUM_ITEM("green", 2),
+        ENUM_ITEM("blue", 3),
+        ENUM_ITEM("", 4),
+        ENUM_ITEM("light-goldenrod-yellow", 5),
+};
+
+static test_result_t yajp_set_enum_test_init_duplicates() {
+    static const yajp_deserialization_enum_item_t items[] = {
+            ENUM_ITEM("red", 1),
+            ENUM_ITEM("green", 2),
+            ENUM_ITEM("red", 3),
+    };
+    yajp_deserialization_enum_t enumeration;
+    int ret;
+
+    ret = yajp_deserialization_enum_init(items, ARR_LEN(items), false, 0, &enumeration);
+
+    test_is_not_equal(ret, 0, FUNC_NAME(yajp_deserialization_enum_init)" returned 0");
+    test_is_null(enumeration.slots, FUNC_NAME(yajp_deserialization_enum_init)" didn't release slots");
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_enum_test_known_values() {
+    yajp_deserialization_enum_t enumeration;
+    int result, ret;
+    size_t i;
+
+    ret = yajp_deserialization_enum_init(colors, ARR_LEN(colors), false, 0, &enumeration);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_enum_init)" returned error");
+
+    for (i = 0; i < ARR_LEN(colors); i++) {
+        result = -1;
+        ret = yajp_set_enum(NULL, 0, (const uint8_t *) colors[i].name, colors[i].name_size, &result, &enumeration);
+
+        test_is_equal(ret, 0, FUNC_NAME(yajp_set_enum)" returned error for '%s'", colors[i].name);
+        test_is_equal(result, colors[i].value, FUNC_NAME(yajp_set_enum)" set wrong 'result' for '%s': %d", colors[i].name, result);
+    }
+
+    yajp_deserialization_enum_release(&enumeration);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_enum_test_unknown_value() {
+    static const char *values[] = { "Red", "gree", "greens", "purple", "light-goldenrod-yellov" };
+    yajp_deserialization_enum_t enumeration;
+    int result = -1, ret;
+    size_t i;
+
+    ret = yajp_deserialization_enum_init(colors, ARR_LEN(colors), false, 0, &enumeration);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_enum_init)" returned error");
+
+    for (i = 0; i < ARR_LEN(values); i++) {
+        ret = yajp_set_enum(NULL, 0, (const uint8_t *) values[i], strlen(values[i]), &result, &enumeration);
+
+        test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_enum)" returned 0 for '%s'", values[i]);
+        test_is_equal(result, -1, FUNC_NAME(yajp_set_enum)" set 'result'");
+    }
+
+    yajp_deserialization_enum_release(&enumeration);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_enum_test_unknown_value_with_default() {
+    static const char value[] = "purple";
+    static const size_t value_size = str_size_without_null(value);
+    yajp_deserialization_enum_t enumeration;
+    int result = -1, ret;
+
+    ret = yajp_deserialization_enum_init(colors, ARR_LEN(colors), true, 42, &enumeration);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_enum_init)" returned error");
+
+    ret = yajp_set_enum(NULL, 0, (const uint8_t *) value, value_size, &result, &enumeration);
+
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_enum)" returned error");
+    test_is_equal(result, 42, FUNC_NAME(yajp_set_enum)" set wrong 'result': %d", result);
+
+    yajp_deserialization_enum_release(&enumeration);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_enum_test_many_values() {
+#define ITEMS_COUNT 1000
+    static char names[ITEMS_COUNT][8];
+    static yajp_deserialization_enum_item_t items[ITEMS_COUNT];
+    yajp_deserialization_enum_t enumeration;
+    int result, ret, i;
+
+    for (i = 0; i < ITEMS_COUNT; i++) {
+        items[i].name = names[i];
+        items[i].name_size = snprintf(names[i], sizeof(names[i]), "v%d", i);
+        items[i].value = i * 2;
+    }
+
+    ret = yajp_deserialization_enum_init(items, ITEMS_COUNT, false, 0, &enumeration);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_enum_init)" returned error");
+
+    for (i = 0; i < ITEMS_COUNT; i++) {
+        result = -1;
+        ret = yajp_set_enum(NULL, 0, (const uint8_t *) items[i].name, items[i].name_size, &result, &enumeration);
+
+        test_is_equal(ret, 0, FUNC_NAME(yajp_set_enum)" returned error for '%s'", items[i].name);
+        test_is_equal(result, items[i].value, FUNC_NAME(yajp_set_enum)" set wrong 'result' for '%s': %d", items[i].name, result);
+    }
+
+    yajp_deserialization_enum_release(&enumeration);
+
+    return TEST_RESULT_PASSED;
+#undef ITEMS_COUNT
+}
+
+typedef struct {
+    uint8_t data[32];
+    size_t data_size;
+} binary_field_t;
+
+static test_result_t yajp_set_base64_test_standard() {
+    static const struct {
+        const char *value;
+        const char *expected;
+    } values[] = {
+            { "", "" },
+            { "Zg==", "f" },
+            { "Zm8=", "fo" },
+            { "Zm9v", "foo" },
+            { "Zm9vYg", "foob" },
+            { "Zm9vYmE", "fooba" },
+            { "Zm9vYmFy", "foobar" },
+            { "VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVy", "The quick brown fox jumps over" },
+            { "+/+/", "\xFB\xFF\xBF" },
+    };
+    static const yajp_deserialization_base64_t base64 = YAJP_DESERIALIZATION_BASE64_INIT(binary_field_t, data, data_size, YAJP_DESERIALIZATION_BASE64_STANDARD);
+    binary_field_t result;
+    int ret;
+    size_t i;
+
+    for (i = 0; i < ARR_LEN(values); i++) {
+        memset(&result, 0, sizeof(result));
+        result.data_size = -1;
+
+        ret = yajp_set_base64(NULL, 0, (const uint8_t *) values[i].value, strlen(values[i].value), result.data,
+                              (void *) &base64);
+
+        test_is_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned error for '%s'", values[i].value);
+        test_is_equal(result.data_size, strlen(values[i].expected), FUNC_NAME(yajp_set_base64)" set wrong size for '%s': %zu", values[i].value, result.data_size);
+        test_is_equal(memcmp(result.data, values[i].expected, result.data_size), 0, FUNC_NAME(yajp_set_base64)" set wrong data for '%s'", values[i].value);
+    }
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_base64_test_url() {
+    static const char value[] = "-_-_AAEC";
+    static const size_t value_size = str_size_without_null(value);
+    static const uint8_t expected[] = { 0xFB, 0xFF, 0xBF, 0x00, 0x01, 0x02 };
+    static const yajp_deserialization_base64_t base64 = YAJP_DESERIALIZATION_BASE64_INIT(binary_field_t, data, data_size, YAJP_DESERIALIZATION_BASE64_URL);
+    binary_field_t result = { .data_size = -1 };
+    int ret;
+
+    ret = yajp_set_base64(NULL, 0, (const uint8_t *) value, value_size, result.data, (void *) &base64);
+
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned error");
+    test_is_equal(result.data_size, sizeof(expected), FUNC_NAME(yajp_set_base64)" set wrong size: %zu", result.data_size);
+    test_is_equal(memcmp(result.data, expected, sizeof(expected)), 0, FUNC_NAME(yajp_set_base64)" set wrong data");
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_base64_test_escaped_solidus() {
+    static const char value[] = "+\\/+\\/AAEC";
+    static const size_t value_size = str_size_without_null(value);
+    static const uint8_t expected[] = { 0xFB, 0xFF, 0xBF, 0x00, 0x01, 0x02 };
+    static const yajp_deserialization_base64_t base64 = YAJP_DESERIALIZATION_BASE64_INIT(binary_field_t, data, data_size, YAJP_DESERIALIZATION_BASE64_STANDARD);
+    binary_field_t result = { .data_size = -1 };
+    int ret;
+
+    ret = yajp_set_base64(NULL, 0, (const uint8_t *) value, value_size, result.data, (void *) &base64);
+
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned error");
+    test_is_equal(result.data_size, sizeof(expected), FUNC_NAME(yajp_set_base64)" set wrong size: %zu", result.data_size);
+    test_is_equal(memcmp(result.data, expected, sizeof(expected)), 0, FUNC_NAME(yajp_set_base64)" set wrong data");
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_base64_test_invalid_string() {
+    static const char *values[] = {
+            "Z",                // single digit
+            "Zm9vY",            // single digit in last group
+            "Zg=",              // incomplete padding
+            "Zm9v=",            // redundant padding
+            "====",             // padding without digits
+            "AAAA====",         // padding after complete group
+            "Zm9vZ===",         // padding after single digit
+            "Zg==Zg==",         // digits after padding
+            "Zm9vYmFy-_",       // digits of URL alphabet
+            "Zm9v YmFy",        // whitespace
+            "Zm9vYmFy\\n",      // escape sequence
+    };
+    static const yajp_deserialization_base64_t base64 = YAJP_DESERIALIZATION_BASE64_INIT(binary_field_t, data, data_size, YAJP_DESERIALIZATION_BASE64_STANDARD);
+    binary_field_t result = { .data_size = -1 };
+    int ret;
+    size_t i;
+
+    for (i = 0; i < ARR_LEN(values); i++) {
+        ret = yajp_set_base64(NULL, 0, (const uint8_t *) values[i], strlen(values[i]), result.data, (void *) &base64);
+
+        test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned 0 for '%s'", values[i]);
+        test_is_equal(result.data_size, (size_t) -1, FUNC_NAME(yajp_set_base64)" set size for '%s'", values[i]);
+    }
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_base64_test_too_long_value() {
+    typedef struct {
+        uint8_t data[4];
+        size_t data_size;
+    } small_binary_field_t;
+
+    static const char *values[] = { "Zm9vYg==", "Zm9vYmE", "Zm9vYmFy" };
+    static const yajp_deserialization_base64_t base64 = YAJP_DESERIALIZATION_BASE64_INIT(small_binary_field_t, data, data_size, YAJP_DESERIALIZATION_BASE64_STANDARD);
+    small_binary_field_t result = { .data_size = -1 };
+    int ret;
+    size_t i;
+
+    ret = yajp_set_base64(NULL, 0, (const uint8_t *) values[0], strlen(values[0]), result.data, (void *) &base64);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned error for '%s'", values[0]);
+    test_is_equal(result.data_size, 4, FUNC_NAME(yajp_set_base64)" set wrong size for '%s': %zu", values[0], result.data_size);
+
+    result.data_size = -1;
+    for (i = 1; i < ARR_LEN(values); i++) {
+        ret = yajp_set_base64(NULL, 0, (const uint8_t *) values[i], strlen(values[i]), result.data, (void *) &base64);
+
+        test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned 0 for '%s'", values[i]);
+        test_is_equal(result.data_size, (size_t) -1, FUNC_NAME(yajp_set_base64)" set size for '%s'", values[i]);
+    }
+
+    return TEST_RESULT_PASSED;
+}
+
+static void encode_base64(const char *alphabet, const uint8_t *data, size_t size, char *result) {
+    uint32_t bits;
+    size_t i;
+
+    for (i = 0; i + 3 <= size; i += 3) {
+        bits = ((uint32_t) data[i] << 16) | ((uint32_t) data[i + 1] << 8) | data[i + 2];
+        *result++ = alphabet[(bits >> 18) & 0x3F];
+        *result++ = alphabet[(bits >> 12) & 0x3F];
+        *result++ = alphabet[(bits >> 6) & 0x3F];
+        *result++ = alphabet[bits & 0x3F];
+    }
+}
+
+static test_result_t yajp_set_base64_test_every_digit() {
+    typedef struct {
+        uint8_t data[192];
+        size_t data_size;
+    } long_binary_field_t;
+
+    static const char *alphabets[] = {
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+    };
+    static const yajp_deserialization_base64_t base64[] = {
+            YAJP_DESERIALIZATION_BASE64_INIT(long_binary_field_t, data, data_size, YAJP_DESERIALIZATION_BASE64_STANDARD),
+            YAJP_DESERIALIZATION_BASE64_INIT(long_binary_field_t, data, data_size, YAJP_DESERIALIZATION_BASE64_URL),
+    };
+    long_binary_field_t result;
+    uint8_t expected[sizeof(result.data)];
+    char value[sizeof(expected) / 3 * 4];
+    const char *digit;
+    size_t alphabet, position, i, bit;
+    int ret, c;
+
+    // value is long enough for vectorized blocks, so replaced digit is checked at different offsets of them
+    for (alphabet = 0; alphabet < ARR_LEN(alphabets); alphabet++) {
+        for (position = 0; position < sizeof(value); position += 23) {
+            for (c = 1; c < 256; c++) {
+                for (i = 0; i < sizeof(expected); i++) {
+                    expected[i] = (uint8_t) (i * 7 + position);
+                }
+                encode_base64(alphabets[alphabet], expected, sizeof(expected), value);
+                value[position] = (char) c;
+
+                result.data_size = -1;
+                ret = yajp_set_base64(NULL, 0, (const uint8_t *) value, sizeof(value), result.data,
+                                      (void *) &base64[alphabet]);
+
+                digit = strchr(alphabets[alphabet], c);
+                if (NULL == digit) {
+                    test_is_not_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned 0 for 0x%02x at %zu", c, position);
+                    test_is_equal(result.data_size, (size_t) -1, FUNC_NAME(yajp_set_base64)" set size for 0x%02x", c);
+                    continue;
+                }
+
+                // sextet of replaced digit is written into expected bytes
+                for (i = 0; i < 6; i++) {
+                    bit = position * 6 + i;
+                    expected[bit / 8] &= (uint8_t) ~(0x80 >> (bit % 8));
+                    expected[bit / 8] |= (uint8_t) ((((digit - alphabets[alphabet]) >> (5 - i)) & 1) << (7 - bit % 8));
+                }
+
+                test_is_equal(ret, 0, FUNC_NAME(yajp_set_base64)" returned error for '%c' at %zu", c, position);
+                test_is_equal(result.data_size, sizeof(expected), FUNC_NAME(yajp_set_base64)" set wrong size: %zu",
+                              result.data_size);
+                test_is_equal(memcmp(result.data, expected, sizeof(expected)), 0,
+                              FUNC_NAME(yajp_set_base64)" set wrong data for '%c' at %zu", c, position);
+            }
+        }
+    }
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_interned_string_test_same_value() {
+    static const char value[] = "eu-central-1";
+    static const size_t value_size = str_size_without_null(value);
+    char copy[sizeof(value)];
+    yajp_deserialization_intern_pool_t pool;
+    const char *result1 = NULL, *result2 = NULL;
+    int ret;
+
+    ret = yajp_deserialization_intern_pool_init(0, &pool);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_intern_pool_init)" returned error");
+
+    memcpy(copy, value, sizeof(value));
+
+    ret = yajp_set_interned_string(NULL, 0, (const uint8_t *) value, value_size, &result1, &pool);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_interned_string)" returned error");
+
+    ret = yajp_set_interned_string(NULL, 0, (const uint8_t *) copy, value_size, &result2, &pool);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_set_interned_string)" returned error");
+
+    test_is_not_null(result1, FUNC_NAME(yajp_set_interned_string)" didn't set 'result'");
+    test_is_equal(strcmp(result1, value), 0, FUNC_NAME(yajp_set_interned_string)" set wrong 'result': '%s'", result1);
+    test_is_equal(result1, result2, FUNC_NAME(yajp_set_interned_string)" returned different pointers for equal values");
+
+    yajp_deserialization_intern_pool_release(&pool);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_interned_string_test_different_values() {
+    static const char *values[] = { "", "us-east-1", "us-east-2", "us-east-1a" };
+    const char *results[ARR_LEN(values)];
+    yajp_deserialization_intern_pool_t pool;
+    int ret;
+    size_t i, j;
+
+    ret = yajp_deserialization_intern_pool_init(ARR_LEN(values), &pool);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_intern_pool_init)" returned error");
+
+    for (i = 0; i < ARR_LEN(values); i++) {
+        ret = yajp_set_interned_string(NULL, 0, (const uint8_t *) values[i], strlen(values[i]), &results[i], &pool);
+
+        test_is_equal(ret, 0, FUNC_NAME(yajp_set_interned_string)" returned error for '%s'", values[i]);
+        test_is_equal(strcmp(results[i], values[i]), 0, FUNC_NAME(yajp_set_interned_string)" set wrong 'result': '%s'", results[i]);
+
+        for (j = 0; j < i; j++) {
+            test_is_not_equal(results[i], results[j], FUNC_NAME(yajp_set_interned_string)" returned same pointer for '%s' and '%s'", values[i], values[j]);
+        }
+    }
+
+    yajp_deserialization_intern_pool_release(&pool);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_set_interned_string_test_many_values() {
+#define VALUES_COUNT 1000
+    static const char *results[VALUES_COUNT];
+    char value[16];
+    yajp_deserialization_intern_pool_t pool;
+    const char *result;
+    int ret, i, value_size;
+
+    ret = yajp_deserialization_intern_pool_init(0, &pool);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_intern_pool_init)" returned error");
+
+    for (i = 0; i < VALUES_COUNT; i++) {
+        value_size = snprintf(value, sizeof(value), "host-%d", i);
+        results[i] = yajp_deserialization_intern(&pool, (const uint8_t *) value, value_size);
+        test_is_not_null(results[i], FUNC_NAME(yajp_deserialization_intern)" returned NULL");
+    }
+
+    for (i = 0; i < VALUES_COUNT; i++) {
+        value_size = snprintf(value, sizeof(value), "host-%d", i);
+        result = yajp_deserialization_intern(&pool, (const uint8_t *) value, value_size);
+
+        test_is_equal(result, results[i], FUNC_NAME(yajp_deserialization_intern)" returned different pointer for '%s'", value);
+        test_is_equal(strcmp(result, value), 0, FUNC_NAME(yajp_deserialization_intern)" returned wrong string '%s'", result);
+    }
+
+    yajp_deserialization_intern_pool_release(&pool);
+
+    return TEST_RESULT_PASSED;
+#undef VALUES_COUNT
+}
+
+#define INTERN_THREADS_COUNT    8
+#define INTERN_VALUES_COUNT     256
+
+typedef struct {
+    yajp_deserialization_intern_pool_t *pool;
+    const char *results[INTERN_VALUES_COUNT];
+} intern_thread_data_t;
+
+static void *intern_thread(void *arg) {
+    intern_thread_data_t *data = arg;
+    char value[16];
+    int i, value_size;
+
+    for (i = 0; i < INTERN_VALUES_COUNT; i++) {
+        value_size = snprintf(value, sizeof(value), "event-%d", i);
+        data->results[i] = yajp_deserialization_intern(data->pool, (const uint8_t *) value, value_size);
+    }
+
+    return NULL;
+}
+
+static test_result_t yajp_set_interned_string_test_concurrent_values() {
+    static intern_thread_data_t data[INTERN_THREADS_COUNT];
+    pthread_t threads[INTERN_THREADS_COUNT];
+    yajp_deserialization_intern_pool_t pool;
+    int ret, i, j;
+
+    ret = yajp_deserialization_intern_pool_init(16, &pool);
+    test_is_equal(ret, 0, FUNC_NAME(yajp_deserialization_intern_pool_init)" returned error");
+
+    for (i = 0; i < INTERN_THREADS_COUNT; i++) {
+        data[i].pool = &pool;
+        ret = pthread_create(&threads[i], NULL, intern_thread, &data[i]);
+        test_is_equal(ret, 0, "Failed to start thread");
+    }
+
+    for (i = 0; i < INTERN_THREADS_COUNT; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (j = 0; j < INTERN_VALUES_COUNT; j++) {
+        test_is_not_null(data[0].results[j], FUNC_NAME(yajp_deserialization_intern)" returned NULL");
+
+        for (i = 1; i < INTERN_THREADS_COUNT; i++) {
+            test_is_equal(data[i].results[j], data[0].results[j], FUNC_NAME(yajp_deserialization_intern)" returned different pointers for the same value");
+        }
+    }
+
+    yajp_deserialization_intern_pool_release(&pool);
+
+    return TEST_RESULT_PASSED;
+}
+
+#undef INTERN_THREADS_COUNT
+#undef INTERN_VALUES_COUNT
@@ -0,0 +1,695 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * parallel_tests.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "yajp/parallel.h"
+#include "yajp/deserialization_routine.h"
+
+/* test cases prototypes */
+static test_result_t yajp_deserialize_ndjson_test_ordered();
+static test_result_t yajp_deserialize_ndjson_test_unordered();
+static test_result_t yajp_deserialize_ndjson_test_stop();
+static test_result_t yajp_deserialize_array_parallel_test();
+static test_result_t yajp_deserialize_array_parallel_test_errors();
+static test_result_t yajp_deserialize_batch_test();
+static test_result_t yajp_deserialize_batch_test_errors();
+static test_result_t yajp_deserialize_batch_test_pool();
+
+/* test suite declaration and initialization */
+const test_case_t test_suite[] = {
+        REGISTER_TEST_CASE(yajp_deserialize_ndjson_test_ordered, 1, yajp_deserialize_ndjson, "where records are delivered in order of lines"),
+        REGISTER_TEST_CASE(yajp_deserialize_ndjson_test_unordered, 2, yajp_deserialize_ndjson, "where records are delivered in order of completion"),
+        REGISTER_TEST_CASE(yajp_deserialize_ndjson_test_stop, 3, yajp_deserialize_ndjson, "where callback stops deserialization"),
+        REGISTER_TEST_CASE(yajp_deserialize_array_parallel_test, 4, yajp_deserialize_array_parallel, "where elements are deserialized as by sequential deserialization"),
+        REGISTER_TEST_CASE(yajp_deserialize_array_parallel_test_errors, 5, yajp_deserialize_array_parallel, "where input is invalid or empty"),
+        REGISTER_TEST_CASE(yajp_deserialize_batch_test, 6, yajp_deserialize_batch, "where documents are fields of bigger records"),
+        REGISTER_TEST_CASE(yajp_deserialize_batch_test_errors, 7, yajp_deserialize_batch, "where some documents are broken"),
+        REGISTER_TEST_CASE(yajp_deserialize_batch_test_pool, 8, yajp_deserialize_batch, "where pool is reused and amount of threads is too big"),
+};
+
+/* test suite tests count declaration and initialization */
+const long test_count = sizeof(test_suite) / sizeof(test_suite[0]);
+
+#define RECORDS_COUNT   20000
+#define BROKEN_RECORD   777
+#define ARRAY_COUNT     5000
+#define BATCH_COUNT     3000
+
+typedef struct {
+    int id;
+    char *name;
+} record_t;
+
+typedef struct {
+    int tag;
+    record_t record;
+    int guard;
+} message_t;
+
+typedef struct {
+    union {
+        record_t *elems;
+        void *rows;
+    };
+    bool final_dim;
+    size_t count;
+} records_array_t;
+
+// document what holds array of records as field, so it's deserialized sequentially by yajp_deserialize_json_string()
+typedef struct {
+    records_array_t records;
+} document_t;
+
+typedef struct {
+    const yajp_deserialization_context_t *ctx;
+    size_t records;             // amount of received records
+    size_t failed;              // amount of records received with error
+    size_t next_index;          // expected index of record in ordered mode
+    size_t id_sum;              // sum of ids of records
+    size_t stop_after;          // amount of records after which callback stops deserialization. 0 - never
+    bool wrong;                 // record didn't match its line
+} receiver_t;
+
+/*
+ * Array of ARRAY_COUNT objects with nested ones and brackets inside of strings. Element BROKEN_RECORD isn't valid JSON
+ * if broken is true.
+ */
+static char *generate_array(bool broken, size_t *size) {
+    size_t capacity = ARRAY_COUNT * 96, used = 0, i;
+    char *input = malloc(capacity);
+
+    if (NULL == input) {
+        return NULL;
+    }
+
+    used += sprintf(input + used, " [\n");
+    for (i = 0; i < ARRAY_COUNT; i++) {
+        if (broken && BROKEN_RECORD == i) {
+            used += sprintf(input + used, "{\"id\":%zu, \"name\":}", i);
+        } else {
+            used += sprintf(input + used, "{\"id\":%zu, \"skipped\":{\"a\":[1, {}]}, \"name\":\"[{\\\"%zu}\"}", i, i);
+        }
+        used += sprintf(input + used, "%s", (i + 1 == ARRAY_COUNT) ? "\n]\n" : " ,\n");
+    }
+
+    *size = used;
+    return input;
+}
+
+/*
+ * Batch of BATCH_COUNT messages of different sizes. Message BROKEN_RECORD isn't valid JSON if broken is true. Texts of
+ * messages aren't terminated by zero.
+ */
+static char *generate_batch(bool broken, yajp_buffer_t *inputs) {
+    size_t capacity = BATCH_COUNT * 64 + BATCH_COUNT / 100 * 4096, used = 0, i;
+    char *text = malloc(capacity);
+    int size;
+
+    if (NULL == text) {
+        return NULL;
+    }
+
+    for (i = 0; i < BATCH_COUNT; i++) {
+        if (broken && BROKEN_RECORD == i) {
+            size = sprintf(text + used, "{\"id\":%zu, \"name\":}", i);
+        } else {
+            // every 100th message is big, so workers get uneven work
+            size = sprintf(text + used, "{\"id\":%zu, \"name\":\"record number %zu\"%*s}", i, i,
+                           (0 == i % 100) ? 4000 : 0, "");
+        }
+
+        inputs[i].data = text + used;
+        inputs[i].size = (size_t) size;
+        used += (size_t) size;
+    }
+
+    return text;
+}
+
+/*
+ * Every record is on line of its id. Every 10th line is empty, lines end with "\r\n" and "\n" in turn, the last line
+ * has no line end. Record BROKEN_RECORD isn't valid JSON.
+ */
+static char *generate_ndjson(size_t *size) {
+    size_t capacity = RECORDS_COUNT * 64, used = 0, i;
+    char *input = malloc(capacity);
+
+    if (NULL == input) {
+        return NULL;
+    }
+
+    for (i = 0; i < RECORDS_COUNT; i++) {
+        if (0 == i % 10) {
+            used += sprintf(input + used, "\n");
+        } else if (BROKEN_RECORD == i) {
+            used += sprintf(input + used, "{\"id\":%zu, \"name\":}\n", i);
+        } else {
+            used += sprintf(input + used, "{\"id\":%zu, \"name\":\"record number %zu\"}%s", i, i,
+                            (i + 1 == RECORDS_COUNT) ? "" : ((0 == i % 2) ? "\r\n" : "\n"));
+        }
+    }
+
+    *size = used;
+    return input;
+}
+
+static int init_context(yajp_deserialization_rule_t *actions, const yajp_allocator_t *allocator,
+                        yajp_deserialization_context_t *ctx) {
+    int ret;
+
+    // declare rules for record_t.id
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &actions[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, 2, ctx);
+    ret |= yajp_deserialization_context_set_allocator(ctx, allocator);
+
+    return ret;
+}
+
+static int init_document_context(yajp_deserialization_rule_t *actions, const yajp_deserialization_context_t *record_ctx,
+                                 const yajp_allocator_t *allocator, yajp_deserialization_context_t *ctx) {
+    int ret;
+
+    // declare rules for document_t.records
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   document_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          records
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             record_ctx
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         record_t
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &actions[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(actions, 1, ctx);
+    ret |= yajp_deserialization_context_set_allocator(ctx, allocator);
+
+    return ret;
+}
+
+static bool record_matches_line(size_t index, const record_t *record) {
+    char name[64];
+
+    sprintf(name, "record number %zu", index);
+    return index == (size_t) record->id && NULL != record->name && 0 == strcmp(name, record->name);
+}
+
+static int ordered_receiver(size_t index, void *record, int error, void *user_data) {
+    receiver_t *receiver = user_data;
+
+    // callback isn't called concurrently in ordered mode, so receiver isn't locked
+    if (index < receiver->next_index || 0 == index % 10 ||
+        (0 == error && !record_matches_line(index, record)) || (0 != error && BROKEN_RECORD != index)) {
+        receiver->wrong = true;
+    }
+
+    receiver->next_index = index + 1;
+    receiver->records++;
+    receiver->failed += (0 != error);
+
+    yajp_deserialization_free(receiver->ctx, record);
+
+    return (0 != receiver->stop_after && receiver->records >= receiver->stop_after);
+}
+
+static int unordered_receiver(size_t index, void *record, int error, void *user_data) {
+    receiver_t *receiver = user_data;
+
+    if ((0 == error && !record_matches_line(index, record)) || (0 != error && BROKEN_RECORD != index)) {
+        __atomic_store_n(&receiver->wrong, true, __ATOMIC_RELAXED);
+    }
+
+    __atomic_fetch_add(&receiver->records, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&receiver->failed, (0 != error), __ATOMIC_RELAXED);
+    if (0 == error) {
+        __atomic_fetch_add(&receiver->id_sum, index, __ATOMIC_RELAXED);
+    }
+
+    yajp_deserialization_free(receiver->ctx, record);
+
+    return 0;
+}
+
+static test_result_t yajp_deserialize_ndjson_test_ordered() {
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    receiver_t receiver = { 0 };
+    size_t input_size;
+    char *input;
+    int ret, nthreads;
+
+    input = generate_ndjson(&input_size);
+    test_is_not_null(input, "Failed to generate input");
+
+    ret = init_context(actions, &allocator, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // single worker runs on calling thread, others start threads
+    for (nthreads = 1; nthreads <= 8; nthreads *= 2) {
+        memset(&receiver, 0, sizeof(receiver));
+        receiver.ctx = &ctx;
+
+        ret = yajp_deserialize_ndjson(input, input_size, &ctx, sizeof(record_t), ordered_receiver, &receiver,
+                                      nthreads, true);
+        test_is_equal(ret, 0, "Deserialization failed");
+        test_is_false(receiver.wrong, "Record was delivered out of order or doesn't match its line");
+        test_is_equal(receiver.records, RECORDS_COUNT - RECORDS_COUNT / 10, "Wrong amount of records: %zu",
+                      receiver.records);
+        test_is_equal(receiver.failed, 1, "Wrong amount of failed records: %zu", receiver.failed);
+    }
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    free(input);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_ndjson_test_unordered() {
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    receiver_t receiver = { 0 };
+    size_t input_size, id_sum = 0, i;
+    char *input;
+    int ret;
+
+    input = generate_ndjson(&input_size);
+    test_is_not_null(input, "Failed to generate input");
+
+    for (i = 0; i < RECORDS_COUNT; i++) {
+        id_sum += (0 != i % 10 && BROKEN_RECORD != i) ? i : 0;
+    }
+
+    ret = init_context(actions, &allocator, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    receiver.ctx = &ctx;
+    ret = yajp_deserialize_ndjson(input, input_size, &ctx, sizeof(record_t), unordered_receiver, &receiver, 4, false);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_false(receiver.wrong, "Record doesn't match its line");
+    test_is_equal(receiver.records, RECORDS_COUNT - RECORDS_COUNT / 10, "Wrong amount of records: %zu",
+                  receiver.records);
+    test_is_equal(receiver.failed, 1, "Wrong amount of failed records: %zu", receiver.failed);
+    test_is_equal(receiver.id_sum, id_sum, "Not all records were delivered");
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    // invalid arguments
+    errno = 0;
+    ret = yajp_deserialize_ndjson(input, input_size, &ctx, sizeof(record_t), NULL, &receiver, 4, false);
+    test_is_equal(ret, -1, "Deserialization without callback succeeded");
+    test_is_equal(errno, EINVAL, "Unexpected errno: %d", errno);
+
+    free(input);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_ndjson_test_stop() {
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    receiver_t receiver = { 0 };
+    size_t input_size;
+    char *input;
+    int ret;
+
+    input = generate_ndjson(&input_size);
+    test_is_not_null(input, "Failed to generate input");
+
+    ret = init_context(actions, &allocator, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    receiver.ctx = &ctx;
+    receiver.stop_after = 100;
+
+    errno = 0;
+    ret = yajp_deserialize_ndjson(input, input_size, &ctx, sizeof(record_t), ordered_receiver, &receiver, 4, true);
+    test_is_equal(ret, -1, "Stopped deserialization succeeded");
+    test_is_equal(errno, ECANCELED, "Unexpected errno: %d", errno);
+    test_is_equal(receiver.records, 100, "Records were delivered after stop: %zu", receiver.records);
+    test_is_false(receiver.wrong, "Record was delivered out of order or doesn't match its line");
+
+    // records deserialized by other workers are released by library
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    free(input);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_array_parallel_test() {
+    yajp_deserialization_context_t ctx, document_ctx;
+    yajp_deserialization_rule_t actions[2], document_actions[1];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    document_t document;
+    record_t *expected, *elements;
+    size_t input_size, count, i;
+    char *input, *wrapped;
+    int ret, nthreads;
+
+    input = generate_array(false, &input_size);
+    test_is_not_null(input, "Failed to generate input");
+
+    wrapped = malloc(input_size + 32);
+    test_is_not_null(wrapped, "Failed to allocate input");
+    sprintf(wrapped, "{\"records\":%s}", input);
+
+    ret = init_context(actions, &allocator, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    ret = init_document_context(document_actions, &ctx, &allocator, &document_ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // sequential deserialization of the same array as field of document is reference
+    memset(&document, 0, sizeof(document));
+    ret = yajp_deserialize_json_string(wrapped, strlen(wrapped) + 1, &document_ctx, &document, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    test_is_equal(document.records.count, ARRAY_COUNT, "Wrong amount of elements: %zu", document.records.count);
+
+    expected = document.records.elems;
+    count = document.records.count;
+
+    for (i = 0; i < count; i++) {
+        char name[64];
+
+        // escape sequences of strings are kept as is
+        sprintf(name, "[{\\\"%zu}", i);
+        test_is_equal(expected[i].id, (int) i, "Wrong id of element %zu: %d", i, expected[i].id);
+        test_is_not_null(expected[i].name, "Element %zu has no name", i);
+        test_is_equal(strcmp(expected[i].name, name), 0, "Wrong name of element %zu: %s", i, expected[i].name);
+    }
+
+    for (nthreads = 1; nthreads <= 8; nthreads *= 2) {
+        ret = yajp_deserialize_array_parallel(input, input_size, &ctx, sizeof(record_t), (void **) &elements, &count,
+                                              NULL, nthreads);
+        test_is_equal(ret, 0, "Deserialization failed");
+        test_is_equal(count, ARRAY_COUNT, "Wrong amount of elements: %zu", count);
+
+        for (i = 0; i < count; i++) {
+            test_is_equal(elements[i].id, expected[i].id, "Element %zu differs", i);
+            test_is_equal(strcmp(elements[i].name, expected[i].name), 0, "Element %zu differs", i);
+            yajp_deserialization_free(&ctx, &elements[i]);
+        }
+        allocator.free(elements, allocator.user);
+    }
+
+    yajp_deserialization_free(&document_ctx, &document);
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    free(wrapped);
+    free(input);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_array_parallel_test_errors() {
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    const char *invalid[] = { "{\"id\":1}", "[{\"id\":1} {\"id\":2}]", "[{\"id\":1}", "[{\"id\":1}] x", "[1, 2]",
+                              "[{\"id\":\"}]" };
+    void *elements = (void *) &ctx;
+    size_t input_size, count = 1, i;
+    char *input;
+    int ret;
+
+    input = generate_array(true, &input_size);
+    test_is_not_null(input, "Failed to generate input");
+
+    ret = init_context(actions, &allocator, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // broken element fails whole array and releases all elements
+    errno = 0;
+    ret = yajp_deserialize_array_parallel(input, input_size, &ctx, sizeof(record_t), &elements, &count, NULL, 4);
+    test_is_equal(ret, -1, "Deserialization of broken array succeeded");
+    test_is_not_equal(errno, 0, "Errno isn't set");
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        errno = 0;
+        ret = yajp_deserialize_array_parallel(invalid[i], strlen(invalid[i]), &ctx, sizeof(record_t), &elements,
+                                              &count, NULL, 4);
+        test_is_equal(ret, -1, "Deserialization of invalid input %zu succeeded", i);
+        test_is_equal(errno, EINVAL, "Unexpected errno for input %zu: %d", i, errno);
+    }
+
+    // empty array, terminating zero is allowed after it
+    ret = yajp_deserialize_array_parallel(" [ \n ] ", sizeof(" [ \n ] "), &ctx, sizeof(record_t), &elements, &count,
+                                          NULL, 4);
+    test_is_equal(ret, 0, "Deserialization of empty array failed");
+    test_is_equal(count, 0, "Wrong amount of elements: %zu", count);
+    test_is_null(elements, "Elements of empty array were allocated");
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    free(input);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_batch_test() {
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    static yajp_buffer_t inputs[BATCH_COUNT];
+    static int errors[BATCH_COUNT];
+    message_t *messages;
+    size_t i, released;
+    char *text;
+    int ret, nthreads;
+
+    text = generate_batch(false, inputs);
+    test_is_not_null(text, "Failed to generate input");
+
+    messages = malloc(BATCH_COUNT * sizeof(*messages));
+    test_is_not_null(messages, "Failed to allocate messages");
+
+    ret = init_context(actions, &allocator, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    for (nthreads = 1; nthreads <= 8; nthreads *= 2) {
+        memset(messages, 0, BATCH_COUNT * sizeof(*messages));
+        for (i = 0; i < BATCH_COUNT; i++) {
+            messages[i].tag = messages[i].guard = (int) i;
+            errors[i] = -1;
+        }
+
+        // records are fields of messages, so only records are written
+        released = stat.releases;
+        ret = yajp_deserialize_batch(inputs, BATCH_COUNT, &ctx, &messages[0].record, sizeof(message_t), errors, NULL,
+                                     nthreads);
+        test_is_equal(ret, 0, "Deserialization failed");
+
+        // memory released by deserialization is memory of workers and of long tokens, not of every document
+        test_is_true(stat.releases - released < BATCH_COUNT / 10, "Parser and lexer are allocated per document: %zu",
+                     stat.releases - released);
+
+        for (i = 0; i < BATCH_COUNT; i++) {
+            test_is_equal(errors[i], 0, "Message %zu failed: %d", i, errors[i]);
+            test_is_true(record_matches_line(i, &messages[i].record), "Message %zu doesn't match its input", i);
+            test_is_equal(messages[i].tag, (int) i, "Tag of message %zu was overwritten", i);
+            test_is_equal(messages[i].guard, (int) i, "Guard of message %zu was overwritten", i);
+            yajp_deserialization_free(&ctx, &messages[i].record);
+        }
+    }
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    free(messages);
+    free(text);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_batch_test_pool() {
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    static yajp_buffer_t inputs[BATCH_COUNT];
+    static int errors[BATCH_COUNT];
+    record_t *records;
+    size_t i;
+    char *text;
+    int ret, run;
+
+    text = generate_batch(false, inputs);
+    test_is_not_null(text, "Failed to generate input");
+
+    records = malloc(BATCH_COUNT * sizeof(*records));
+    test_is_not_null(records, "Failed to allocate records");
+
+    // heap allocator, so workers take sessions of pool threads
+    ret = init_context(actions, NULL, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    for (run = 0; run < 3; run++) {
+        memset(records, 0, BATCH_COUNT * sizeof(*records));
+
+        ret = yajp_deserialize_batch(inputs, BATCH_COUNT, &ctx, records, sizeof(record_t), errors, NULL, 100000);
+        test_is_equal(ret, 0, "Deserialization %d failed", run);
+
+        for (i = 0; i < BATCH_COUNT; i++) {
+            test_is_equal(errors[i], 0, "Message %zu failed: %d", i, errors[i]);
+            test_is_true(record_matches_line(i, &records[i]), "Message %zu doesn't match its input", i);
+            yajp_deserialization_free(&ctx, &records[i]);
+        }
+    }
+
+    free(records);
+    free(text);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_deserialize_batch_test_errors() {
+    yajp_deserialization_context_t ctx;
+    yajp_deserialization_rule_t actions[2];
+    counting_allocator_stat_t stat = { 0 };
+    yajp_allocator_t allocator = { counting_alloc, counting_realloc, counting_free, &stat };
+    static yajp_buffer_t inputs[BATCH_COUNT];
+    static int errors[BATCH_COUNT];
+    record_t *records;
+    size_t i;
+    char *text;
+    int ret;
+
+    text = generate_batch(true, inputs);
+    test_is_not_null(text, "Failed to generate input");
+
+    records = calloc(BATCH_COUNT, sizeof(*records));
+    test_is_not_null(records, "Failed to allocate records");
+
+    ret = init_context(actions, &allocator, &ctx);
+    test_is_equal(ret, 0, "Failed to initialize deserialization context");
+
+    // broken message fails batch, but doesn't stop others
+    errno = 0;
+    ret = yajp_deserialize_batch(inputs, BATCH_COUNT, &ctx, records, sizeof(record_t), errors, NULL, 4);
+    test_is_equal(ret, -1, "Deserialization of broken batch succeeded");
+    test_is_not_equal(errno, 0, "Errno isn't set");
+
+    for (i = 0; i < BATCH_COUNT; i++) {
+        if (BROKEN_RECORD == i) {
+            test_is_not_equal(errors[i], 0, "Broken message succeeded");
+        } else {
+            test_is_equal(errors[i], 0, "Message %zu failed: %d", i, errors[i]);
+            test_is_true(record_matches_line(i, &records[i]), "Message %zu doesn't match its input", i);
+        }
+        yajp_deserialization_free(&ctx, &records[i]);
+    }
+
+    test_is_equal(stat.allocations, stat.releases, "Not all memory was released: %zu of %zu", stat.releases,
+                  stat.allocations);
+
+    // empty batch and invalid arguments
+    ret = yajp_deserialize_batch(NULL, 0, &ctx, NULL, 0, NULL, NULL, 4);
+    test_is_equal(ret, 0, "Deserialization of empty batch failed");
+
+    errno = 0;
+    ret = yajp_deserialize_batch(inputs, BATCH_COUNT, &ctx, records, 0, NULL, NULL, 4);
+    test_is_equal(ret, -1, "Deserialization with zero stride succeeded");
+    test_is_equal(errno, EINVAL, "Unexpected errno: %d", errno);
+
+    // errno of batch is errno of the first failed document, even if other documents fail later with other errors
+    ret = yajp_deserialization_context_set_max_depth(&ctx, 2);
+    test_is_equal(ret, 0, "Failed to set maximal depth");
+
+    inputs[0].data = "{\"id\":1, \"nested\":{\"deeper\":{}}}";
+    inputs[1].data = "{\"id\":";
+    inputs[2].data = "{\"id\":";
+    for (i = 0; i < 3; i++) {
+        inputs[i].size = strlen(inputs[i].data);
+    }
+
+    errno = 0;
+    ret = yajp_deserialize_batch(inputs, 3, &ctx, records, sizeof(record_t), errors, NULL, 1);
+    test_is_equal(ret, -1, "Deserialization of broken batch succeeded");
+    test_is_not_equal(errors[0], errors[1], "Documents failed with the same errno %d", errors[0]);
+    test_is_equal(errno, errors[0], "Expected errno %d of the first document, got %d", errors[0], errno);
+
+    for (i = 0; i < 3; i++) {
+        yajp_deserialization_free(&ctx, &records[i]);
+    }
+
+    free(records);
+    free(text);
+
+    return TEST_RESULT_PASSED;
+}
@@ -0,0 +1,1034 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * serialization_tests.c
+ * Copyright (C) 2020 Sergei Kosivchenko <arhichief@gmail.com> 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+ * THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <limits.h>
+
+#include "yajp/serialization.h"
+#include "yajp/deserialization_routine.h"
+
+/* test cases prototypes */
+static test_result_t yajp_serialize_json_test_round_trip();
+static test_result_t yajp_serialize_json_test_strings();
+static test_result_t yajp_serialize_json_test_stream();
+static test_result_t yajp_serialize_json_test_errors();
+static test_result_t yajp_serialize_json_test_numbers();
+static test_result_t yajp_serialize_json_test_escape_scan();
+static test_result_t yajp_serialize_json_test_chain();
+static test_result_t yajp_serialize_json_test_exact_size();
+
+/* test suite declaration and initialization */
+const test_case_t test_suite[] = {
+        REGISTER_TEST_CASE(yajp_serialize_json_test_round_trip, 1, yajp_serialize_json_buffer, "where document in order of rules is written back byte to byte"),
+        REGISTER_TEST_CASE(yajp_serialize_json_test_strings, 2, yajp_serialize_json_buffer, "where strings hold characters what should be escaped"),
+        REGISTER_TEST_CASE(yajp_serialize_json_test_stream, 3, yajp_serialize_json_stream, "where document is bigger than buffer of stream"),
+        REGISTER_TEST_CASE(yajp_serialize_json_test_errors, 4, yajp_serialize_json_buffer, "where values can't be written"),
+        REGISTER_TEST_CASE(yajp_serialize_json_test_numbers, 5, yajp_serialize_json_buffer, "where numbers are written by the shortest representations"),
+        REGISTER_TEST_CASE(yajp_serialize_json_test_escape_scan, 6, yajp_serialization_context_set_escape_non_ascii, "where characters to escape are at every position of blocks"),
+        REGISTER_TEST_CASE(yajp_serialize_json_test_chain, 7, yajp_serialize_json_chain, "where long strings are referenced by segments and chain is written by writev"),
+        REGISTER_TEST_CASE(yajp_serialize_json_test_exact_size, 8, yajp_serialize_json_into, "where document is measured before it's written into buffer of exact size"),
+};
+
+/* test suite tests count declaration and initialization */
+const long test_count = sizeof(test_suite) / sizeof(test_suite[0]);
+
+typedef struct array_handle array_handle_t;
+struct array_handle {
+    union {
+        void *elems;
+        array_handle_t *rows;
+    };
+    bool final_dim;
+    size_t count;
+};
+
+typedef struct point {
+    int x;
+    int y;
+} point_t;
+
+typedef struct record {
+    short id;
+    long long big;
+    double ratio;
+    float weight;
+    bool active;
+    char *name;
+    char code[8];
+    int color;
+    int64_t created;
+    uint8_t payload[16];
+    size_t payload_size;
+    point_t *origin;
+    point_t corner;
+    array_handle_t values;
+    array_handle_t matrix;
+    array_handle_t tags;
+    array_handle_t points;
+    char *missing;
+} record_t;
+
+typedef struct contexts {
+    yajp_deserialization_rule_t point_rules[2];
+    yajp_deserialization_rule_t record_rules[17];
+    yajp_deserialization_context_t point;
+    yajp_deserialization_context_t record;
+    yajp_deserialization_enum_t colors;
+} contexts_t;
+
+enum color {
+    COLOR_RED,
+    COLOR_GREEN,
+    COLOR_BLUE,
+};
+
+static const yajp_deserialization_enum_item_t colors_items[] = {
+        { "red", sizeof("red") - 1, COLOR_RED },
+        { "green", sizeof("green") - 1, COLOR_GREEN },
+        { "blue", sizeof("blue") - 1, COLOR_BLUE },
+};
+
+static const yajp_deserialization_base64_t record_payload_base64 =
+        YAJP_DESERIALIZATION_BASE64_INIT(record_t, payload, payload_size, YAJP_DESERIALIZATION_BASE64_STANDARD);
+
+/*
+ * Document with fields in order of rules and in form what is written by serialization
+ */
+static const char record_js[] = "{\"id\":7,\"big\":-9007199254740993,\"ratio\":0.1,\"weight\":1.5,"
+                                "\"active\":true,\"name\":\"a \\\"quoted\\\" name\\n\",\"code\":\"XY\","
+                                "\"color\":\"green\",\"created\":\"2021-03-04T05:06:07.25Z\",\"payload\":\"AAEC/w==\","
+                                "\"origin\":{\"x\":1,\"y\":-2},\"corner\":{\"x\":3,\"y\":4},\"values\":[1,2,3],"
+                                "\"matrix\":[[1,2],[3],[]],\"tags\":[\"a\",\"b\\\\c\"],"
+                                "\"points\":[{\"x\":5,\"y\":6},{\"x\":7,\"y\":8}]}";
+
+static int init_contexts(contexts_t *contexts) {
+    int ret;
+
+    if (0 != yajp_deserialization_enum_init(colors_items, ARR_LEN(colors_items), false, 0, &contexts->colors)) {
+        return -1;
+    }
+
+    // declare rules for point_t.x
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   point_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          x
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->point_rules[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for point_t.y
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   point_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          y
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->point_rules[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    ret = yajp_deserialization_context_init(contexts->point_rules, ARR_LEN(contexts->point_rules), &contexts->point);
+    if (0 != ret) {
+        return ret;
+    }
+
+    // declare rules for record_t.id
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          id
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_short
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[0]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.big
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          big
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_long_long_int
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[1]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.ratio
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          ratio
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_double
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[2]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.weight
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          weight
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_float
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[3]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.active
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          active
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_BOOLEAN)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_bool
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[4]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.name
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          name
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[5]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.code
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          code
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_INLINE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[6]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.color
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          color
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_enum
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &contexts->colors
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[7]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.created
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          created
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_timestamp
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[8]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.payload
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          payload
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_base64
+    #define YAJP_DESERIALIZATION_SETTER_DATA                &record_payload_base64
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[9]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.origin
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          origin
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &contexts->point
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[10]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.corner
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          corner
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &contexts->point
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[11]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.values
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          values
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[12]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.matrix
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          matrix
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_NUMBER)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_int
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         int
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[13]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.tags
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          tags
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         char *
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[14]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.points
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          points
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_ARRAY_OF | YAJP_DESERIALIZATION_TYPE_OBJECT)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE_ELEMENTS)
+    #define YAJP_DESERIALIZATION_OBJECT_CONTEXT             &contexts->point
+
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENT_TYPE         point_t
+    #define YAJP_DESERIALIZATION_ARRAY_ELEMENTS             elems
+    #define YAJP_DESERIALIZATION_ARRAY_ROWS                 rows
+    #define YAJP_DESERIALIZATION_ARRAY_COUNTER              count
+    #define YAJP_DESERIALIZATION_ARRAY_FINAL_DIM            final_dim
+
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[15]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    // declare rules for record_t.missing, it is never set
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_HOLDER_TYPE   record_t
+    #define YAJP_DESERIALIZATION_STRUCT_FIELD_NAME          missing
+    #define YAJP_DESERIALIZATION_FIELD_TYPE                 (YAJP_DESERIALIZATION_TYPE_STRING)
+    #define YAJP_DESERIALIZATION_OPTIONS                    (YAJP_DESERIALIZATION_OPTIONS_ALLOCATE)
+    #define YAJP_DESERIALIZATION_SETTER                     yajp_set_string
+    #define YAJP_DESERIALIZATION_RULE                       &contexts->record_rules[16]
+    #define YAJP_DESERIALIZATION_RULE_INIT_RESULT           ret
+    #include <yajp/deserialization_action_initialization.h>
+    if (0 != ret) {
+        return ret;
+    }
+    // ==========================================
+
+    return yajp_deserialization_context_init(contexts->record_rules, ARR_LEN(contexts->record_rules), &contexts->record);
+}
+
+static void release_contexts(contexts_t *contexts) {
+    yajp_deserialization_context_release(&contexts->record);
+    yajp_deserialization_context_release(&contexts->point);
+    yajp_deserialization_enum_release(&contexts->colors);
+}
+
+static test_result_t yajp_serialize_json_test_round_trip() {
+    contexts_t contexts;
+    record_t record, copy;
+    char *json;
+    size_t json_size;
+    int ret;
+
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    memset(&record, 0, sizeof(record));
+    ret = yajp_deserialize_json_string(record_js, sizeof(record_js) - 1, &contexts.record, &record, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+
+    ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+    test_is_equal(json_size, sizeof(record_js) - 1, "Expected size %zu, got %zu", sizeof(record_js) - 1, json_size);
+    test_is_equal(strcmp(json, record_js), 0, "Unexpected document %s", json);
+
+    // written document is deserialized into the same structure
+    memset(&copy, 0, sizeof(copy));
+    ret = yajp_deserialize_json_string(json, json_size, &contexts.record, &copy, NULL);
+    test_is_equal(ret, 0, "Written document can't be deserialized");
+    test_is_equal(copy.big, record.big, "Expected %lld, got %lld", record.big, copy.big);
+    test_is_equal(copy.ratio, record.ratio, "Double value wasn't read back exactly");
+    test_is_equal(copy.weight, record.weight, "Float value wasn't read back exactly");
+    test_is_equal(copy.created, record.created, "Timestamp wasn't read back exactly");
+    test_is_equal(copy.payload_size, 4, "Expected 4 bytes of payload, got %zu", copy.payload_size);
+    test_is_equal(memcmp(copy.payload, record.payload, 4), 0, "Payload wasn't read back exactly");
+    test_is_equal(copy.matrix.count, 3, "Expected 3 rows, got %zu", copy.matrix.count);
+    test_is_equal(copy.matrix.rows[2].count, 0, "Empty row wasn't read back");
+    test_is_null(copy.missing, "Omitted field was set");
+
+    free(json);
+    yajp_deserialization_free(&contexts.record, &copy);
+    yajp_deserialization_free(&contexts.record, &record);
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_serialize_json_test_strings() {
+    static const char expected[] = "{\"id\":0,\"big\":0,\"ratio\":0,\"weight\":0,\"active\":false,"
+                                   "\"name\":\"tab\\there \\\"q\\\" back\\\\slash \\u00e9 \\\\x \\u0001\\r\","
+                                   "\"code\":\"1234567\",\"color\":\"red\",\"created\":\"1969-12-31T23:59:59.999999999Z\","
+                                   "\"payload\":\"\",\"corner\":{\"x\":0,\"y\":0},\"values\":[],\"matrix\":[],"
+                                   "\"tags\":[\"\\\"\",\"\\\\\"],\"points\":[]}";
+    char name[] = "tab\there \"q\" back\\slash \\u00e9 \\x \x01\r";
+    char *tags[] = { "\"", "\\" };
+    contexts_t contexts;
+    record_t record;
+    char *json;
+    size_t json_size;
+    int ret;
+
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    // strings filled by program, not by deserialization
+    memset(&record, 0, sizeof(record));
+    record.name = name;
+    memcpy(record.code, "1234567", sizeof(record.code));
+    record.created = -1;
+    record.tags.elems = tags;
+    record.tags.final_dim = true;
+    record.tags.count = ARR_LEN(tags);
+
+    ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+    test_is_equal(strcmp(json, expected), 0, "Unexpected document %s", json);
+
+    memset(&record, 0, sizeof(record));
+    ret = yajp_deserialize_json_string(json, json_size, &contexts.record, &record, NULL);
+    test_is_equal(ret, 0, "Written document can't be deserialized");
+    test_is_equal(record.created, -1, "Timestamp before the epoch wasn't read back");
+
+    free(json);
+    yajp_deserialization_free(&contexts.record, &record);
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_serialize_json_test_stream() {
+#define VALUES_COUNT    100000
+#define NAME_SIZE       (256 * 1024)
+
+    contexts_t contexts;
+    record_t record, copy;
+    FILE *stream;
+    char *json, *written;
+    size_t json_size, written_size, i;
+    int ret;
+
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    // array is written by many blocks of stream buffer, name is bigger than buffer and is written to stream directly
+    memset(&record, 0, sizeof(record));
+    record.values.elems = calloc(VALUES_COUNT, sizeof(int));
+    record.name = malloc(NAME_SIZE + 1);
+    test_is_not_null(record.values.elems, "Failed to allocate array");
+    test_is_not_null(record.name, "Failed to allocate string");
+
+    record.values.final_dim = true;
+    record.values.count = VALUES_COUNT;
+    for (i = 0; i < VALUES_COUNT; i++) {
+        ((int *) record.values.elems)[i] = (int) (i * 7919) - VALUES_COUNT;
+    }
+    memset(record.name, 'n', NAME_SIZE);
+    record.name[NAME_SIZE] = '\0';
+
+    ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization into buffer failed with errno %d", errno);
+
+    stream = tmpfile();
+    test_is_not_null(stream, "Failed to create temporary file");
+
+    ret = yajp_serialize_json_stream(stream, &contexts.record, &record);
+    test_is_equal(ret, 0, "Serialization into stream failed with errno %d", errno);
+
+    written_size = (size_t) ftell(stream);
+    test_is_equal(written_size, json_size, "Expected %zu bytes in stream, got %zu", json_size, written_size);
+
+    written = malloc(written_size);
+    test_is_not_null(written, "Failed to allocate buffer");
+    rewind(stream);
+    test_is_equal(fread(written, 1, written_size, stream), written_size, "Failed to read stream");
+    test_is_equal(memcmp(written, json, json_size), 0, "Stream differs from buffer");
+
+    rewind(stream);
+    memset(&copy, 0, sizeof(copy));
+    ret = yajp_deserialize_json_stream(stream, &contexts.record, &copy, NULL);
+    test_is_equal(ret, 0, "Written document can't be deserialized");
+    test_is_equal(copy.values.count, VALUES_COUNT, "Expected %d values, got %zu", VALUES_COUNT, copy.values.count);
+    test_is_equal(memcmp(copy.values.elems, record.values.elems, VALUES_COUNT * sizeof(int)), 0, "Values differ");
+    test_is_equal(strcmp(copy.name, record.name), 0, "Names differ");
+
+    fclose(stream);
+    free(written);
+    free(json);
+    free(record.values.elems);
+    free(record.name);
+    yajp_deserialization_free(&contexts.record, &copy);
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+
+#undef NAME_SIZE
+#undef VALUES_COUNT
+}
+
+static int custom_setter(const uint8_t *name, size_t name_size, const uint8_t *value, size_t value_size, void *field,
+                         void *user_data) {
+    return yajp_set_int(name, name_size, value, value_size, field, user_data);
+}
+
+typedef struct node node_t;
+struct node {
+    int id;
+    node_t *next;
+};
+
+static test_result_t yajp_serialize_json_test_errors() {
+    yajp_deserialization_context_t custom_ctx, node_ctx;
+    yajp_deserialization_rule_t custom_rules[1], node_rules[2];
+    contexts_t contexts;
+    record_t record;
+    node_t node;
+    char *json = NULL;
+    size_t json_size;
+    int ret;
+
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    errno = 0;
+    ret = yajp_serialize_json_buffer(&contexts.record, NULL, &json, &json_size);
+    test_is_equal(ret, -1, "NULL structure was serialized");
+    test_is_equal(errno, EINVAL, "Expected errno %d, got %d", EINVAL, errno);
+
+    // JSON has no infinities
+    memset(&record, 0, sizeof(record));
+    record.ratio = INFINITY;
+    errno = 0;
+    ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+    test_is_equal(ret, -1, "Infinity was serialized");
+    test_is_equal(errno, EINVAL, "Expected errno %d, got %d", EINVAL, errno);
+    test_is_null(json, "Document was returned on error");
+
+    // enumeration has no item for value
+    record.ratio = 0;
+    record.color = 42;
+    errno = 0;
+    ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+    test_is_equal(ret, -1, "Unknown item of enumeration was serialized");
+    test_is_equal(errno, EINVAL, "Expected errno %d, got %d", EINVAL, errno);
+
+    // C type of field with custom setter is unknown
+    ret = yajp_deserialization_rule_init("id", sizeof("id") - 1, offsetof(node_t, id), sizeof(int),
+                                         YAJP_DESERIALIZATION_TYPE_NUMBER, 0, 0, 0, 0, 0, custom_setter, NULL,
+                                         &custom_rules[0]);
+    test_is_equal(ret, 0, "Failed to initialize rule");
+    test_is_equal(yajp_deserialization_context_init(custom_rules, 1, &custom_ctx), 0, "Failed to initialize context");
+
+    memset(&node, 0, sizeof(node));
+    errno = 0;
+    ret = yajp_serialize_json_buffer(&custom_ctx, &node, &json, &json_size);
+    test_is_equal(ret, -1, "Field with custom setter was serialized");
+    test_is_equal(errno, ENOTSUP, "Expected errno %d, got %d", ENOTSUP, errno);
+
+    // structures linked in cycle are deeper than any maximal depth
+    ret = yajp_deserialization_rule_init("id", sizeof("id") - 1, offsetof(node_t, id), sizeof(int),
+                                         YAJP_DESERIALIZATION_TYPE_NUMBER, 0, 0, 0, 0, 0, yajp_set_int, NULL,
+                                         &node_rules[0]);
+    test_is_equal(ret, 0, "Failed to initialize rule");
+    ret = yajp_deserialization_rule_init("next", sizeof("next") - 1, offsetof(node_t, next), sizeof(node_t),
+                                         YAJP_DESERIALIZATION_TYPE_OBJECT | YAJP_DESERIALIZATION_OPTIONS_ALLOCATE,
+                                         0, 0, 0, 0, 0, NULL, &node_ctx, &node_rules[1]);
+    test_is_equal(ret, 0, "Failed to initialize rule");
+    test_is_equal(yajp_deserialization_context_init(node_rules, 2, &node_ctx), 0, "Failed to initialize context");
+
+    node.next = &node;
+    errno = 0;
+    ret = yajp_serialize_json_buffer(&node_ctx, &node, &json, &json_size);
+    test_is_equal(ret, -1, "Cycle was serialized");
+    test_is_equal(errno, EOVERFLOW, "Expected errno %d, got %d", EOVERFLOW, errno);
+
+    node.next = NULL;
+    ret = yajp_serialize_json_buffer(&node_ctx, &node, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+    test_is_equal(strcmp(json, "{\"id\":0}"), 0, "Unexpected document %s", json);
+    free(json);
+
+    yajp_deserialization_context_release(&node_ctx);
+    yajp_deserialization_context_release(&custom_ctx);
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+}
+
+#define NUMBERS_COUNT   20000
+
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static test_result_t yajp_serialize_json_test_numbers() {
+    static const char expected[] = "{\"id\":-32768,\"big\":-9223372036854775808,\"ratio\":1e+23,\"weight\":0.3,";
+    static const double doubles[] = { 0.1, 1e23, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308, 1e21, 1e-7,
+                                      123456789012345680000.0, 0.000001, 9007199254740993.0, -0.0 };
+    static const char *doubles_js[] = { "0.1", "1e+23", "5e-324", "2.2250738585072014e-308", "1.7976931348623157e+308",
+                                        "1e+21", "1e-7", "123456789012345680000", "0.000001", "9007199254740992", "-0" };
+    contexts_t contexts;
+    record_t record, copy;
+    uint64_t state = 88172645463325252ULL, bits;
+    uint32_t float_bits;
+    char *json, *ratio;
+    size_t json_size, i;
+    int ret;
+
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    memset(&record, 0, sizeof(record));
+    record.id = SHRT_MIN;
+    record.big = LLONG_MIN;
+    record.ratio = 1e23;
+    record.weight = 0.3f;
+
+    ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+    test_is_equal(strncmp(json, expected, sizeof(expected) - 1), 0, "Unexpected document %s", json);
+    free(json);
+
+    for (i = 0; i < ARR_LEN(doubles); i++) {
+        record.ratio = doubles[i];
+        ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+        test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+
+        ratio = strstr(json, "\"ratio\":") + sizeof("\"ratio\":") - 1;
+        test_is_equal(strncmp(ratio, doubles_js[i], strlen(doubles_js[i])), 0, "Expected %s, got %s", doubles_js[i],
+                      ratio);
+        test_is_equal(ratio[strlen(doubles_js[i])], ',', "Expected %s, got %s", doubles_js[i], ratio);
+        free(json);
+    }
+
+    // random bit patterns cover subnormal, big and small numbers, all of them should be read back exactly
+    for (i = 0; i < NUMBERS_COUNT; i++) {
+        do {
+            bits = next_random(&state);
+            memcpy(&record.ratio, &bits, sizeof(record.ratio));
+            float_bits = (uint32_t) bits;
+            memcpy(&record.weight, &float_bits, sizeof(record.weight));
+        } while (!isfinite(record.ratio) || !isfinite(record.weight));
+
+        record.id = (short) bits;
+        record.big = (long long) bits >> (bits & 63);
+
+        ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+        test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+
+        memset(&copy, 0, sizeof(copy));
+        ret = yajp_deserialize_json_string(json, json_size, &contexts.record, &copy, NULL);
+        test_is_equal(ret, 0, "Written document %s can't be deserialized", json);
+        test_is_equal(copy.id, record.id, "Expected %hd, got %hd", record.id, copy.id);
+        test_is_equal(copy.big, record.big, "Expected %lld, got %lld", record.big, copy.big);
+        test_is_equal(memcmp(&copy.ratio, &record.ratio, sizeof(copy.ratio)), 0, "Double %a wasn't read back from %s",
+                      record.ratio, json);
+        test_is_equal(memcmp(&copy.weight, &record.weight, sizeof(copy.weight)), 0, "Float %a wasn't read back from %s",
+                      record.weight, json);
+
+        free(json);
+        yajp_deserialization_free(&contexts.record, &copy);
+    }
+
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+}
+
+/*
+ * Serialize record with name and compare written name with expected one
+ */
+static test_result_t check_written_name(const yajp_deserialization_context_t *ctx, char *name, const char *expected) {
+    static const char prefix[] = "{\"id\":0,\"big\":0,\"ratio\":0,\"weight\":0,\"active\":false,\"name\":\"";
+    record_t record;
+    char *json;
+    size_t json_size, expected_size = strlen(expected);
+    int ret;
+
+    memset(&record, 0, sizeof(record));
+    record.name = name;
+
+    ret = yajp_serialize_json_buffer(ctx, &record, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+    test_is_equal(strncmp(json, prefix, sizeof(prefix) - 1), 0, "Unexpected document %s", json);
+    test_is_equal(strncmp(json + sizeof(prefix) - 1, expected, expected_size), 0, "Expected name %s, got %s", expected,
+                  json + sizeof(prefix) - 1);
+    test_is_equal(strncmp(json + sizeof(prefix) - 1 + expected_size, "\",\"code\"", 8), 0, "Expected name %s, got %s",
+                  expected, json + sizeof(prefix) - 1);
+    free(json);
+
+    return TEST_RESULT_PASSED;
+}
+
+static test_result_t yajp_serialize_json_test_escape_scan() {
+    static const char letters[] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa";
+    static const char *specials[] = { "\"", "\\", "\x1f", "\n", "\xc3\xa9" };
+    static const char *escaped[] = { "\\\"", "\\\\", "\\u001f", "\\n", "\xc3\xa9" };
+    static const char *non_ascii[] = { "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xff", "\xe2\x82", "\xed\xa0\x80",
+                                       "\xc0\xaf", "\\u00e9 is kept" };
+    static const char *non_ascii_escaped[] = { "\\u00e9", "\\u20ac", "\\ud83d\\ude00", "\\ufffd", "\\ufffd\\ufffd",
+                                               "\\ufffd\\ufffd\\ufffd", "\\ufffd\\ufffd", "\\u00e9 is kept" };
+    contexts_t contexts;
+    // room for letters before and after the longest escape sequence, as compiler can't relate both counts
+    char name[2 * sizeof(letters) + 8], expected[2 * sizeof(letters) + 8];
+    size_t length, position, i;
+    test_result_t result;
+
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    // character is found at every position of the first blocks and of the tail
+    for (i = 0; i < ARR_LEN(specials); i++) {
+        for (length = 1; length <= 40; length++) {
+            for (position = 0; position < length; position++) {
+                // non-ASCII characters are written as they are by default
+                snprintf(name, sizeof(name), "%.*s%s%.*s", (int) position, letters, specials[i],
+                         (int) (length - position - 1), letters);
+                snprintf(expected, sizeof(expected), "%.*s%s%.*s", (int) position, letters,
+                         escaped[i], (int) (length - position - 1), letters);
+
+                result = check_written_name(&contexts.record, name, expected);
+                if (TEST_RESULT_PASSED != result) {
+                    return result;
+                }
+            }
+        }
+    }
+
+    test_is_equal(yajp_serialization_context_set_escape_non_ascii(&contexts.record, true), 0,
+                  "Failed to set escaping of non-ASCII characters");
+
+    for (i = 0; i < ARR_LEN(non_ascii); i++) {
+        // character is the last one of the first block
+        snprintf(name, sizeof(name), "%.15s%s", letters, non_ascii[i]);
+        snprintf(expected, sizeof(expected), "%.15s%s", letters, non_ascii_escaped[i]);
+
+        result = check_written_name(&contexts.record, name, expected);
+        if (TEST_RESULT_PASSED != result) {
+            return result;
+        }
+    }
+
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+}
+
+#define CHAIN_NAME_SIZE     100000
+#define CHAIN_TAGS_COUNT    600
+#define CHAIN_TAG_SIZE      600
+
+static test_result_t yajp_serialize_json_test_chain() {
+    contexts_t contexts;
+    record_t record;
+    yajp_serialization_chain_t chain;
+    char *name = malloc(CHAIN_NAME_SIZE + 1), *tag = malloc(CHAIN_TAG_SIZE + 1), *tags[CHAIN_TAGS_COUNT], *json, *read;
+    size_t json_size, offset = 0, referenced = 0, i;
+    FILE *file;
+    int ret;
+
+    test_is_not_null(name, "Failed to allocate name");
+    test_is_not_null(tag, "Failed to allocate tag");
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    // long name has escape sequence in the middle, so it's referenced by two segments
+    memset(name, 'n', CHAIN_NAME_SIZE);
+    name[CHAIN_NAME_SIZE / 2] = '"';
+    name[CHAIN_NAME_SIZE] = '\0';
+    memset(tag, 't', CHAIN_TAG_SIZE);
+    tag[CHAIN_TAG_SIZE] = '\0';
+    for (i = 0; i < CHAIN_TAGS_COUNT; i++) {
+        tags[i] = (0 == i % 2) ? tag : "short";
+    }
+
+    memset(&record, 0, sizeof(record));
+    record.name = name;
+    record.tags.elems = tags;
+    record.tags.final_dim = true;
+    record.tags.count = CHAIN_TAGS_COUNT;
+
+    ret = yajp_serialize_json_buffer(&contexts.record, &record, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+
+    ret = yajp_serialize_json_chain(&contexts.record, &record, YAJP_SERIALIZATION_DEFAULT_REFERENCE_SIZE, &chain);
+    test_is_equal(ret, 0, "Serialization into chain failed with errno %d", errno);
+    test_is_equal(chain.size, json_size, "Expected %zu bytes, got %zu", json_size, chain.size);
+
+    // segments hold the same document, long strings aren't copied
+    for (i = 0; i < chain.count; i++) {
+        test_is_gt(chain.segments[i].iov_len, 0, "Segment %zu is empty", i);
+        test_is_equal(memcmp(json + offset, chain.segments[i].iov_base, chain.segments[i].iov_len), 0,
+                      "Segment %zu differs from document", i);
+        offset += chain.segments[i].iov_len;
+
+        if (chain.segments[i].iov_base == name || chain.segments[i].iov_base == name + CHAIN_NAME_SIZE / 2 + 1 ||
+            chain.segments[i].iov_base == tag) {
+            referenced++;
+        }
+    }
+    test_is_equal(referenced, 2 + CHAIN_TAGS_COUNT / 2, "Expected %d referenced segments, got %zu",
+                  2 + CHAIN_TAGS_COUNT / 2, referenced);
+    test_is_gt(chain.count, 256, "Chain of %zu segments is written by one call", chain.count);
+
+    file = tmpfile();
+    test_is_not_null(file, "Failed to create file");
+    ret = yajp_serialization_chain_write(fileno(file), &chain);
+    test_is_equal(ret, 0, "Chain wasn't written, errno %d", errno);
+
+    read = malloc(json_size);
+    test_is_not_null(read, "Failed to allocate memory");
+    rewind(file);
+    test_is_equal(fread(read, 1, json_size, file), json_size, "File is shorter than document");
+    test_is_equal(memcmp(read, json, json_size), 0, "Written chain differs from document");
+    fclose(file);
+    free(read);
+    yajp_serialization_chain_release(&chain);
+    test_is_null(chain.segments, "Released chain still has segments");
+
+    // all strings are copied into blocks
+    ret = yajp_serialize_json_chain(&contexts.record, &record, SIZE_MAX, &chain);
+    test_is_equal(ret, 0, "Serialization into chain failed with errno %d", errno);
+    test_is_equal(chain.size, json_size, "Expected %zu bytes, got %zu", json_size, chain.size);
+    for (i = 0, offset = 0; i < chain.count; i++) {
+        test_is_equal(memcmp(json + offset, chain.segments[i].iov_base, chain.segments[i].iov_len), 0,
+                      "Segment %zu differs from document", i);
+        offset += chain.segments[i].iov_len;
+    }
+    yajp_serialization_chain_release(&chain);
+
+    errno = 0;
+    ret = yajp_serialize_json_chain(&contexts.record, NULL, 0, &chain);
+    test_is_equal(ret, -1, "NULL structure was serialized");
+    test_is_equal(errno, EINVAL, "Expected errno %d, got %d", EINVAL, errno);
+    test_is_null(chain.segments, "Chain was returned on error");
+
+    free(json);
+    free(name);
+    free(tag);
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+}
+
+/*
+ * Serialize record by both passes and compare document with one grown geometrically
+ */
+static test_result_t check_exact_size(yajp_deserialization_context_t *ctx, const record_t *record) {
+    char *json, *exact, *into;
+    size_t json_size, exact_size, measured_size, into_size;
+    int ret;
+
+    test_is_equal(yajp_serialization_context_set_exact_size(ctx, false), 0, "Failed to reset exact size mode");
+    ret = yajp_serialize_json_buffer(ctx, record, &json, &json_size);
+    test_is_equal(ret, 0, "Serialization failed with errno %d", errno);
+
+    test_is_equal(yajp_serialization_context_set_exact_size(ctx, true), 0, "Failed to set exact size mode");
+    ret = yajp_serialize_json_buffer(ctx, record, &exact, &exact_size);
+    test_is_equal(ret, 0, "Serialization of exact size failed with errno %d", errno);
+    test_is_equal(exact_size, json_size, "Expected size %zu, got %zu", json_size, exact_size);
+    test_is_equal(strcmp(exact, json), 0, "Unexpected document %s", exact);
+
+    ret = yajp_serialize_json_size(ctx, record, &measured_size);
+    test_is_equal(ret, 0, "Measuring failed with errno %d", errno);
+    test_is_equal(measured_size, json_size, "Expected size %zu, got %zu", json_size, measured_size);
+
+    // buffer of caller isn't terminated by '\0', byte after document stays untouched
+    into = malloc(json_size + 1);
+    test_is_not_null(into, "Failed to allocate buffer");
+    into[json_size] = '#';
+    ret = yajp_serialize_json_into(ctx, record, into, json_size, &into_size);
+    test_is_equal(ret, 0, "Serialization into buffer failed with errno %d", errno);
+    test_is_equal(into_size, json_size, "Expected size %zu, got %zu", json_size, into_size);
+    test_is_equal(memcmp(into, json, json_size), 0, "Unexpected document %.*s", (int) into_size, into);
+    test_is_equal(into[json_size], '#', "Byte after document was written");
+
+    // required size is returned when document doesn't fit
+    errno = 0;
+    into_size = 0;
+    ret = yajp_serialize_json_into(ctx, record, into, json_size - 1, &into_size);
+    test_is_equal(ret, -1, "Document was written into short buffer");
+    test_is_equal(errno, ERANGE, "Expected errno %d, got %d", ERANGE, errno);
+    test_is_equal(into_size, json_size, "Expected required size %zu, got %zu", json_size, into_size);
+
+    free(into);
+    free(exact);
+    free(json);
+
+    return TEST_RESULT_PASSED;
+}
+
+#define EXACT_TAGS_COUNT    1000
+
+static test_result_t yajp_serialize_json_test_exact_size() {
+    char name[] = "tab\there \"q\" \xc3\xa9 \xf0\x9f\x98\x80 \x01";
+    char *tags[EXACT_TAGS_COUNT], tag[8][32];
+    contexts_t contexts;
+    record_t record;
+    size_t json_size, i;
+    test_result_t result;
+    int ret;
+
+    test_is_equal(init_contexts(&contexts), 0, "Failed to initialize contexts");
+
+    memset(&record, 0, sizeof(record));
+    ret = yajp_deserialize_json_string(record_js, sizeof(record_js) - 1, &contexts.record, &record, NULL);
+    test_is_equal(ret, 0, "Deserialization failed");
+    result = check_exact_size(&contexts.record, &record);
+    if (TEST_RESULT_PASSED != result) {
+        return result;
+    }
+    yajp_deserialization_free(&contexts.record, &record);
+
+    // strings with and without characters to escape, cache outgrows its initial capacity
+    for (i = 0; i < ARR_LEN(tag); i++) {
+        snprintf(tag[i], sizeof(tag[i]), "%s tag %zu", (0 == i % 2) ? "plain" : "\"quoted\"\n", i);
+    }
+    for (i = 0; i < EXACT_TAGS_COUNT; i++) {
+        tags[i] = tag[i % ARR_LEN(tag)];
+    }
+    memset(&record, 0, sizeof(record));
+    record.name = name;
+    record.ratio = 0.1 * 3;
+    record.weight = 3.4028235e38f;
+    record.tags.elems = tags;
+    record.tags.final_dim = true;
+    record.tags.count = EXACT_TAGS_COUNT;
+
+    result = check_exact_size(&contexts.record, &record);
+    if (TEST_RESULT_PASSED != result) {
+        return result;
+    }
+
+    test_is_equal(yajp_serialization_context_set_escape_non_ascii(&contexts.record, true), 0,
+                  "Failed to set escaping of non-ASCII characters");
+    result = check_exact_size(&contexts.record, &record);
+    if (TEST_RESULT_PASSED != result) {
+        return result;
+    }
+
+    errno = 0;
+    ret = yajp_serialize_json_size(&contexts.record, NULL, &json_size);
+    test_is_equal(ret, -1, "NULL structure was measured");
+    test_is_equal(errno, EINVAL, "Expected errno %d, got %d", EINVAL, errno);
+
+    release_contexts(&contexts);
+
+    return TEST_RESULT_PASSED;
+}
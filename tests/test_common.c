@@ -26,6 +26,31 @@
 
 #include "test_common.h"
 
+void *counting_alloc(size_t size, void *user) {
+    __atomic_fetch_add(&((counting_allocator_stat_t *) user)->allocations, 1, __ATOMIC_RELAXED);
+    return malloc(size);
+}
+
+void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *user) {
+    (void) old_size;
+
+    if (NULL == ptr) {
+        __atomic_fetch_add(&((counting_allocator_stat_t *) user)->allocations, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&((counting_allocator_stat_t *) user)->reallocations, 1, __ATOMIC_RELAXED);
+    }
+    return realloc(ptr, new_size);
+}
+
+void counting_free(void *ptr, void *user) {
+    if (NULL != ptr) {
+        __atomic_fetch_add(&((counting_allocator_stat_t *) user)->releases, 1, __ATOMIC_RELAXED);
+    }
+    free(ptr);
+}
+
+#ifndef TEST_COMMON_WITHOUT_RUNNER
+
 static int read_test_number(const char *num_str, long *test_num) {
     char *end;
     long result;
@@ -100,4 +125,6 @@ int main(int argc, char **argv) {
     }
 
     return run_test(test_num);
-}
\ No newline at end of file
+}
+
+#endif // TEST_COMMON_WITHOUT_RUNNER
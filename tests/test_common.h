@@ -220,6 +220,23 @@ extern const test_case_t test_suite[];
  */
 #define FUNC_NAME(val) STRINGIFY(val)"()"
 
+/**
+ * Statistics of counting allocator. Counters are updated atomically, so allocator can be shared by threads
+ */
+typedef struct {
+    size_t allocations;     /* Amount of allocations, including reallocations of NULL */
+    size_t reallocations;   /* Amount of resizes of allocated memory */
+    size_t releases;        /* Amount of releases of allocated memory */
+} counting_allocator_stat_t;
+
+/**
+ * Functions of allocator what counts its calls in @c counting_allocator_stat_t passed as user pointer and takes
+ * memory from heap, i.e. { counting_alloc, counting_realloc, counting_free, &stat }
+ */
+void *counting_alloc(size_t size, void *user);
+void *counting_realloc(void *ptr, size_t old_size, size_t new_size, void *user);
+void counting_free(void *ptr, void *user);
+
 /**
  * Returns length of array
  */